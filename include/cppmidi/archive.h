@@ -0,0 +1,323 @@
+/**
+ * archive.h
+ *
+ * Classes to store many MIDI files together in a single archive. Files are grouped into
+ * blocks, and within a block the events of all its files are stored column by column:
+ * the delta times as variable length values, and the status and data bytes each in their
+ * own column as differences from a prediction, so that similar events produce the same
+ * bytes. Every column is then compressed separately with a Huffman code. Texts of meta
+ * events, such as track and instrument names, are stored only once for the whole archive
+ * in a shared dictionary.
+ *
+ * An index of the blocks at the end of the archive makes it possible to read any single
+ * file by decoding only the block that holds it, while reading all the files in order
+ * decodes every block exactly once.
+ *
+ * Unlike caches, archives are stored in a fixed (little endian) byte order.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_ARCHIVE_h
+#define MIDI_ARCHIVE_h
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <unordered_map>
+#include <cstdint>
+#include <cppmidi/file.h>
+#include <cppmidi/status.h>
+#include <cppmidi/columns.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    class Archive {
+        public:
+            /**
+             * The identifier at the start and at the end of every archive.
+             * @var const static char*
+             */
+            const static char* IDENTIFIER;
+
+            /**
+             * The current version of the format.
+             * @var const static uint32_t
+             */
+            const static uint32_t VERSION = 1;
+
+            /**
+             * The size of the trailer at the very end of the archive.
+             * @var const static size_t
+             */
+            const static size_t TRAILER_SIZE = 40;
+
+            /**
+             * The position of a block in the archive.
+             */
+            struct Block {
+                /**
+                 * The offset and size of the block in the archive.
+                 * @var uint64_t
+                 */
+                uint64_t offset;
+                uint64_t size;
+
+                /**
+                 * The index of the first file in the block, and the amount of files.
+                 * @var uint64_t
+                 */
+                uint64_t first;
+                uint64_t count;
+
+                /**
+                 * The FNV-1a hash of the block, to detect damage.
+                 * @var uint64_t
+                 */
+                uint64_t hash;
+            };
+    };
+
+    class ArchiveWriter {
+        public:
+            /**
+             * Constructor, which writes the start of the archive.
+             * @param output    The output stream, which should be in binary mode.
+             * @param blockSize The amount of encoded bytes after which a block is finished.
+             */
+            ArchiveWriter(std::ostream& output, size_t blockSize = 1 << 20);
+
+            /**
+             * Destructor, which closes the archive if that was not done yet.
+             */
+            virtual ~ArchiveWriter() { close(); }
+
+            /**
+             * Method to add a file to the archive.
+             * @param file The file.
+             * @param name The name of the file, such as its original path.
+             * @return bool False if the archive was already closed or writing failed.
+             */
+            bool add(const File& file, const std::string& name = "");
+
+            /**
+             * Method to finish the archive, by writing the last block, the dictionary and
+             * the index. Nothing can be added afterwards.
+             * @return bool False if writing failed.
+             */
+            bool close();
+
+            /**
+             * Method to get the amount of files added so far.
+             * @return uint64_t The amount of files.
+             */
+            uint64_t size() const { return _files; }
+
+        private:
+            /**
+             * Method to encode the current block and write it.
+             */
+            void flush();
+
+            /**
+             * Method to add a text to the dictionary.
+             * @param data The text.
+             * @param size The length of the text.
+             * @return uint32_t The index in the dictionary.
+             */
+            uint32_t intern(const uint8_t *data, size_t size);
+
+            /**
+             * The output stream.
+             * @var std::ostream&
+             */
+            std::ostream& _output;
+
+            /**
+             * The amount of encoded bytes after which a block is finished.
+             * @var size_t
+             */
+            size_t _blockSize;
+
+            /**
+             * The offset of the next block, relative to the start of the archive.
+             * @var uint64_t
+             */
+            uint64_t _offset;
+
+            /**
+             * The amount of files added so far.
+             * @var uint64_t
+             */
+            uint64_t _files;
+
+            /**
+             * The columns of the current block, see the implementation for the layout.
+             * @var std::vector<uint8_t>
+             */
+            std::vector<uint8_t> _columns[6];
+
+            /**
+             * The status bytes, most recently used first.
+             * @var uint8_t[256]
+             */
+            uint8_t _order[256];
+
+            /**
+             * The previous data bytes after every status byte.
+             * @var uint8_t[2][256]
+             */
+            uint8_t _previous[2][256];
+
+            /**
+             * The length of the current run of correctly predicted bytes, for the status
+             * and both data columns.
+             * @var uint32_t[3]
+             */
+            uint32_t _run[3];
+
+            /**
+             * The amount of files in the current block.
+             * @var uint64_t
+             */
+            uint64_t _blockFiles;
+
+            /**
+             * The finished blocks.
+             * @var std::vector<Archive::Block>
+             */
+            std::vector<Archive::Block> _blocks;
+
+            /**
+             * The texts in the dictionary, and their index.
+             * @var std::vector<std::string>, std::unordered_map<std::string, uint32_t>
+             */
+            std::vector<std::string> _dictionary;
+            std::unordered_map<std::string, uint32_t> _lookup;
+
+            /**
+             * Whether the archive was closed.
+             * @var bool
+             */
+            bool _closed;
+    };
+
+    class ArchiveReader {
+        public:
+            /**
+             * Default constructor, for a reader without an archive.
+             */
+            ArchiveReader() : _input(NULL), _start(0), _files(0), _loaded(-1) {}
+
+            /**
+             * Destructor
+             */
+            virtual ~ArchiveReader() {}
+
+            /**
+             * Method to open an archive, reading its index and dictionary. The stream has to be
+             * seekable, in binary mode, and stay open for as long as the reader is used.
+             * @param input The input stream, positioned at the start of the archive.
+             * @return Status ERROR_IO or ERROR_ARCHIVE_FORMAT on failure.
+             */
+            Status open(std::istream& input);
+
+            /**
+             * Method to get the amount of files in the archive.
+             * @return uint64_t The amount of files.
+             */
+            uint64_t size() const { return _files; }
+
+            /**
+             * Method to get the blocks of the archive.
+             * @return const std::vector<Archive::Block>& The blocks.
+             */
+            const std::vector<Archive::Block>& getBlocks() const { return _blocks; }
+
+            /**
+             * Method to read a single file. Only the block holding the file is decoded, and
+             * it is kept until a file from another block is read.
+             * @param index The index of the file.
+             * @param file  The file to fill.
+             * @param name  If not NULL, this is set to the name of the file.
+             * @return Status ERROR_IO or ERROR_ARCHIVE_FORMAT on failure.
+             */
+            Status read(uint64_t index, File& file, std::string *name = NULL);
+
+            /**
+             * Method to read all the files in order, decoding every block once.
+             * @param callback Callable which accepts the index, the name and a File&.
+             * @return Status The first error, after which reading stops.
+             */
+            template <typename Callback>
+            Status scan(Callback callback) {
+                File file;
+
+                for (uint64_t i = 0; i < _files; i++) {
+                    std::string name;
+                    Status status = read(i, file, &name);
+                    if (!status.ok())
+                        return status;
+
+                    callback(i, name, file);
+                }
+
+                return Status();
+            }
+
+        private:
+            /**
+             * Method to decode a block, unless it is the block that was decoded last.
+             * @param block The index of the block.
+             * @return Status ERROR_IO or ERROR_ARCHIVE_FORMAT on failure.
+             */
+            Status load(size_t block);
+
+            /**
+             * The input stream.
+             * @var std::istream*
+             */
+            std::istream *_input;
+
+            /**
+             * The offset in the input stream where the archive starts.
+             * @var uint64_t
+             */
+            uint64_t _start;
+
+            /**
+             * The amount of files in the archive.
+             * @var uint64_t
+             */
+            uint64_t _files;
+
+            /**
+             * The blocks of the archive.
+             * @var std::vector<Archive::Block>
+             */
+            std::vector<Archive::Block> _blocks;
+
+            /**
+             * The shared dictionary of texts.
+             * @var std::vector<Payload>
+             */
+            std::vector<Payload> _dictionary;
+
+            /**
+             * The index of the decoded block, -1 if none.
+             * @var int64_t
+             */
+            int64_t _loaded;
+
+            /**
+             * The files and names of the decoded block.
+             * @var std::vector<EventColumns>, std::vector<std::string>
+             */
+            std::vector<EventColumns> _columns;
+            std::vector<std::string> _names;
+    };
+}
+
+#endif
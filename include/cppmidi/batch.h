@@ -0,0 +1,230 @@
+/**
+ * batch.h
+ *
+ * Class to decode many MIDI files at once, such as whole directory trees. The files are
+ * decoded on a work-stealing thread pool, and every decoded file is handed to a callback.
+ * Large files are split up further, with each of their tracks decoded as a separate task,
+ * so a single huge file does not keep one worker busy while the others are idle.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_BATCH_h
+#define MIDI_BATCH_h
+
+#include <string>
+#include <vector>
+#include <set>
+#include <utility>
+#include <functional>
+#include <cstdint>
+#include <cppmidi/file.h>
+#include <cppmidi/status.h>
+#include <cppmidi/decoder.h>
+#include <cppmidi/threadpool.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    class BatchOptions {
+        public:
+            /**
+             * Default constructor, with the defaults.
+             */
+            BatchOptions() : threads(0), splitSize(1 << 20), recursive(true) {}
+
+            /**
+             * The options to decode every file with.
+             * @var DecodeOptions
+             */
+            DecodeOptions decode;
+
+            /**
+             * The amount of worker threads, 0 for one per hardware thread.
+             * @var unsigned
+             */
+            unsigned threads;
+
+            /**
+             * The size in bytes from which a file is decoded with a task per track.
+             * @var size_t
+             */
+            size_t splitSize;
+
+            /**
+             * Whether subdirectories are searched as well.
+             * @var bool
+             */
+            bool recursive;
+    };
+
+    class BatchStats {
+        public:
+            /**
+             * Default constructor, for a batch without any files.
+             */
+            BatchStats() : files(0), failed(0), tracks(0), events(0), bytes(0), seconds(0) {}
+
+            /**
+             * Method to get the amount of input that was processed per second.
+             * @return double The throughput in bytes per second.
+             */
+            double throughput() const { return seconds > 0 ? bytes / seconds : 0; }
+
+            /**
+             * The amount of files that were processed, including the failed ones.
+             * @var size_t
+             */
+            size_t files;
+
+            /**
+             * The amount of files that could not be read or decoded without errors.
+             * @var size_t
+             */
+            size_t failed;
+
+            /**
+             * The amount of decoded tracks and events.
+             * @var size_t
+             */
+            size_t tracks;
+            size_t events;
+
+            /**
+             * The amount of bytes that were read.
+             * @var uint64_t
+             */
+            uint64_t bytes;
+
+            /**
+             * The time the batch took in total.
+             * @var double
+             */
+            double seconds;
+
+            /**
+             * The path and error of every file that failed.
+             * @var std::vector<std::pair<std::string, Status>>
+             */
+            std::vector<std::pair<std::string, Status>> failures;
+    };
+
+    class Batch {
+        public:
+            /**
+             * The type of the callback, which is called once for every file, from one of the
+             * worker threads. Several calls can thus run at the same time. The file is destroyed
+             * when the callback returns, so anything that should outlive it has to be moved out.
+             * Files that failed are passed as well, with as many tracks as could be recovered.
+             */
+            typedef std::function<void(const std::string& path, File& file, const DecodeResult& result)> Callback;
+
+            /**
+             * Constructor, which starts the worker threads.
+             * @param options The options for the batch.
+             */
+            Batch(const BatchOptions& options = BatchOptions()) : _options(options), _pool(options.threads) {}
+
+            /**
+             * Destructor
+             */
+            virtual ~Batch() {}
+
+            /**
+             * Method to decode all the MIDI files in a directory. Decoding starts while the
+             * directory is still being searched.
+             * @param directory The directory.
+             * @param callback  The callback for every file.
+             * @return BatchStats The statistics of the batch.
+             */
+            BatchStats run(const std::string& directory, const Callback& callback);
+
+            /**
+             * Method to decode a list of files.
+             * @param paths    The paths of the files.
+             * @param callback The callback for every file.
+             * @return BatchStats The statistics of the batch.
+             */
+            BatchStats run(const std::vector<std::string>& paths, const Callback& callback);
+
+            /**
+             * Method to find all the MIDI files in a directory, by their extension.
+             * @param directory The directory.
+             * @param paths     The paths of the found files are appended to this.
+             * @param recursive Whether subdirectories are searched as well.
+             * @return bool False if the directory could not be opened.
+             */
+            static bool list(const std::string& directory, std::vector<std::string>& paths, bool recursive = true);
+
+            /**
+             * Method to check whether a filename has the extension of a MIDI file, being .mid,
+             * .midi, .smf or .kar in any case.
+             * @param name The filename.
+             * @return bool True if it is a MIDI file.
+             */
+            static bool isMidiFile(const std::string& name);
+
+        private:
+            /**
+             * Shared state of the files in a single run.
+             */
+            struct Run;
+
+            /**
+             * Method to search a directory and call a function for every MIDI file.
+             * @param directory The directory.
+             * @param recursive Whether subdirectories are searched as well.
+             * @param found     The function to call with the path of every file.
+             * @return bool False if the directory could not be opened.
+             */
+            static bool walk(const std::string& directory, bool recursive, const std::function<void(const std::string&)>& found);
+
+            /**
+             * Method to search a directory, unless it was searched already. Links can lead to the
+             * same directory along several paths, or back into a directory being searched.
+             * @param directory The directory.
+             * @param recursive Whether subdirectories are searched as well.
+             * @param found     The function to call with the path of every file.
+             * @param visited   The device and inode of every directory that was searched.
+             * @return bool False if the directory could not be opened.
+             */
+            static bool walk(const std::string& directory, bool recursive, const std::function<void(const std::string&)>& found,
+                std::set<std::pair<uint64_t, uint64_t>>& visited);
+
+            /**
+             * Method to schedule the decoding of a single file.
+             * @param run  The run the file belongs to.
+             * @param path The path of the file.
+             */
+            void schedule(const std::shared_ptr<Run>& run, const std::string& path);
+
+            /**
+             * Method to read, decode and pass on a single file, which runs on a worker.
+             * @param run  The run the file belongs to.
+             * @param path The path of the file.
+             */
+            void process(const std::shared_ptr<Run>& run, const std::string& path);
+
+            /**
+             * Method to finish the run by waiting for all the files.
+             * @param run The run.
+             * @return BatchStats The statistics of the run.
+             */
+            BatchStats finish(const std::shared_ptr<Run>& run);
+
+            /**
+             * The options for the batch.
+             * @var BatchOptions
+             */
+            BatchOptions _options;
+
+            /**
+             * The workers.
+             * @var ThreadPool
+             */
+            ThreadPool _pool;
+    };
+}
+
+#endif
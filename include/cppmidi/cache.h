@@ -0,0 +1,411 @@
+/**
+ * cache.h
+ *
+ * Classes for a binary cache of decoded MIDI files. A cache stores the events column by
+ * column with absolute ticks, together with the tempo map and some information about every
+ * track, so it can be used directly without decoding anything. Every section is aligned
+ * and stored in the byte order of the machine that wrote it, which means a cache can be
+ * memory mapped and its columns used in place: opening one takes the same time no matter
+ * how large it is.
+ *
+ * The cache remembers the size, modification time and hash of the MIDI file it was built
+ * from, so it can be thrown away once the source changes. A cache from a different version
+ * or a machine with a different byte order is simply rejected, and should be rebuilt.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_CACHE_h
+#define MIDI_CACHE_h
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <cppmidi/file.h>
+#include <cppmidi/status.h>
+#include <cppmidi/payload.h>
+#include <cppmidi/columns.h>
+#include <cppmidi/tempomap.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    /**
+     * The header at the start of every cache. All offsets are in bytes from the start of
+     * the cache, and aligned to 8 bytes.
+     */
+    struct CacheHeader {
+        /**
+         * The identifier of a cache, "MIDICach".
+         * @var char[8]
+         */
+        char magic[8];
+
+        /**
+         * The version of the format.
+         * @var uint32_t
+         */
+        uint32_t version;
+
+        /**
+         * The value 0x01020304, to recognize caches from machines with another byte order.
+         * @var uint32_t
+         */
+        uint32_t byteOrder;
+
+        /**
+         * The size, modification time in seconds and FNV-1a hash of the source file.
+         * @var uint64_t
+         */
+        uint64_t sourceSize;
+        int64_t sourceModified;
+        uint64_t sourceHash;
+
+        /**
+         * The file format and division from the header of the source.
+         * @var uint16_t
+         */
+        uint16_t format;
+        uint16_t division;
+
+        /**
+         * The amount of tracks.
+         * @var uint32_t
+         */
+        uint32_t tracks;
+
+        /**
+         * The amount of events, payloads, payload bytes and tempo changes.
+         * @var uint64_t
+         */
+        uint64_t events;
+        uint64_t payloads;
+        uint64_t payloadBytes;
+        uint64_t tempos;
+
+        /**
+         * The offsets of all the sections.
+         * @var uint64_t
+         */
+        uint64_t trackOffset;
+        uint64_t tickOffset;
+        uint64_t statusOffset;
+        uint64_t data1Offset;
+        uint64_t data2Offset;
+        uint64_t payloadOffset;
+        uint64_t sliceOffset;
+        uint64_t tempoOffset;
+        uint64_t bytesOffset;
+
+        /**
+         * The total size of the cache.
+         * @var uint64_t
+         */
+        uint64_t size;
+    };
+
+    /**
+     * The information about a single track.
+     */
+    struct CacheTrack {
+        /**
+         * The index of the first event, and the amount of events.
+         * @var uint64_t
+         */
+        uint64_t first;
+        uint64_t count;
+
+        /**
+         * The tick of the last event.
+         * @var uint32_t
+         */
+        uint32_t endTick;
+
+        /**
+         * The index of the payload with the name of the track, NO_PAYLOAD without a name.
+         * @var uint32_t
+         */
+        uint32_t name;
+
+        /**
+         * Bit mask with the channels that have messages in this track.
+         * @var uint16_t
+         */
+        uint16_t channels;
+
+        /**
+         * Unused, always 0.
+         * @var uint16_t
+         */
+        uint16_t reserved;
+
+        /**
+         * The amount of notes that are turned on in this track.
+         * @var uint32_t
+         */
+        uint32_t notes;
+    };
+
+    /**
+     * The position of a single payload within the payload bytes.
+     */
+    struct CacheSlice {
+        /**
+         * The offset within the payload bytes.
+         * @var uint64_t
+         */
+        uint64_t offset;
+
+        /**
+         * The amount of bytes.
+         * @var uint64_t
+         */
+        uint64_t size;
+    };
+
+    /**
+     * The size, modification time and hash of a source file.
+     */
+    struct CacheSource {
+        /**
+         * The size in bytes.
+         * @var uint64_t
+         */
+        uint64_t size;
+
+        /**
+         * The modification time in seconds.
+         * @var int64_t
+         */
+        int64_t modified;
+
+        /**
+         * The FNV-1a hash of the contents.
+         * @var uint64_t
+         */
+        uint64_t hash;
+    };
+
+    class CacheView {
+        public:
+            /**
+             * Default constructor, for a view without a cache.
+             */
+            CacheView() : _data(NULL), _size(0) {}
+
+            /**
+             * Destructor, which unmaps the cache.
+             */
+            virtual ~CacheView() { close(); }
+
+            /**
+             * Method to open a cache by mapping it into memory. Only the header is checked,
+             * so this does not depend on the size of the cache.
+             * @param path The path of the cache.
+             * @return Status ERROR_IO, ERROR_CACHE_FORMAT or ERROR_CACHE_VERSION on failure.
+             */
+            Status open(const std::string& path);
+
+            /**
+             * Method to use a cache that is already in memory. The memory has to be aligned to
+             * 8 bytes and outlive the view.
+             * @param data The bytes of the cache.
+             * @param size The amount of bytes.
+             * @return Status ERROR_CACHE_FORMAT or ERROR_CACHE_VERSION on failure.
+             */
+            Status open(const uint8_t *data, size_t size);
+
+            /**
+             * Method to close the cache.
+             */
+            void close();
+
+            /**
+             * Method to check if a cache is open.
+             * @return bool True if open.
+             */
+            bool isOpen() const { return _data != NULL; }
+
+            /**
+             * Method to cheaply check if a source file did not change since the cache was
+             * built, by comparing its size and modification time.
+             * @param path The path of the source file.
+             * @return bool True if the source seems unchanged.
+             */
+            bool isFresh(const std::string& path) const;
+
+            /**
+             * Method to check if the cache was built from exactly these bytes.
+             * @param data The bytes of the source file.
+             * @param size The amount of bytes.
+             * @return bool True if the size and hash match.
+             */
+            bool matches(const uint8_t *data, size_t size) const;
+
+            /**
+             * Method to get the header of the cache.
+             * @return const CacheHeader& The header.
+             */
+            const CacheHeader& getHeader() const { return *reinterpret_cast<const CacheHeader*>(_data); }
+
+            /**
+             * Method to get the amount of events.
+             * @return size_t The amount of events.
+             */
+            size_t size() const { return getHeader().events; }
+
+            /**
+             * Method to get the amount of tracks.
+             * @return size_t The amount of tracks.
+             */
+            size_t getTrackCount() const { return getHeader().tracks; }
+
+            /**
+             * Method to get the information about a track.
+             * @param i The index of the track.
+             * @return const CacheTrack& The track.
+             */
+            const CacheTrack& getTrack(size_t i) const { return section<CacheTrack>(getHeader().trackOffset)[i]; }
+
+            /**
+             * Methods to get the columns of the events, of size() elements each. See
+             * EventColumns for the meaning of every column.
+             * @return const T* The first element of the column.
+             */
+            const uint32_t* getTicks() const { return section<uint32_t>(getHeader().tickOffset); }
+            const uint8_t* getStatus() const { return section<uint8_t>(getHeader().statusOffset); }
+            const uint8_t* getData1() const { return section<uint8_t>(getHeader().data1Offset); }
+            const uint8_t* getData2() const { return section<uint8_t>(getHeader().data2Offset); }
+
+            /**
+             * Method to get the payload of an event, which points into the cache itself.
+             * @param event The index of the event.
+             * @return Payload The payload, empty for messages.
+             */
+            Payload getPayload(size_t event) const;
+
+            /**
+             * Method to get a payload by its own index.
+             * @param index The index of the payload.
+             * @return Payload The payload, empty if the index is out of range.
+             */
+            Payload getPayloadAt(uint32_t index) const;
+
+            /**
+             * Method to get the tempo changes.
+             * @return const TempoChange* The first of getHeader().tempos changes.
+             */
+            const TempoChange* getTempos() const { return section<TempoChange>(getHeader().tempoOffset); }
+
+            /**
+             * Method to get the tempo map.
+             * @return TempoMap The tempo map.
+             */
+            TempoMap getTempoMap() const { return TempoMap(getHeader().division, getTempos(), getHeader().tempos); }
+
+            /**
+             * Method to create the events of the file again. Payloads are copied, so the file
+             * can outlive the view. Unlike opening, this checks every reference in the cache.
+             * @param file The file to fill.
+             * @return Status ERROR_CACHE_FORMAT if the cache is damaged.
+             */
+            Status toFile(File& file) const;
+
+        private:
+            /**
+             * The view cannot be copied, since it owns the mapping.
+             */
+            CacheView(const CacheView&);
+            CacheView& operator =(const CacheView&);
+
+            /**
+             * Method to get a section of the cache.
+             * @param offset The offset of the section.
+             * @return const T* The first element of the section.
+             */
+            template <typename T>
+            const T* section(uint64_t offset) const { return reinterpret_cast<const T*>(_data + offset); }
+
+            /**
+             * The bytes of the cache.
+             * @var const uint8_t*
+             */
+            const uint8_t *_data;
+
+            /**
+             * The size of the mapping, 0 if the memory is not mapped by us.
+             * @var size_t
+             */
+            size_t _size;
+    };
+
+    class Cache {
+        public:
+            /**
+             * The identifier at the start of every cache.
+             * @var const static char*
+             */
+            const static char* IDENTIFIER;
+
+            /**
+             * The current version of the format.
+             * @var const static uint32_t
+             */
+            const static uint32_t VERSION = 1;
+
+            /**
+             * Method to write a cache of a file.
+             * @param file   The decoded file.
+             * @param source The source the file was decoded from.
+             * @param output The output stream, which should be in binary mode.
+             * @return Status ERROR_IO if writing failed.
+             */
+            static Status write(const File& file, const CacheSource& source, std::ostream& output);
+
+            /**
+             * Method to write a cache of events that are already stored in columns.
+             * @param columns The events.
+             * @param tempo   The tempo map.
+             * @param source  The source the events were decoded from.
+             * @param output  The output stream, which should be in binary mode.
+             * @return Status ERROR_IO if writing failed.
+             */
+            static Status write(const EventColumns& columns, const TempoMap& tempo, const CacheSource& source, std::ostream& output);
+
+            /**
+             * Method to decode a MIDI file and write a cache of it.
+             * @param source The path of the MIDI file.
+             * @param cache  The path of the cache.
+             * @return Status The error of reading, decoding or writing.
+             */
+            static Status build(const std::string& source, const std::string& cache);
+
+            /**
+             * Method to open the cache of a MIDI file, which is built first if it does not
+             * exist, cannot be used or was built from other bytes than the source holds now.
+             * By default the source is read to compare its hash, which still costs far less
+             * than decoding it. Without verifying, only the size and modification time are
+             * compared, which does not read the source at all, but misses a change that keeps
+             * the size and is made within the same second as the cache was built.
+             * @param source The path of the MIDI file.
+             * @param cache  The path of the cache.
+             * @param view   The view to open the cache in.
+             * @param verify Whether the hash of the source is compared.
+             * @return Status The error of building or opening.
+             */
+            static Status load(const std::string& source, const std::string& cache, CacheView& view, bool verify = true);
+
+            /**
+             * Method to get the size, modification time and hash of a source file.
+             * @param path   The path of the source file.
+             * @param source The information about the source.
+             * @param buffer The contents of the file are read into this.
+             * @return bool False if the file could not be read.
+             */
+            static bool describe(const std::string& path, CacheSource& source, std::vector<uint8_t>& buffer);
+    };
+}
+
+#endif
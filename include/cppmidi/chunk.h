@@ -0,0 +1,74 @@
+/**
+ * chunk.h
+ *
+ * A chunk of a file exactly as it was read: its identifier of 4 characters and the bytes
+ * after its length. Files keep the chunks that are not tracks this way, so they are written
+ * again as they were, and a RawFile holds its tracks this way, so they can be copied between
+ * files without decoding them.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_CHUNK_h
+#define MIDI_CHUNK_h
+
+#include <cstdint>
+#include <cstring>
+#include <cppmidi/payload.h>
+#include <cppmidi/track.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    class Chunk {
+        public:
+            /**
+             * Constructor
+             * @param identifier The 4 characters of the identifier.
+             * @param data       The bytes of the chunk, without the chunk header.
+             */
+            Chunk(const char *identifier, const Payload& data) : _data(data) {
+                memcpy(_identifier, identifier, 4);
+            }
+
+            /**
+             * Method to get the identifier, which is not terminated.
+             * @return const char* The 4 characters of the identifier.
+             */
+            const char* getIdentifier() const { return _identifier; }
+
+            /**
+             * Method to get the bytes of the chunk, without the chunk header.
+             * @return const Payload& The bytes.
+             */
+            const Payload& getData() const { return _data; }
+
+            /**
+             * Method to check whether this is a track chunk.
+             * @return bool True if the identifier is that of a track.
+             */
+            bool isTrack() const { return memcmp(_identifier, Track::IDENTIFIER, 4) == 0; }
+
+            /**
+             * Method to get the size of the chunk when it is written, with the chunk header.
+             * @return uint64_t The amount of bytes.
+             */
+            uint64_t size() const { return 8 + _data.size(); }
+
+        private:
+            /**
+             * The identifier.
+             * @var char[4]
+             */
+            char _identifier[4];
+
+            /**
+             * The bytes of the chunk.
+             * @var Payload
+             */
+            Payload _data;
+    };
+}
+
+#endif
@@ -0,0 +1,132 @@
+/**
+ * columns.h
+ *
+ * Class which stores the events of a file column by column instead of as separate objects.
+ * Every event has an absolute tick, its status byte and two data bytes, each in their own
+ * contiguous array, which makes scanning many events very cheap. The tracks of the file are
+ * stored one after another.
+ *
+ * The meaning of the data bytes depends on the status byte:
+ *  - Messages (0x80-0xEF): the two data bytes of the message.
+ *  - Meta events (0xFF): the meta type, and 0.
+ *  - SysEx events (0xF0, 0xF7): the SysExPacket, and 0.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_COLUMNS_h
+#define MIDI_COLUMNS_h
+
+#include <vector>
+#include <cstdint>
+#include <cppmidi/file.h>
+#include <cppmidi/payload.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    class EventColumns {
+        public:
+            /**
+             * Value in the payload column for events without a payload.
+             * @var const static uint32_t
+             */
+            const static uint32_t NO_PAYLOAD = 0xFFFFFFFF;
+
+            /**
+             * Default constructor, for no events at all.
+             */
+            EventColumns() : format(1), division(96), trackBegin(1, 0) {}
+
+            /**
+             * Constructor which stores all the events of a file.
+             * @param file The file.
+             */
+            EventColumns(const File& file) : format(1), division(96), trackBegin(1, 0) { assign(file); }
+
+            /**
+             * Destructor
+             */
+            virtual ~EventColumns() {}
+
+            /**
+             * Method to replace the columns with all the events of a file. Payloads are shared
+             * with the events, not copied.
+             * @param file The file.
+             */
+            void assign(const File& file);
+
+            /**
+             * Method to create the events from the columns again. Anything in the file is
+             * replaced, and the payloads are shared with the columns.
+             * @param file The file to fill.
+             */
+            void restore(File& file) const;
+
+            /**
+             * Method to reserve room for an amount of events and payloads.
+             * @param events   The amount of events.
+             * @param payloads The amount of payloads.
+             */
+            void reserve(size_t events, size_t payloads);
+
+            /**
+             * Method to get the amount of events.
+             * @return size_t The amount of events.
+             */
+            size_t size() const { return ticks.size(); }
+
+            /**
+             * Method to get the amount of tracks, including the empty slots of the file.
+             * @return size_t The amount of tracks.
+             */
+            size_t tracks() const { return trackBegin.size() - 1; }
+
+            /**
+             * The file format and division from the header of the file.
+             * @var uint16_t
+             */
+            uint16_t format;
+            uint16_t division;
+
+            /**
+             * The absolute tick of every event.
+             * @var std::vector<uint32_t>
+             */
+            std::vector<uint32_t> ticks;
+
+            /**
+             * The status byte of every event.
+             * @var std::vector<uint8_t>
+             */
+            std::vector<uint8_t> status;
+
+            /**
+             * The data bytes of every event.
+             * @var std::vector<uint8_t>
+             */
+            std::vector<uint8_t> data1;
+            std::vector<uint8_t> data2;
+
+            /**
+             * The index of the payload of every event, NO_PAYLOAD for messages.
+             * @var std::vector<uint32_t>
+             */
+            std::vector<uint32_t> payload;
+
+            /**
+             * The payloads of the meta and sysex events.
+             * @var std::vector<Payload>
+             */
+            std::vector<Payload> payloads;
+
+            /**
+             * The index of the first event of every track, followed by the amount of events.
+             * @var std::vector<uint32_t>
+             */
+            std::vector<uint32_t> trackBegin;
+    };
+}
+
+#endif
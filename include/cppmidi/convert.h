@@ -0,0 +1,57 @@
+/**
+ * convert.h
+ *
+ * Class to convert files between format 0, where all the events are in a single track,
+ * and format 1, where every channel has its own track and the meta events are on the
+ * first (conductor) track.
+ *
+ * Both conversions count the events per output track first, so every track is allocated
+ * exactly once, and then clone every event once into its final place with a new delta
+ * time. The events of the input are never modified.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_CONVERT_h
+#define MIDI_CONVERT_h
+
+#include <cppmidi/file.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    class Converter {
+        public:
+            /**
+             * Method to split a file with a single track into a conductor track with all the
+             * meta and sysex events, followed by a track for every channel that is used, in
+             * order of channel. Every track ends with an end of track event at the tick where
+             * the original track ended.
+             * @param input  The file, which may have at most one track.
+             * @param output The file to fill, which is cleared first.
+             * @return bool False if the input has more than one track.
+             */
+            static bool toMultiTrack(const File& input, File& output);
+
+            /**
+             * Method to merge all the tracks of a file into a single track. Events on the same
+             * tick keep the order of their tracks, so those of the conductor track come first.
+             * The end of track events are replaced by a single one at the end of the last track.
+             * @param input  The file, which may not be of format 2.
+             * @param output The file to fill, which is cleared first.
+             * @return bool False if the input is of format 2, which has independent sequences.
+             */
+            static bool toSingleTrack(const File& input, File& output);
+
+            /**
+             * Method to convert a file to another format in place.
+             * @param file   The file.
+             * @param format SINGLETRACK or MULTITRACK_SYNC.
+             * @return bool False if the file cannot be converted, in which case it is unchanged.
+             */
+            static bool convert(File& file, MidiMode format);
+    };
+}
+
+#endif
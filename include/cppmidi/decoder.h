@@ -0,0 +1,380 @@
+/**
+ * decoder.h
+ *
+ * Class which decodes MIDI files from memory without throwing exceptions. Every error is
+ * reported through the returned result, and a file that could not be decoded is left
+ * empty instead of half built. Chunks with an unknown but printable identifier are kept in
+ * the file as they are, so they are written again in the same place. That includes the
+ * ones after the last track, up to the end of the file.
+ *
+ * Optionally, tracks which turn out to be corrupt can be skipped. The decoder then continues
+ * with the next chunk, or if the chunk header itself is broken, searches for the next "MTrk"
+ * identifier and continues from there. This way the intact tracks of a partly damaged file
+ * can still be recovered.
+ *
+ * Limits can be set on the size of the input, the amount of events per track, the size of
+ * meta and sysex payloads, and the memory used by the decoded file. They are checked before
+ * anything is allocated, so a hostile file cannot make the decoder exhaust memory. Exceeding
+ * a limit within a track is treated like a corrupt track.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_DECODER_h
+#define MIDI_DECODER_h
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <iostream>
+#include <cstdint>
+#include <cppmidi/status.h>
+#include <cppmidi/file.h>
+#include <cppmidi/track.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    /**
+     * Declared in intern.h, which has to be included to intern while decoding.
+     */
+    class InternPool;
+
+    class DecodeOptions {
+        public:
+            /**
+             * Default constructor, with the strict defaults.
+             */
+            DecodeOptions() : skipCorruptTracks(false), maxBytes(0), maxEventsPerTrack(0), maxPayloadSize(0), maxMemory(0), pool(NULL) {}
+
+            /**
+             * Whether corrupt tracks should be skipped instead of failing the whole file.
+             * @var bool
+             */
+            bool skipCorruptTracks;
+
+            /**
+             * The largest size of the input in bytes, 0 for no limit.
+             * @var uint64_t
+             */
+            uint64_t maxBytes;
+
+            /**
+             * The largest amount of events in a single track, 0 for no limit.
+             * @var uint32_t
+             */
+            uint32_t maxEventsPerTrack;
+
+            /**
+             * The largest payload of a single meta or sysex event in bytes, 0 for no limit.
+             * @var uint32_t
+             */
+            uint32_t maxPayloadSize;
+
+            /**
+             * The largest amount of memory in bytes the decoder may allocate for a file, for
+             * its input buffer, events and copied payloads together, 0 for no limit.
+             * @var uint64_t
+             */
+            uint64_t maxMemory;
+
+            /**
+             * The pool the payloads of meta events are interned in, NULL to not intern them.
+             * The pool has to outlive the decoder, but not the decoded files.
+             * @var InternPool*
+             */
+            InternPool *pool;
+    };
+
+    class DecodeBudget {
+        public:
+            /**
+             * Constructor
+             * @param limit The amount of bytes that can be taken, 0 for no limit.
+             */
+            DecodeBudget(uint64_t limit = 0) : _limit(limit), _used(0) {}
+
+            /**
+             * Method to take bytes from the budget before allocating them. Several tracks can
+             * take from the same budget at once.
+             * @param bytes The amount of bytes.
+             * @return bool False if the bytes are not available, in which case nothing is taken.
+             */
+            bool take(uint64_t bytes) {
+                uint64_t used = _used.load(std::memory_order_relaxed);
+
+                do {
+                    if (_limit && bytes > _limit - used)
+                        return false;
+                }
+                while (!_used.compare_exchange_weak(used, used + bytes, std::memory_order_relaxed));
+
+                return true;
+            }
+
+            /**
+             * Method to return bytes that were taken but not used.
+             * @param bytes The amount of bytes.
+             */
+            void give(uint64_t bytes) { _used.fetch_sub(bytes, std::memory_order_relaxed); }
+
+            /**
+             * Method to check if the budget has a limit at all.
+             * @return bool True if there is a limit.
+             */
+            bool limited() const { return _limit != 0; }
+
+            /**
+             * Method to get the amount of bytes that were taken.
+             * @return uint64_t The amount of bytes.
+             */
+            uint64_t getUsed() const { return _used.load(std::memory_order_relaxed); }
+
+        private:
+            /**
+             * The limit, 0 for no limit.
+             * @var uint64_t
+             */
+            uint64_t _limit;
+
+            /**
+             * The amount of bytes that were taken.
+             * @var std::atomic<uint64_t>
+             */
+            std::atomic<uint64_t> _used;
+    };
+
+    class DecodeResult {
+        public:
+            /**
+             * Default constructor, for a result without errors or tracks.
+             */
+            DecodeResult() : tracks(0), skipped(0) {}
+
+            /**
+             * Method to check if the file was decoded completely. When corrupt tracks are
+             * skipped this is false as well, even though the file then holds every track
+             * that could be recovered.
+             * @return bool True if there were no errors.
+             */
+            bool ok() const { return status.ok(); }
+
+            /**
+             * The first error that was found.
+             * @var Status
+             */
+            Status status;
+
+            /**
+             * The amount of tracks that were decoded.
+             * @var uint16_t
+             */
+            uint16_t tracks;
+
+            /**
+             * The amount of tracks that were skipped because they were corrupt.
+             * @var uint16_t
+             */
+            uint16_t skipped;
+    };
+
+    class Decoder {
+        public:
+            /**
+             * Default constructor, which uses the default options.
+             */
+            Decoder() {}
+
+            /**
+             * Constructor
+             * @param options The options to decode with.
+             */
+            Decoder(const DecodeOptions& options) : _options(options) {}
+
+            /**
+             * Destructor
+             */
+            virtual ~Decoder() {}
+
+            /**
+             * Method to decode a complete file from memory. Anything in the file is replaced. Since
+             * the memory is not owned by the decoder, payloads are copied out of it.
+             * @param data The bytes of the file.
+             * @param size The amount of bytes.
+             * @param file The file to decode into.
+             * @return DecodeResult The result of the decoding.
+             */
+            DecodeResult decode(const uint8_t *data, size_t size, File& file) const {
+                return decode(data, size, file, std::shared_ptr<const void>());
+            }
+
+            /**
+             * Method to decode a complete file from memory. Anything in the file is replaced.
+             * @param buffer The bytes of the file.
+             * @param file   The file to decode into.
+             * @return DecodeResult The result of the decoding.
+             */
+            DecodeResult decode(const std::vector<uint8_t>& buffer, File& file) const {
+                return decode(buffer.data(), buffer.size(), file);
+            }
+
+            /**
+             * Method to decode a complete file from a shared buffer. Instead of copying them, the
+             * payloads of large events such as sysex dumps point into the buffer, which is kept
+             * alive for as long as any of them exists. The buffer thus counts as memory of the file.
+             * @param buffer The shared bytes of the file.
+             * @param file   The file to decode into.
+             * @return DecodeResult The result of the decoding.
+             */
+            DecodeResult decode(const std::shared_ptr<const std::vector<uint8_t>>& buffer, File& file) const {
+                return decode(buffer->data(), buffer->size(), file, buffer, buffer->size());
+            }
+
+            /**
+             * Method to decode a complete file from a stream, which should be in binary mode.
+             * Exactly the chunks of the file are read from the stream, into a buffer that is
+             * shared with the payloads of the decoded events.
+             * @param input The input stream.
+             * @param file  The file to decode into.
+             * @return DecodeResult The result of the decoding.
+             */
+            DecodeResult decode(std::istream& input, File& file) const;
+
+            /**
+             * Method to decode the events of a single track chunk, which are added to the track.
+             * Decoding stops at the end of track event, which is added as well, and anything
+             * after it is ignored. A track without one gets one after its last event. Both are
+             * errors for the Validator, but the decoded track is always valid to write back.
+             * @param data  The bytes of the file.
+             * @param begin The offset of the first event, right after the chunk header.
+             * @param end   The offset right after the last byte of the chunk.
+             * @param track The track to add the events to.
+             * @return Status The error and its offset, ERROR_NONE on success.
+             */
+            Status decodeTrack(const uint8_t *data, size_t begin, size_t end, Track& track) const {
+                return decodeTrack(data, begin, end, track, std::shared_ptr<const void>());
+            }
+
+            /**
+             * Method to decode the events of a single track chunk, with payloads pointing into
+             * a shared buffer instead of being copied. The memory of the events is taken from a
+             * budget, which can be shared by all the tracks of a file that are decoded at once.
+             * The end of track event is handled just like above.
+             * @param data   The bytes of the file.
+             * @param begin  The offset of the first event, right after the chunk header.
+             * @param end    The offset right after the last byte of the chunk.
+             * @param track  The track to add the events to.
+             * @param owner  The buffer holding the bytes, or empty if payloads should be copied.
+             * @param budget The memory budget, or NULL for a budget of maxMemory for this track alone.
+             * @return Status The error and its offset, ERROR_NONE on success.
+             */
+            Status decodeTrack(const uint8_t *data, size_t begin, size_t end, Track& track, const std::shared_ptr<const void>& owner,
+                               DecodeBudget *budget = NULL) const;
+
+            /**
+             * Method to decode only the header of a file and find its track chunks. Anything in
+             * the file is replaced by the header, an empty track for every chunk and the unknown
+             * chunks, so that the tracks can be decoded independently with decodeTrack(), for
+             * example in parallel. Unlike decode(), any error is fatal and leaves the file empty.
+             * @param data   The bytes of the file.
+             * @param size   The amount of bytes.
+             * @param file   The file to prepare.
+             * @param chunks The begin and end offsets of the events of every track, in order.
+             * @param owner  The buffer holding the bytes, or empty if unknown chunks should be copied.
+             * @return Status The error and its offset, ERROR_NONE on success.
+             */
+            Status prepare(const uint8_t *data, size_t size, File& file, std::vector<std::pair<size_t, size_t>>& chunks,
+                           const std::shared_ptr<const void>& owner = std::shared_ptr<const void>()) const;
+
+            /**
+             * Method to decode the header chunk of a file, which only needs the bytes of the header
+             * itself. The tracks of the file are left alone.
+             * @param data      The bytes of the file.
+             * @param size      The amount of bytes.
+             * @param file      The file to set the header of.
+             * @param numTracks The amount of tracks announced by the header.
+             * @param offset    The offset of the first chunk after the header.
+             * @return Status The error and its offset, ERROR_NONE on success.
+             */
+            static Status decodeHeader(const uint8_t *data, size_t size, File& file, uint16_t& numTracks, size_t& offset);
+
+            /**
+             * Method to check for an unknown chunk after the last track. Such chunks are kept up
+             * to the end of the file, but anything that does not look like one, including another
+             * track or header, quietly ends the file.
+             * @param data   The bytes of the file.
+             * @param size   The amount of bytes.
+             * @param offset The offset of the chunk.
+             * @return size_t The size of the chunk with its header, 0 if there is no such chunk.
+             */
+            static size_t trailingChunk(const uint8_t *data, size_t size, size_t offset);
+
+            /**
+             * Method to read the chunks of a complete file from a stream into a buffer, without
+             * decoding them. After as many tracks as the header announces, the unknown chunks
+             * that follow are read as well, until the stream ends or something else follows.
+             * @param input  The input stream.
+             * @param buffer The buffer, which is replaced with the read bytes.
+             * @param limit  The largest size of the buffer, 0 for no limit.
+             * @return Status ERROR_TRUNCATED if the stream ended early, ERROR_LIMIT_BYTES if a
+             *                chunk would make the buffer larger than the limit.
+             */
+            static Status read(std::istream& input, std::vector<uint8_t>& buffer, uint64_t limit = 0);
+
+            /**
+             * Method to read a single chunk, including its header, from a stream and append it to
+             * a buffer. The buffer grows with the data that is actually read, so a chunk header
+             * with a huge length on a short stream does not allocate that length.
+             * @param input  The input stream.
+             * @param buffer The buffer the chunk is appended to.
+             * @param limit  The largest size of the buffer, 0 for no limit.
+             * @return Status ERROR_TRUNCATED if the stream ended early, ERROR_LIMIT_BYTES if the
+             *                chunk would make the buffer larger than the limit.
+             */
+            static Status readChunk(std::istream& input, std::vector<uint8_t>& buffer, uint64_t limit = 0);
+
+            /**
+             * Method to get the limit on the input of a file, from the size and memory limits.
+             * @return uint64_t The largest amount of bytes to read, 0 for no limit.
+             */
+            uint64_t inputLimit() const;
+
+            /**
+             * Method to check the size of the input of a file against the limits, before it is
+             * read into memory.
+             * @param size The size of the input.
+             * @return Status ERROR_LIMIT_BYTES or ERROR_LIMIT_MEMORY if the input is too large.
+             */
+            Status checkInput(uint64_t size) const;
+
+        private:
+            /**
+             * Method to decode a complete file from memory.
+             * @param data  The bytes of the file.
+             * @param size  The amount of bytes.
+             * @param file  The file to decode into.
+             * @param owner The buffer holding the bytes, or empty if payloads should be copied.
+             * @param used  The memory the decoder already allocated for the input.
+             * @return DecodeResult The result of the decoding.
+             */
+            DecodeResult decode(const uint8_t *data, size_t size, File& file, const std::shared_ptr<const void>& owner, uint64_t used = 0) const;
+
+            /**
+             * Method which finds the next track chunk identifier after an offset.
+             * @param data   The bytes of the file.
+             * @param offset The offset to start searching after.
+             * @param size   The amount of bytes.
+             * @return size_t The offset of the identifier, size if not found.
+             */
+            static size_t resync(const uint8_t *data, size_t offset, size_t size);
+
+            /**
+             * The options to decode with.
+             * @var DecodeOptions
+             */
+            DecodeOptions _options;
+    };
+}
+
+#endif
@@ -0,0 +1,360 @@
+/**
+ * encoder.h
+ *
+ * Class which encodes events, tracks and files into a sink, which is chosen at compile time.
+ * Computing the size of something and writing it go through exactly the same code, by
+ * encoding into a sink that only counts, so the length of a track chunk is always exactly
+ * the amount of bytes that follow it. Events are told apart by their category instead of
+ * through a virtual call, so encoding a track inlines completely.
+ *
+ * A sink only needs two methods: put(uint8_t) for a single byte and write(const uint8_t*,
+ * size_t) for several bytes at once. The sinks here count bytes, write into memory that is
+ * large enough already, append to a vector, or write to a stream.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_ENCODER_h
+#define MIDI_ENCODER_h
+
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <cstring>
+#include <cppmidi/event.h>
+#include <cppmidi/header.h>
+#include <cppmidi/track.h>
+#include <cppmidi/chunk.h>
+#include <cppmidi/file.h>
+#include <cppmidi/events/message.h>
+#include <cppmidi/events/meta.h>
+#include <cppmidi/events/sysex.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    class CountingSink {
+        public:
+            /**
+             * Default constructor, for a sink without any bytes.
+             */
+            CountingSink() : _size(0) {}
+
+            /**
+             * Methods to count bytes.
+             * @param byte The byte.
+             * @param data The bytes.
+             * @param size The amount of bytes.
+             */
+            void put(uint8_t) { _size++; }
+            void write(const uint8_t *, size_t size) { _size += size; }
+
+            /**
+             * Method to get the amount of bytes that were counted.
+             * @return uint64_t The amount of bytes.
+             */
+            uint64_t size() const { return _size; }
+
+            /**
+             * Method to get the encoded size of an event, a track chunk, a header or a file.
+             * @param object The object.
+             * @return uint64_t The amount of bytes.
+             */
+            template <typename Object>
+            static uint64_t measure(const Object& object);
+
+        private:
+            /**
+             * The amount of bytes.
+             * @var uint64_t
+             */
+            uint64_t _size;
+    };
+
+    class RawSink {
+        public:
+            /**
+             * Constructor
+             * @param data The memory to write into, which must be large enough for everything
+             *             that is written, for example by measuring it first.
+             */
+            RawSink(uint8_t *data) : _data(data) {}
+
+            /**
+             * Methods to write bytes.
+             * @param byte The byte.
+             * @param data The bytes.
+             * @param size The amount of bytes.
+             */
+            void put(uint8_t byte) { *_data++ = byte; }
+            void write(const uint8_t *data, size_t size) {
+                if (size == 0)
+                    return;
+
+                memcpy(_data, data, size);
+                _data += size;
+            }
+
+            /**
+             * Method to get the position of the next byte.
+             * @return uint8_t* The position.
+             */
+            uint8_t* position() const { return _data; }
+
+        private:
+            /**
+             * The position of the next byte.
+             * @var uint8_t*
+             */
+            uint8_t *_data;
+    };
+
+    class BufferSink {
+        public:
+            /**
+             * Constructor
+             * @param buffer The buffer the bytes are appended to.
+             */
+            BufferSink(std::vector<uint8_t>& buffer) : _buffer(buffer) {}
+
+            /**
+             * Methods to append bytes.
+             * @param byte The byte.
+             * @param data The bytes.
+             * @param size The amount of bytes.
+             */
+            void put(uint8_t byte) { _buffer.push_back(byte); }
+            void write(const uint8_t *data, size_t size) { _buffer.insert(_buffer.end(), data, data + size); }
+
+        private:
+            /**
+             * The buffer.
+             * @var std::vector<uint8_t>&
+             */
+            std::vector<uint8_t>& _buffer;
+    };
+
+    class StreamSink {
+        public:
+            /**
+             * Constructor
+             * @param output The output stream, which should be in binary mode.
+             */
+            StreamSink(std::ostream& output) : _output(output), _buffer(output.rdbuf()) {}
+
+            /**
+             * Methods to write bytes. The bytes go straight into the buffer of the stream, and
+             * the stream is marked bad if that fails.
+             * @param byte The byte.
+             * @param data The bytes.
+             * @param size The amount of bytes.
+             */
+            void put(uint8_t byte) {
+                if (_buffer == NULL || _buffer->sputc(byte) == std::char_traits<char>::eof())
+                    _output.setstate(std::ios::badbit);
+            }
+            void write(const uint8_t *data, size_t size) {
+                if (_buffer == NULL || (size_t) _buffer->sputn(reinterpret_cast<const char*>(data), size) != size)
+                    _output.setstate(std::ios::badbit);
+            }
+
+        private:
+            /**
+             * The output stream and its buffer.
+             * @var std::ostream&, std::streambuf*
+             */
+            std::ostream& _output;
+            std::streambuf *_buffer;
+    };
+
+    template <typename Sink>
+    class Encoder {
+        public:
+            /**
+             * Constructor
+             * @param sink The sink to encode into.
+             */
+            Encoder(Sink& sink) : _sink(sink) {}
+
+            /**
+             * Method to encode a variable length value.
+             * @param value The value.
+             */
+            void writeVLValue(uint32_t value) {
+                uint8_t bytes[5];
+                size_t count = 0;
+
+                /* Collecting the groups of 7 bits from the lowest, and writing them reversed. */
+                do {
+                    bytes[4 - count] = (value & 0x7F) | (count ? 0x80 : 0);
+                    value >>= 7;
+                    count++;
+                }
+                while (value);
+
+                _sink.write(bytes + 5 - count, count);
+            }
+
+            /**
+             * Method to encode an event without its delta time.
+             * @param event The event.
+             */
+            void writeBody(const Event& event) {
+                switch (event.getCategory()) {
+                case CATEGORY_MESSAGE: {
+                    const Events::Message& msg = static_cast<const Events::Message&>(event);
+                    _sink.put(msg.getType() << 4 | msg.getChannel());
+                    _sink.put(msg.getData1());
+
+                    /* Program changes and channel aftertouch have a single data byte. */
+                    if (msg.getType() != Events::MessageType::PROGRAM_CHANGE && msg.getType() != Events::MessageType::CHANNEL_AFTERTOUCH)
+                        _sink.put(msg.getData2());
+
+                    break;
+                }
+                case CATEGORY_META: {
+                    const Events::Meta& meta = static_cast<const Events::Meta&>(event);
+                    _sink.put(0xFF);
+                    _sink.put(meta.getType());
+                    writeVLValue(meta.getData().size());
+                    _sink.write(meta.getData().data(), meta.getData().size());
+                    break;
+                }
+                case CATEGORY_SYSEX: {
+                    /* The payload already holds the manufacturer and the closing 0xF7. */
+                    const Events::SysEx& sysex = static_cast<const Events::SysEx&>(event);
+                    _sink.put(sysex.getType());
+                    writeVLValue(sysex.getPayload().size());
+                    _sink.write(sysex.getPayload().data(), sysex.getPayload().size());
+                    break;
+                }
+                }
+            }
+
+            /**
+             * Method to encode an event with its delta time.
+             * @param event The event.
+             */
+            void write(const Event& event) {
+                writeVLValue(event.deltaTime.getValue());
+                writeBody(event);
+            }
+
+            /**
+             * Method to encode the header of a chunk.
+             * @param identifier The 4 characters that identify the chunk.
+             * @param length     The length of the data after the header.
+             */
+            void writeChunkHeader(const char *identifier, uint32_t length) {
+                const uint8_t bytes[4] = { uint8_t(length >> 24), uint8_t(length >> 16), uint8_t(length >> 8), uint8_t(length) };
+
+                _sink.write(reinterpret_cast<const uint8_t*>(identifier), 4);
+                _sink.write(bytes, 4);
+            }
+
+            /**
+             * Method to encode the events of a track, without the chunk header.
+             * @param track The track.
+             */
+            void writeEvents(const Track& track) {
+                for (auto event : track.getEvents())
+                    write(*event);
+            }
+
+            /**
+             * Method to encode a complete track chunk, with the exact length of its events.
+             * @param track The track.
+             * @return bool False if the track is too long for a chunk, in which case nothing is written.
+             */
+            bool write(const Track& track) {
+                CountingSink counter;
+                Encoder<CountingSink>(counter).writeEvents(track);
+
+                if (counter.size() > 0xFFFFFFFF)
+                    return false;
+
+                writeChunkHeader(Track::IDENTIFIER, counter.size());
+                writeEvents(track);
+                return true;
+            }
+
+            /**
+             * Method to encode the header chunk.
+             * @param header The header.
+             */
+            void write(const Header& header) {
+                const uint8_t bytes[6] = {
+                    uint8_t(header.getFileFormat() >> 8), uint8_t(header.getFileFormat()),
+                    uint8_t(header.getNumTracks() >> 8), uint8_t(header.getNumTracks()),
+                    uint8_t(header.getDeltaTicks() >> 8), uint8_t(header.getDeltaTicks())
+                };
+
+                writeChunkHeader(Header::IDENTIFIER, 6);
+                _sink.write(bytes, 6);
+            }
+
+            /**
+             * Method to encode a chunk as it is, with its chunk header.
+             * @param chunk The chunk.
+             * @return bool False if the chunk is too long, in which case nothing is written.
+             */
+            bool write(const Chunk& chunk) {
+                if (chunk.getData().size() > 0xFFFFFFFF)
+                    return false;
+
+                writeChunkHeader(chunk.getIdentifier(), chunk.getData().size());
+                _sink.write(chunk.getData().data(), chunk.getData().size());
+                return true;
+            }
+
+            /**
+             * Method to encode a complete file, with the chunks that are not tracks in front
+             * of the tracks they belong to.
+             * @param file The file.
+             * @return bool False if a track is too long for a chunk, in which case the tracks
+             *              before it were written already.
+             */
+            bool write(const File& file) {
+                write(file.getHeader());
+
+                const auto& chunks = file.getChunks();
+                size_t next = 0;
+
+                for (int i = 0; i < file.getTrackSlots(); i++) {
+                    for (; next < chunks.size() && chunks[next].first <= i; next++)
+                        write(chunks[next].second);
+
+                    if (file.getTrack(i) != NULL && !write(*file.getTrack(i)))
+                        return false;
+                }
+
+                for (; next < chunks.size(); next++)
+                    write(chunks[next].second);
+
+                return true;
+            }
+
+        private:
+            /**
+             * The sink.
+             * @var Sink&
+             */
+            Sink& _sink;
+    };
+
+    /**
+     * Method to get the encoded size of an event, a track chunk, a header or a file.
+     * @param object The object.
+     * @return uint64_t The amount of bytes.
+     */
+    template <typename Object>
+    uint64_t CountingSink::measure(const Object& object) {
+        CountingSink sink;
+        Encoder<CountingSink>(sink).write(object);
+
+        return sink.size();
+    }
+}
+
+#endif
@@ -11,6 +11,8 @@
 #define MIDI_endian_h
 
 #include <iostream>
+#include <vector>
+#include <cstdint>
 
 /**
  * Define to swap a short and switch the endianness. Please note that this will completely ignore
@@ -155,6 +157,33 @@ namespace Midi {
 
                 return byte;
             }
+
+            /**
+             * Helper function for reading a number of bytes and appending them to a buffer. The
+             * bytes are read in blocks, so the buffer only grows as far as there actually is data
+             * and an untrusted count cannot make this allocate more than the stream delivers.
+             * @param input  The stream to be read from.
+             * @param buffer The buffer the bytes are appended to.
+             * @param count  The amount of bytes to read.
+             * @return bool  True if all the bytes could be read.
+             */
+            static bool readBytes(std::istream &input, std::vector<uint8_t> &buffer, size_t count);
+
+            /**
+             * Helper function for reading a big endian int from memory.
+             * @param data  The first of the 4 bytes.
+             */
+            inline static uint32_t readIntBig(const uint8_t *data) {
+                return uint32_t(data[0]) << 24 | uint32_t(data[1]) << 16 | uint32_t(data[2]) << 8 | data[3];
+            }
+
+            /**
+             * Helper function for reading a big endian short from memory.
+             * @param data  The first of the 2 bytes.
+             */
+            inline static uint16_t readShortBig(const uint8_t *data) {
+                return uint16_t(data[0] << 8 | data[1]);
+            }
     };
 }
 
@@ -20,12 +20,23 @@
  * Setting up the basic namespace.
  */
 namespace Midi {
+    /**
+     * Enum to tell the different kinds of events apart without having to go through
+     * a dynamic_cast. Every derived class sets this once in its constructor.
+     */
+    enum EventCategory {
+        CATEGORY_MESSAGE = 0,
+        CATEGORY_META = 1,
+        CATEGORY_SYSEX = 2
+    };
+
     class Event {
         public:
             /**
-             * Default constructor.
+             * Constructor, which should be called by the derived classes with their category.
+             * @param category The category of the derived event.
              */
-            Event() : deltaTime(0), _gcount(0) {}
+            Event(EventCategory category) : deltaTime(0), _gcount(0), _category(category) {}
 
             /**
              * Destructor
@@ -70,6 +81,13 @@ namespace Midi {
              */
             virtual uint32_t getLength() const { return deltaTime.getLength(); }
 
+            /**
+             * Method to get the category of this event, which is a lot cheaper than trying
+             * to cast the event to every derived class.
+             * @return EventCategory The category of this event.
+             */
+            EventCategory getCategory() const { return static_cast<EventCategory>(_category); }
+
             /**
              * Time difference since last event. Since this can be anything, the trivial accessor is
              * omitted.
@@ -82,6 +100,13 @@ namespace Midi {
              * @var uint32_t
              */
             uint32_t _gcount;
+
+        private:
+            /**
+             * The category of this event, stored as a byte to keep the events small.
+             * @var uint8_t
+             */
+            uint8_t _category;
     };
 }
 
@@ -0,0 +1,117 @@
+/**
+ * eventindex.h
+ *
+ * Class which keeps sorted lists with the positions of the events in a track, split
+ * by channel, by message type and by the combination of both. This way all the events
+ * of a certain kind can be visited without looking at any of the other events.
+ *
+ * Next to the positions, the absolute tick of every event is kept, since the delta
+ * times of the skipped events would otherwise be needed to know when an event happens.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_EVENTINDEX_h
+#define MIDI_EVENTINDEX_h
+
+#include <vector>
+#include <cstdint>
+#include <cppmidi/event.h>
+#include <cppmidi/events/message.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    class EventIndex {
+        public:
+            /**
+             * Constructor which indexes all the events in a list of events.
+             * @param events The events to index, usually those of a track.
+             */
+            EventIndex(const std::vector<Event*>& events);
+
+            /**
+             * Destructor
+             */
+            virtual ~EventIndex() {}
+
+            /**
+             * Method to get the positions of all the messages on a channel.
+             * @param channel The channel, ranging from 0-15.
+             * @return const std::vector<uint32_t>& The sorted positions.
+             */
+            const std::vector<uint32_t>& get(uint8_t channel) const { return _byChannel[channel & 0xF]; }
+
+            /**
+             * Method to get the positions of all the messages of a type.
+             * @param type The message type.
+             * @return const std::vector<uint32_t>& The sorted positions.
+             */
+            const std::vector<uint32_t>& get(Events::MessageType type) const { return _byType[(type - 0x8) & 0x7]; }
+
+            /**
+             * Method to get the positions of all the messages of a type on a channel.
+             * @param type    The message type.
+             * @param channel The channel, ranging from 0-15.
+             * @return const std::vector<uint32_t>& The sorted positions.
+             */
+            const std::vector<uint32_t>& get(Events::MessageType type, uint8_t channel) const {
+                return _byStatus[((type - 0x8) & 0x7) << 4 | (channel & 0xF)];
+            }
+
+            /**
+             * Method to get the positions of all the events of a category.
+             * @param category The category.
+             * @return const std::vector<uint32_t>& The sorted positions.
+             */
+            const std::vector<uint32_t>& get(EventCategory category) const { return _byCategory[category]; }
+
+            /**
+             * Method to get the absolute tick of the event at a position.
+             * @param position The position of the event.
+             * @return uint32_t The absolute tick.
+             */
+            uint32_t getTick(uint32_t position) const { return _ticks[position]; }
+
+            /**
+             * Method to get the amount of indexed events.
+             * @return size_t The amount of events.
+             */
+            size_t size() const { return _ticks.size(); }
+
+        private:
+            /**
+             * Positions per status byte, so per message type and channel. There are only 7
+             * message types, but 8 makes the lookup a simple shift.
+             * @var std::vector<uint32_t>[]
+             */
+            std::vector<uint32_t> _byStatus[8 * 16];
+
+            /**
+             * Positions per channel.
+             * @var std::vector<uint32_t>[]
+             */
+            std::vector<uint32_t> _byChannel[16];
+
+            /**
+             * Positions per message type.
+             * @var std::vector<uint32_t>[]
+             */
+            std::vector<uint32_t> _byType[8];
+
+            /**
+             * Positions per event category.
+             * @var std::vector<uint32_t>[]
+             */
+            std::vector<uint32_t> _byCategory[3];
+
+            /**
+             * The absolute tick of every event.
+             * @var std::vector<uint32_t>
+             */
+            std::vector<uint32_t> _ticks;
+    };
+}
+
+#endif
@@ -17,6 +17,11 @@
  * Setting up the basic namespace.
  */
 namespace Midi {
+    /**
+     * The decoder is declared here, so it can construct events directly.
+     */
+    class Decoder;
+
     namespace Events {
         /**
          * Enum to indicate the message type, since this message type is limited to very select
@@ -93,18 +98,26 @@ namespace Midi {
                  */
                 uint8_t getChannel() const { return _channel; }
 
+                /**
+                 * Method to get the first data byte, which is the note for note events and the
+                 * controller number for controller events.
+                 * @return uint8_t The first data byte, ranging from 0-127.
+                 */
+                uint8_t getData1() const { return _data1; }
+
+                /**
+                 * Method to get the second data byte, which is the velocity for note events and the
+                 * value for controller events. Unused for program change and channel aftertouch.
+                 * @return uint8_t The second data byte, ranging from 0-127.
+                 */
+                uint8_t getData2() const { return _data2; }
+
                 /**
                  * Method to get the length of this message in bytes. This will depend on the type
                  * of this message, since some messages ignore the 4th byte.
                  * @return uint32_t The length in bytes.
                  */
-                virtual uint32_t getLength() const {
-                    if (_type == MessageType::PROGRAM_CHANGE
-                            || _type == MessageType::CHANNEL_AFTERTOUCH)
-                        return 2 + Event::getLength();
-                    else
-                        return 3 + Event::getLength();
-                }
+                virtual uint32_t getLength() const;
 
                 /**
                  * Method to set the type byte for the current message. This could alter the length if
@@ -134,11 +147,16 @@ namespace Midi {
                  * @param data The second databyte.
                  */
                 void setData2(uint8_t data) { _data2 = (data < 128) ? data : 127; }
+                /**
+                 * The decoder fills in the fields directly.
+                 */
+                friend class Midi::Decoder;
+
             private:
                 /**
                  * Private constructor, which does simply nothing.
                  */
-                Message() : Event() {}
+                Message() : Event(CATEGORY_MESSAGE) {}
 
                 /**
                  * Current type byte, with the high nibble set to the status. Ranges from 0x8 to 0xE.
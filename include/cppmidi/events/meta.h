@@ -10,13 +10,21 @@
 #define MIDI_EVENT_META_h
 
 #include <iostream>
+#include <string>
 #include <cppmidi/event.h>
 #include <cppmidi/vlvalue.h>
+#include <cppmidi/payload.h>
 
 /**
  * Setting up the basic namespace.
  */
 namespace Midi {
+    /**
+     * The decoder is declared here, so it can construct events directly.
+     */
+    class Decoder;
+    class File;
+
     namespace Events {
         /* Enum to maintain all the possible Meta events, to prevent meta events with invalid
          * types to exist.
@@ -39,6 +47,69 @@ namespace Midi {
             SPECIFIC = 0x7F
         };
 
+        /**
+         * The decoded data of a SIGNATURE_TIME event.
+         */
+        struct TimeSignature {
+            /**
+             * The numerator of the time signature.
+             * @var uint8_t
+             */
+            uint8_t numerator;
+
+            /**
+             * The denominator as a power of two, so 2 means a quarter and 3 an eighth.
+             * @var uint8_t
+             */
+            uint8_t denominator;
+
+            /**
+             * The amount of MIDI clocks in a metronome click.
+             * @var uint8_t
+             */
+            uint8_t clocksPerClick;
+
+            /**
+             * The amount of notated 32nd notes in a quarter note, normally 8.
+             * @var uint8_t
+             */
+            uint8_t notesPerQuarter;
+        };
+
+        /**
+         * The decoded data of a SIGNATURE_KEY event.
+         */
+        struct KeySignature {
+            /**
+             * The amount of sharps if positive, or flats if negative.
+             * @var int8_t
+             */
+            int8_t sharps;
+
+            /**
+             * Whether the key is minor instead of major.
+             * @var bool
+             */
+            bool minor;
+        };
+
+        /**
+         * The decoded data of a SMPTE_OFFSET event.
+         */
+        struct SmpteOffset {
+            /**
+             * The hours, with the frame rate in the upper bits as stored in the file.
+             * @var uint8_t
+             */
+            uint8_t hours;
+
+            /**
+             * The minutes, seconds, frames and fractional frames (100ths of a frame).
+             * @var uint8_t
+             */
+            uint8_t minutes, seconds, frames, fractions;
+        };
+
         class Meta : public Event {
             public:
                 /**
@@ -46,7 +117,23 @@ namespace Midi {
                  * is a fixed header for this event (0xFF).
                  * @param t The type of metaevent to create.
                  */
-                Meta(MetaType t) : Event(), _type(t), _dataSize(0) { }
+                Meta(MetaType t) : Event(CATEGORY_META), _type(t) { }
+
+                /**
+                 * Creates a metaevent with type t and data. Short data is stored inside the
+                 * event, longer data is shared with the payload.
+                 * @param t    The type of metaevent to create.
+                 * @param data The data of the event.
+                 */
+                Meta(MetaType t, const Payload& data) : Event(CATEGORY_META), _type(t), _data(data) { }
+
+                /**
+                 * Creates a metaevent with type t and a copy of the data.
+                 * @param t    The type of metaevent to create.
+                 * @param data The data bytes.
+                 * @param size The amount of data bytes.
+                 */
+                Meta(MetaType t, const uint8_t *data, size_t size) : Event(CATEGORY_META), _type(t), _data(data, size) { }
 
                 /**
                  * Destructor.
@@ -61,7 +148,8 @@ namespace Midi {
                 virtual std::ostream& print(std::ostream& output) const;
 
                 /**
-                 * Method to clone the event, should be implemented by derived classes.
+                 * Method to clone the event, should be implemented by derived classes. The
+                 * clone shares the data with this event.
                  * @returns Event* the cloned event pointer, which is dynamically allocated.
                  */
                 virtual Event* clone() const {
@@ -71,8 +159,10 @@ namespace Midi {
                 /**
                  * Method which tries to pop a Meta object from the input stream.
                  * Returns NULL if it cannot be popped, otherwise it will return a dynamically allocated
-                 * Event*. If NULL is returned, the guarantee is made that the stream is not modified.* @param input The input stream.
-                 * @return Event* A dynamically allocated event.
+                 * Event*. If NULL is returned, the guarantee is made that the stream is not modified,
+                 * unless the stream ended within the event, in which case the stream is left failed.
+                 * @param input The input stream.
+                 * @return Event* A dynamically allocated event, NULL if it cannot be popped.
                  */
                 static Event* popEvent(std::istream &input);
 
@@ -81,12 +171,94 @@ namespace Midi {
                  * this event.
                  * @return uint32_t The total length in bytes of this sysex event.
                  */
-                virtual uint32_t getLength() const { return Event::getLength() + 2 + _dataSize.getLength() + _data.size(); }
+                virtual uint32_t getLength() const;
+
+                /**
+                 * Method to get the type of this meta event.
+                 * @return uint8_t The type, usually one of the MetaType values.
+                 */
+                uint8_t getType() const { return _type; }
+
+                /**
+                 * Method to get the data of this meta event, which for the text events is the
+                 * text without a terminating zero.
+                 * @return const Payload& The data.
+                 */
+                const Payload& getData() const { return _data; }
+
+                /**
+                 * Method to get the tempo of a TEMPO event.
+                 * @return uint32_t The microseconds per quarter note, 0 if this is no tempo event.
+                 */
+                uint32_t getTempo() const;
+
+                /**
+                 * Method to decode a SIGNATURE_TIME event.
+                 * @param signature The decoded time signature.
+                 * @return bool False if this is no time signature event.
+                 */
+                bool getTimeSignature(TimeSignature& signature) const;
+
+                /**
+                 * Method to decode a SIGNATURE_KEY event.
+                 * @param signature The decoded key signature.
+                 * @return bool False if this is no key signature event.
+                 */
+                bool getKeySignature(KeySignature& signature) const;
+
+                /**
+                 * Method to decode a SMPTE_OFFSET event.
+                 * @param offset The decoded offset.
+                 * @return bool False if this is no SMPTE offset event.
+                 */
+                bool getSmpteOffset(SmpteOffset& offset) const;
+
+                /**
+                 * Method to create a TEMPO event.
+                 * @param microseconds The microseconds per quarter note, at most 24 bits.
+                 * @return Meta The event.
+                 */
+                static Meta tempo(uint32_t microseconds);
+
+                /**
+                 * Method to create a SIGNATURE_TIME event.
+                 * @param signature The time signature.
+                 * @return Meta The event.
+                 */
+                static Meta timeSignature(const TimeSignature& signature);
+
+                /**
+                 * Method to create a SIGNATURE_KEY event.
+                 * @param signature The key signature.
+                 * @return Meta The event.
+                 */
+                static Meta keySignature(const KeySignature& signature);
+
+                /**
+                 * Method to create a text event, such as TEXT, NAME_TRACK or TEXT_LYRIC.
+                 * @param t    The type of text event.
+                 * @param text The text.
+                 * @return Meta The event.
+                 */
+                static Meta text(MetaType t, const std::string& text) {
+                    return Meta(t, reinterpret_cast<const uint8_t*>(text.data()), text.size());
+                }
+
+                /**
+                 * The decoder fills in the fields directly.
+                 */
+                friend class Midi::Decoder;
+
+                /**
+                 * The file replaces the data by an interned payload with the same bytes.
+                 */
+                friend class Midi::File;
+
             private:
                 /**
                  * Private Meta constructor.
                  */
-                Meta() : Event(), _dataSize(0) { }
+                Meta() : Event(CATEGORY_META) { }
 
                 /**
                  * The type of this meta event.
@@ -95,16 +267,10 @@ namespace Midi {
                 uint8_t _type;
 
                 /**
-                 * The VLValue with the length of the data.
-                 * @var VLValue
-                 */
-                VLValue _dataSize;
-
-                /**
-                 * Variable to hold the data for the meta event.
-                 * @var uint8_t
+                 * Variable to hold the data for the meta event, inline if it is short.
+                 * @var Payload
                  */
-                std::vector<uint8_t> _data;
+                Payload _data;
         };
     }
 }
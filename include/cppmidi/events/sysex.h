@@ -3,6 +3,15 @@
  *
  * Class for a sysex event.
  *
+ * In a file, a sysex event is stored as 0xF0, the length as a variable length value and
+ * the data, which normally ends with 0xF7. Large messages may be split into packets, where
+ * the first packet does not end with 0xF7 and the following packets start with 0xF7
+ * instead of 0xF0. A 0xF7 event outside such a split message is an escape, which holds
+ * arbitrary bytes that are sent as they are.
+ *
+ * The data is kept in a Payload, so a decoded sysex points into the buffer of the file
+ * instead of holding its own copy, which matters for multi-megabyte sample dumps.
+ *
  * @author Michael van der Werve
  */
 
@@ -12,20 +21,58 @@
 #include <iostream>
 #include <vector>
 #include <cppmidi/event.h>
+#include <cppmidi/payload.h>
 
 /**
  * Setting up the basic namespace.
  */
 namespace Midi {
+    /**
+     * The decoder is declared here, so it can construct events directly.
+     */
+    class Decoder;
+
     namespace Events {
+        /**
+         * Enum with the kinds of sysex packets that can appear in a file.
+         */
+        enum SysExPacket {
+            SYSEX_COMPLETE = 0,
+            SYSEX_FIRST = 1,
+            SYSEX_CONTINUATION = 2,
+            SYSEX_ESCAPE = 3
+        };
+
         class SysEx : public Event {
             public:
                 /**
-                 * Constructor from the ID. The type is standard 0xF0 (unsure what other types
-                 * do and are for exactly) and the new length becomes 3.
-                 * @param id The id of the manufacturer.
+                 * Flag to mark a manufacturer id as one of the 3 byte ids, which are written as
+                 * 0x00 followed by the two lower bytes. Without it, the id is a single byte.
+                 * @var const static uint32_t
+                 */
+                const static uint32_t EXTENDED_ID = 0x10000;
+
+                /**
+                 * Constructor for a complete sysex message, from the id of the manufacturer and
+                 * the data that follows it. The closing 0xF7 is added automatically.
+                 * @param id   The id of the manufacturer, with EXTENDED_ID set for 3 byte ids.
+                 * @param data The data bytes, which are copied.
+                 * @param size The amount of data bytes.
+                 */
+                SysEx(uint32_t id, const uint8_t *data = NULL, size_t size = 0);
+
+                /**
+                 * Constructor for a packet exactly as it is stored in a file.
+                 * @param type    Either 0xF0 or 0xF7.
+                 * @param payload The bytes after the length, including any closing 0xF7.
+                 * @param packet  The kind of packet.
                  */
-                SysEx(uint8_t id) : Event(), manufacturerID(id), _type(0xF0) { }
+                SysEx(uint8_t type, const Payload& payload, SysExPacket packet);
+
+                /**
+                 * Destructor
+                 */
+                virtual ~SysEx() {}
 
                 /**
                  * Function which prints this event.
@@ -34,16 +81,16 @@ namespace Midi {
                  */
                 virtual std::ostream& print(std::ostream& output) const;
 
-
                 /**
                  * Method which adds the current data length plus the usual length of
                  * this event.
                  * @return uint64_t The total length in bytes of this sysex event.
                  */
-                virtual uint32_t getLength() const { return Event::getLength() + 2 + data.size(); }
+                virtual uint32_t getLength() const;
 
                 /**
-                 * Method to clone the event, should be implemented by derived classes.
+                 * Method to clone the event, should be implemented by derived classes. The
+                 * clone shares the payload with this event.
                  * @returns Event* the cloned event pointer, which is dynamically allocated.
                  */
                 virtual Event* clone() const {
@@ -53,31 +100,76 @@ namespace Midi {
                 /**
                  * Method which tries to pop a SysEx object from the input stream.
                  * Returns NULL if it cannot be popped, otherwise it will return a dynamically allocated
-                 * Event*. If NULL is returned, the guarantee is made that the stream is not modified.* @param input The input stream.
+                 * Event*. If NULL is returned, the guarantee is made that the stream is not modified,
+                 * unless the stream ended within the event, in which case the stream is left failed.
+                 * Since it is not known what came before it, a 0xF7 packet is considered an escape.
                  * @param input The input stream.
-                 * @return Event* A dynamically allocated event.
+                 * @return Event* A dynamically allocated event, NULL if it cannot be popped.
                  */
                 static Event* popEvent(std::istream &input);
 
                 /**
-                 * Variable with the manufacturer id, which could be anything.
-                 * @var uint8_t
+                 * Method to get the status byte of this event.
+                 * @return uint8_t Either 0xF0 or 0xF7.
                  */
-                uint8_t manufacturerID;
+                uint8_t getType() const { return _type; }
 
                 /**
-                 * This variable will hold the data - unfortunately we cannot do much
-                 * with the data because it varies so much from thing manufacturer to
-                 * manufacturer. However this should/could be set in the case of a
-                 * system exclusive event.
-                 * @var uint8_t
+                 * Method to get the kind of packet of this event.
+                 * @return SysExPacket The kind of packet.
                  */
-                std::vector<uint8_t> data;
+                SysExPacket getPacket() const { return static_cast<SysExPacket>(_packet); }
+
+                /**
+                 * Method to get the id of the manufacturer. Only packets that start a message have
+                 * one, for the others this is 0.
+                 * @return uint32_t The id, with EXTENDED_ID set for 3 byte ids.
+                 */
+                uint32_t getManufacturerID() const;
+
+                /**
+                 * Method to get the data after the manufacturer id and without the closing 0xF7.
+                 * This shares the bytes with the payload.
+                 * @return Payload The data.
+                 */
+                Payload getData() const;
+
+                /**
+                 * Method to get the complete payload as stored in a file, so after the length and
+                 * including any closing 0xF7.
+                 * @return const Payload& The payload.
+                 */
+                const Payload& getPayload() const { return _payload; }
+
+                /**
+                 * The decoder fills in the fields directly.
+                 */
+                friend class Midi::Decoder;
+
             private:
                 /**
-                 * The type of this sysex event.
+                 * Method to get the amount of bytes the manufacturer id takes in the payload.
+                 * @return size_t 0, 1 or 3.
+                 */
+                size_t getManufacturerLength() const;
+
+                /**
+                 * The status byte of this sysex event, 0xF0 or 0xF7.
+                 * @var uint8_t
                  */
                 uint8_t _type;
+
+                /**
+                 * The kind of packet, as a SysExPacket.
+                 * @var uint8_t
+                 */
+                uint8_t _packet;
+
+                /**
+                 * The bytes after the length, including any closing 0xF7.
+                 * @var Payload
+                 */
+                Payload _payload;
         };
     }
 }
@@ -13,28 +13,93 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <utility>
+#include <future>
+#include <functional>
 
 #include <cppmidi/track.h>
 #include <cppmidi/header.h>
+#include <cppmidi/chunk.h>
+#include <cppmidi/status.h>
 
 /**
  * Setting up the Midi namespace.
  */
 namespace Midi {
+    /**
+     * Declared in decoder.h, which has to be included to load files asynchronously.
+     */
+    class DecodeOptions;
+    class DecodeResult;
+
+    /**
+     * Declared in intern.h, which has to be included to intern the payloads of a file.
+     */
+    class InternPool;
+
+    /**
+     * The memory a file takes, in bytes. Payloads are counted once per buffer they refer to.
+     */
+    struct MemoryUsage {
+        /**
+         * The memory of the file, its tracks and the event objects.
+         * @var size_t
+         */
+        size_t events;
+
+        /**
+         * The bytes of the payloads that only this file refers to.
+         * @var size_t
+         */
+        size_t payloads;
+
+        /**
+         * The bytes of the payloads this file shares with other files, for example through
+         * an intern pool, which are not freed together with the file.
+         * @var size_t
+         */
+        size_t shared;
+    };
+
     class File {
         public:
             /**
              * Default constructor
              */
-            File() : _tracks() { }
+            File() : _tracks(), _chunks() { }
+
+            /**
+             * Copy constructor, which copies all the tracks of the other file.
+             * @param file The file to copy.
+             */
+            File(const File& file);
+
+            /**
+             * Assignment operator, which replaces the tracks by copies of those of the other file.
+             * @param file The file to copy.
+             * @return File& This file.
+             */
+            File& operator =(const File& file);
 
             /**
              * Destructor
              */
-            virtual ~File() {
-                /* Tracks are dynamically allocated by us, and should thus be freed. */
-                for (auto track : _tracks)
-                    delete track;
+            virtual ~File() { clear(); }
+
+            /**
+             * Method to remove all the tracks and chunks and reset the header, so the file is
+             * empty again.
+             */
+            void clear();
+
+            /**
+             * Method to exchange the tracks, chunks and the header with another file.
+             * @param other The other file.
+             */
+            void swap(File& other) {
+                _tracks.swap(other._tracks);
+                _chunks.swap(other._chunks);
+                std::swap(_head, other._head);
             }
 
             /**
@@ -49,6 +114,129 @@ namespace Midi {
              */
             Track* getTrack(int index);
 
+            /**
+             * Method to get an existing track from the file without creating it.
+             * @param index The index of the track.
+             * @return const Track* Pointer to the track, NULL if there is no track at the index.
+             */
+            const Track* getTrack(int index) const;
+
+            /**
+             * Method to get the amount of track slots in this file. Not every slot has to
+             * contain a track, so getTrack() can still return NULL for an index below this.
+             * @return int The amount of track slots.
+             */
+            int getTrackSlots() const { return _tracks.size(); }
+
+            /**
+             * Method to get the header of this file.
+             * @return const Header& The header.
+             */
+            const Header& getHeader() const { return _head; }
+
+            /**
+             * Method to get the header of this file, to change the format or division. The
+             * amount of tracks is kept up to date by the file itself.
+             * @return Header& The header.
+             */
+            Header& getHeader() { return _head; }
+
+            /**
+             * Method to add a chunk that is not a track, which is written in front of the track
+             * in a slot. Chunks in front of the same slot are written in the order they were
+             * added in, and chunks after the last slot are written at the end.
+             * @param chunk    The chunk.
+             * @param position The slot of the track the chunk is written in front of.
+             */
+            void addChunk(const Chunk& chunk, int position);
+
+            /**
+             * Method to get the chunks that are not tracks, with the slot each is written in
+             * front of, in the order they are written in. Unknown chunks of a decoded file end
+             * up here.
+             * @return const std::vector<std::pair<int, Chunk>>& The chunks.
+             */
+            const std::vector<std::pair<int, Chunk>>& getChunks() const { return _chunks; }
+
+            /**
+             * Method to remove the chunks that are not tracks.
+             */
+            void clearChunks() { _chunks.clear(); }
+
+            /**
+             * Method to visit all the messages of a type on a channel in all the tracks, using
+             * the index of every track so none of the other events are touched.
+             * @param type     The message type.
+             * @param channel  The channel, ranging from 0-15.
+             * @param callback Callable which accepts the track index, the absolute tick and a const Message&.
+             */
+            template <typename Callback>
+            void forEachMessage(Events::MessageType type, uint8_t channel, Callback callback) const {
+                for (int i = 0; i < getTrackSlots(); i++) {
+                    if (_tracks[i] == NULL)
+                        continue;
+
+                    _tracks[i]->forEachMessage(type, channel, [&callback, i](uint32_t tick, const Events::Message& msg) {
+                        callback(i, tick, msg);
+                    });
+                }
+            }
+
+            /**
+             * Method to replace the payloads of all the meta events by interned ones, so they
+             * share their bytes with those of other files in the same pool.
+             * @param pool The pool.
+             */
+            void intern(InternPool& pool);
+
+            /**
+             * Method to get the memory this file takes.
+             * @return MemoryUsage The memory usage.
+             */
+            MemoryUsage memoryUsage() const;
+
+            /**
+             * Method to load a file in the background. Blocks of the file are read on a separate
+             * I/O thread, while the tracks that were read completely are already decoded on a
+             * pool of workers. Anything in this file is replaced, and the file should not be
+             * used until the load has finished.
+             * @param path The path of the file.
+             * @return std::future<DecodeResult> The result, with ERROR_IO if reading failed.
+             */
+            std::future<DecodeResult> loadAsync(const std::string& path);
+
+            /**
+             * Method to load a file in the background.
+             * @param path    The path of the file.
+             * @param options The options to decode with.
+             * @return std::future<DecodeResult> The result, with ERROR_IO if reading failed.
+             */
+            std::future<DecodeResult> loadAsync(const std::string& path, const DecodeOptions& options);
+
+            /**
+             * Method to load a file in the background, calling a callback when it is done.
+             * @param path     The path of the file.
+             * @param options  The options to decode with.
+             * @param callback Called with the result, from one of the background threads.
+             */
+            void loadAsync(const std::string& path, const DecodeOptions& options, const std::function<void(const DecodeResult&)>& callback);
+
+            /**
+             * Method to save a file in the background. The file is encoded by the pool of workers
+             * and written by the I/O thread, and it should not be changed until that is done.
+             * @param path The path to write to.
+             * @return std::future<Status> ERROR_IO if the file could not be created or written,
+             *                             ERROR_TRACK_LENGTH if a track is too long for a chunk.
+             */
+            std::future<Status> saveAsync(const std::string& path) const;
+
+            /**
+             * Method to save a file in the background, calling a callback when it is done.
+             * @param path     The path to write to.
+             * @param callback Called with the status, from one of the background threads.
+             */
+            void saveAsync(const std::string& path, const std::function<void(const Status&)>& callback) const;
+
             /**
              * Friend function to overload the operator to write to streams, used for
              * file writing. This makes it that the midi can be written to virtually
@@ -67,12 +255,28 @@ namespace Midi {
              */
             friend std::istream& operator >>(std::istream& input, File& f);
 
+            /**
+             * The decoder fills in the tracks and header directly.
+             */
+            friend class Decoder;
+
+            /**
+             * The loader hands over the tracks it decoded in the background.
+             */
+            friend class FileLoader;
+
         private:
             /**
-             * Since there is always a maximum of 16 tracks, create a primitive array.
-             * @var *Track[]
+             * The tracks, where a slot is NULL if no track was created for it.
+             * @var std::vector<Track*>
+             */
+            std::vector<Track*> _tracks;
+
+            /**
+             * The chunks that are not tracks, ordered by the slot they are written in front of.
+             * @var std::vector<std::pair<int, Chunk>>
              */
-            Track *_tracks[16];
+            std::vector<std::pair<int, Chunk>> _chunks;
 
             /**
              * This will keep track of the header data.
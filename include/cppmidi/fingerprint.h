@@ -0,0 +1,134 @@
+/**
+ * fingerprint.h
+ *
+ * Classes to recognize files with the same or nearly the same musical content, for finding
+ * duplicates in a corpus.
+ *
+ * A fingerprint only looks at the channel messages and the tempo changes, so names, text
+ * and other meta events do not matter. Every message is hashed together with its absolute
+ * tick, where a NOTE_ON without velocity counts as a NOTE_OFF and the velocity of a NOTE_OFF
+ * is ignored. The fingerprint of a track is the sum of the hashes of its events, and that of
+ * a file the sum of those of its tracks. Because of this, the order of the tracks and the
+ * order of the events on the same tick do not matter, and a file has the same fingerprint
+ * in format 0 and in format 1. Ticks are scaled to a fixed resolution first, so the same
+ * file saved with another division is recognized as well, as long as its events still fall
+ * on the same positions.
+ *
+ * A sketch finds files that are only nearly the same, with a few notes added, removed or
+ * moved. It is a MinHash of the shingles of consecutive notes, where a shingle holds the
+ * pitches and the time between the notes, so it does not change when the whole file is
+ * shifted in time. Two sketches estimate how similar the sets of shingles of two files are.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_FINGERPRINT_h
+#define MIDI_FINGERPRINT_h
+
+#include <cstdint>
+#include <cppmidi/file.h>
+#include <cppmidi/track.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    class Fingerprint {
+        public:
+            /**
+             * The amount of ticks per quarter note that ticks are scaled to.
+             * @var const static uint32_t
+             */
+            const static uint32_t RESOLUTION = 15360;
+
+            /**
+             * Method to compute the fingerprint of a track.
+             * @param track    The track.
+             * @param division The division from the header of the file the track is from.
+             * @return uint64_t The fingerprint, 0 for a track without messages and tempo changes.
+             */
+            static uint64_t of(const Track& track, uint16_t division);
+
+            /**
+             * Method to compute the fingerprint of a file, which is the sum of the fingerprints
+             * of its tracks.
+             * @param file The file.
+             * @return uint64_t The fingerprint, 0 for a file without messages and tempo changes.
+             */
+            static uint64_t of(const File& file);
+
+            /**
+             * Method to scale a tick to the fixed resolution. Ticks of files with SMPTE timing
+             * are not scaled, since they do not count in quarter notes.
+             * @param tick     The absolute tick.
+             * @param division The division from the header of the file.
+             * @return uint64_t The scaled tick.
+             */
+            static uint64_t normalize(uint32_t tick, uint16_t division) {
+                return (division & 0x8000) || division == 0 ? tick : (uint64_t) tick * RESOLUTION / division;
+            }
+    };
+
+    class Sketch {
+        public:
+            /**
+             * The amount of minimums, which sets the precision of the similarity.
+             * @var const static size_t
+             */
+            const static size_t SIZE = 64;
+
+            /**
+             * The amount of bands the minimums are split into for bucketing.
+             * @var const static size_t
+             */
+            const static size_t BANDS = 16;
+
+            /**
+             * The amount of consecutive notes in a shingle.
+             * @var const static size_t
+             */
+            const static size_t SHINGLE = 4;
+
+            /**
+             * Default constructor, for the sketch of a file without notes.
+             */
+            Sketch();
+
+            /**
+             * Constructor which computes the sketch of a file.
+             * @param file The file.
+             */
+            Sketch(const File& file);
+
+            /**
+             * Method to estimate how similar the content of two files is.
+             * @param other The sketch of the other file.
+             * @return double The estimated Jaccard similarity of the shingles, from 0 to 1.
+             */
+            double similarity(const Sketch& other) const;
+
+            /**
+             * Method to get the hash of a band of minimums. Files that share the hash of any
+             * band are likely to be similar, so using every band as a key in a hash table
+             * finds the candidates without comparing every pair of files.
+             * @param band The band, from 0 up to BANDS.
+             * @return uint64_t The hash of the band.
+             */
+            uint64_t getBand(size_t band) const;
+
+            /**
+             * Method to check whether the file had no notes.
+             * @return bool True if it had none.
+             */
+            bool empty() const { return minimums[0] == UINT64_MAX; }
+
+            /**
+             * The smallest hash of the shingles under every hash function, which are all
+             * UINT64_MAX if the file had no notes.
+             * @var uint64_t[SIZE]
+             */
+            uint64_t minimums[SIZE];
+    };
+}
+
+#endif
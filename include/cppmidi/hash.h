@@ -0,0 +1,70 @@
+/**
+ * hash.h
+ *
+ * Small non-cryptographic hash functions, used to recognize content that did not change,
+ * such as the source of a cache. They are fast and stable between platforms, but should
+ * not be relied on against anyone crafting collisions on purpose.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_HASH_h
+#define MIDI_HASH_h
+
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    class Hash {
+        public:
+            /**
+             * The initial value of a 64 bit FNV-1a hash.
+             * @var const static uint64_t
+             */
+            const static uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+
+            /**
+             * The prime of a 64 bit FNV-1a hash.
+             * @var const static uint64_t
+             */
+            const static uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+            /**
+             * Method to compute the 64 bit FNV-1a hash of some bytes, optionally continuing
+             * from the hash of the bytes before them.
+             * @param data The bytes.
+             * @param size The amount of bytes.
+             * @param hash The hash to continue from.
+             * @return uint64_t The hash.
+             */
+            static uint64_t fnv1a(const void *data, size_t size, uint64_t hash = FNV_OFFSET) {
+                const uint8_t *bytes = static_cast<const uint8_t*>(data);
+
+                for (size_t i = 0; i < size; i++)
+                    hash = (hash ^ bytes[i]) * FNV_PRIME;
+
+                return hash;
+            }
+
+            /**
+             * Method to mix the bits of a 64 bit value, so that values that are close together
+             * end up far apart. This is the finalizer of MurmurHash3.
+             * @param value The value.
+             * @return uint64_t The mixed value.
+             */
+            static uint64_t mix(uint64_t value) {
+                value ^= value >> 33;
+                value *= 0xff51afd7ed558ccdULL;
+                value ^= value >> 33;
+                value *= 0xc4ceb9fe1a85ec53ULL;
+                value ^= value >> 33;
+
+                return value;
+            }
+    };
+}
+
+#endif
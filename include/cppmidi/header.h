@@ -46,21 +46,20 @@ namespace Midi {
              * Method to get the currently used fileformat in the MidiMode style.
              * @return uint16_t  The currently used MidiMode.
              */
-            uint16_t getFileFormat() { return _fileFormat; }
+            uint16_t getFileFormat() const { return _fileFormat; }
 
             /**
-             * Method to get the number of tracks. Is always 2 bytes but has a
-             * maximum of 16.
+             * Method to get the number of tracks. Is always 2 bytes.
              * @return uint16_t Amount of tracks
              */
-            uint16_t getNumTracks() { return _numTracks; }
+            uint16_t getNumTracks() const { return _numTracks; }
 
             /**
              * Method to get the delta tick time, which is the amount of ticks per
              * quarter note.
              * @return uint16_t Amount of ticks
              */
-            uint16_t getDeltaTicks() { return _deltaTicks; }
+            uint16_t getDeltaTicks() const { return _deltaTicks; }
 
             /**
              * Method to set the current file format, constrained to the MidiMode.
@@ -68,12 +67,20 @@ namespace Midi {
              */
             void setFileFormat(MidiMode mode) { _fileFormat = mode; }
 
+            /**
+             * Method to set the delta tick time, the amount of ticks per quarter note. If the
+             * high bit is set, the upper byte is instead a negative SMPTE frame rate and the
+             * lower byte the amount of ticks per frame.
+             * @param ticks The amount of ticks.
+             */
+            void setDeltaTicks(uint16_t ticks) { _deltaTicks = ticks; }
+
             /**
              * Method to set the number of tracks currently used in the Midi file.
              * @param num   The number of tracks to be set.
              */
             bool setNumTracks(int num) {
-                if (num >= 16)
+                if (num > 0xFFFF || num < 0)
                     return false;
 
                 _numTracks = num;
@@ -99,6 +106,11 @@ namespace Midi {
              */
             friend std::istream& operator >>(std::istream& input, Header& head);
 
+            /**
+             * The decoder fills in the header directly.
+             */
+            friend class Decoder;
+
         private:
             /**
              * The currently used fileformat.
@@ -0,0 +1,147 @@
+/**
+ * intern.h
+ *
+ * Class which keeps a single copy of every distinct payload, so files that are held in
+ * memory together share the bytes of their track names, copyright notices, instrument
+ * names and other repeated meta events instead of all having their own copy.
+ *
+ * An interned payload is a normal Payload that refers to the single copy. The pool itself
+ * only watches the copies, so a copy is freed as soon as the last payload referring to it
+ * is gone, and the pool forgets it some time later. Payloads short enough to be stored
+ * inline are never interned, since they take no extra memory to begin with.
+ *
+ * The pool can be used by many threads at once, for example by a Batch through its
+ * DecodeOptions. It is split into shards with their own lock, so threads interning
+ * different payloads rarely wait for each other.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_INTERN_h
+#define MIDI_INTERN_h
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <cstdint>
+#include <cppmidi/payload.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    class InternPool {
+        public:
+            /**
+             * The amount of shards, which must be a power of two.
+             * @var const static size_t
+             */
+            const static size_t SHARDS = 16;
+
+            /**
+             * Default constructor, for an empty pool.
+             */
+            InternPool() : _hits(0), _misses(0) {}
+
+            /**
+             * The pool is shared by reference, and cannot be copied.
+             */
+            InternPool(const InternPool& pool) = delete;
+            InternPool& operator =(const InternPool& pool) = delete;
+
+            /**
+             * Destructor, after which the interned payloads still keep their bytes alive.
+             */
+            virtual ~InternPool() {}
+
+            /**
+             * Method to get the payload with the same bytes as the given ones, which refers to
+             * the single copy in the pool. If the pool has no copy yet, one is made.
+             * @param data The bytes.
+             * @param size The amount of bytes.
+             * @return Payload The interned payload.
+             */
+            Payload intern(const uint8_t *data, size_t size);
+
+            /**
+             * Method to get the interned payload with the same bytes as a payload.
+             * @param payload The payload.
+             * @return Payload The interned payload.
+             */
+            Payload intern(const Payload& payload) { return intern(payload.data(), payload.size()); }
+
+            /**
+             * Method to forget all the copies that are not used by any payload anymore. This
+             * also happens by itself as the pool grows.
+             * @return size_t The amount of forgotten copies.
+             */
+            size_t purge();
+
+            /**
+             * Method to get the amount of copies in the pool, including the ones that are not
+             * used anymore but were not forgotten yet.
+             * @return size_t The amount of copies.
+             */
+            size_t size() const;
+
+            /**
+             * Method to get how often a copy was found in the pool, and how often a new copy
+             * had to be made.
+             * @return uint64_t The amount of hits or misses.
+             */
+            uint64_t getHits() const { return _hits.load(std::memory_order_relaxed); }
+            uint64_t getMisses() const { return _misses.load(std::memory_order_relaxed); }
+
+        private:
+            /**
+             * A part of the pool with its own lock.
+             */
+            struct Shard {
+                /**
+                 * Default constructor
+                 */
+                Shard() : threshold(64) {}
+
+                /**
+                 * The lock for the copies.
+                 * @var std::mutex
+                 */
+                mutable std::mutex mutex;
+
+                /**
+                 * The copies, by the hash of their bytes.
+                 * @var std::unordered_multimap<uint64_t, std::weak_ptr<const std::vector<uint8_t>>>
+                 */
+                std::unordered_multimap<uint64_t, std::weak_ptr<const std::vector<uint8_t>>> copies;
+
+                /**
+                 * The amount of copies at which the unused ones are forgotten next.
+                 * @var size_t
+                 */
+                size_t threshold;
+            };
+
+            /**
+             * Method to forget the unused copies of a shard, which must be locked.
+             * @param shard The shard.
+             * @return size_t The amount of forgotten copies.
+             */
+            static size_t purge(Shard& shard);
+
+            /**
+             * The shards.
+             * @var Shard[SHARDS]
+             */
+            Shard _shards[SHARDS];
+
+            /**
+             * The amount of hits and misses.
+             * @var std::atomic<uint64_t>
+             */
+            std::atomic<uint64_t> _hits, _misses;
+    };
+}
+
+#endif
@@ -0,0 +1,346 @@
+/**
+ * noteindex.h
+ *
+ * Class which pairs the separate NOTE_ON and NOTE_OFF messages of a file into notes
+ * with a start and an end, and keeps them in an interval tree so all the notes that
+ * sound in a certain time range can be found quickly.
+ *
+ * The pairing is done in a single pass over every track. A NOTE_ON with a velocity of
+ * 0 counts as a NOTE_OFF, overlapping notes on the same channel and pitch are paired
+ * first in, first out and notes which never get turned off end at the last tick of
+ * their track. The NotePairer does the pairing itself, so everything that pairs notes,
+ * like the Statistics, pairs them in exactly the same way.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_NOTEINDEX_h
+#define MIDI_NOTEINDEX_h
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cppmidi/file.h>
+#include <cppmidi/track.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    /**
+     * A single paired note. The times are absolute ticks from the start of the track,
+     * and the note sounds from start up to (but not including) end.
+     */
+    struct Note {
+        /**
+         * The absolute tick of the NOTE_ON.
+         * @var uint32_t
+         */
+        uint32_t start;
+
+        /**
+         * The absolute tick of the NOTE_OFF, or of the end of the track if unterminated.
+         * @var uint32_t
+         */
+        uint32_t end;
+
+        /**
+         * The channel the note is played on. Ranges from 0-15.
+         * @var uint8_t
+         */
+        uint8_t channel;
+
+        /**
+         * The pitch of the note. Ranges from 0-127.
+         * @var uint8_t
+         */
+        uint8_t pitch;
+
+        /**
+         * The velocity of the NOTE_ON. Ranges from 1-127.
+         * @var uint8_t
+         */
+        uint8_t velocity;
+
+        /**
+         * Whether an actual NOTE_OFF was found for this note.
+         * @var bool
+         */
+        bool terminated;
+
+        /**
+         * The index of the track this note was found in.
+         * @var uint16_t
+         */
+        uint16_t track;
+    };
+
+    class NotePairer {
+        public:
+            /**
+             * Default constructor, for a track without any notes yet.
+             */
+            NotePairer() { reset(); }
+
+            /**
+             * Method to start pairing the notes of the next track.
+             */
+            void reset() {
+                std::fill(_head, _head + 16 * 128, -1);
+                std::fill(_tail, _tail + 16 * 128, -1);
+                _next.clear();
+            }
+
+            /**
+             * Method to open a note, for a NOTE_ON with a velocity above 0.
+             * @param channel The channel, ranging from 0-15.
+             * @param pitch   The pitch, ranging from 0-127.
+             * @return int32_t The number of the note, counting from 0 for every track.
+             */
+            int32_t open(uint8_t channel, uint8_t pitch) {
+                const uint16_t slot = (channel & 0x0F) << 7 | (pitch & 0x7F);
+                const int32_t note = _next.size();
+
+                /* The new note goes at the back of the queue of its channel and pitch. */
+                _next.push_back(-1);
+
+                if (_tail[slot] < 0)
+                    _head[slot] = note;
+                else
+                    _next[_tail[slot]] = note;
+
+                _tail[slot] = note;
+                return note;
+            }
+
+            /**
+             * Method to close the oldest open note on a channel and pitch, for a NOTE_OFF or a
+             * NOTE_ON with a velocity of 0.
+             * @param channel The channel, ranging from 0-15.
+             * @param pitch   The pitch, ranging from 0-127.
+             * @return int32_t The number of the closed note, -1 if no note was open.
+             */
+            int32_t close(uint8_t channel, uint8_t pitch) {
+                const uint16_t slot = (channel & 0x0F) << 7 | (pitch & 0x7F);
+                const int32_t note = _head[slot];
+
+                if (note >= 0 && (_head[slot] = _next[note]) < 0)
+                    _tail[slot] = -1;
+
+                return note;
+            }
+
+            /**
+             * Method to get the amount of notes that were opened in the track.
+             * @return size_t The amount of notes.
+             */
+            size_t size() const { return _next.size(); }
+
+        private:
+            /**
+             * Every channel and pitch combination has a queue of open notes, which is kept as a
+             * linked list through the next vector so no allocation per slot is needed. The first
+             * open note is the one that will be closed next.
+             * @var int32_t[16 * 128], int32_t[16 * 128], std::vector<int32_t>
+             */
+            int32_t _head[16 * 128], _tail[16 * 128];
+            std::vector<int32_t> _next;
+    };
+
+    class NoteIndex {
+        public:
+            /**
+             * Default constructor, which creates an empty index.
+             */
+            NoteIndex() {}
+
+            /**
+             * Constructor which pairs all the notes of all the tracks in a file.
+             * @param file The file to index.
+             */
+            NoteIndex(const File& file);
+
+            /**
+             * Constructor which pairs all the notes of a single track.
+             * @param track The track to index.
+             * @param index The track index which is stored in the notes.
+             */
+            NoteIndex(const Track& track, uint16_t index = 0);
+
+            /**
+             * Destructor
+             */
+            virtual ~NoteIndex() {}
+
+            /**
+             * Method to get all the notes, sorted on their start tick.
+             * @return const std::vector<Note>& The notes.
+             */
+            const std::vector<Note>& getNotes() const { return _notes; }
+
+            /**
+             * Method to get the amount of notes in the index.
+             * @return size_t The amount of notes.
+             */
+            size_t size() const { return _notes.size(); }
+
+            /**
+             * Operator to get a single note from the index.
+             * @param i The index of the note.
+             * @return const Note& The note.
+             */
+            const Note& operator [](size_t i) const { return _notes[i]; }
+
+            /**
+             * Method to find all the notes that sound somewhere in [t0, t1). A note without
+             * duration is treated as sounding on its start tick. The indexes of the found notes
+             * are appended to the result, in no particular order. Runs in O(log n + k).
+             * @param t0     The first tick of the range.
+             * @param t1     The first tick after the range.
+             * @param result The vector the note indexes will be appended to.
+             */
+            void query(uint32_t t0, uint32_t t1, std::vector<uint32_t>& result) const;
+
+            /**
+             * Method to find all the notes that sound somewhere in [t0, t1), like query, but
+             * instead of collecting the indexes the callback is called with every found note.
+             * @param t0       The first tick of the range.
+             * @param t1       The first tick after the range.
+             * @param callback Callable which accepts a const Note&.
+             */
+            template <typename Callback>
+            void forEach(uint32_t t0, uint32_t t1, Callback callback) const {
+                /* An empty range can never contain a note. */
+                if (t1 <= t0 || _nodes.empty())
+                    return;
+
+                visit(0, t0, t1 - 1, callback);
+            }
+
+        private:
+            /**
+             * A single node from the centered interval tree. The intervals of the node are stored
+             * twice in the shared arrays, once sorted on start and once sorted on end.
+             */
+            struct Node {
+                /**
+                 * The center tick, every note in this node contains this tick.
+                 * @var uint32_t
+                 */
+                uint32_t center;
+
+                /**
+                 * The offset of the intervals of this node in _byStart and _byEnd.
+                 * @var uint32_t
+                 */
+                uint32_t offset;
+
+                /**
+                 * The amount of intervals in this node.
+                 * @var uint32_t
+                 */
+                uint32_t count;
+
+                /**
+                 * The index of the left and right child nodes, -1 if there is none.
+                 * @var int32_t
+                 */
+                int32_t left, right;
+            };
+
+            /**
+             * Method which pairs the notes of a single track and appends them to the notes.
+             * @param track The track to pair.
+             * @param index The track index which is stored in the notes.
+             */
+            void pair(const Track& track, uint16_t index);
+
+            /**
+             * Method which sorts the notes and builds the interval tree from them.
+             */
+            void build();
+
+            /**
+             * Method which recursively builds a node from a set of note indexes.
+             * @param indexes The note indexes, sorted on start tick.
+             * @return int32_t The index of the node, -1 if the set was empty.
+             */
+            int32_t buildNode(std::vector<uint32_t>& indexes);
+
+            /**
+             * Method to get the last tick a note sounds on, inclusive.
+             * @param note The note.
+             * @return uint32_t The last tick.
+             */
+            static uint32_t last(const Note& note) { return note.end > note.start ? note.end - 1 : note.start; }
+
+            /**
+             * Method which recursively visits a node for the closed range [q0, q1].
+             * @param node     The node index.
+             * @param q0       The first tick of the range.
+             * @param q1       The last tick of the range.
+             * @param callback The callback for every found note.
+             */
+            template <typename Callback>
+            void visit(int32_t node, uint32_t q0, uint32_t q1, Callback& callback) const {
+                while (node >= 0) {
+                    const Node& n = _nodes[node];
+
+                    /* The range lies completely before the center, so only the notes starting
+                     * before the end of the range match, and only the left subtree can contain more.
+                     */
+                    if (q1 < n.center) {
+                        for (uint32_t i = n.offset; i < n.offset + n.count && _notes[_byStart[i]].start <= q1; i++)
+                            callback(_notes[_byStart[i]]);
+
+                        node = n.left;
+                    }
+
+                    /* The range lies completely after the center, so this is mirrored. */
+                    else if (q0 > n.center) {
+                        for (uint32_t i = n.offset; i < n.offset + n.count && last(_notes[_byEnd[i]]) >= q0; i++)
+                            callback(_notes[_byEnd[i]]);
+
+                        node = n.right;
+                    }
+
+                    /* The range contains the center, so every note in this node matches and both
+                     * subtrees have to be visited.
+                     */
+                    else {
+                        for (uint32_t i = n.offset; i < n.offset + n.count; i++)
+                            callback(_notes[_byStart[i]]);
+
+                        visit(n.left, q0, q1, callback);
+                        node = n.right;
+                    }
+                }
+            }
+
+            /**
+             * All the paired notes, sorted on start tick.
+             * @var std::vector<Note>
+             */
+            std::vector<Note> _notes;
+
+            /**
+             * The nodes of the interval tree, where the root is the first node.
+             * @var std::vector<Node>
+             */
+            std::vector<Node> _nodes;
+
+            /**
+             * The note indexes per node, sorted on ascending start.
+             * @var std::vector<uint32_t>
+             */
+            std::vector<uint32_t> _byStart;
+
+            /**
+             * The note indexes per node, sorted on descending end.
+             * @var std::vector<uint32_t>
+             */
+            std::vector<uint32_t> _byEnd;
+    };
+}
+
+#endif
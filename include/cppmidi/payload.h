@@ -0,0 +1,184 @@
+/**
+ * payload.h
+ *
+ * Class for the data bytes of events with a variable amount of data, such as sysex
+ * and meta events. A payload does not necessarily own its bytes: it can be a view into
+ * a buffer that is shared by many payloads (for example the buffer of a decoded file),
+ * or even a view into memory that is guaranteed to outlive it. Copying a payload
+ * never copies the bytes on the heap.
+ *
+ * Short payloads, like those of tempo and time signature events, are stored inside the
+ * payload itself, so they need no allocation and no indirection at all.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_PAYLOAD_h
+#define MIDI_PAYLOAD_h
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    class Payload {
+        public:
+            /**
+             * The maximum amount of bytes that is stored inside the payload.
+             * @var const static size_t
+             */
+            const static size_t INLINE_SIZE = 8;
+
+            /**
+             * Default constructor, which creates an empty payload.
+             */
+            Payload() : _data(NULL), _size(0), _inline(false) {}
+
+            /**
+             * Constructor which copies the bytes, either inside the payload if they fit, or into
+             * a new buffer owned by this payload (and the payloads copied from it).
+             * @param data The bytes to copy.
+             * @param size The amount of bytes.
+             */
+            Payload(const uint8_t *data, size_t size);
+
+            /**
+             * Constructor which creates a view into a shared buffer, which is kept alive for
+             * as long as the payload exists.
+             * @param owner The shared buffer.
+             * @param data  The first byte of the view, which must lie within the buffer.
+             * @param size  The amount of bytes in the view.
+             */
+            Payload(const std::shared_ptr<const void>& owner, const uint8_t *data, size_t size) :
+                _owner(owner), _data(data), _size(size), _inline(false) {}
+
+            /**
+             * Method to create a payload for bytes in a shared buffer. Short payloads are copied
+             * inside the payload, so they do not keep the buffer alive, and longer ones become a
+             * view into the buffer. Without a buffer, the bytes are always copied.
+             * @param owner The shared buffer, may be empty.
+             * @param data  The first byte, which must lie within the buffer.
+             * @param size  The amount of bytes.
+             * @return Payload The payload.
+             */
+            static Payload share(const std::shared_ptr<const void>& owner, const uint8_t *data, size_t size) {
+                if (!owner || size <= INLINE_SIZE)
+                    return Payload(data, size);
+
+                return Payload(owner, data, size);
+            }
+
+            /**
+             * Method to create a view into memory that is not owned by the payload at all. The
+             * caller has to make sure the memory outlives the payload and all its copies.
+             * @param data The first byte.
+             * @param size The amount of bytes.
+             * @return Payload The view.
+             */
+            static Payload borrow(const uint8_t *data, size_t size) { return Payload(std::shared_ptr<const void>(), data, size); }
+
+            /**
+             * Method to get a part of this payload, which shares the bytes with this payload.
+             * @param offset The offset of the first byte.
+             * @param size   The amount of bytes, clamped to the end of the payload.
+             * @return Payload The part of the payload.
+             */
+            Payload slice(size_t offset, size_t size) const {
+                if (offset > _size)
+                    offset = _size;
+
+                if (size > _size - offset)
+                    size = _size - offset;
+
+                /* An inline part has to be copied, since it cannot point into this payload. */
+                if (_inline)
+                    return Payload(_bytes + offset, size);
+
+                return Payload(_owner, _data + offset, size);
+            }
+
+            /**
+             * Method to get the bytes of this payload.
+             * @return const uint8_t* The first byte.
+             */
+            const uint8_t* data() const { return _inline ? _bytes : _data; }
+
+            /**
+             * Method to get the amount of bytes.
+             * @return size_t The size.
+             */
+            size_t size() const { return _size; }
+
+            /**
+             * Method to check if the payload is empty.
+             * @return bool True if there are no bytes.
+             */
+            bool empty() const { return _size == 0; }
+
+            /**
+             * Operator to get a single byte.
+             * @param i The index of the byte.
+             * @return uint8_t The byte.
+             */
+            uint8_t operator [](size_t i) const { return data()[i]; }
+
+            /**
+             * Methods to iterate over the bytes.
+             * @return const uint8_t* The begin or the end.
+             */
+            const uint8_t* begin() const { return data(); }
+            const uint8_t* end() const { return data() + _size; }
+
+            /**
+             * Method to check whether the bytes are owned by (or shared with) this payload, and
+             * are not borrowed memory.
+             * @return bool True if the bytes are kept alive by this payload.
+             */
+            bool owned() const { return _owner || _inline || _size == 0; }
+
+            /**
+             * Method to check whether the bytes are stored inside the payload.
+             * @return bool True if stored inline.
+             */
+            bool isInline() const { return _inline; }
+
+            /**
+             * Method to get the buffer that keeps the bytes alive, empty if borrowed.
+             * @return const std::shared_ptr<const void>& The owner.
+             */
+            const std::shared_ptr<const void>& getOwner() const { return _owner; }
+
+        private:
+            /**
+             * The buffer that holds the bytes, empty if the bytes are borrowed.
+             * @var std::shared_ptr<const void>
+             */
+            std::shared_ptr<const void> _owner;
+
+            /**
+             * Either the first byte somewhere else, or the bytes themselves if inline.
+             */
+            union {
+                const uint8_t *_data;
+                uint8_t _bytes[INLINE_SIZE];
+            };
+
+            /**
+             * The amount of bytes.
+             * @var uint32_t
+             */
+            uint32_t _size;
+
+            /**
+             * Whether the bytes are stored inline.
+             * @var bool
+             */
+            bool _inline;
+    };
+}
+
+#endif
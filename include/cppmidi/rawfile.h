@@ -0,0 +1,200 @@
+/**
+ * rawfile.h
+ *
+ * Class which holds a file as its chunks, without decoding any of the tracks. The chunks
+ * are views into the buffer the file was read into, so reading a file only checks the chunk
+ * headers, and copying, removing, reordering or splicing tracks between files only moves
+ * those views around. When the file is written, only the header and the chunk headers are
+ * written again, and the bytes of every track are copied exactly as they were read.
+ *
+ * Chunks with an unknown identifier are kept as well, in front of the same track. A single
+ * track can still be decoded on its own, and a decoded track can be added, which encodes it
+ * once.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_RAWFILE_h
+#define MIDI_RAWFILE_h
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <iostream>
+#include <cstdint>
+#include <cppmidi/chunk.h>
+#include <cppmidi/header.h>
+#include <cppmidi/track.h>
+#include <cppmidi/status.h>
+#include <cppmidi/decoder.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    class RawFile {
+        public:
+            /**
+             * The position after the last track, to add tracks at the end.
+             * @var const static size_t
+             */
+            const static size_t END = SIZE_MAX;
+
+            /**
+             * Default constructor, for a file without any tracks.
+             */
+            RawFile() {}
+
+            /**
+             * Destructor
+             */
+            virtual ~RawFile() {}
+
+            /**
+             * Method to read a file from a shared buffer, which the chunks keep alive. Anything
+             * in this file is replaced. Just like when decoding, reading continues after as many
+             * tracks as the header announces only for the unknown chunks that follow them.
+             * @param buffer The buffer with the bytes of the file.
+             * @return Status The error and its offset, ERROR_NONE on success. On failure the
+             *                file is left empty.
+             */
+            Status read(const std::shared_ptr<const std::vector<uint8_t>>& buffer);
+
+            /**
+             * Method to read a file from a stream, which should be in binary mode.
+             * @param input The input stream.
+             * @return Status The error and its offset, ERROR_NONE on success.
+             */
+            Status read(std::istream& input);
+
+            /**
+             * Method to read a file from disk.
+             * @param path The path of the file.
+             * @return Status The error and its offset, ERROR_IO if the file could not be opened.
+             */
+            Status load(const std::string& path);
+
+            /**
+             * Method to write the file to a stream, with the amount of tracks in the header
+             * set to the amount of track chunks.
+             * @param output The output stream.
+             * @return Status ERROR_IO if writing failed, with the offset where it failed.
+             */
+            Status write(std::ostream& output) const;
+
+            /**
+             * Method to write the file to disk.
+             * @param path The path to write to.
+             * @return Status ERROR_IO if the file could not be created or written.
+             */
+            Status save(const std::string& path) const;
+
+            /**
+             * Method to get the header. The amount of tracks in it is only set when writing.
+             * @return Header& The header.
+             */
+            Header& getHeader() { return _head; }
+            const Header& getHeader() const { return _head; }
+
+            /**
+             * Method to get all the chunks after the header, in the order they are written in.
+             * @return const std::vector<Chunk>& The chunks.
+             */
+            const std::vector<Chunk>& getChunks() const { return _chunks; }
+
+            /**
+             * Method to get the amount of track chunks.
+             * @return size_t The amount of tracks.
+             */
+            size_t getTrackCount() const;
+
+            /**
+             * Method to get a track chunk.
+             * @param index The index of the track.
+             * @return const Chunk* The chunk, NULL if there is no track at the index.
+             */
+            const Chunk* getTrack(size_t index) const;
+
+            /**
+             * Method to decode a single track.
+             * @param index   The index of the track.
+             * @param track   The track to add the events to.
+             * @param options The options to decode with.
+             * @return Status The error and its offset within the chunk, ERROR_TRUNCATED if
+             *                there is no track at the index.
+             */
+            Status decodeTrack(size_t index, Track& track, const DecodeOptions& options = DecodeOptions()) const;
+
+            /**
+             * Method to add a decoded track, which is encoded once.
+             * @param track    The track.
+             * @param position The index the track gets, END to add it after the last track.
+             * @return bool False if the file cannot hold another track, or the track is too
+             *              long for a chunk.
+             */
+            bool addTrack(const Track& track, size_t position = END);
+
+            /**
+             * Method to copy tracks from another file, or from this file itself, without
+             * decoding them. A file of format 0 becomes a file of format 1 when it gets a
+             * second track, and a file without tracks takes over the division of the source.
+             * @param source   The file to copy the tracks from.
+             * @param first    The index of the first track to copy.
+             * @param count    The amount of tracks to copy, END for all tracks from the first.
+             * @param position The index the first copied track gets, END to add them after
+             *                 the last track.
+             * @return bool False if the divisions of the files differ, the tracks are out of
+             *              range, or there would be too many tracks, in which case nothing
+             *              is copied.
+             */
+            bool splice(const RawFile& source, size_t first = 0, size_t count = END, size_t position = END);
+
+            /**
+             * Method to remove a track.
+             * @param index The index of the track.
+             * @return bool False if there is no track at the index.
+             */
+            bool removeTrack(size_t index);
+
+            /**
+             * Method to rearrange the tracks. Every entry is the current index of the track
+             * that gets that position, so tracks may also be left out or repeated. Unknown
+             * chunks stay in front of the track with the same index.
+             * @param order The current indices of the tracks, in their new order.
+             * @return bool False if an index is out of range or there would be too many
+             *              tracks, in which case nothing changes.
+             */
+            bool reorder(const std::vector<size_t>& order);
+
+        private:
+            /**
+             * Method to find the chunk of a track.
+             * @param index The index of the track.
+             * @return size_t The index of the chunk, or the amount of chunks if there is no
+             *                track at the index.
+             */
+            size_t locate(size_t index) const;
+
+            /**
+             * Method to check whether the file can hold more tracks, and to change the format
+             * of a file with a single track if needed.
+             * @param count The amount of tracks the file would have.
+             * @return bool False if the header cannot count that many tracks.
+             */
+            bool admit(size_t count);
+
+            /**
+             * The header.
+             * @var Header
+             */
+            Header _head;
+
+            /**
+             * The chunks after the header.
+             * @var std::vector<Chunk>
+             */
+            std::vector<Chunk> _chunks;
+    };
+}
+
+#endif
@@ -0,0 +1,191 @@
+/**
+ * renderer.h
+ *
+ * Class to render a file to audio offline, for quick previews of what it sounds like. The
+ * notes are played by a small polyphonic synthesizer, with a wavetable oscillator and an
+ * envelope for every family of General MIDI programs, and a simple drum voice for the
+ * percussion channel 10. The volume, expression, pan, program and pitch bend of a channel
+ * are taken at the moment a note starts, and are not followed while the note sounds.
+ *
+ * The audio is cut into time slices which are rendered in parallel on a thread pool. Every
+ * voice renders the same samples regardless of the slice it is rendered in, so the result
+ * does not depend on the amount of threads.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_RENDERER_h
+#define MIDI_RENDERER_h
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <cppmidi/file.h>
+#include <cppmidi/status.h>
+#include <cppmidi/threadpool.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    class RenderOptions {
+        public:
+            /**
+             * Default constructor, with the defaults.
+             */
+            RenderOptions() : sampleRate(44100), threads(0), sliceFrames(1 << 14), polyphony(64), gain(1.0), normalize(true), maxSeconds(600) {}
+
+            /**
+             * The amount of frames per second.
+             * @var unsigned
+             */
+            unsigned sampleRate;
+
+            /**
+             * The amount of worker threads, 0 for one per hardware thread.
+             * @var unsigned
+             */
+            unsigned threads;
+
+            /**
+             * The amount of frames in every time slice that is rendered as a separate task.
+             * @var size_t
+             */
+            size_t sliceFrames;
+
+            /**
+             * The largest amount of notes that sound at once. When another note starts, the
+             * oldest note is faded out quickly.
+             * @var size_t
+             */
+            size_t polyphony;
+
+            /**
+             * The gain the mix is multiplied with.
+             * @var double
+             */
+            double gain;
+
+            /**
+             * Whether the mix is scaled down if it would clip otherwise.
+             * @var bool
+             */
+            bool normalize;
+
+            /**
+             * The longest audio that is rendered, in seconds, 0 for no limit. A file that would
+             * be longer is not rendered at all, since the whole mix is held in memory.
+             * @var double
+             */
+            double maxSeconds;
+    };
+
+    class RenderStats {
+        public:
+            /**
+             * Default constructor, for nothing rendered.
+             */
+            RenderStats() : frames(0), voices(0), seconds(0), elapsed(0), peak(0) {}
+
+            /**
+             * Method to get how many times faster than real time the file was rendered.
+             * @return double The real-time factor.
+             */
+            double realTimeFactor() const { return elapsed > 0 ? seconds / elapsed : 0; }
+
+            /**
+             * The amount of rendered frames.
+             * @var uint64_t
+             */
+            uint64_t frames;
+
+            /**
+             * The amount of rendered voices, one for every note.
+             * @var size_t
+             */
+            size_t voices;
+
+            /**
+             * The length of the audio, in seconds.
+             * @var double
+             */
+            double seconds;
+
+            /**
+             * The time rendering took, in seconds.
+             * @var double
+             */
+            double elapsed;
+
+            /**
+             * The largest absolute sample of the mix before it was normalized, where 1 is full scale.
+             * @var double
+             */
+            double peak;
+
+            /**
+             * The error, ERROR_LIMIT_DURATION if the audio would be longer than allowed, in
+             * which case nothing was rendered.
+             * @var Status
+             */
+            Status status;
+    };
+
+    class Renderer {
+        public:
+            /**
+             * Constructor, which starts the worker threads.
+             * @param options The options for rendering.
+             */
+            Renderer(const RenderOptions& options = RenderOptions()) : _options(options), _pool(options.threads) {}
+
+            /**
+             * Destructor
+             */
+            virtual ~Renderer() {}
+
+            /**
+             * Method to render a file.
+             * @param file    The file.
+             * @param samples The stereo samples, interleaved left and right, replacing anything in it.
+             * @return RenderStats The statistics of the rendering, with the error if it failed.
+             */
+            RenderStats render(const File& file, std::vector<int16_t>& samples);
+
+            /**
+             * Method to render a file into a WAV file.
+             * @param file  The file.
+             * @param path  The path of the WAV file.
+             * @param stats If not NULL, the statistics of the rendering are stored here.
+             * @return Status The status, with ERROR_IO if the WAV file could not be written, or the
+             *                error of render(), in which case no WAV file is written.
+             */
+            Status save(const File& file, const std::string& path, RenderStats *stats = NULL);
+
+            /**
+             * Method to write 16 bit PCM samples as a WAV file.
+             * @param output     The output stream, in binary mode.
+             * @param samples    The samples, interleaved per channel.
+             * @param sampleRate The amount of frames per second.
+             * @param channels   The amount of channels.
+             * @return bool False if writing failed or there are too many samples for a WAV file.
+             */
+            static bool writeWav(std::ostream& output, const std::vector<int16_t>& samples, unsigned sampleRate, uint16_t channels = 2);
+
+        private:
+            /**
+             * The options.
+             * @var RenderOptions
+             */
+            RenderOptions _options;
+
+            /**
+             * The pool that renders the slices.
+             * @var ThreadPool
+             */
+            ThreadPool _pool;
+    };
+}
+
+#endif
@@ -0,0 +1,274 @@
+/**
+ * snapshot.h
+ *
+ * Classes to share a file between threads while it is being edited. A snapshot is an
+ * immutable version of a file, which is cheap to copy since it only refers to its tracks.
+ * An editor starts from a snapshot and copies a track only when it is changed, so the next
+ * snapshot shares all the other tracks with the previous one. Readers keep using the
+ * snapshot they hold, without ever being blocked by the editor.
+ *
+ * A SharedFile holds the latest snapshot, which readers load and editors replace.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_SNAPSHOT_h
+#define MIDI_SNAPSHOT_h
+
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <iostream>
+#include <cstdint>
+#include <cppmidi/file.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    /**
+     * The contents of a snapshot, which are never changed after it was published.
+     */
+    struct SnapshotData {
+        /**
+         * The header.
+         * @var Header
+         */
+        Header header;
+
+        /**
+         * The tracks, where a slot is empty if there is no track for it.
+         * @var std::vector<std::shared_ptr<const Track>>
+         */
+        std::vector<std::shared_ptr<const Track>> tracks;
+
+        /**
+         * The chunks that are not tracks, with the slot of the track they are in front of.
+         * @var std::vector<std::pair<int, Chunk>>
+         */
+        std::vector<std::pair<int, Chunk>> chunks;
+
+        /**
+         * The version, which is 1 higher than that of the snapshot it was edited from.
+         * @var uint64_t
+         */
+        uint64_t version;
+    };
+
+    class Snapshot {
+        public:
+            /**
+             * Default constructor, for an empty file.
+             */
+            Snapshot();
+
+            /**
+             * Constructor which copies all the tracks and other chunks of a file.
+             * @param file The file.
+             */
+            Snapshot(const File& file);
+
+            /**
+             * Method to get the header.
+             * @return const Header& The header.
+             */
+            const Header& getHeader() const { return _data->header; }
+
+            /**
+             * Method to get the amount of track slots.
+             * @return int The amount of track slots.
+             */
+            int getTrackSlots() const { return _data->tracks.size(); }
+
+            /**
+             * Method to get a track.
+             * @param index The index of the track.
+             * @return const Track* The track, NULL if there is no track at the index.
+             */
+            const Track* getTrack(int index) const;
+
+            /**
+             * Method to get a track that stays valid after the snapshot is gone.
+             * @param index The index of the track.
+             * @return std::shared_ptr<const Track> The track, empty if there is no track at the index.
+             */
+            std::shared_ptr<const Track> shareTrack(int index) const;
+
+            /**
+             * Method to get the version of the snapshot.
+             * @return uint64_t The version.
+             */
+            uint64_t getVersion() const { return _data->version; }
+
+            /**
+             * Method to copy the snapshot into a file that can be changed freely.
+             * @param file The file, of which anything is replaced.
+             */
+            void toFile(File& file) const;
+
+            /**
+             * Stream operator, which writes the snapshot just like the file it holds.
+             * @param output   The output stream.
+             * @param snapshot The snapshot.
+             * @return std::ostream& The original output stream.
+             */
+            friend std::ostream& operator <<(std::ostream& output, const Snapshot& snapshot);
+
+            /**
+             * The editor and shared file create and replace the data.
+             */
+            friend class SnapshotEditor;
+            friend class SharedFile;
+
+        private:
+            /**
+             * Constructor for data that was built already.
+             * @param data The data.
+             */
+            Snapshot(const std::shared_ptr<const SnapshotData>& data) : _data(data) {}
+
+            /**
+             * The data, which is shared by all the copies of the snapshot.
+             * @var std::shared_ptr<const SnapshotData>
+             */
+            std::shared_ptr<const SnapshotData> _data;
+    };
+
+    class SnapshotEditor {
+        public:
+            /**
+             * Constructor
+             * @param base The snapshot to start from.
+             */
+            SnapshotEditor(const Snapshot& base);
+
+            /**
+             * Method to get the header, to change the format or division. The amount of
+             * tracks is kept up to date by the editor.
+             * @return Header& The header.
+             */
+            Header& getHeader() { return _header; }
+
+            /**
+             * Method to get a track without changing it.
+             * @param index The index of the track.
+             * @return const Track* The track, NULL if there is no track at the index.
+             */
+            const Track* getTrack(int index) const;
+
+            /**
+             * Method to get a track to change it. The first time a shared track is edited, it
+             * is copied, and a track is created if there was none at the index.
+             * @param index The index of the track.
+             * @return Track* The track, NULL if the index is too large for the header.
+             */
+            Track* editTrack(int index);
+
+            /**
+             * Method to replace a track by a copy of another track.
+             * @param index The index of the track.
+             * @param track The track to copy.
+             * @return bool False if the index is too large for the header.
+             */
+            bool setTrack(int index, const Track& track);
+
+            /**
+             * Method to remove a track, leaving its slot empty.
+             * @param index The index of the track.
+             */
+            void removeTrack(int index);
+
+            /**
+             * Method to create the snapshot with the changes so far. The editor can be used
+             * again afterwards, and will copy the tracks it edits again.
+             * @return Snapshot The new snapshot.
+             */
+            Snapshot commit();
+
+        private:
+            /**
+             * The header.
+             * @var Header
+             */
+            Header _header;
+
+            /**
+             * The tracks, shared with the snapshots, and those that only this editor can
+             * change, which are NULL for the tracks that are shared.
+             * @var std::vector<std::shared_ptr<const Track>>, std::vector<Track*>
+             */
+            std::vector<std::shared_ptr<const Track>> _tracks;
+            std::vector<Track*> _owned;
+
+            /**
+             * The chunks that are not tracks, which the editor passes on unchanged.
+             * @var std::vector<std::pair<int, Chunk>>
+             */
+            std::vector<std::pair<int, Chunk>> _chunks;
+
+            /**
+             * The version of the snapshot the editor started from.
+             * @var uint64_t
+             */
+            uint64_t _version;
+    };
+
+    class SharedFile {
+        public:
+            /**
+             * Default constructor, for an empty file.
+             */
+            SharedFile() : _data(Snapshot()._data) {}
+
+            /**
+             * Constructor
+             * @param snapshot The first snapshot.
+             */
+            SharedFile(const Snapshot& snapshot) : _data(snapshot._data) {}
+
+            /**
+             * Destructor
+             */
+            virtual ~SharedFile() {}
+
+            /**
+             * Method to get the latest snapshot, which never blocks on editors.
+             * @return Snapshot The snapshot.
+             */
+            Snapshot load() const { return Snapshot(std::atomic_load(&_data)); }
+
+            /**
+             * Method to replace the latest snapshot.
+             * @param snapshot The new snapshot.
+             */
+            void store(const Snapshot& snapshot) { std::atomic_store(&_data, snapshot._data); }
+
+            /**
+             * Method to edit the latest snapshot. If another editor published a snapshot in the
+             * meantime, the edit is done again on that snapshot, so no changes are lost.
+             * @param callback Callable which accepts a SnapshotEditor&.
+             * @return Snapshot The published snapshot.
+             */
+            template <typename Callback>
+            Snapshot update(Callback callback) {
+                while (true) {
+                    Snapshot base = load();
+                    SnapshotEditor editor(base);
+                    callback(editor);
+
+                    Snapshot next = editor.commit();
+                    if (std::atomic_compare_exchange_strong(&_data, &base._data, next._data))
+                        return next;
+                }
+            }
+
+        private:
+            /**
+             * The latest snapshot, which is only accessed atomically.
+             * @var std::shared_ptr<const SnapshotData>
+             */
+            std::shared_ptr<const SnapshotData> _data;
+    };
+}
+
+#endif
@@ -0,0 +1,219 @@
+/**
+ * stateindex.h
+ *
+ * Class which knows the state of every channel at any tick of a file: the value of every
+ * controller, the program, the pitch bend and the channel pressure, together with the
+ * tempo. Without it, starting playback in the middle of a file means replaying everything
+ * before that point.
+ *
+ * All the changes of state of all the tracks are merged into a single list, and the full
+ * state is stored as a checkpoint at a fixed interval of ticks. The state at a tick is then
+ * found by copying the checkpoint before it and replaying only the changes in between.
+ *
+ * Channel mode messages (controllers 120 and up) are not state, except that resetting all
+ * controllers forgets the modulation, expression, pedals, pitch bend and pressure of the
+ * channel, as General MIDI recommends. Data increments and decrements are not chased.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_STATEINDEX_h
+#define MIDI_STATEINDEX_h
+
+#include <vector>
+#include <cstdint>
+#include <cppmidi/file.h>
+#include <cppmidi/track.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    /**
+     * The state of a single channel. Everything that was never set is UNSET, so it can be
+     * told apart from a value that was set explicitly.
+     */
+    struct ChannelState {
+        /**
+         * The value of everything that was never set.
+         * @var const static uint8_t
+         */
+        const static uint8_t UNSET = 0xFF;
+
+        /**
+         * The value of every controller.
+         * @var uint8_t[128]
+         */
+        uint8_t controllers[128];
+
+        /**
+         * The program.
+         * @var uint8_t
+         */
+        uint8_t program;
+
+        /**
+         * The channel pressure.
+         * @var uint8_t
+         */
+        uint8_t pressure;
+
+        /**
+         * The least and most significant 7 bits of the pitch bend.
+         * @var uint8_t
+         */
+        uint8_t bendLow, bendHigh;
+    };
+
+    /**
+     * The state of all the channels, and the tempo.
+     */
+    struct SongState {
+        /**
+         * The state of every channel.
+         * @var ChannelState[16]
+         */
+        ChannelState channels[16];
+
+        /**
+         * The tempo in microseconds per quarter note, 0 if it was never set.
+         * @var uint32_t
+         */
+        uint32_t tempo;
+    };
+
+    class StateIndex {
+        public:
+            /**
+             * Constructor which collects the changes of state of all the tracks in a file.
+             * @param file     The file to index.
+             * @param interval The amount of ticks between two checkpoints, 0 for every 16
+             *                 quarter notes.
+             */
+            StateIndex(const File& file, uint32_t interval = 0);
+
+            /**
+             * Destructor
+             */
+            virtual ~StateIndex() {}
+
+            /**
+             * Method to get the state after all the events before a tick, which is the state
+             * playback starting at that tick begins with.
+             * @param tick The absolute tick.
+             * @return SongState The state.
+             */
+            SongState stateAt(uint32_t tick) const;
+
+            /**
+             * Method to copy the events in [from, to) of the file the index was built from into
+             * a new file, with every track shifted to start at tick 0. The chased state is put
+             * at tick 0: the tempo on the first track, and every channel on the first track that
+             * uses it. Notes still sounding at the end are turned off there, and note offs of
+             * notes that started before the range are left out.
+             * @param file   The file the index was built from.
+             * @param from   The first tick of the range.
+             * @param to     The first tick after the range.
+             * @param output The file to fill, which is cleared first.
+             * @return bool False if the file is of format 2, where the tracks do not share state.
+             */
+            bool extract(const File& file, uint32_t from, uint32_t to, File& output) const;
+
+            /**
+             * Method to get the amount of ticks between two checkpoints.
+             * @return uint32_t The interval.
+             */
+            uint32_t getInterval() const { return _interval; }
+
+            /**
+             * Method to get the amount of checkpoints.
+             * @return size_t The amount of checkpoints.
+             */
+            size_t getCheckpoints() const { return _checkpoints.size(); }
+
+        private:
+            /**
+             * A single change of state. For a tempo change the status is 0xFF and the tempo
+             * is stored in the value, otherwise the value holds the data bytes of the message.
+             */
+            struct Change {
+                /**
+                 * The absolute tick.
+                 * @var uint32_t
+                 */
+                uint32_t tick;
+
+                /**
+                 * The first data byte in the lowest byte and the second one above it, or the tempo.
+                 * @var uint32_t
+                 */
+                uint32_t value;
+
+                /**
+                 * The status byte.
+                 * @var uint8_t
+                 */
+                uint8_t status;
+            };
+
+            /**
+             * The state at the start of an interval, with the first change after it.
+             */
+            struct Checkpoint {
+                /**
+                 * The tick the interval starts at.
+                 * @var uint32_t
+                 */
+                uint32_t tick;
+
+                /**
+                 * The state after all the changes before the interval.
+                 * @var SongState
+                 */
+                SongState state;
+
+                /**
+                 * The position of the first change in the interval.
+                 * @var size_t
+                 */
+                size_t position;
+            };
+
+            /**
+             * Method to apply a change to a state.
+             * @param state  The state.
+             * @param change The change.
+             */
+            static void apply(SongState& state, const Change& change);
+
+            /**
+             * Method to append the events that restore a state to a track, all at tick 0.
+             * @param state    The state.
+             * @param channels Which channels to restore on this track.
+             * @param tempo    Whether to restore the tempo on this track.
+             * @param track    The track.
+             */
+            static void restore(const SongState& state, const bool *channels, bool tempo, Track& track);
+
+            /**
+             * The amount of ticks between two checkpoints.
+             * @var uint32_t
+             */
+            uint32_t _interval;
+
+            /**
+             * All the changes, sorted on tick.
+             * @var std::vector<Change>
+             */
+            std::vector<Change> _changes;
+
+            /**
+             * The checkpoints, sorted on tick. Intervals without any changes do not get a
+             * checkpoint, so long silences take no memory.
+             * @var std::vector<Checkpoint>
+             */
+            std::vector<Checkpoint> _checkpoints;
+    };
+}
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * statistics.h
+ *
+ * Class which collects musical statistics of files: histograms of pitch classes, velocities
+ * and note durations, how many notes sound at the same time, and how active every channel
+ * is. All of them are computed together in a single pass over the columns of a file, such
+ * as those of EventColumns or a CacheView, without looking at any event objects.
+ *
+ * Statistics of different files can be merged, so the statistics of a whole corpus can be
+ * collected in parallel and combined afterwards.
+ *
+ * Notes are paired the same way as in the NoteIndex. Times are measured in quarter notes,
+ * where files with SMPTE timing count half a second as a quarter note.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_STATISTICS_h
+#define MIDI_STATISTICS_h
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cppmidi/file.h>
+#include <cppmidi/columns.h>
+#include <cppmidi/cache.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    class Statistics {
+        public:
+            /**
+             * The amount of buckets of the duration histogram.
+             * @var const static size_t
+             */
+            const static size_t DURATION_BUCKETS = 16;
+
+            /**
+             * The amount of polyphony levels, where the last level counts everything above it.
+             * @var const static size_t
+             */
+            const static size_t POLYPHONY_LEVELS = 64;
+
+            /**
+             * Default constructor, for statistics without any files.
+             */
+            Statistics();
+
+            /**
+             * Method to add the statistics of a file.
+             * @param file The file.
+             */
+            void add(const File& file) { add(EventColumns(file)); }
+
+            /**
+             * Method to add the statistics of the columns of a file.
+             * @param columns The columns.
+             */
+            void add(const EventColumns& columns);
+
+            /**
+             * Method to add the statistics of a cached file.
+             * @param view The opened cache.
+             */
+            void add(const CacheView& view);
+
+            /**
+             * Method to add the statistics that were collected by somebody else.
+             * @param other The other statistics.
+             */
+            void merge(const Statistics& other);
+
+            /**
+             * Method to get the average amount of notes per quarter note.
+             * @return double The note density.
+             */
+            double getDensity() const { return quarters > 0 ? notes / quarters : 0; }
+
+            /**
+             * Method to get the average amount of notes that sound at the same time.
+             * @return double The average polyphony.
+             */
+            double getAveragePolyphony() const;
+
+            /**
+             * The amount of files, events and notes.
+             * @var uint64_t
+             */
+            uint64_t files;
+            uint64_t events;
+            uint64_t notes;
+
+            /**
+             * The total length of the files, in quarter notes.
+             * @var double
+             */
+            double quarters;
+
+            /**
+             * The amount of notes per pitch class, where 0 is C.
+             * @var uint64_t[12]
+             */
+            uint64_t pitchClasses[12];
+
+            /**
+             * The amount of notes per velocity.
+             * @var uint64_t[128]
+             */
+            uint64_t velocities[128];
+
+            /**
+             * The amount of notes per duration, where bucket 0 holds the notes shorter than a
+             * 32nd note and bucket b those from 2^(b-1) up to 2^b 32nd notes. The last bucket
+             * also holds all the longer notes.
+             * @var uint64_t[DURATION_BUCKETS]
+             */
+            uint64_t durations[DURATION_BUCKETS];
+
+            /**
+             * The amount of quarter notes during which a number of notes sound at once.
+             * @var double[POLYPHONY_LEVELS]
+             */
+            double polyphony[POLYPHONY_LEVELS];
+
+            /**
+             * The largest amount of notes that sound at once.
+             * @var uint32_t
+             */
+            uint32_t maxPolyphony;
+
+            /**
+             * The amount of messages and notes on every channel.
+             * @var uint64_t[16]
+             */
+            uint64_t channelMessages[16];
+            uint64_t channelNotes[16];
+
+        private:
+            /**
+             * Method to add the statistics of a file stored in columns.
+             * @param division The division from the header.
+             * @param ticks    The absolute ticks of the events.
+             * @param status   The status bytes.
+             * @param data1    The first data bytes.
+             * @param data2    The second data bytes.
+             * @param tracks   The first event and the amount of events of every track.
+             */
+            void add(uint16_t division, const uint32_t *ticks, const uint8_t *status, const uint8_t *data1, const uint8_t *data2,
+                     const std::vector<std::pair<size_t, size_t>>& tracks);
+    };
+}
+
+#endif
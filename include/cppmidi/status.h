@@ -0,0 +1,95 @@
+/**
+ * status.h
+ *
+ * The error codes used when checking or decoding MIDI data without exceptions, and a small
+ * status object which combines an error code with the offset in the input where it occurred.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_STATUS_h
+#define MIDI_STATUS_h
+
+#include <cstddef>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    /**
+     * Enum with everything that can be wrong with MIDI data.
+     */
+    enum ErrorCode {
+        ERROR_NONE = 0,
+        ERROR_TRUNCATED,
+        ERROR_HEADER_MAGIC,
+        ERROR_HEADER_LENGTH,
+        ERROR_HEADER_FORMAT,
+        ERROR_CHUNK_MAGIC,
+        ERROR_CHUNK_LENGTH,
+        ERROR_VLVALUE,
+        ERROR_DATA_BYTE,
+        ERROR_STATUS_BYTE,
+        ERROR_EVENT_OVERRUN,
+        ERROR_MISSING_EOT,
+        ERROR_EVENT_AFTER_EOT,
+        ERROR_IO,
+        ERROR_CACHE_FORMAT,
+        ERROR_CACHE_VERSION,
+        ERROR_ARCHIVE_FORMAT,
+        ERROR_LIMIT_BYTES,
+        ERROR_LIMIT_EVENTS,
+        ERROR_LIMIT_PAYLOAD,
+        ERROR_LIMIT_MEMORY,
+        ERROR_TRACK_LENGTH,
+        ERROR_LIMIT_DURATION
+    };
+
+    class Status {
+        public:
+            /**
+             * Default constructor, which is a status without any error.
+             */
+            Status() : code(ERROR_NONE), offset(0) {}
+
+            /**
+             * Constructor
+             * @param c The error code.
+             * @param o The offset in the input where the error was found.
+             */
+            Status(ErrorCode c, size_t o) : code(c), offset(o) {}
+
+            /**
+             * Method to check if this status is free of errors.
+             * @return bool True if there was no error.
+             */
+            bool ok() const { return code == ERROR_NONE; }
+
+            /**
+             * Method to get a human readable description of the error code.
+             * @return const char* The description.
+             */
+            const char* describe() const { return describe(code); }
+
+            /**
+             * Method to get a human readable description of an error code.
+             * @param code The error code.
+             * @return const char* The description.
+             */
+            static const char* describe(ErrorCode code);
+
+            /**
+             * The error code, ERROR_NONE if everything is fine.
+             * @var ErrorCode
+             */
+            ErrorCode code;
+
+            /**
+             * The offset in the input of the byte where the error was found.
+             * @var size_t
+             */
+            size_t offset;
+    };
+}
+
+#endif
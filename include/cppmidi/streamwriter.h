@@ -0,0 +1,153 @@
+/**
+ * streamwriter.h
+ *
+ * Class to write a file while its events are being produced, without ever holding a track
+ * in memory. Events are encoded into a block of a fixed size, which is written whenever it
+ * is full. Since the length of a track chunk is only known once the track is finished, it
+ * is written as 0 first and filled in afterwards, just like the amount of tracks in the
+ * header. The output therefore has to be seekable, such as a std::ofstream.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_STREAMWRITER_h
+#define MIDI_STREAMWRITER_h
+
+#include <iostream>
+#include <memory>
+#include <cstdint>
+#include <cppmidi/event.h>
+#include <cppmidi/header.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    /**
+     * The stream buffer holding the block, see the implementation.
+     */
+    class StreamBlock;
+
+    class StreamWriter {
+        public:
+            /**
+             * Constructor, which writes the header.
+             * @param output    The output stream, which should be seekable and in binary mode.
+             * @param format    The format of the file.
+             * @param division  The amount of ticks per quarter note, or the SMPTE division.
+             * @param blockSize The size in bytes of the block the events are encoded into.
+             */
+            StreamWriter(std::ostream& output, MidiMode format = MULTITRACK_SYNC, uint16_t division = 96, size_t blockSize = 1 << 16);
+
+            /**
+             * Destructor, which closes the file if that was not done yet.
+             */
+            virtual ~StreamWriter();
+
+            /**
+             * Method to start a new track, which finishes the current track first.
+             * @return bool False if the file was closed, writing failed, or the format or
+             *              header do not allow another track.
+             */
+            bool beginTrack();
+
+            /**
+             * Method to add an event to the current track.
+             * @param event The event, with its delta time.
+             * @return bool False if there is no track, the track was ended with an end of
+             *              track event already, it would become too long, or writing failed.
+             */
+            bool write(const Event& event);
+
+            /**
+             * Method to finish the current track, adding an end of track event if the last
+             * event was not one, and filling in the length of the track.
+             * @return bool False if there is no track or writing failed.
+             */
+            bool endTrack();
+
+            /**
+             * Method to finish the file, by finishing the current track and filling in the
+             * amount of tracks in the header. Nothing can be written afterwards.
+             * @return bool False if writing failed.
+             */
+            bool close();
+
+            /**
+             * Method to get the amount of tracks that were started.
+             * @return uint16_t The amount of tracks.
+             */
+            uint16_t getTracks() const { return _tracks; }
+
+            /**
+             * Method to get the amount of bytes written so far, including the bytes in the block.
+             * @return uint64_t The size of the file.
+             */
+            uint64_t getSize() const { return _size; }
+
+        private:
+            /**
+             * Method to fill in a big endian value that was written before.
+             * @param offset The offset of the value, relative to the start of the file.
+             * @param value  The value.
+             * @param size   The amount of bytes, 2 or 4.
+             * @return bool False if writing failed.
+             */
+            bool patch(uint64_t offset, uint32_t value, size_t size);
+
+            /**
+             * The output stream.
+             * @var std::ostream&
+             */
+            std::ostream& _output;
+
+            /**
+             * The block the events are encoded into, and the stream encoding into it.
+             * @var std::unique_ptr<StreamBlock>, std::unique_ptr<std::ostream>
+             */
+            std::unique_ptr<StreamBlock> _block;
+            std::unique_ptr<std::ostream> _stream;
+
+            /**
+             * The position of the start of the file in the output.
+             * @var std::streampos
+             */
+            std::streampos _start;
+
+            /**
+             * The format of the file.
+             * @var MidiMode
+             */
+            MidiMode _format;
+
+            /**
+             * The amount of bytes written so far.
+             * @var uint64_t
+             */
+            uint64_t _size;
+
+            /**
+             * The amount of tracks that were started.
+             * @var uint16_t
+             */
+            uint16_t _tracks;
+
+            /**
+             * The offset of the current track chunk, and the length of its data so far.
+             * @var uint64_t
+             */
+            uint64_t _trackOffset;
+            uint64_t _trackLength;
+
+            /**
+             * Whether a track is open, whether it was ended with an end of track event, and
+             * whether the file was closed.
+             * @var bool
+             */
+            bool _open;
+            bool _ended;
+            bool _closed;
+    };
+}
+
+#endif
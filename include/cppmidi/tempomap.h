@@ -0,0 +1,162 @@
+/**
+ * tempomap.h
+ *
+ * Class which converts between ticks and real time, using all the tempo changes of a file.
+ * Every tempo change stores the time at which it happens, so a conversion only needs a
+ * binary search and a single multiplication.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_TEMPOMAP_h
+#define MIDI_TEMPOMAP_h
+
+#include <vector>
+#include <cstdint>
+#include <cppmidi/file.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    /**
+     * A single tempo change. The layout is fixed, since it is stored in caches as is.
+     */
+    struct TempoChange {
+        /**
+         * The absolute tick at which the tempo changes.
+         * @var uint32_t
+         */
+        uint32_t tick;
+
+        /**
+         * The new tempo, in microseconds per quarter note.
+         * @var uint32_t
+         */
+        uint32_t tempo;
+
+        /**
+         * The time of the change, in microseconds since the start.
+         * @var uint64_t
+         */
+        uint64_t microseconds;
+    };
+
+    class TempoMap {
+        public:
+            /**
+             * The tempo until the first tempo change, being 120 beats per minute.
+             * @var const static uint32_t
+             */
+            const static uint32_t DEFAULT_TEMPO = 500000;
+
+            /**
+             * Constructor for a map without tempo changes.
+             * @param division The division from the header of the file.
+             */
+            TempoMap(uint16_t division = 96);
+
+            /**
+             * Constructor which collects the tempo changes from all the tracks of a file.
+             * @param file The file.
+             */
+            TempoMap(const File& file);
+
+            /**
+             * Constructor from tempo changes that were computed before, such as from a cache.
+             * @param division The division from the header of the file.
+             * @param changes  The tempo changes, sorted on tick.
+             * @param count    The amount of tempo changes.
+             */
+            TempoMap(uint16_t division, const TempoChange *changes, size_t count);
+
+            /**
+             * Destructor
+             */
+            virtual ~TempoMap() {}
+
+            /**
+             * Method to add a tempo change, after which the times of all the changes are
+             * computed again.
+             * @param tick  The absolute tick.
+             * @param tempo The tempo in microseconds per quarter note.
+             */
+            void add(uint32_t tick, uint32_t tempo);
+
+            /**
+             * Method to convert an absolute tick into microseconds since the start.
+             * @param tick The absolute tick.
+             * @return uint64_t The time in microseconds.
+             */
+            uint64_t toMicroseconds(uint32_t tick) const;
+
+            /**
+             * Method to convert an absolute tick into seconds since the start.
+             * @param tick The absolute tick.
+             * @return double The time in seconds.
+             */
+            double toSeconds(uint32_t tick) const { return toMicroseconds(tick) / 1e6; }
+
+            /**
+             * Method to convert a time into the last tick at or before it.
+             * @param microseconds The time in microseconds since the start.
+             * @return uint32_t The absolute tick.
+             */
+            uint32_t toTick(uint64_t microseconds) const;
+
+            /**
+             * Method to get the tempo at a tick.
+             * @param tick The absolute tick.
+             * @return uint32_t The tempo in microseconds per quarter note.
+             */
+            uint32_t getTempo(uint32_t tick) const;
+
+            /**
+             * Method to get all the tempo changes, sorted on tick. There is always a change
+             * at tick 0, which is the default tempo if the file does not set one.
+             * @return const std::vector<TempoChange>& The tempo changes.
+             */
+            const std::vector<TempoChange>& getChanges() const { return _changes; }
+
+            /**
+             * Method to get the division the map was built with.
+             * @return uint16_t The division.
+             */
+            uint16_t getDivision() const { return _division; }
+
+        private:
+            /**
+             * Method to find the last change at or before a tick.
+             * @param tick The absolute tick.
+             * @return const TempoChange& The change.
+             */
+            const TempoChange& find(uint32_t tick) const;
+
+            /**
+             * Method to convert an amount of ticks into microseconds at a tempo.
+             * @param ticks The amount of ticks.
+             * @param tempo The tempo.
+             * @return uint64_t The amount of microseconds.
+             */
+            uint64_t duration(uint64_t ticks, uint32_t tempo) const;
+
+            /**
+             * Method which sorts the changes and computes their times.
+             */
+            void update();
+
+            /**
+             * The division from the header of the file.
+             * @var uint16_t
+             */
+            uint16_t _division;
+
+            /**
+             * The tempo changes.
+             * @var std::vector<TempoChange>
+             */
+            std::vector<TempoChange> _changes;
+    };
+}
+
+#endif
@@ -0,0 +1,147 @@
+/**
+ * threadpool.h
+ *
+ * Class for a simple work-stealing thread pool. Every worker has its own queue of tasks,
+ * which it runs last in, first out. A worker that runs out of tasks steals the oldest task
+ * of another worker. Tasks that are submitted from inside a task go to the queue of the
+ * worker that runs it, so splitting work into smaller tasks keeps it local.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_THREADPOOL_h
+#define MIDI_THREADPOOL_h
+
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <condition_variable>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    class ThreadPool {
+        public:
+            /**
+             * Constructor, which starts the workers.
+             * @param threads The amount of workers, 0 for one per hardware thread.
+             */
+            ThreadPool(unsigned threads = 0);
+
+            /**
+             * Destructor, which waits for all the tasks to finish and stops the workers.
+             */
+            virtual ~ThreadPool();
+
+            /**
+             * Method to add a task to the pool.
+             * @param task The task to run.
+             */
+            void submit(const std::function<void()>& task);
+
+            /**
+             * Method which blocks until all the submitted tasks, including the tasks they
+             * submitted themselves, have finished. Should not be called from inside a task.
+             */
+            void wait();
+
+            /**
+             * Method to get the amount of workers.
+             * @return unsigned The amount of workers.
+             */
+            unsigned size() const { return _threads.size(); }
+
+        private:
+            /**
+             * The queue of a single worker.
+             */
+            struct Queue {
+                /**
+                 * Mutex protecting the tasks, which is hardly ever contended.
+                 * @var std::mutex
+                 */
+                std::mutex mutex;
+
+                /**
+                 * The tasks, where the owner takes from the back and thieves from the front.
+                 * @var std::deque<std::function<void()>>
+                 */
+                std::deque<std::function<void()>> tasks;
+            };
+
+            /**
+             * Method which is run by every worker.
+             * @param index The index of the worker.
+             */
+            void run(unsigned index);
+
+            /**
+             * Method to take a task, from the own queue first and otherwise from another.
+             * @param index The index of the worker.
+             * @param task  The task that was taken.
+             * @return bool True if a task was found.
+             */
+            bool take(unsigned index, std::function<void()>& task);
+
+            /**
+             * The queues of the workers.
+             * @var std::vector<std::unique_ptr<Queue>>
+             */
+            std::vector<std::unique_ptr<Queue>> _queues;
+
+            /**
+             * The worker threads.
+             * @var std::vector<std::thread>
+             */
+            std::vector<std::thread> _threads;
+
+            /**
+             * Mutex for sleeping and waking up, and for the counters below.
+             * @var std::mutex
+             */
+            std::mutex _mutex;
+
+            /**
+             * Condition to wake up sleeping workers when there are tasks.
+             * @var std::condition_variable
+             */
+            std::condition_variable _available;
+
+            /**
+             * Condition to wake up wait() when all tasks are done.
+             * @var std::condition_variable
+             */
+            std::condition_variable _idle;
+
+            /**
+             * The amount of tasks waiting in the queues.
+             * @var size_t
+             */
+            size_t _queued;
+
+            /**
+             * The amount of tasks that were submitted but did not finish yet.
+             * @var size_t
+             */
+            size_t _pending;
+
+            /**
+             * The queue that gets the next task submitted from outside the pool.
+             * @var std::atomic<unsigned>
+             */
+            std::atomic<unsigned> _next;
+
+            /**
+             * Whether the workers should stop.
+             * @var bool
+             */
+            bool _stopping;
+    };
+}
+
+#endif
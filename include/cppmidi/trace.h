@@ -0,0 +1,160 @@
+/**
+ * trace.h
+ *
+ * Tracing of where the time of decoding and encoding goes, such as opening files, parsing
+ * the header, decoding and encoding every track and the work of a batch. Every span records
+ * its thread, its start and duration and the amount of bytes it handled, and the recorded
+ * spans are written as a Chrome trace (the JSON trace event format), which can be opened
+ * in chrome://tracing or Perfetto.
+ *
+ * The spans in the library are only compiled in when CPPMIDI_TRACING is defined, which the
+ * Makefile does with TRACE=1. Without it the macros below are empty and tracing costs
+ * nothing at all. With it, spans are only recorded between Trace::start() and Trace::stop(),
+ * and every thread records into a buffer of its own, so threads never wait for each other.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_TRACE_h
+#define MIDI_TRACE_h
+
+#include <atomic>
+#include <string>
+#include <iostream>
+#include <cstdint>
+#include <cppmidi/status.h>
+
+/**
+ * Macros to trace a span from here to the end of the scope, and to set the amount of bytes
+ * it handled once that is known. The name must be a string literal.
+ */
+#ifdef CPPMIDI_TRACING
+#define CPPMIDI_TRACE_SPAN(span, name, bytes) Midi::TraceSpan span(name, bytes)
+#define CPPMIDI_TRACE_BYTES(span, bytes) span.setBytes(bytes)
+#else
+#define CPPMIDI_TRACE_SPAN(span, name, bytes) ((void) 0)
+#define CPPMIDI_TRACE_BYTES(span, bytes) ((void) 0)
+#endif
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    class Trace {
+        public:
+            /**
+             * Method to start recording spans.
+             */
+            static void start() { _active.store(true, std::memory_order_relaxed); }
+
+            /**
+             * Method to stop recording spans. The spans that were recorded are kept.
+             */
+            static void stop() { _active.store(false, std::memory_order_relaxed); }
+
+            /**
+             * Method to check whether spans are recorded.
+             * @return bool True if they are.
+             */
+            static bool active() { return _active.load(std::memory_order_relaxed); }
+
+            /**
+             * Method to get the current time of the clock the spans use.
+             * @return uint64_t The time in nanoseconds.
+             */
+            static uint64_t now();
+
+            /**
+             * Method to record a span on the calling thread.
+             * @param name  The name, which must stay valid, like a string literal.
+             * @param begin The start time, from now().
+             * @param end   The end time, from now().
+             * @param bytes The amount of bytes that were handled, 0 if that does not apply.
+             */
+            static void record(const char *name, uint64_t begin, uint64_t end, uint64_t bytes);
+
+            /**
+             * Method to get the amount of recorded spans.
+             * @return size_t The amount of spans.
+             */
+            static size_t size();
+
+            /**
+             * Method to throw away all the recorded spans.
+             */
+            static void clear();
+
+            /**
+             * Method to write the recorded spans as a Chrome trace.
+             * @param output The output stream.
+             * @return Status ERROR_IO if writing failed.
+             */
+            static Status write(std::ostream& output);
+
+            /**
+             * Method to save the recorded spans as a Chrome trace.
+             * @param path The path to write to.
+             * @return Status ERROR_IO if the file could not be created or written.
+             */
+            static Status save(const std::string& path);
+
+        private:
+            /**
+             * Whether spans are recorded.
+             * @var std::atomic<bool>
+             */
+            static std::atomic<bool> _active;
+    };
+
+    class TraceSpan {
+        public:
+            /**
+             * Constructor, which starts the span if spans are recorded.
+             * @param name  The name, which must stay valid, like a string literal.
+             * @param bytes The amount of bytes that are handled, 0 if that does not apply.
+             */
+            TraceSpan(const char *name, uint64_t bytes = 0) :
+                _name(name), _bytes(bytes), _begin(Trace::active() ? Trace::now() : 0) {}
+
+            /**
+             * A span is recorded once, and cannot be copied.
+             */
+            TraceSpan(const TraceSpan& span) = delete;
+            TraceSpan& operator =(const TraceSpan& span) = delete;
+
+            /**
+             * Destructor, which records the span if it was started.
+             */
+            virtual ~TraceSpan() {
+                if (_begin != 0)
+                    Trace::record(_name, _begin, Trace::now(), _bytes);
+            }
+
+            /**
+             * Method to set the amount of bytes that were handled.
+             * @param bytes The amount of bytes.
+             */
+            void setBytes(uint64_t bytes) { _bytes = bytes; }
+
+        private:
+            /**
+             * The name.
+             * @var const char*
+             */
+            const char *_name;
+
+            /**
+             * The amount of bytes.
+             * @var uint64_t
+             */
+            uint64_t _bytes;
+
+            /**
+             * The start time, 0 if the span was not started.
+             * @var uint64_t
+             */
+            uint64_t _begin;
+    };
+}
+
+#endif
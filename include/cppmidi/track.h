@@ -11,7 +11,10 @@
 
 #include <iostream>
 #include <vector>
+#include <atomic>
 #include <cppmidi/event.h>
+#include <cppmidi/eventindex.h>
+#include <cppmidi/events/message.h>
 
 /**
  * Setting up the midi namespace
@@ -25,12 +28,32 @@ namespace Midi {
              */
             const static char* IDENTIFIER;
 
+            /**
+             * Default constructor
+             */
+            Track() : _length(0), _index(NULL) {}
+
+            /**
+             * Copy constructor, which clones all the events of the other track.
+             * @param track The track to copy.
+             */
+            Track(const Track& track);
+
+            /**
+             * Assignment operator, which replaces the events by clones of those of the other track.
+             * @param track The track to copy.
+             * @return Track& This track.
+             */
+            Track& operator =(const Track& track);
+
             /**
              * Destructor, frees up all the copied pointers.
              */
             virtual ~Track() {
                 for (auto event : _events)
                     delete event;
+
+                delete _index.load();
             }
 
             /**
@@ -50,6 +73,25 @@ namespace Midi {
              */
             friend std::istream& operator >>(std::istream& input, Track& track);
 
+            /**
+             * The decoder adds the decoded events directly.
+             */
+            friend class Decoder;
+
+            /**
+             * The converter moves the cloned events directly into presized tracks.
+             */
+            friend class Converter;
+
+            /**
+             * The state index moves the events of an extracted range directly into tracks.
+             */
+            friend class StateIndex;
+
+            /**
+             * The track builder moves its sorted events directly into tracks.
+             */
+            friend class TrackBuilder;
 
             /**
              * Method to add an event to the internal events. This will simply clone the
@@ -60,6 +102,42 @@ namespace Midi {
                 return addEvent(e.clone());
             }
 
+            /**
+             * Method to get all the events in this track, in the order they will be written.
+             * @return const std::vector<Event*>& The events of this track.
+             */
+            const std::vector<Event*>& getEvents() const { return _events; }
+
+            /**
+             * Method to get the length of the track data, which excludes the chunk identifier
+             * and the length itself.
+             * @return uint32_t The length in bytes.
+             */
+            uint32_t getLength() const { return _length; }
+
+            /**
+             * Method to get the index with the positions of the events per channel and type.
+             * The index is built the first time it is needed and kept until the track changes.
+             * Building is safe from multiple threads, as long as nobody modifies the track.
+             * @return const EventIndex& The index of this track.
+             */
+            const EventIndex& getIndex() const;
+
+            /**
+             * Method to visit all the messages of a type on a channel, without touching any
+             * of the other events in the track.
+             * @param type     The message type.
+             * @param channel  The channel, ranging from 0-15.
+             * @param callback Callable which accepts the absolute tick and a const Message&.
+             */
+            template <typename Callback>
+            void forEachMessage(Events::MessageType type, uint8_t channel, Callback callback) const {
+                const EventIndex& index = getIndex();
+
+                for (auto position : index.get(type, channel))
+                    callback(index.getTick(position), *static_cast<const Events::Message*>(_events[position]));
+            }
+
         private:
 
             /**
@@ -70,12 +148,23 @@ namespace Midi {
              * @todo Check the length.
              */
             bool addEvent(Event* e) {
+                invalidate();
+
                 _length += e->getLength();
                 _events.push_back(e);
 
                 return true;
             }
 
+            /**
+             * Method which throws away the index, since it no longer matches the events.
+             */
+            void invalidate() {
+                /* Checking first, so adding events to a track that was never indexed stays cheap. */
+                if (_index.load(std::memory_order_relaxed) != NULL)
+                    delete _index.exchange(NULL);
+            }
+
             /**
              * Integer to keep track of the track length, which is a maximum of 4 bytes.
              * @var uint32_t
@@ -87,6 +176,12 @@ namespace Midi {
              * @var std::vector<Event*>
              */
             std::vector<Event*> _events;
+
+            /**
+             * The lazily built index of the events, NULL if it was not built yet.
+             * @var std::atomic<EventIndex*>
+             */
+            mutable std::atomic<EventIndex*> _index;
     };
 }
 
@@ -0,0 +1,167 @@
+/**
+ * trackbuilder.h
+ *
+ * Class to build a track from events at absolute ticks that are added in any order, for
+ * example by a generator that produces the note offs long after the note ons, or by many
+ * threads at once. The events are only put in order when the track is built, with a stable
+ * radix sort on the tick and a priority, after which the delta times follow in a single pass.
+ *
+ * The priority decides the order of events on the same tick, lowest first. By default meta
+ * events come first, then system exclusive messages, note offs, the other channel messages
+ * and finally note ons, so a note that ends on the tick another one starts is not cut short.
+ * Events with the same tick and priority keep the order they were added in by each thread.
+ *
+ * Adding is split into shards with their own lock, picked by the adding thread, so threads
+ * rarely wait for each other.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_TRACKBUILDER_h
+#define MIDI_TRACKBUILDER_h
+
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <cppmidi/event.h>
+#include <cppmidi/track.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    class TrackBuilder {
+        public:
+            /**
+             * The amount of shards, which must be a power of two.
+             * @var const static size_t
+             */
+            const static size_t SHARDS = 16;
+
+            /**
+             * Default constructor, for a builder without events.
+             */
+            TrackBuilder() {}
+
+            /**
+             * The builder owns the events that were added, and cannot be copied.
+             */
+            TrackBuilder(const TrackBuilder& builder) = delete;
+            TrackBuilder& operator =(const TrackBuilder& builder) = delete;
+
+            /**
+             * Destructor, which frees the events that were not built into a track.
+             */
+            virtual ~TrackBuilder() { clear(); }
+
+            /**
+             * Method to add a copy of an event, with the default priority for its kind.
+             * @param tick  The absolute tick.
+             * @param event The event, of which the delta time is ignored.
+             */
+            void add(uint32_t tick, const Event& event) { add(tick, event, priority(event)); }
+
+            /**
+             * Method to add a copy of an event.
+             * @param tick     The absolute tick.
+             * @param event    The event, of which the delta time is ignored.
+             * @param priority The priority among the events on the same tick, lowest first.
+             */
+            void add(uint32_t tick, const Event& event, uint8_t priority);
+
+            /**
+             * Method to add a note on and its note off.
+             * @param tick     The absolute tick of the note on.
+             * @param duration The amount of ticks until the note off.
+             * @param channel  The channel, ranging from 0-15.
+             * @param note     The note number.
+             * @param velocity The velocity of the note on.
+             */
+            void addNote(uint32_t tick, uint32_t duration, uint8_t channel, uint8_t note, uint8_t velocity);
+
+            /**
+             * Method to get the amount of events that were added.
+             * @return size_t The amount of events.
+             */
+            size_t size() const;
+
+            /**
+             * Method to throw away all the events that were added.
+             */
+            void clear();
+
+            /**
+             * Method to move all the events into a track, in order, after the events that are
+             * already in it. Events before the last of those events are moved up to its tick.
+             * The track gets a single end of track event at the very end: one that ends the
+             * track already is moved there, and the ones that were added only make the end
+             * later. The builder is empty afterwards. This should not be called while other
+             * threads are adding.
+             * @param track The track.
+             * @param end   The earliest tick of the end of track event.
+             */
+            void build(Track& track, uint32_t end = 0);
+
+            /**
+             * Method to get the default priority of an event.
+             * @param event The event.
+             * @return uint8_t The priority.
+             */
+            static uint8_t priority(const Event& event);
+
+        private:
+            /**
+             * An event that was added, with the tick and priority it is sorted on.
+             */
+            struct Entry {
+                /**
+                 * The tick in the upper bits and the priority in the lowest byte.
+                 * @var uint64_t
+                 */
+                uint64_t key;
+
+                /**
+                 * The event.
+                 * @var Event*
+                 */
+                Event *event;
+            };
+
+            /**
+             * A part of the builder with its own lock.
+             */
+            struct Shard {
+                /**
+                 * The lock for the entries.
+                 * @var std::mutex
+                 */
+                mutable std::mutex mutex;
+
+                /**
+                 * The entries, in the order they were added.
+                 * @var std::vector<Entry>
+                 */
+                std::vector<Entry> entries;
+            };
+
+            /**
+             * Method to get the shard of the calling thread.
+             * @return Shard& The shard.
+             */
+            Shard& shard();
+
+            /**
+             * Method to sort entries on their key, keeping the order of equal keys.
+             * @param entries The entries.
+             */
+            static void sort(std::vector<Entry>& entries);
+
+            /**
+             * The shards.
+             * @var Shard[SHARDS]
+             */
+            Shard _shards[SHARDS];
+    };
+}
+
+#endif
@@ -0,0 +1,77 @@
+/**
+ * validator.h
+ *
+ * Class which checks whether a buffer holds a well formed standard MIDI file, without
+ * decoding or allocating anything. This is meant to reject garbage cheaply before the
+ * much more expensive decoding is started.
+ *
+ * Checked are the chunk magic and lengths, the header fields, the variable length values,
+ * the data bytes of all messages, the status bytes (including running status) and the
+ * placement of the end of track event. Chunks with an unknown but printable identifier
+ * are skipped, as the MIDI specification demands.
+ *
+ * A track without an end of track event, or with bytes after it, is an error here. The
+ * Decoder accepts such a track, but completes it with an end of track event and ignores
+ * the bytes after it, so the decoded track is valid.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_VALIDATOR_h
+#define MIDI_VALIDATOR_h
+
+#include <vector>
+#include <cstdint>
+#include <cppmidi/status.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    class Validator {
+        public:
+            /**
+             * Method to validate a complete MIDI file in memory.
+             * @param data The bytes of the file.
+             * @param size The amount of bytes.
+             * @return Status The first error found and its offset, ERROR_NONE if valid.
+             */
+            static Status validate(const uint8_t *data, size_t size);
+
+            /**
+             * Method to validate a complete MIDI file in memory.
+             * @param buffer The bytes of the file.
+             * @return Status The first error found and its offset, ERROR_NONE if valid.
+             */
+            static Status validate(const std::vector<uint8_t>& buffer) { return validate(buffer.data(), buffer.size()); }
+
+            /**
+             * Method to validate the events of a single track chunk.
+             * @param data  The bytes of the file.
+             * @param begin The offset of the first event, right after the chunk header.
+             * @param end   The offset right after the last byte of the chunk.
+             * @return Status The first error found and its offset, ERROR_NONE if valid.
+             */
+            static Status validateTrack(const uint8_t *data, size_t begin, size_t end);
+
+            /**
+             * The amount of data bytes that follow a status byte, indexed by the upper nibble.
+             * System messages are handled separately and have 0 here.
+             * @var const static uint8_t[]
+             */
+            const static uint8_t DATA_BYTES[16];
+
+            /**
+             * Method to check if a chunk identifier consists of printable characters only, which
+             * is what an unknown chunk that can be skipped should look like.
+             * @param data The first of the 4 bytes.
+             * @return bool True if printable.
+             */
+            static bool isPrintable(const uint8_t *data) {
+                return (data[0] - 0x20u) < 0x5F && (data[1] - 0x20u) < 0x5F
+                    && (data[2] - 0x20u) < 0x5F && (data[3] - 0x20u) < 0x5F;
+            }
+    };
+}
+
+#endif
@@ -18,6 +18,8 @@
 
 #include <iostream>
 #include <vector>
+#include <cstdint>
+#include <cppmidi/status.h>
 
 /**
  * Setting up the basic namespace.
@@ -74,6 +76,15 @@ namespace Midi {
              */
             uint8_t getLength() const { return _bytes.size(); }
 
+            /**
+             * Method to get the length a value would have as a VLValue, without creating one.
+             * @param value The value.
+             * @return uint8_t The length it would be when written to a stream.
+             */
+            static uint8_t lengthOf(uint32_t value) {
+                return 1 + (value >= (1u << 7)) + (value >= (1u << 14)) + (value >= (1u << 21)) + (value >= (1u << 28));
+            }
+
             /**
              * Method to set the value of this VLValue.
              * @param value The value to set this VLValue to.
@@ -85,6 +96,31 @@ namespace Midi {
              * @return uint32_t The value of this VLValue object as an integer.
              */
             uint32_t getValue() const { return _value; }
+
+            /**
+             * Method to read a variable length value from memory, which is at most 4 bytes long.
+             * @param data   The bytes to read from.
+             * @param offset The offset of the value, moved past it on success.
+             * @param end    The offset the value must end before.
+             * @param value  The decoded value.
+             * @return ErrorCode ERROR_NONE on success, ERROR_EVENT_OVERRUN or ERROR_VLVALUE otherwise.
+             */
+            static ErrorCode read(const uint8_t *data, size_t& offset, size_t end, uint32_t& value) {
+                value = 0;
+
+                for (int i = 0; i < 4; i++) {
+                    if (offset >= end)
+                        return ERROR_EVENT_OVERRUN;
+
+                    const uint8_t byte = data[offset++];
+                    value = value << 7 | (byte & 0x7F);
+
+                    if (!(byte & 0x80))
+                        return ERROR_NONE;
+                }
+
+                return ERROR_VLVALUE;
+            }
         private:
 
             /**
@@ -0,0 +1,361 @@
+/**
+ * wire.h
+ *
+ * Classes to read and write MIDI as it is sent over a cable or a serial port, instead of as
+ * it is stored in a file. On the wire there are no delta times, a status byte may be left
+ * out if it is the same as the one before (running status), and real-time bytes such as the
+ * clock, start and stop may appear anywhere, even in the middle of another message.
+ *
+ * The parser takes the bytes one at a time and never allocates: it keeps a few bytes of
+ * state, takes constant time per byte and reports every complete event as a WireEvent of 8
+ * bytes. A system exclusive message can be any length, so its data is reported in chunks
+ * of up to 6 bytes. Every chunk except the last has status 0xF0, and the last one has status
+ * 0xF7, even if the message was ended by another status byte instead of by 0xF7.
+ *
+ * The encoder writes events into one of the sinks from encoder.h, leaving out the status
+ * byte when running status allows it.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_WIRE_h
+#define MIDI_WIRE_h
+
+#include <cstdint>
+#include <cstring>
+#include <cppmidi/encoder.h>
+#include <cppmidi/events/message.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    /**
+     * A single event from the wire.
+     */
+    struct WireEvent {
+        /**
+         * The largest amount of data bytes in an event, for a chunk of a system exclusive message.
+         * @var const static uint8_t
+         */
+        const static uint8_t CHUNK_SIZE = 6;
+
+        /**
+         * Method to create the event for a channel message.
+         * @param msg The message.
+         * @return WireEvent The event.
+         */
+        static WireEvent from(const Events::Message& msg) {
+            WireEvent event = { uint8_t(msg.getType() << 4 | msg.getChannel()), 2, { msg.getData1(), msg.getData2() } };
+
+            if (msg.getType() == Events::MessageType::PROGRAM_CHANGE || msg.getType() == Events::MessageType::CHANNEL_AFTERTOUCH)
+                event.data[1] = 0, event.size = 1;
+
+            return event;
+        }
+
+        /**
+         * Method to create the channel message of the event, which must be a channel message.
+         * @return Events::Message The message.
+         */
+        Events::Message toMessage() const {
+            return Events::Message(getType(), getChannel(), data[0], size > 1 ? data[1] : 0);
+        }
+
+        /**
+         * Methods to check what kind of event this is.
+         * @return bool True if it is of that kind.
+         */
+        bool isChannel() const { return status < 0xF0; }
+        bool isSystemCommon() const { return status > 0xF0 && status < 0xF7; }
+        bool isSysEx() const { return status == 0xF0 || status == 0xF7; }
+        bool isRealtime() const { return status >= 0xF8; }
+
+        /**
+         * Method to get the type of a channel message.
+         * @return Events::MessageType The type.
+         */
+        Events::MessageType getType() const { return static_cast<Events::MessageType>(status >> 4); }
+
+        /**
+         * Method to get the channel of a channel message.
+         * @return uint8_t The channel, ranging from 0-15.
+         */
+        uint8_t getChannel() const { return status & 0x0F; }
+
+        /**
+         * The status byte.
+         * @var uint8_t
+         */
+        uint8_t status;
+
+        /**
+         * The amount of data bytes.
+         * @var uint8_t
+         */
+        uint8_t size;
+
+        /**
+         * The data bytes.
+         * @var uint8_t[CHUNK_SIZE]
+         */
+        uint8_t data[CHUNK_SIZE];
+    };
+
+    class WireParser {
+        public:
+            /**
+             * Default constructor, for a parser that has not seen any status byte yet.
+             */
+            WireParser() : _status(0), _expected(0), _dropped(0) {
+                _event.size = 0;
+            }
+
+            /**
+             * Method to parse a single byte. A single byte completes at most two events: when
+             * a status byte ends a system exclusive message and is a complete event itself.
+             * @param byte     The byte.
+             * @param callback Callable which accepts a const WireEvent&.
+             */
+            template <typename Callback>
+            void push(uint8_t byte, Callback&& callback) {
+                /* Real-time bytes may appear anywhere, and do not change any state. */
+                if (byte >= 0xF8) {
+                    const WireEvent event = { byte, 0, { 0 } };
+                    callback(event);
+                    return;
+                }
+
+                if (byte < 0x80) {
+                    if (_status == 0) {
+                        _dropped++;
+                        return;
+                    }
+
+                    _event.data[_event.size++] = byte;
+
+                    if (_status == 0xF0) {
+                        if (_event.size == WireEvent::CHUNK_SIZE)
+                            flush(0xF0, callback);
+                    }
+                    else if (_event.size == _expected)
+                        complete(callback);
+
+                    return;
+                }
+
+                /* Any status byte ends a system exclusive message. */
+                if (_status == 0xF0) {
+                    flush(0xF7, callback);
+                    _status = 0;
+
+                    if (byte == 0xF7)
+                        return;
+                }
+
+                /* An end of exclusive without a system exclusive message does nothing. */
+                if (byte == 0xF7) {
+                    _status = 0;
+                    return;
+                }
+
+                _status = byte;
+                _expected = expected(byte);
+                _event.status = byte;
+                _event.size = 0;
+
+                if (_expected == 0 && byte != 0xF0)
+                    complete(callback);
+            }
+
+            /**
+             * Method to parse a sequence of bytes.
+             * @param data     The bytes.
+             * @param size     The amount of bytes.
+             * @param callback Callable which accepts a const WireEvent&.
+             */
+            template <typename Callback>
+            void push(const uint8_t *data, size_t size, Callback&& callback) {
+                for (size_t i = 0; i < size; i++)
+                    push(data[i], callback);
+            }
+
+            /**
+             * Method to forget the running status and any partial message, for example after
+             * the connection was lost.
+             */
+            void reset() {
+                _status = 0;
+                _event.size = 0;
+            }
+
+            /**
+             * Method to get the amount of data bytes that were dropped, because there was no
+             * status byte for them.
+             * @return uint64_t The amount of bytes.
+             */
+            uint64_t getDropped() const { return _dropped; }
+
+            /**
+             * Method to get the amount of data bytes of a status byte.
+             * @param status The status byte.
+             * @return uint8_t The amount of data bytes, 0 for system exclusive.
+             */
+            static uint8_t expected(uint8_t status) {
+                switch (status >> 4) {
+                case Events::MessageType::PROGRAM_CHANGE:
+                case Events::MessageType::CHANNEL_AFTERTOUCH:
+                    return 1;
+                case 0xF:
+                    /* The song position has 2 data bytes, the time code and song select have 1. */
+                    return status == 0xF2 ? 2 : (status == 0xF1 || status == 0xF3) ? 1 : 0;
+                default:
+                    return 2;
+                }
+            }
+
+        private:
+            /**
+             * Method to report a complete message. Channel messages keep their status for
+             * running status, system common messages do not.
+             * @param callback The callback.
+             */
+            template <typename Callback>
+            void complete(Callback& callback) {
+                const WireEvent& event = _event;
+                callback(event);
+                _event.size = 0;
+
+                if (_status >= 0xF0)
+                    _status = 0;
+            }
+
+            /**
+             * Method to report a chunk of a system exclusive message.
+             * @param status   0xF0 if the message continues, 0xF7 if it ended.
+             * @param callback The callback.
+             */
+            template <typename Callback>
+            void flush(uint8_t status, Callback& callback) {
+                const WireEvent& event = _event;
+                _event.status = status;
+                callback(event);
+
+                _event.status = 0xF0;
+                _event.size = 0;
+            }
+
+            /**
+             * The status of the message that is being parsed, 0 if there is none.
+             * @var uint8_t
+             */
+            uint8_t _status;
+
+            /**
+             * The amount of data bytes of the message.
+             * @var uint8_t
+             */
+            uint8_t _expected;
+
+            /**
+             * The event that is being filled.
+             * @var WireEvent
+             */
+            WireEvent _event;
+
+            /**
+             * The amount of dropped data bytes.
+             * @var uint64_t
+             */
+            uint64_t _dropped;
+    };
+
+    template <typename Sink>
+    class WireEncoder {
+        public:
+            /**
+             * Constructor
+             * @param sink    The sink to write into.
+             * @param running Whether status bytes are left out when running status allows it.
+             */
+            WireEncoder(Sink& sink, bool running = true) : _sink(sink), _running(running), _status(0), _sysex(false) {}
+
+            /**
+             * Method to write an event. Chunks of a system exclusive message are written
+             * between a single 0xF0 and 0xF7, so the chunks of a parser can be passed on as
+             * they are.
+             * @param event The event.
+             */
+            void write(const WireEvent& event) {
+                if (event.isRealtime()) {
+                    _sink.put(event.status);
+                    return;
+                }
+
+                if (event.isSysEx()) {
+                    if (!_sysex)
+                        _sink.put(0xF0);
+
+                    _sink.write(event.data, event.size);
+                    _sysex = event.status == 0xF0;
+                    _status = 0;
+
+                    if (!_sysex)
+                        _sink.put(0xF7);
+
+                    return;
+                }
+
+                /* A message in the middle of a system exclusive message ends it. */
+                if (_sysex) {
+                    _sink.put(0xF7);
+                    _sysex = false;
+                }
+
+                if (!_running || event.status != _status)
+                    _sink.put(event.status);
+
+                _status = event.isChannel() ? event.status : 0;
+                _sink.write(event.data, event.size);
+            }
+
+            /**
+             * Method to write a channel message.
+             * @param msg The message.
+             */
+            void write(const Events::Message& msg) { write(WireEvent::from(msg)); }
+
+            /**
+             * Method to forget the running status, so the next message is written with its
+             * status byte. Receivers that join halfway need this every now and then.
+             */
+            void reset() { _status = 0; }
+
+        private:
+            /**
+             * The sink.
+             * @var Sink&
+             */
+            Sink& _sink;
+
+            /**
+             * Whether running status is used.
+             * @var bool
+             */
+            bool _running;
+
+            /**
+             * The running status, 0 if there is none.
+             * @var uint8_t
+             */
+            uint8_t _status;
+
+            /**
+             * Whether a system exclusive message was started and not ended yet.
+             * @var bool
+             */
+            bool _sysex;
+    };
+}
+
+#endif
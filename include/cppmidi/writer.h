@@ -0,0 +1,116 @@
+/**
+ * writer.h
+ *
+ * Class to write large files quickly. Every track is a chunk of its own that does not depend
+ * on any of the other tracks, so the tracks are encoded at the same time into separate
+ * buffers on a thread pool. The buffers are then written in order, to a file descriptor
+ * with a single gather write.
+ *
+ * The thread that writes takes part in encoding as well, so a writer can be shared between
+ * threads, and small files are simply encoded by the calling thread alone.
+ *
+ * @author Michael van der Werve
+ */
+
+#ifndef MIDI_WRITER_h
+#define MIDI_WRITER_h
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include <cstdint>
+#include <cppmidi/file.h>
+#include <cppmidi/status.h>
+#include <cppmidi/threadpool.h>
+
+/**
+ * Setting up the midi namespace
+ */
+namespace Midi {
+    class Writer {
+        public:
+            /**
+             * Constructor, which starts the thread pool.
+             * @param threads   The amount of worker threads, 0 for one per hardware thread.
+             * @param splitSize The size in bytes of the tracks from which they are encoded on the pool.
+             */
+            Writer(unsigned threads = 0, size_t splitSize = 1 << 18) :
+                _owned(new ThreadPool(threads)), _pool(*_owned), _splitSize(splitSize) {}
+
+            /**
+             * Constructor, which encodes on a pool that is shared with other work.
+             * @param pool      The thread pool, which has to outlive the writer.
+             * @param splitSize The size in bytes of the tracks from which they are encoded on the pool.
+             */
+            Writer(ThreadPool& pool, size_t splitSize = 1 << 18) : _pool(pool), _splitSize(splitSize) {}
+
+            /**
+             * Destructor
+             */
+            virtual ~Writer() {}
+
+            /**
+             * Method to encode a file into chunks, the first one holding the header and every
+             * next one a complete track, in the order of the tracks. The chunks of the file
+             * that are not tracks are copied in between, in front of their tracks.
+             * @param file   The file.
+             * @param chunks The chunks to fill, which are left empty if the file cannot be encoded.
+             * @return Status ERROR_TRACK_LENGTH if a track is too long for a chunk, with the
+             *                offset the chunk would have been written at.
+             */
+            Status encode(const File& file, std::vector<std::vector<uint8_t>>& chunks);
+
+            /**
+             * Method to write a file to a stream, which should be in binary mode.
+             * @param file   The file.
+             * @param output The output stream.
+             * @return Status ERROR_IO if writing failed, with the offset where it failed, or
+             *                ERROR_TRACK_LENGTH from encode(), in which case nothing is written.
+             */
+            Status write(const File& file, std::ostream& output);
+
+            /**
+             * Method to write a file to a file descriptor, with a single gather write when possible.
+             * @param file The file.
+             * @param fd   The file descriptor.
+             * @return Status ERROR_IO if writing failed, with the offset where it failed, or
+             *                ERROR_TRACK_LENGTH from encode(), in which case nothing is written.
+             */
+            Status write(const File& file, int fd);
+
+            /**
+             * Method to write encoded chunks to a file descriptor, with a single gather write
+             * when possible.
+             * @param chunks The chunks, as filled by encode().
+             * @param fd     The file descriptor.
+             * @return Status ERROR_IO if writing failed, with the offset where it failed.
+             */
+            static Status write(const std::vector<std::vector<uint8_t>>& chunks, int fd);
+
+            /**
+             * Method to save a file, replacing the file at the path if there was one.
+             * @param file The file.
+             * @param path The path to write to.
+             * @return Status ERROR_IO if the file could not be created or written, or
+             *                ERROR_TRACK_LENGTH from encode(), in which case the file is left alone.
+             */
+            Status save(const File& file, const std::string& path);
+
+        private:
+            /**
+             * The pool that was started by us, if any, and the pool the tracks are encoded on.
+             * @var std::unique_ptr<ThreadPool>, ThreadPool&
+             */
+            std::unique_ptr<ThreadPool> _owned;
+            ThreadPool& _pool;
+
+            /**
+             * The size in bytes of the tracks from which they are encoded on the pool.
+             * @var size_t
+             */
+            size_t _splitSize;
+    };
+}
+
+#endif
@@ -0,0 +1,895 @@
+/**
+ * archive.cpp
+ *
+ * File with implementations for the Midi::ArchiveWriter and Midi::ArchiveReader classes.
+ *
+ * Every block consists of the sizes of its six columns, as variable length values, followed
+ * by the columns themselves:
+ *  0. The files: for every file its name, format, division, amount of tracks and the amount
+ *     of events of every track.
+ *  1. The delta time of every event, as variable length value.
+ *  2. The status byte of every event.
+ *  3. The first data byte of every event (see EventColumns).
+ *  4. The second data byte of every event.
+ *  5. The payload of every meta or sysex event: either the index of a text in the dictionary,
+ *     or the length and the bytes of the payload.
+ *
+ * The status column stores the position of the status byte in a list of the status bytes
+ * that were used most recently, and the data columns store the difference from the data
+ * byte of the previous event with the same status byte. Both are 0 if the prediction was
+ * right, and a 0 is followed by the amount of extra bytes that were predicted right too.
+ *
+ * Every column is finally compressed with its own Huffman code, unless that does not make
+ * it any smaller.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/archive.h>
+#include <cppmidi/hash.h>
+#include <cppmidi/events/meta.h>
+#include <cppmidi/events/sysex.h>
+#include <cstring>
+#include <queue>
+#include <algorithm>
+#include <functional>
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    const char* Archive::IDENTIFIER = "MIDIArch";
+
+    /**
+     * The maximum length of a text that is put in the dictionary, longer texts are rarely
+     * repeated.
+     */
+    static const size_t MAX_TEXT = 256;
+
+    /**
+     * The maximum amount of texts in the dictionary, after which texts are stored in the
+     * blocks themselves.
+     */
+    static const size_t MAX_DICTIONARY = 1 << 22;
+
+    /**
+     * Method to append a variable length value. Unlike the values in MIDI files, these are
+     * stored with the least significant group first and may be up to 64 bits.
+     * @param output The bytes to append to.
+     * @param value  The value.
+     */
+    static void putVarint(std::vector<uint8_t>& output, uint64_t value) {
+        while (value >= 0x80) {
+            output.push_back(value | 0x80);
+            value >>= 7;
+        }
+
+        output.push_back(value);
+    }
+
+    /**
+     * Method to read a variable length value.
+     * @param data   The bytes.
+     * @param offset The offset, which is moved past the value.
+     * @param end    The offset after the last byte that may be read.
+     * @param value  The value.
+     * @return bool False if the value is truncated or too long.
+     */
+    static bool getVarint(const uint8_t *data, size_t& offset, size_t end, uint64_t& value) {
+        value = 0;
+
+        for (unsigned shift = 0; shift < 64 && offset < end; shift += 7) {
+            const uint8_t byte = data[offset++];
+            value |= (uint64_t) (byte & 0x7F) << shift;
+
+            if (!(byte & 0x80))
+                return true;
+        }
+
+        return false;
+    }
+
+    /**
+     * Method to append a 64 bit little endian number.
+     * @param output The bytes to append to.
+     * @param value  The number.
+     */
+    static void putLittle(std::vector<uint8_t>& output, uint64_t value) {
+        for (int i = 0; i < 8; i++)
+            output.push_back(value >> (i * 8));
+    }
+
+    /**
+     * Method to read a 64 bit little endian number.
+     * @param data The bytes.
+     * @return uint64_t The number.
+     */
+    static uint64_t getLittle(const uint8_t *data) {
+        uint64_t value = 0;
+        for (int i = 7; i >= 0; i--)
+            value = value << 8 | data[i];
+
+        return value;
+    }
+
+    /**
+     * Method to read bytes from a position in a stream.
+     * @param input  The input stream.
+     * @param offset The position.
+     * @param size   The amount of bytes.
+     * @param buffer The buffer, which is replaced with the bytes.
+     * @return bool False if the bytes could not be read.
+     */
+    static bool readAt(std::istream& input, uint64_t offset, uint64_t size, std::vector<uint8_t>& buffer) {
+        input.clear();
+        input.seekg(offset);
+
+        buffer.resize(size);
+        input.read(reinterpret_cast<char*>(buffer.data()), size);
+
+        return (uint64_t) input.gcount() == size;
+    }
+
+    /**
+     * The longest Huffman code, so a code can be looked up with a single table.
+     */
+    static const unsigned MAX_CODE = 15;
+
+    /**
+     * Method to compute the lengths of the Huffman codes for the bytes of a column. Whenever
+     * a code gets too long, the counts are flattened and the codes are computed again.
+     * @param counts  How often every byte occurs.
+     * @param lengths The length of the code of every byte, 0 if it does not occur.
+     */
+    static void buildLengths(const uint64_t *counts, uint8_t *lengths) {
+        typedef std::pair<uint64_t, int> Node;
+        std::vector<uint64_t> weights(counts, counts + 256);
+
+        while (true) {
+            std::priority_queue<Node, std::vector<Node>, std::greater<Node>> queue;
+            memset(lengths, 0, 256);
+
+            for (int s = 0; s < 256; s++) {
+                if (weights[s] > 0)
+                    queue.push(Node(weights[s], s));
+            }
+
+            /* A single byte still needs a code of one bit. */
+            if (queue.size() < 2) {
+                if (!queue.empty())
+                    lengths[queue.top().second] = 1;
+
+                return;
+            }
+
+            /* Nodes 0-255 are the bytes themselves, the others are created while merging. */
+            int parent[512], next = 256;
+            while (queue.size() > 1) {
+                const Node a = queue.top(); queue.pop();
+                const Node b = queue.top(); queue.pop();
+
+                parent[a.second] = parent[b.second] = next;
+                queue.push(Node(a.first + b.first, next++));
+            }
+
+            parent[next - 1] = -1;
+
+            unsigned longest = 0;
+            for (int s = 0; s < 256; s++) {
+                if (weights[s] == 0)
+                    continue;
+
+                for (int n = s; parent[n] != -1; n = parent[n])
+                    lengths[s]++;
+
+                longest = std::max<unsigned>(longest, lengths[s]);
+            }
+
+            if (longest <= MAX_CODE)
+                return;
+
+            for (auto& weight : weights) {
+                if (weight > 0)
+                    weight = weight >> 1 | 1;
+            }
+        }
+    }
+
+    /**
+     * Method to assign canonical codes to the bytes, given the lengths of their codes.
+     * @param lengths The length of the code of every byte.
+     * @param codes   The code of every byte.
+     */
+    static void buildCodes(const uint8_t *lengths, uint16_t *codes) {
+        uint16_t count[MAX_CODE + 1] = { 0 }, next[MAX_CODE + 1] = { 0 };
+        for (int s = 0; s < 256; s++)
+            count[lengths[s]]++;
+
+        count[0] = 0;
+        for (unsigned length = 1, code = 0; length <= MAX_CODE; length++) {
+            code = (code + count[length - 1]) << 1;
+            next[length] = code;
+        }
+
+        for (int s = 0; s < 256; s++)
+            codes[s] = lengths[s] ? next[lengths[s]]++ : 0;
+    }
+
+    /**
+     * Method to compress a column and append it. The column starts with its original size
+     * and whether it is compressed, followed by the lengths of the codes and the codes.
+     * @param input  The column.
+     * @param output The bytes to append to.
+     */
+    static void encodeColumn(const std::vector<uint8_t>& input, std::vector<uint8_t>& output) {
+        putVarint(output, input.size());
+
+        uint64_t counts[256] = { 0 }, bits = 0;
+        for (auto byte : input)
+            counts[byte]++;
+
+        uint8_t lengths[256];
+        buildLengths(counts, lengths);
+
+        for (int s = 0; s < 256; s++)
+            bits += counts[s] * lengths[s];
+
+        /* Small columns are stored as is, since the lengths of the codes take 128 bytes. */
+        if (128 + (bits + 7) / 8 >= input.size()) {
+            output.push_back(0);
+            output.insert(output.end(), input.begin(), input.end());
+            return;
+        }
+
+        output.push_back(1);
+        for (int s = 0; s < 256; s += 2)
+            output.push_back(lengths[s] | lengths[s + 1] << 4);
+
+        uint16_t codes[256];
+        buildCodes(lengths, codes);
+
+        /* Only the lowest bits of the buffer are used, the rest simply falls off. */
+        uint64_t buffer = 0;
+        unsigned filled = 0;
+        for (auto byte : input) {
+            buffer = buffer << lengths[byte] | codes[byte];
+            filled += lengths[byte];
+
+            for (; filled >= 8; filled -= 8)
+                output.push_back(buffer >> (filled - 8));
+        }
+
+        if (filled > 0)
+            output.push_back(buffer << (8 - filled));
+    }
+
+    /**
+     * Method to decompress a column.
+     * @param data   The compressed column.
+     * @param size   The size of the compressed column.
+     * @param output The column.
+     * @return bool False if the column is corrupt.
+     */
+    static bool decodeColumn(const uint8_t *data, size_t size, std::vector<uint8_t>& output) {
+        size_t offset = 0;
+        uint64_t count;
+
+        if (!getVarint(data, offset, size, count) || offset >= size)
+            return false;
+
+        const uint8_t mode = data[offset++];
+        if (mode == 0) {
+            if (count != size - offset)
+                return false;
+
+            output.assign(data + offset, data + size);
+            return true;
+        }
+
+        if (mode != 1 || size - offset < 128)
+            return false;
+
+        uint8_t lengths[256];
+        for (int s = 0; s < 256; s += 2) {
+            lengths[s] = data[offset] & 0x0F;
+            lengths[s + 1] = data[offset++] >> 4;
+        }
+
+        /* Every byte takes at least one bit, and the codes may not overlap. */
+        const uint64_t available = (uint64_t) (size - offset) * 8;
+        uint64_t space = 0;
+        for (int s = 0; s < 256; s++) {
+            if (lengths[s])
+                space += 1 << (MAX_CODE - lengths[s]);
+        }
+
+        if (count > available || space > 1 << MAX_CODE)
+            return false;
+
+        uint16_t codes[256];
+        buildCodes(lengths, codes);
+
+        /* Every entry holds the byte and the length of its code, a length of 0 is no code. */
+        std::vector<uint16_t> table(1 << MAX_CODE, 0);
+        for (int s = 0; s < 256; s++) {
+            if (!lengths[s])
+                continue;
+
+            const unsigned shift = MAX_CODE - lengths[s];
+            std::fill(table.begin() + (codes[s] << shift), table.begin() + ((codes[s] + 1) << shift), s | lengths[s] << 8);
+        }
+
+        output.resize(count);
+
+        uint64_t buffer = 0, used = 0;
+        unsigned filled = 0;
+        for (uint64_t i = 0; i < count; i++) {
+            /* Past the end zeros are shifted in, which is caught by counting the used bits. */
+            for (; filled < MAX_CODE; filled += 8)
+                buffer = buffer << 8 | (offset < size ? data[offset++] : 0);
+
+            const uint16_t entry = table[(buffer >> (filled - MAX_CODE)) & ((1 << MAX_CODE) - 1)];
+            if (!(entry >> 8))
+                return false;
+
+            output[i] = entry;
+            filled -= entry >> 8;
+            used += entry >> 8;
+        }
+
+        return used <= available;
+    }
+
+    /**
+     * Method to append a prediction error to a column, where runs of correct predictions
+     * are only counted, and written once they end.
+     * @param column The column.
+     * @param run    The length of the current run.
+     * @param value  The prediction error, 0 if the prediction was right.
+     */
+    static void putResidual(std::vector<uint8_t>& column, uint32_t& run, uint8_t value) {
+        if (value == 0 && run++ > 0)
+            return;
+
+        if (value == 0) {
+            column.push_back(0);
+            return;
+        }
+
+        if (run > 0)
+            putVarint(column, run - 1);
+
+        run = 0;
+        column.push_back(value);
+    }
+
+    /**
+     * Reader for a column of prediction errors.
+     */
+    class ResidualColumn {
+        public:
+            /**
+             * Constructor
+             * @param column The column.
+             */
+            ResidualColumn(const std::vector<uint8_t>& column) : _column(column), _offset(0), _run(0) {}
+
+            /**
+             * Method to read the next prediction error.
+             * @param value The prediction error.
+             * @return bool False if the column ended early.
+             */
+            bool next(uint8_t& value) {
+                if (_run > 0) {
+                    _run--;
+                    value = 0;
+                    return true;
+                }
+
+                if (_offset >= _column.size())
+                    return false;
+
+                value = _column[_offset++];
+                return value != 0 || getVarint(_column.data(), _offset, _column.size(), _run);
+            }
+
+        private:
+            /**
+             * The column.
+             * @var const std::vector<uint8_t>&
+             */
+            const std::vector<uint8_t>& _column;
+
+            /**
+             * The offset of the next byte.
+             * @var size_t
+             */
+            size_t _offset;
+
+            /**
+             * The amount of correct predictions that are still to come.
+             * @var uint64_t
+             */
+            uint64_t _run;
+    };
+
+    /**
+     * Method to reset the predictions, which happens at the start of every block.
+     * @param order    The status bytes, most recently used first.
+     * @param previous The previous data bytes after every status byte.
+     */
+    static void resetPredictions(uint8_t *order, uint8_t (*previous)[256]) {
+        for (int i = 0; i < 256; i++)
+            order[i] = i;
+
+        memset(previous, 0, 2 * 256);
+    }
+
+    /**
+     * Method to move a status byte to the front of the recently used list.
+     * @param order    The status bytes, most recently used first.
+     * @param position The position of the status byte.
+     */
+    static void moveToFront(uint8_t *order, uint8_t position) {
+        const uint8_t status = order[position];
+        memmove(order + 1, order, position);
+        order[0] = status;
+    }
+
+    /**
+     * Constructor, which writes the start of the archive.
+     * @param output    The output stream, which should be in binary mode.
+     * @param blockSize The amount of encoded bytes after which a block is finished.
+     */
+    ArchiveWriter::ArchiveWriter(std::ostream& output, size_t blockSize) :
+        _output(output), _blockSize(blockSize), _offset(16), _files(0), _blockFiles(0), _closed(false) {
+        resetPredictions(_order, _previous);
+        memset(_run, 0, sizeof(_run));
+
+        std::vector<uint8_t> start(Archive::IDENTIFIER, Archive::IDENTIFIER + 8);
+        putLittle(start, Archive::VERSION);
+
+        _output.write(reinterpret_cast<const char*>(start.data()), start.size());
+    }
+
+    /**
+     * Method to add a file to the archive.
+     * @param file The file.
+     * @param name The name of the file, such as its original path.
+     * @return bool False if the archive was already closed or writing failed.
+     */
+    bool ArchiveWriter::add(const File& file, const std::string& name) {
+        if (_closed || !_output)
+            return false;
+
+        EventColumns columns(file);
+        std::vector<uint8_t>& files = _columns[0];
+
+        putVarint(files, name.size());
+        files.insert(files.end(), name.begin(), name.end());
+        putVarint(files, columns.format);
+        putVarint(files, columns.division);
+        putVarint(files, columns.tracks());
+
+        for (size_t t = 0; t < columns.tracks(); t++)
+            putVarint(files, columns.trackBegin[t + 1] - columns.trackBegin[t]);
+
+        for (size_t t = 0; t < columns.tracks(); t++) {
+            uint32_t tick = 0;
+
+            for (size_t i = columns.trackBegin[t]; i < columns.trackBegin[t + 1]; i++) {
+                putVarint(_columns[1], columns.ticks[i] - tick);
+                tick = columns.ticks[i];
+
+                const uint8_t status = columns.status[i];
+                const uint8_t position = std::find(_order, _order + 256, status) - _order;
+                moveToFront(_order, position);
+
+                putResidual(_columns[2], _run[0], position);
+                putResidual(_columns[3], _run[1], columns.data1[i] - _previous[0][status]);
+                putResidual(_columns[4], _run[2], columns.data2[i] - _previous[1][status]);
+
+                _previous[0][status] = columns.data1[i];
+                _previous[1][status] = columns.data2[i];
+
+                if (columns.payload[i] == EventColumns::NO_PAYLOAD)
+                    continue;
+
+                /* Short texts are likely to repeat, think of track and instrument names. */
+                const Payload& payload = columns.payloads[columns.payload[i]];
+                const bool text = columns.status[i] == 0xFF && columns.data1[i] >= Events::TEXT && columns.data1[i] <= Events::CUE;
+
+                if (text && payload.size() <= MAX_TEXT &&
+                    (_dictionary.size() < MAX_DICTIONARY || _lookup.count(std::string(payload.begin(), payload.end())))) {
+                    putVarint(_columns[5], (uint64_t) intern(payload.data(), payload.size()) << 1 | 1);
+                    continue;
+                }
+
+                putVarint(_columns[5], (uint64_t) payload.size() << 1);
+                _columns[5].insert(_columns[5].end(), payload.begin(), payload.end());
+            }
+        }
+
+        _files++;
+        _blockFiles++;
+
+        size_t size = 0;
+        for (const auto& column : _columns)
+            size += column.size();
+
+        if (size >= _blockSize)
+            flush();
+
+        return (bool) _output;
+    }
+
+    /**
+     * Method to finish the archive.
+     * @return bool False if writing failed.
+     */
+    bool ArchiveWriter::close() {
+        if (_closed)
+            return (bool) _output;
+
+        flush();
+        _closed = true;
+
+        std::vector<uint8_t> footer;
+        putVarint(footer, _dictionary.size());
+        for (const auto& text : _dictionary) {
+            putVarint(footer, text.size());
+            footer.insert(footer.end(), text.begin(), text.end());
+        }
+
+        const uint64_t indexOffset = _offset + footer.size();
+        for (const auto& block : _blocks) {
+            putLittle(footer, block.offset);
+            putLittle(footer, block.size);
+            putLittle(footer, block.first);
+            putLittle(footer, block.count);
+            putLittle(footer, block.hash);
+        }
+
+        putLittle(footer, _offset);
+        putLittle(footer, indexOffset);
+        putLittle(footer, _blocks.size());
+        putLittle(footer, _files);
+        footer.insert(footer.end(), Archive::IDENTIFIER, Archive::IDENTIFIER + 8);
+
+        _output.write(reinterpret_cast<const char*>(footer.data()), footer.size());
+        _output.flush();
+
+        return (bool) _output;
+    }
+
+    /**
+     * Method to encode the current block and write it.
+     */
+    void ArchiveWriter::flush() {
+        if (_blockFiles == 0)
+            return;
+
+        /* Finishing the runs that are still open. */
+        for (int c = 0; c < 3; c++) {
+            if (_run[c] > 0)
+                putVarint(_columns[2 + c], _run[c] - 1);
+        }
+
+        std::vector<uint8_t> encoded[6], sizes;
+        size_t size = 0;
+        for (int c = 0; c < 6; c++) {
+            encodeColumn(_columns[c], encoded[c]);
+            putVarint(sizes, encoded[c].size());
+            size += encoded[c].size();
+        }
+
+        uint64_t hash = Hash::fnv1a(sizes.data(), sizes.size());
+        _output.write(reinterpret_cast<const char*>(sizes.data()), sizes.size());
+
+        for (const auto& column : encoded) {
+            hash = Hash::fnv1a(column.data(), column.size(), hash);
+            _output.write(reinterpret_cast<const char*>(column.data()), column.size());
+        }
+
+        _blocks.push_back({ _offset, sizes.size() + size, _files - _blockFiles, _blockFiles, hash });
+        _offset += sizes.size() + size;
+
+        /* Every block can be decoded on its own. */
+        for (auto& column : _columns)
+            column.clear();
+
+        resetPredictions(_order, _previous);
+        memset(_run, 0, sizeof(_run));
+        _blockFiles = 0;
+    }
+
+    /**
+     * Method to add a text to the dictionary.
+     * @param data The text.
+     * @param size The length of the text.
+     * @return uint32_t The index in the dictionary.
+     */
+    uint32_t ArchiveWriter::intern(const uint8_t *data, size_t size) {
+        std::string text(data, data + size);
+
+        auto it = _lookup.find(text);
+        if (it != _lookup.end())
+            return it->second;
+
+        _dictionary.push_back(text);
+        _lookup.emplace(text, _dictionary.size() - 1);
+
+        return _dictionary.size() - 1;
+    }
+
+    /**
+     * Method to open an archive, reading its index and dictionary.
+     * @param input The input stream, positioned at the start of the archive.
+     * @return Status ERROR_IO or ERROR_ARCHIVE_FORMAT on failure.
+     */
+    Status ArchiveReader::open(std::istream& input) {
+        _input = NULL;
+        _files = 0;
+        _loaded = -1;
+        _blocks.clear();
+        _dictionary.clear();
+
+        const std::streamoff start = input.tellg();
+        input.seekg(0, std::ios::end);
+        const std::streamoff end = input.tellg();
+
+        if (start < 0 || end < start)
+            return Status(ERROR_IO, 0);
+
+        const uint64_t size = end - start;
+        std::vector<uint8_t> buffer;
+
+        if (size < 16 + Archive::TRAILER_SIZE)
+            return Status(ERROR_ARCHIVE_FORMAT, 0);
+
+        if (!readAt(input, start, 16, buffer))
+            return Status(ERROR_IO, 0);
+
+        if (memcmp(buffer.data(), Archive::IDENTIFIER, 8) || getLittle(buffer.data() + 8) != Archive::VERSION)
+            return Status(ERROR_ARCHIVE_FORMAT, 0);
+
+        if (!readAt(input, start + size - Archive::TRAILER_SIZE, Archive::TRAILER_SIZE, buffer))
+            return Status(ERROR_IO, size - Archive::TRAILER_SIZE);
+
+        const uint64_t dictionaryOffset = getLittle(buffer.data());
+        const uint64_t indexOffset = getLittle(buffer.data() + 8);
+        const uint64_t blocks = getLittle(buffer.data() + 16);
+        const uint64_t files = getLittle(buffer.data() + 24);
+        const uint64_t footer = size - Archive::TRAILER_SIZE;
+
+        if (memcmp(buffer.data() + 32, Archive::IDENTIFIER, 8) || dictionaryOffset > indexOffset ||
+            indexOffset > footer || blocks != (footer - indexOffset) / 40 || (footer - indexOffset) % 40)
+            return Status(ERROR_ARCHIVE_FORMAT, footer);
+
+        if (!readAt(input, start + indexOffset, footer - indexOffset, buffer))
+            return Status(ERROR_IO, indexOffset);
+
+        /* The blocks have to follow each other and hold all the files in order. */
+        uint64_t offset = 16, first = 0;
+        for (uint64_t i = 0; i < blocks; i++) {
+            const uint8_t *entry = buffer.data() + i * 40;
+            Archive::Block block = { getLittle(entry), getLittle(entry + 8), getLittle(entry + 16), getLittle(entry + 24), getLittle(entry + 32) };
+
+            if (block.offset != offset || block.size > dictionaryOffset - offset || block.first != first || block.count == 0)
+                return Status(ERROR_ARCHIVE_FORMAT, indexOffset + i * 40);
+
+            offset += block.size;
+            first += block.count;
+            _blocks.push_back(block);
+        }
+
+        if (offset != dictionaryOffset || first != files)
+            return Status(ERROR_ARCHIVE_FORMAT, indexOffset);
+
+        if (!readAt(input, start + dictionaryOffset, indexOffset - dictionaryOffset, buffer))
+            return Status(ERROR_IO, dictionaryOffset);
+
+        size_t position = 0;
+        uint64_t count, length;
+        if (!getVarint(buffer.data(), position, buffer.size(), count) || count > buffer.size())
+            return Status(ERROR_ARCHIVE_FORMAT, dictionaryOffset);
+
+        _dictionary.reserve(count);
+        for (uint64_t i = 0; i < count; i++) {
+            if (!getVarint(buffer.data(), position, buffer.size(), length) || length > buffer.size() - position)
+                return Status(ERROR_ARCHIVE_FORMAT, dictionaryOffset + position);
+
+            _dictionary.push_back(Payload(buffer.data() + position, length));
+            position += length;
+        }
+
+        _input = &input;
+        _start = start;
+        _files = files;
+
+        return Status();
+    }
+
+    /**
+     * Method to read a single file.
+     * @param index The index of the file.
+     * @param file  The file to fill.
+     * @param name  If not NULL, this is set to the name of the file.
+     * @return Status ERROR_IO or ERROR_ARCHIVE_FORMAT on failure.
+     */
+    Status ArchiveReader::read(uint64_t index, File& file, std::string *name) {
+        file.clear();
+
+        if (_input == NULL || index >= _files)
+            return Status(ERROR_IO, 0);
+
+        /* Finding the last block that starts at or before the file. */
+        size_t low = 0, high = _blocks.size();
+        while (high - low > 1) {
+            const size_t middle = (low + high) / 2;
+            if (_blocks[middle].first <= index)
+                low = middle;
+            else
+                high = middle;
+        }
+
+        Status status = load(low);
+        if (!status.ok())
+            return status;
+
+        const size_t position = index - _blocks[low].first;
+        _columns[position].restore(file);
+
+        if (name != NULL)
+            *name = _names[position];
+
+        return Status();
+    }
+
+    /**
+     * Method to decode a block, unless it is the block that was decoded last.
+     * @param index The index of the block.
+     * @return Status ERROR_IO or ERROR_ARCHIVE_FORMAT on failure.
+     */
+    Status ArchiveReader::load(size_t index) {
+        if (_loaded == (int64_t) index)
+            return Status();
+
+        _loaded = -1;
+        _columns.clear();
+        _names.clear();
+
+        const Archive::Block& block = _blocks[index];
+        std::vector<uint8_t> buffer;
+
+        if (!readAt(*_input, _start + block.offset, block.size, buffer))
+            return Status(ERROR_IO, block.offset);
+
+        const Status corrupt(ERROR_ARCHIVE_FORMAT, block.offset);
+        if (Hash::fnv1a(buffer.data(), buffer.size()) != block.hash)
+            return corrupt;
+
+        /* The sizes of the compressed columns come first. */
+        size_t offset = 0, sizes[6];
+        uint64_t value;
+        for (int c = 0; c < 6; c++) {
+            if (!getVarint(buffer.data(), offset, buffer.size(), value) || value > buffer.size())
+                return corrupt;
+
+            sizes[c] = value;
+        }
+
+        /* The payloads share the column they are stored in. */
+        std::vector<uint8_t> columns[5];
+        std::shared_ptr<std::vector<uint8_t>> payloads = std::make_shared<std::vector<uint8_t>>();
+
+        for (int c = 0; c < 6; c++) {
+            if (sizes[c] > buffer.size() - offset || !decodeColumn(buffer.data() + offset, sizes[c], c < 5 ? columns[c] : *payloads))
+                return corrupt;
+
+            offset += sizes[c];
+        }
+
+        const std::vector<uint8_t>& files = columns[0];
+        const std::vector<uint8_t>& ticks = columns[1];
+        size_t filesOffset = 0, ticksOffset = 0, payloadsOffset = 0;
+
+        uint8_t order[256], previous[2][256];
+        resetPredictions(order, previous);
+        ResidualColumn residuals[3] = { ResidualColumn(columns[2]), ResidualColumn(columns[3]), ResidualColumn(columns[4]) };
+
+        /* Every file takes at least four bytes in the first column. */
+        if (block.count > files.size())
+            return corrupt;
+
+        _columns.resize(block.count);
+        _names.resize(block.count);
+
+        for (uint64_t f = 0; f < block.count; f++) {
+            EventColumns& file = _columns[f];
+            uint64_t length, format, division, tracks, events;
+
+            if (!getVarint(files.data(), filesOffset, files.size(), length) || length > files.size() - filesOffset)
+                return corrupt;
+
+            _names[f].assign(files.begin() + filesOffset, files.begin() + filesOffset + length);
+            filesOffset += length;
+
+            if (!getVarint(files.data(), filesOffset, files.size(), format) || !getVarint(files.data(), filesOffset, files.size(), division) ||
+                !getVarint(files.data(), filesOffset, files.size(), tracks) || format > 0xFFFF || division > 0xFFFF || tracks >= 0xFFFF)
+                return corrupt;
+
+            file.format = format;
+            file.division = division;
+
+            /* Every event takes at least a byte for its delta time, which limits how much
+             * has to be reserved for a corrupt block.
+             */
+            for (uint64_t t = 0; t < tracks; t++) {
+                if (!getVarint(files.data(), filesOffset, files.size(), events) || events > ticks.size() - ticksOffset - file.trackBegin.back())
+                    return corrupt;
+
+                file.trackBegin.push_back(file.trackBegin.back() + events);
+            }
+
+            file.reserve(file.trackBegin.back(), 0);
+
+            for (uint64_t t = 0; t < tracks; t++) {
+                uint32_t tick = 0;
+
+                for (uint32_t i = file.trackBegin[t]; i < file.trackBegin[t + 1]; i++) {
+                    uint8_t position, data1, data2;
+                    if (!getVarint(ticks.data(), ticksOffset, ticks.size(), value) ||
+                        !residuals[0].next(position) || !residuals[1].next(data1) || !residuals[2].next(data2))
+                        return corrupt;
+
+                    const uint8_t status = order[position];
+                    moveToFront(order, position);
+
+                    data1 = previous[0][status] += data1;
+                    data2 = previous[1][status] += data2;
+
+                    tick += value;
+                    file.ticks.push_back(tick);
+                    file.status.push_back(status);
+                    file.data1.push_back(data1);
+                    file.data2.push_back(data2);
+
+                    /* Only what the writer could have produced is accepted. */
+                    if (status < 0xF0) {
+                        if (status < 0x80 || ((data1 | data2) & 0x80))
+                            return corrupt;
+
+                        file.payload.push_back(EventColumns::NO_PAYLOAD);
+                        continue;
+                    }
+
+                    if ((status != 0xFF && status != 0xF0 && status != 0xF7) || (status != 0xFF && data1 > Events::SYSEX_ESCAPE))
+                        return corrupt;
+
+                    if (!getVarint(payloads->data(), payloadsOffset, payloads->size(), value))
+                        return corrupt;
+
+                    file.payload.push_back(file.payloads.size());
+
+                    if (value & 1) {
+                        if ((value >> 1) >= _dictionary.size())
+                            return corrupt;
+
+                        file.payloads.push_back(_dictionary[value >> 1]);
+                        continue;
+                    }
+
+                    if ((value >> 1) > payloads->size() - payloadsOffset)
+                        return corrupt;
+
+                    file.payloads.push_back(Payload::share(payloads, payloads->data() + payloadsOffset, value >> 1));
+                    payloadsOffset += value >> 1;
+                }
+            }
+        }
+
+        _loaded = index;
+        return Status();
+    }
+}
@@ -0,0 +1,406 @@
+/**
+ * batch.cpp
+ *
+ * File with implementations for the Midi::Batch class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/batch.h>
+#include <cppmidi/trace.h>
+#include <cstdio>
+#include <cctype>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <dirent.h>
+#include <sys/stat.h>
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    /**
+     * Shared state of the files in a single run.
+     */
+    struct Batch::Run {
+        /**
+         * Constructor
+         * @param c The callback for every file.
+         */
+        Run(const Callback& c) : callback(c), start(std::chrono::steady_clock::now()) {}
+
+        /**
+         * Method to account for a processed file and pass it on to the callback.
+         * @param path   The path of the file.
+         * @param file   The decoded file.
+         * @param result The result of decoding.
+         * @param bytes  The size of the file.
+         */
+        void done(const std::string& path, File& file, const DecodeResult& result, size_t bytes) {
+            size_t events = 0;
+            for (int i = 0; i < file.getTrackSlots(); i++) {
+                if (file.getTrack(i) != NULL)
+                    events += file.getTrack(i)->getEvents().size();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stats.files++;
+                stats.tracks += result.tracks;
+                stats.events += events;
+                stats.bytes += bytes;
+
+                if (!result.ok()) {
+                    stats.failed++;
+                    stats.failures.push_back(std::make_pair(path, result.status));
+                }
+            }
+
+            callback(path, file, result);
+        }
+
+        /**
+         * The callback for every file.
+         * @var Callback
+         */
+        Callback callback;
+
+        /**
+         * The moment the run started.
+         * @var std::chrono::steady_clock::time_point
+         */
+        std::chrono::steady_clock::time_point start;
+
+        /**
+         * Mutex for the statistics.
+         * @var std::mutex
+         */
+        std::mutex mutex;
+
+        /**
+         * The statistics so far.
+         * @var BatchStats
+         */
+        BatchStats stats;
+    };
+
+    /**
+     * The state of a file that is decoded with a task per track.
+     */
+    struct BatchSplit {
+        /**
+         * The path of the file.
+         * @var std::string
+         */
+        std::string path;
+
+        /**
+         * The bytes of the file, shared with the payloads of the events.
+         * @var std::shared_ptr<const std::vector<uint8_t>>
+         */
+        std::shared_ptr<const std::vector<uint8_t>> buffer;
+
+        /**
+         * The file, with an empty track for every chunk.
+         * @var File
+         */
+        File file;
+
+        /**
+         * The offsets of the events of every track.
+         * @var std::vector<std::pair<size_t, size_t>>
+         */
+        std::vector<std::pair<size_t, size_t>> chunks;
+
+        /**
+         * The amount of tracks that are not decoded yet.
+         * @var std::atomic<size_t>
+         */
+        std::atomic<size_t> remaining;
+
+        /**
+         * Whether any of the tracks failed.
+         * @var std::atomic<bool>
+         */
+        std::atomic<bool> failed;
+
+        /**
+         * The memory budget shared by all the tracks.
+         * @var std::unique_ptr<DecodeBudget>
+         */
+        std::unique_ptr<DecodeBudget> budget;
+    };
+
+    /**
+     * Method to read a complete file into a buffer.
+     * @param path    The path of the file.
+     * @param buffer  The buffer to read into.
+     * @param decoder The decoder, of which the limits on the input are checked.
+     * @return Status ERROR_IO if the file could not be read, or the error of a limit.
+     */
+    static Status readFile(const std::string& path, std::vector<uint8_t>& buffer, const Decoder& decoder) {
+        CPPMIDI_TRACE_SPAN(span, "open", 0);
+        FILE *handle = fopen(path.c_str(), "rb");
+        if (handle == NULL)
+            return Status(ERROR_IO, 0);
+
+        /* The size is only a hint, the file might change while it is read. */
+        struct stat info;
+        if (fstat(fileno(handle), &info) == 0 && info.st_size > 0) {
+            Status status = decoder.checkInput(info.st_size);
+            if (!status.ok()) {
+                fclose(handle);
+                return status;
+            }
+
+            buffer.reserve(info.st_size);
+        }
+
+        const uint64_t limit = decoder.inputLimit();
+        uint8_t block[65536];
+        size_t count;
+
+        while ((count = fread(block, 1, sizeof(block), handle)) > 0) {
+            if (limit && count > limit - buffer.size()) {
+                fclose(handle);
+                return decoder.checkInput(limit + 1);
+            }
+
+            buffer.insert(buffer.end(), block, block + count);
+            CPPMIDI_TRACE_BYTES(span, buffer.size());
+        }
+
+        const bool ok = !ferror(handle);
+        fclose(handle);
+
+        return ok ? Status() : Status(ERROR_IO, buffer.size());
+    }
+
+    /**
+     * Method to decode all the MIDI files in a directory.
+     * @param directory The directory.
+     * @param callback  The callback for every file.
+     * @return BatchStats The statistics of the batch.
+     */
+    BatchStats Batch::run(const std::string& directory, const Callback& callback) {
+        std::shared_ptr<Run> state = std::make_shared<Run>(callback);
+
+        /* A directory that cannot be opened is reported like a file that cannot be read. */
+        if (!walk(directory, _options.recursive, [this, &state](const std::string& path) { schedule(state, path); })) {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->stats.failed++;
+            state->stats.failures.push_back(std::make_pair(directory, Status(ERROR_IO, 0)));
+        }
+
+        return finish(state);
+    }
+
+    /**
+     * Method to decode a list of files.
+     * @param paths    The paths of the files.
+     * @param callback The callback for every file.
+     * @return BatchStats The statistics of the batch.
+     */
+    BatchStats Batch::run(const std::vector<std::string>& paths, const Callback& callback) {
+        std::shared_ptr<Run> state = std::make_shared<Run>(callback);
+
+        for (const auto& path : paths)
+            schedule(state, path);
+
+        return finish(state);
+    }
+
+    /**
+     * Method to find all the MIDI files in a directory, by their extension.
+     * @param directory The directory.
+     * @param paths     The paths of the found files are appended to this.
+     * @param recursive Whether subdirectories are searched as well.
+     * @return bool False if the directory could not be opened.
+     */
+    bool Batch::list(const std::string& directory, std::vector<std::string>& paths, bool recursive) {
+        return walk(directory, recursive, [&paths](const std::string& path) { paths.push_back(path); });
+    }
+
+    /**
+     * Method to check whether a filename has the extension of a MIDI file.
+     * @param name The filename.
+     * @return bool True if it is a MIDI file.
+     */
+    bool Batch::isMidiFile(const std::string& name) {
+        const size_t dot = name.rfind('.');
+        if (dot == std::string::npos)
+            return false;
+
+        std::string extension = name.substr(dot + 1);
+        for (auto& c : extension)
+            c = tolower(c);
+
+        return extension == "mid" || extension == "midi" || extension == "smf" || extension == "kar";
+    }
+
+    /**
+     * Method to search a directory and call a function for every MIDI file.
+     * @param directory The directory.
+     * @param recursive Whether subdirectories are searched as well.
+     * @param found     The function to call with the path of every file.
+     * @return bool False if the directory could not be opened.
+     */
+    bool Batch::walk(const std::string& directory, bool recursive, const std::function<void(const std::string&)>& found) {
+        std::set<std::pair<uint64_t, uint64_t>> visited;
+        return walk(directory, recursive, found, visited);
+    }
+
+    /**
+     * Method to search a directory, unless it was searched already.
+     * @param directory The directory.
+     * @param recursive Whether subdirectories are searched as well.
+     * @param found     The function to call with the path of every file.
+     * @param visited   The device and inode of every directory that was searched.
+     * @return bool False if the directory could not be opened.
+     */
+    bool Batch::walk(const std::string& directory, bool recursive, const std::function<void(const std::string&)>& found,
+        std::set<std::pair<uint64_t, uint64_t>>& visited) {
+        struct stat self;
+        if (stat(directory.c_str(), &self) != 0)
+            return false;
+
+        /* A directory that is reached again, for example through a link to a parent, is
+         * not searched a second time, so every file is found once and the walk ends.
+         */
+        if (!visited.insert(std::make_pair((uint64_t) self.st_dev, (uint64_t) self.st_ino)).second)
+            return true;
+
+        DIR *dir = opendir(directory.c_str());
+        if (dir == NULL)
+            return false;
+
+        std::vector<std::string> subdirectories;
+
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            const std::string name = entry->d_name;
+            if (name == "." || name == "..")
+                continue;
+
+            const std::string path = directory + "/" + name;
+
+            /* Not every filesystem fills in the type, so then we have to ask. */
+            bool isDirectory = entry->d_type == DT_DIR;
+            if (entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK) {
+                struct stat info;
+                isDirectory = stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+            }
+
+            if (isDirectory)
+                subdirectories.push_back(path);
+            else if (isMidiFile(name))
+                found(path);
+        }
+
+        closedir(dir);
+
+        /* Subdirectories are searched after closing this one, to limit the open handles. */
+        if (recursive) {
+            for (const auto& subdirectory : subdirectories)
+                walk(subdirectory, recursive, found, visited);
+        }
+
+        return true;
+    }
+
+    /**
+     * Method to schedule the decoding of a single file.
+     * @param state The run the file belongs to.
+     * @param path  The path of the file.
+     */
+    void Batch::schedule(const std::shared_ptr<Run>& state, const std::string& path) {
+        _pool.submit([this, state, path]() { process(state, path); });
+    }
+
+    /**
+     * Method to read, decode and pass on a single file, which runs on a worker.
+     * @param state The run the file belongs to.
+     * @param path  The path of the file.
+     */
+    void Batch::process(const std::shared_ptr<Run>& state, const std::string& path) {
+        CPPMIDI_TRACE_SPAN(span, "batchFile", 0);
+        std::shared_ptr<std::vector<uint8_t>> buffer = std::make_shared<std::vector<uint8_t>>();
+        Decoder decoder(_options.decode);
+
+        Status status = readFile(path, *buffer, decoder);
+        CPPMIDI_TRACE_BYTES(span, buffer->size());
+
+        if (!status.ok()) {
+            File file;
+            DecodeResult result;
+            result.status = status;
+
+            state->done(path, file, result, buffer->size());
+            return;
+        }
+
+        /* Small files are simply decoded at once, which is what nearly all files are. */
+        std::shared_ptr<BatchSplit> split;
+        if (buffer->size() >= _options.splitSize) {
+            split = std::make_shared<BatchSplit>();
+            if (!decoder.prepare(buffer->data(), buffer->size(), split->file, split->chunks, buffer).ok() || split->chunks.size() < 2)
+                split.reset();
+        }
+
+        if (!split) {
+            File file;
+            DecodeResult result = decoder.decode(std::shared_ptr<const std::vector<uint8_t>>(buffer), file);
+
+            state->done(path, file, result, buffer->size());
+            return;
+        }
+
+        split->path = path;
+        split->buffer = buffer;
+        split->remaining = split->chunks.size();
+        split->failed = false;
+        split->budget.reset(new DecodeBudget(_options.decode.maxMemory));
+        split->budget->take(buffer->size());
+
+        /* These tasks go to the queue of this worker, where idle workers can steal them. */
+        for (size_t i = 0; i < split->chunks.size(); i++) {
+            _pool.submit([this, state, split, i, decoder]() {
+                const auto& chunk = split->chunks[i];
+                Track& track = *split->file.getTrack(i);
+
+                if (!decoder.decodeTrack(split->buffer->data(), chunk.first, chunk.second, track, split->buffer, split->budget.get()).ok())
+                    split->failed = true;
+
+                /* The last track to finish passes on the file. */
+                if (--split->remaining > 0)
+                    return;
+
+                DecodeResult result;
+                result.tracks = split->chunks.size();
+
+                /* A corrupt track is decoded once more as a whole file, so it is reported and
+                 * possibly skipped exactly like in a normal decode.
+                 */
+                if (split->failed)
+                    result = decoder.decode(split->buffer, split->file);
+
+                state->done(split->path, split->file, result, split->buffer->size());
+            });
+        }
+    }
+
+    /**
+     * Method to finish the run by waiting for all the files.
+     * @param state The run.
+     * @return BatchStats The statistics of the run.
+     */
+    BatchStats Batch::finish(const std::shared_ptr<Run>& state) {
+        _pool.wait();
+
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - state->start).count();
+
+        return state->stats;
+    }
+}
@@ -0,0 +1,486 @@
+/**
+ * cache.cpp
+ *
+ * File with implementations for the Midi::Cache and Midi::CacheView classes.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/cache.h>
+#include <cppmidi/hash.h>
+#include <cppmidi/decoder.h>
+#include <cppmidi/events/meta.h>
+#include <cppmidi/events/sysex.h>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using Midi::Events::MetaType;
+using Midi::Events::MessageType;
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    const char* Cache::IDENTIFIER = "MIDICach";
+
+    /**
+     * Method to round a size up to the alignment of the sections.
+     * @param size The size.
+     * @return uint64_t The aligned size.
+     */
+    static uint64_t align(uint64_t size) {
+        return (size + 7) & ~(uint64_t) 7;
+    }
+
+    /**
+     * Method to write the padding after a section of a certain size.
+     * @param output The output stream.
+     * @param size   The size of the section.
+     */
+    static void writePadding(std::ostream& output, uint64_t size) {
+        static const char padding[8] = { 0 };
+        output.write(padding, align(size) - size);
+    }
+
+    /**
+     * Method to write a section, padded up to the alignment.
+     * @param output The output stream.
+     * @param data   The bytes of the section.
+     * @param size   The amount of bytes.
+     */
+    static void writeSection(std::ostream& output, const void *data, uint64_t size) {
+        if (size > 0)
+            output.write(static_cast<const char*>(data), size);
+
+        writePadding(output, size);
+    }
+
+    /**
+     * Method to check if a section lies completely within the cache and is aligned.
+     * @param offset The offset of the section.
+     * @param count  The amount of elements.
+     * @param width  The size of a single element.
+     * @param size   The size of the cache.
+     * @return bool True if the section is valid.
+     */
+    static bool checkSection(uint64_t offset, uint64_t count, uint64_t width, uint64_t size) {
+        if (offset % 8 != 0 || offset > size)
+            return false;
+
+        /* Dividing instead of multiplying, so a huge count cannot overflow. */
+        return count <= (size - offset) / width;
+    }
+
+    /**
+     * Method to write a cache of a file.
+     * @param file   The decoded file.
+     * @param source The source the file was decoded from.
+     * @param output The output stream, which should be in binary mode.
+     * @return Status ERROR_IO if writing failed.
+     */
+    Status Cache::write(const File& file, const CacheSource& source, std::ostream& output) {
+        return write(EventColumns(file), TempoMap(file), source, output);
+    }
+
+    /**
+     * Method to write a cache of events that are already stored in columns.
+     * @param columns The events.
+     * @param tempo   The tempo map.
+     * @param source  The source the events were decoded from.
+     * @param output  The output stream, which should be in binary mode.
+     * @return Status ERROR_IO if writing failed.
+     */
+    Status Cache::write(const EventColumns& columns, const TempoMap& tempo, const CacheSource& source, std::ostream& output) {
+        CacheHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, IDENTIFIER, sizeof(header.magic));
+
+        header.version = VERSION;
+        header.byteOrder = 0x01020304;
+        header.sourceSize = source.size;
+        header.sourceModified = source.modified;
+        header.sourceHash = source.hash;
+        header.format = columns.format;
+        header.division = columns.division;
+        header.tracks = columns.tracks();
+        header.events = columns.size();
+        header.payloads = columns.payloads.size();
+        header.tempos = tempo.getChanges().size();
+
+        /* The payloads are stored one after another, so they need their positions. */
+        std::vector<CacheSlice> slices;
+        slices.reserve(columns.payloads.size());
+        for (const auto& payload : columns.payloads) {
+            slices.push_back({ header.payloadBytes, payload.size() });
+            header.payloadBytes += payload.size();
+        }
+
+        /* A bit of information per track, so it does not have to be computed every time. */
+        std::vector<CacheTrack> tracks(columns.tracks());
+        for (size_t t = 0; t < tracks.size(); t++) {
+            CacheTrack& track = tracks[t];
+            memset(&track, 0, sizeof(track));
+
+            track.first = columns.trackBegin[t];
+            track.count = columns.trackBegin[t + 1] - track.first;
+            track.name = EventColumns::NO_PAYLOAD;
+
+            for (size_t i = track.first; i < track.first + track.count; i++) {
+                const uint8_t status = columns.status[i];
+                track.endTick = columns.ticks[i];
+
+                if (status == 0xFF) {
+                    if (columns.data1[i] == MetaType::NAME_TRACK && track.name == EventColumns::NO_PAYLOAD)
+                        track.name = columns.payload[i];
+                }
+                else if (status < 0xF0) {
+                    track.channels |= 1 << (status & 0x0F);
+
+                    if ((status >> 4) == MessageType::NOTE_ON && columns.data2[i] > 0)
+                        track.notes++;
+                }
+            }
+        }
+
+        /* Every section follows the previous one, in the order of the header. */
+        uint64_t offset = align(sizeof(header));
+        header.trackOffset = offset;   offset += align(tracks.size() * sizeof(CacheTrack));
+        header.tickOffset = offset;    offset += align(header.events * sizeof(uint32_t));
+        header.statusOffset = offset;  offset += align(header.events);
+        header.data1Offset = offset;   offset += align(header.events);
+        header.data2Offset = offset;   offset += align(header.events);
+        header.payloadOffset = offset; offset += align(header.events * sizeof(uint32_t));
+        header.sliceOffset = offset;   offset += align(slices.size() * sizeof(CacheSlice));
+        header.tempoOffset = offset;   offset += align(header.tempos * sizeof(TempoChange));
+        header.bytesOffset = offset;   offset += align(header.payloadBytes);
+        header.size = offset;
+
+        writeSection(output, &header, sizeof(header));
+        writeSection(output, tracks.data(), tracks.size() * sizeof(CacheTrack));
+        writeSection(output, columns.ticks.data(), header.events * sizeof(uint32_t));
+        writeSection(output, columns.status.data(), header.events);
+        writeSection(output, columns.data1.data(), header.events);
+        writeSection(output, columns.data2.data(), header.events);
+        writeSection(output, columns.payload.data(), header.events * sizeof(uint32_t));
+        writeSection(output, slices.data(), slices.size() * sizeof(CacheSlice));
+        writeSection(output, tempo.getChanges().data(), header.tempos * sizeof(TempoChange));
+
+        for (const auto& payload : columns.payloads)
+            output.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+
+        writePadding(output, header.payloadBytes);
+
+        return output ? Status() : Status(ERROR_IO, 0);
+    }
+
+    /**
+     * Method to decode a MIDI file and write a cache of it.
+     * @param source The path of the MIDI file.
+     * @param cache  The path of the cache.
+     * @return Status The error of reading, decoding or writing.
+     */
+    Status Cache::build(const std::string& source, const std::string& cache) {
+        CacheSource info;
+        std::shared_ptr<std::vector<uint8_t>> buffer = std::make_shared<std::vector<uint8_t>>();
+
+        if (!describe(source, info, *buffer))
+            return Status(ERROR_IO, 0);
+
+        File file;
+        DecodeResult result = Decoder().decode(std::shared_ptr<const std::vector<uint8_t>>(buffer), file);
+        if (!result.ok())
+            return result.status;
+
+        /* Writing to a temporary file first, so nobody ever maps a half written cache. Its
+         * name is unique, so builders of the same cache never write to each other's file.
+         */
+        std::vector<char> name(cache.begin(), cache.end());
+        const char suffix[] = ".XXXXXX";
+        name.insert(name.end(), suffix, suffix + sizeof(suffix));
+
+        const int fd = mkstemp(name.data());
+        if (fd < 0)
+            return Status(ERROR_IO, 0);
+
+        /* A temporary file is only readable by its owner, unlike the cache it becomes. */
+        fchmod(fd, 0644);
+        ::close(fd);
+
+        const std::string temporary(name.data());
+        std::ofstream output(temporary, std::ios::trunc | std::ios::binary);
+
+        Status status = write(file, info, output);
+        output.close();
+
+        if (status.ok() && (!output || rename(temporary.c_str(), cache.c_str()) != 0))
+            status = Status(ERROR_IO, 0);
+
+        if (!status.ok())
+            remove(temporary.c_str());
+
+        return status;
+    }
+
+    /**
+     * Method to open the cache of a MIDI file, which is built first if needed.
+     * @param source The path of the MIDI file.
+     * @param cache  The path of the cache.
+     * @param view   The view to open the cache in.
+     * @param verify Whether the hash of the source is compared.
+     * @return Status The error of building or opening.
+     */
+    Status Cache::load(const std::string& source, const std::string& cache, CacheView& view, bool verify) {
+        if (view.open(cache).ok()) {
+            /* The hash decides when verifying, so merely touching the source costs no rebuild. */
+            CacheSource info;
+            std::vector<uint8_t> buffer;
+
+            if (verify ? describe(source, info, buffer) && view.matches(buffer.data(), buffer.size()) : view.isFresh(source))
+                return Status();
+        }
+
+        view.close();
+
+        Status status = build(source, cache);
+        if (!status.ok())
+            return status;
+
+        return view.open(cache);
+    }
+
+    /**
+     * Method to get the size, modification time and hash of a source file.
+     * @param path   The path of the source file.
+     * @param source The information about the source.
+     * @param buffer The contents of the file are read into this.
+     * @return bool False if the file could not be read.
+     */
+    bool Cache::describe(const std::string& path, CacheSource& source, std::vector<uint8_t>& buffer) {
+        FILE *handle = fopen(path.c_str(), "rb");
+        if (handle == NULL)
+            return false;
+
+        struct stat info;
+        if (fstat(fileno(handle), &info) != 0) {
+            fclose(handle);
+            return false;
+        }
+
+        buffer.resize(info.st_size);
+        const size_t count = buffer.empty() ? 0 : fread(buffer.data(), 1, buffer.size(), handle);
+        fclose(handle);
+
+        if (count != buffer.size())
+            return false;
+
+        source.size = buffer.size();
+        source.modified = info.st_mtime;
+        source.hash = Hash::fnv1a(buffer.data(), buffer.size());
+
+        return true;
+    }
+
+    /**
+     * Method to open a cache by mapping it into memory.
+     * @param path The path of the cache.
+     * @return Status ERROR_IO, ERROR_CACHE_FORMAT or ERROR_CACHE_VERSION on failure.
+     */
+    Status CacheView::open(const std::string& path) {
+        close();
+
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return Status(ERROR_IO, 0);
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < (off_t) sizeof(CacheHeader)) {
+            ::close(fd);
+            return Status(ERROR_CACHE_FORMAT, 0);
+        }
+
+        /* The mapping stays valid after closing the descriptor. */
+        void *data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+
+        if (data == MAP_FAILED)
+            return Status(ERROR_IO, 0);
+
+        Status status = open(static_cast<const uint8_t*>(data), info.st_size);
+        if (!status.ok()) {
+            munmap(data, info.st_size);
+            return status;
+        }
+
+        _size = info.st_size;
+        return status;
+    }
+
+    /**
+     * Method to use a cache that is already in memory.
+     * @param data The bytes of the cache.
+     * @param size The amount of bytes.
+     * @return Status ERROR_CACHE_FORMAT or ERROR_CACHE_VERSION on failure.
+     */
+    Status CacheView::open(const uint8_t *data, size_t size) {
+        close();
+
+        if (size < sizeof(CacheHeader) || reinterpret_cast<uintptr_t>(data) % 8 != 0)
+            return Status(ERROR_CACHE_FORMAT, 0);
+
+        const CacheHeader& header = *reinterpret_cast<const CacheHeader*>(data);
+        if (memcmp(header.magic, Cache::IDENTIFIER, sizeof(header.magic)))
+            return Status(ERROR_CACHE_FORMAT, 0);
+
+        if (header.version != Cache::VERSION || header.byteOrder != 0x01020304)
+            return Status(ERROR_CACHE_VERSION, 8);
+
+        /* Only the bounds of the sections are checked, the contents are trusted until they
+         * are turned back into a file.
+         */
+        if (header.size != size ||
+            !checkSection(header.trackOffset, header.tracks, sizeof(CacheTrack), size) ||
+            !checkSection(header.tickOffset, header.events, sizeof(uint32_t), size) ||
+            !checkSection(header.statusOffset, header.events, 1, size) ||
+            !checkSection(header.data1Offset, header.events, 1, size) ||
+            !checkSection(header.data2Offset, header.events, 1, size) ||
+            !checkSection(header.payloadOffset, header.events, sizeof(uint32_t), size) ||
+            !checkSection(header.sliceOffset, header.payloads, sizeof(CacheSlice), size) ||
+            !checkSection(header.tempoOffset, header.tempos, sizeof(TempoChange), size) ||
+            !checkSection(header.bytesOffset, header.payloadBytes, 1, size))
+            return Status(ERROR_CACHE_FORMAT, 0);
+
+        _data = data;
+        return Status();
+    }
+
+    /**
+     * Method to close the cache.
+     */
+    void CacheView::close() {
+        if (_size > 0)
+            munmap(const_cast<uint8_t*>(_data), _size);
+
+        _data = NULL;
+        _size = 0;
+    }
+
+    /**
+     * Method to cheaply check if a source file did not change since the cache was built.
+     * @param path The path of the source file.
+     * @return bool True if the source seems unchanged.
+     */
+    bool CacheView::isFresh(const std::string& path) const {
+        struct stat info;
+        if (!isOpen() || stat(path.c_str(), &info) != 0)
+            return false;
+
+        return (uint64_t) info.st_size == getHeader().sourceSize && info.st_mtime == getHeader().sourceModified;
+    }
+
+    /**
+     * Method to check if the cache was built from exactly these bytes.
+     * @param data The bytes of the source file.
+     * @param size The amount of bytes.
+     * @return bool True if the size and hash match.
+     */
+    bool CacheView::matches(const uint8_t *data, size_t size) const {
+        return isOpen() && size == getHeader().sourceSize && Hash::fnv1a(data, size) == getHeader().sourceHash;
+    }
+
+    /**
+     * Method to get the payload of an event.
+     * @param event The index of the event.
+     * @return Payload The payload, empty for messages.
+     */
+    Payload CacheView::getPayload(size_t event) const {
+        if (event >= size())
+            return Payload();
+
+        return getPayloadAt(section<uint32_t>(getHeader().payloadOffset)[event]);
+    }
+
+    /**
+     * Method to get a payload by its own index.
+     * @param index The index of the payload.
+     * @return Payload The payload, empty if the index is out of range.
+     */
+    Payload CacheView::getPayloadAt(uint32_t index) const {
+        if (index >= getHeader().payloads)
+            return Payload();
+
+        const CacheSlice& slice = section<CacheSlice>(getHeader().sliceOffset)[index];
+        if (slice.offset > getHeader().payloadBytes || slice.size > getHeader().payloadBytes - slice.offset)
+            return Payload();
+
+        return Payload::borrow(_data + getHeader().bytesOffset + slice.offset, slice.size);
+    }
+
+    /**
+     * Method to create the events of the file again.
+     * @param file The file to fill.
+     * @return Status ERROR_CACHE_FORMAT if the cache is damaged.
+     */
+    Status CacheView::toFile(File& file) const {
+        file.clear();
+
+        if (!isOpen())
+            return Status(ERROR_CACHE_FORMAT, 0);
+
+        const CacheHeader& header = getHeader();
+        EventColumns columns;
+
+        columns.format = header.format;
+        columns.division = header.division;
+        columns.ticks.assign(getTicks(), getTicks() + header.events);
+        columns.status.assign(getStatus(), getStatus() + header.events);
+        columns.data1.assign(getData1(), getData1() + header.events);
+        columns.data2.assign(getData2(), getData2() + header.events);
+        columns.payload.assign(section<uint32_t>(header.payloadOffset), section<uint32_t>(header.payloadOffset) + header.events);
+
+        /* The file might outlive this view, so the payloads are copied. */
+        columns.payloads.reserve(header.payloads);
+        for (uint32_t i = 0; i < header.payloads; i++) {
+            Payload payload = getPayloadAt(i);
+            columns.payloads.push_back(Payload(payload.data(), payload.size()));
+        }
+
+        /* The tracks have to cover the events exactly and in order. */
+        for (uint32_t t = 0; t < header.tracks; t++) {
+            const CacheTrack& track = getTrack(t);
+            if (track.first != columns.trackBegin.back() || track.count > header.events - track.first)
+                return Status(ERROR_CACHE_FORMAT, header.trackOffset + t * sizeof(CacheTrack));
+
+            columns.trackBegin.push_back(track.first + track.count);
+
+            /* Deltas are computed from the ticks, so they may never go back in time. */
+            for (uint64_t i = track.first + 1; i < track.first + track.count; i++) {
+                if (columns.ticks[i] < columns.ticks[i - 1])
+                    return Status(ERROR_CACHE_FORMAT, header.tickOffset + i * sizeof(uint32_t));
+            }
+        }
+
+        if (columns.trackBegin.back() != header.events)
+            return Status(ERROR_CACHE_FORMAT, header.trackOffset);
+
+        for (uint64_t i = 0; i < header.events; i++) {
+            const uint8_t status = columns.status[i];
+            const bool hasPayload = status >= 0xF0;
+
+            /* Anything that could not have come from a decoded file is rejected. */
+            if (status < 0x80 || (hasPayload && status != 0xFF && status != 0xF0 && status != 0xF7) ||
+                hasPayload != (columns.payload[i] != EventColumns::NO_PAYLOAD) ||
+                (hasPayload && columns.payload[i] >= header.payloads) ||
+                (!hasPayload && ((columns.data1[i] | columns.data2[i]) & 0x80)) ||
+                (hasPayload && status != 0xFF && columns.data1[i] > Events::SYSEX_ESCAPE))
+                return Status(ERROR_CACHE_FORMAT, header.statusOffset + i);
+        }
+
+        columns.restore(file);
+        return Status();
+    }
+}
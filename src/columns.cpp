@@ -0,0 +1,150 @@
+/**
+ * columns.cpp
+ *
+ * File with implementations for the Midi::EventColumns class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/columns.h>
+#include <cppmidi/events/message.h>
+#include <cppmidi/events/meta.h>
+#include <cppmidi/events/sysex.h>
+
+using Midi::Events::Message;
+using Midi::Events::MessageType;
+using Midi::Events::Meta;
+using Midi::Events::MetaType;
+using Midi::Events::SysEx;
+using Midi::Events::SysExPacket;
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    const uint32_t EventColumns::NO_PAYLOAD;
+
+    /**
+     * Method to replace the columns with all the events of a file.
+     * @param file The file.
+     */
+    void EventColumns::assign(const File& file) {
+        format = file.getHeader().getFileFormat();
+        division = file.getHeader().getDeltaTicks();
+
+        /* Counting first, so every column is allocated exactly once. */
+        size_t events = 0;
+        for (int i = 0; i < file.getTrackSlots(); i++) {
+            if (file.getTrack(i) != NULL)
+                events += file.getTrack(i)->getEvents().size();
+        }
+
+        ticks.clear();
+        status.clear();
+        data1.clear();
+        data2.clear();
+        payload.clear();
+        payloads.clear();
+        trackBegin.assign(1, 0);
+        reserve(events, 0);
+
+        for (int i = 0; i < file.getTrackSlots(); i++) {
+            const Track *track = file.getTrack(i);
+            uint32_t tick = 0;
+
+            if (track != NULL) {
+                for (auto event : track->getEvents()) {
+                    tick += event->deltaTime.getValue();
+                    ticks.push_back(tick);
+
+                    switch (event->getCategory()) {
+                    case CATEGORY_MESSAGE: {
+                        const Message *message = static_cast<const Message*>(event);
+                        status.push_back(message->getType() << 4 | message->getChannel());
+                        data1.push_back(message->getData1());
+                        data2.push_back(message->getData2());
+                        payload.push_back(NO_PAYLOAD);
+                        break;
+                    }
+                    case CATEGORY_META: {
+                        const Meta *meta = static_cast<const Meta*>(event);
+                        status.push_back(0xFF);
+                        data1.push_back(meta->getType());
+                        data2.push_back(0);
+                        payload.push_back(payloads.size());
+                        payloads.push_back(meta->getData());
+                        break;
+                    }
+                    case CATEGORY_SYSEX: {
+                        const SysEx *sysex = static_cast<const SysEx*>(event);
+                        status.push_back(sysex->getType());
+                        data1.push_back(sysex->getPacket());
+                        data2.push_back(0);
+                        payload.push_back(payloads.size());
+                        payloads.push_back(sysex->getPayload());
+                        break;
+                    }
+                    }
+                }
+            }
+
+            trackBegin.push_back(ticks.size());
+        }
+    }
+
+    /**
+     * Method to create the events from the columns again.
+     * @param file The file to fill.
+     */
+    void EventColumns::restore(File& file) const {
+        file.clear();
+        file.getHeader().setFileFormat(static_cast<MidiMode>(format));
+        file.getHeader().setDeltaTicks(division);
+
+        for (size_t t = 0; t < tracks(); t++) {
+            Track *track = file.getTrack(t);
+            uint32_t tick = 0;
+
+            /* Without a track there is no point in going on, the header cannot count it. */
+            if (track == NULL)
+                return;
+
+            for (size_t i = trackBegin[t]; i < trackBegin[t + 1]; i++) {
+                const uint32_t delta = ticks[i] - tick;
+                const Payload empty;
+                const Payload& data = payload[i] == NO_PAYLOAD ? empty : payloads[payload[i]];
+                tick = ticks[i];
+
+                if (status[i] == 0xFF) {
+                    Meta meta(static_cast<MetaType>(data1[i]), data);
+                    meta.deltaTime = delta;
+                    track->addEvent(meta);
+                }
+                else if (status[i] >= 0xF0) {
+                    SysEx sysex(status[i], data, static_cast<SysExPacket>(data1[i]));
+                    sysex.deltaTime = delta;
+                    track->addEvent(sysex);
+                }
+                else {
+                    Message message(static_cast<MessageType>(status[i] >> 4), status[i] & 0x0F, data1[i], data2[i]);
+                    message.deltaTime = delta;
+                    track->addEvent(message);
+                }
+            }
+        }
+    }
+
+    /**
+     * Method to reserve room for an amount of events and payloads.
+     * @param events   The amount of events.
+     * @param payloads The amount of payloads.
+     */
+    void EventColumns::reserve(size_t events, size_t payloads) {
+        ticks.reserve(events);
+        status.reserve(events);
+        data1.reserve(events);
+        data2.reserve(events);
+        payload.reserve(events);
+        this->payloads.reserve(payloads);
+    }
+}
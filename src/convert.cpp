@@ -0,0 +1,258 @@
+/**
+ * convert.cpp
+ *
+ * File with implementations for the Midi::Converter class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/convert.h>
+#include <cppmidi/events/message.h>
+#include <cppmidi/events/meta.h>
+#include <queue>
+#include <algorithm>
+#include <functional>
+
+using Midi::Events::Message;
+using Midi::Events::Meta;
+using Midi::Events::MetaType;
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    /**
+     * Method to check whether an event is an end of track event.
+     * @param event The event.
+     * @return bool True if it is.
+     */
+    static bool isEnd(const Event *event) {
+        return event->getCategory() == CATEGORY_META && static_cast<const Meta*>(event)->getType() == MetaType::EOT;
+    }
+
+    /**
+     * Method to copy the chunks that are not tracks to a converted file. The chunks in front
+     * of the first track stay in front, and all the others are moved to the end.
+     * @param input  The original file.
+     * @param output The converted file.
+     */
+    static void copyChunks(const File& input, File& output) {
+        int first = 0;
+        while (first < input.getTrackSlots() && input.getTrack(first) == NULL)
+            first++;
+
+        for (const auto& entry : input.getChunks())
+            output.addChunk(entry.second, entry.first <= first ? 0 : 0xFFFF);
+    }
+
+    /**
+     * The position of the next event of a track while merging.
+     */
+    struct MergeCursor {
+        /**
+         * The absolute tick of the next event.
+         * @var uint32_t
+         */
+        uint32_t tick;
+
+        /**
+         * The index of the track, and of the next event in it.
+         * @var size_t
+         */
+        size_t track;
+        size_t position;
+
+        /**
+         * Operator for the priority queue, which puts the earliest event on top and the
+         * events of earlier tracks first on the same tick.
+         * @param other The other cursor.
+         * @return bool True if this cursor comes after the other.
+         */
+        bool operator >(const MergeCursor& other) const {
+            return tick != other.tick ? tick > other.tick : track > other.track;
+        }
+    };
+
+    /**
+     * Method to split a file with a single track into a conductor track and a track for
+     * every channel.
+     * @param input  The file, which may have at most one track.
+     * @param output The file to fill, which is cleared first.
+     * @return bool False if the input has more than one track.
+     */
+    bool Converter::toMultiTrack(const File& input, File& output) {
+        const Track *source = NULL;
+        for (int i = 0; i < input.getTrackSlots(); i++) {
+            if (input.getTrack(i) == NULL)
+                continue;
+
+            if (source != NULL)
+                return false;
+
+            source = input.getTrack(i);
+        }
+
+        output.clear();
+        output.getHeader().setFileFormat(MULTITRACK_SYNC);
+        output.getHeader().setDeltaTicks(input.getHeader().getDeltaTicks());
+        copyChunks(input, output);
+
+        /* Slot 0 is the conductor track, and slot 1 + n the track for channel n. */
+        size_t counts[17] = { 0 };
+        uint32_t end = 0;
+
+        if (source != NULL) {
+            for (auto event : source->getEvents()) {
+                end += event->deltaTime.getValue();
+
+                if (event->getCategory() == CATEGORY_MESSAGE)
+                    counts[1 + static_cast<const Message*>(event)->getChannel()]++;
+                else if (!isEnd(event))
+                    counts[0]++;
+            }
+        }
+
+        /* The conductor track is always there, the channel tracks only if they are used. */
+        Track *tracks[17] = { NULL };
+        int next = 0;
+        for (size_t slot = 0; slot < 17; slot++) {
+            if (slot > 0 && counts[slot] == 0)
+                continue;
+
+            tracks[slot] = output.getTrack(next++);
+            tracks[slot]->_events.reserve(counts[slot] + 1);
+        }
+
+        /* The absolute tick of the last event added to every track. */
+        uint32_t last[17] = { 0 };
+        uint32_t tick = 0;
+
+        if (source != NULL) {
+            for (auto event : source->getEvents()) {
+                tick += event->deltaTime.getValue();
+
+                if (isEnd(event))
+                    continue;
+
+                const size_t slot = event->getCategory() == CATEGORY_MESSAGE ? 1 + static_cast<const Message*>(event)->getChannel() : 0;
+
+                /* The delta time changes the length of the event, so it is set before adding. */
+                Event *copy = event->clone();
+                copy->deltaTime = tick - last[slot];
+                last[slot] = tick;
+
+                tracks[slot]->addEvent(copy);
+            }
+        }
+
+        for (size_t slot = 0; slot < 17; slot++) {
+            if (tracks[slot] == NULL)
+                continue;
+
+            Meta *eot = new Meta(MetaType::EOT);
+            eot->deltaTime = end - last[slot];
+            tracks[slot]->addEvent(eot);
+        }
+
+        return true;
+    }
+
+    /**
+     * Method to merge all the tracks of a file into a single track.
+     * @param input  The file, which may not be of format 2.
+     * @param output The file to fill, which is cleared first.
+     * @return bool False if the input is of format 2, which has independent sequences.
+     */
+    bool Converter::toSingleTrack(const File& input, File& output) {
+        if (input.getHeader().getFileFormat() == MULTITRACK_ASYNC)
+            return false;
+
+        std::vector<const Track*> sources;
+        size_t total = 0;
+        uint32_t end = 0;
+
+        for (int i = 0; i < input.getTrackSlots(); i++) {
+            const Track *track = input.getTrack(i);
+            if (track == NULL)
+                continue;
+
+            uint32_t tick = 0;
+            for (auto event : track->getEvents()) {
+                tick += event->deltaTime.getValue();
+                total += !isEnd(event);
+            }
+
+            end = std::max(end, tick);
+            sources.push_back(track);
+        }
+
+        output.clear();
+        output.getHeader().setFileFormat(SINGLETRACK);
+        output.getHeader().setDeltaTicks(input.getHeader().getDeltaTicks());
+        copyChunks(input, output);
+
+        Track *merged = output.getTrack(0);
+        merged->_events.reserve(total + 1);
+
+        /* Every track is sorted on tick already, so only the next event of every track
+         * has to be compared.
+         */
+        std::priority_queue<MergeCursor, std::vector<MergeCursor>, std::greater<MergeCursor>> queue;
+        for (size_t t = 0; t < sources.size(); t++) {
+            if (!sources[t]->getEvents().empty())
+                queue.push({ sources[t]->getEvents()[0]->deltaTime.getValue(), t, 0 });
+        }
+
+        uint32_t last = 0;
+        while (!queue.empty()) {
+            MergeCursor cursor = queue.top();
+            queue.pop();
+
+            const std::vector<Event*>& events = sources[cursor.track]->getEvents();
+            const Event *event = events[cursor.position];
+
+            if (!isEnd(event)) {
+                Event *copy = event->clone();
+                copy->deltaTime = cursor.tick - last;
+                last = cursor.tick;
+
+                merged->addEvent(copy);
+            }
+
+            if (++cursor.position < events.size()) {
+                cursor.tick += events[cursor.position]->deltaTime.getValue();
+                queue.push(cursor);
+            }
+        }
+
+        Meta *eot = new Meta(MetaType::EOT);
+        eot->deltaTime = end - last;
+        merged->addEvent(eot);
+
+        return true;
+    }
+
+    /**
+     * Method to convert a file to another format in place.
+     * @param file   The file.
+     * @param format SINGLETRACK or MULTITRACK_SYNC.
+     * @return bool False if the file cannot be converted, in which case it is unchanged.
+     */
+    bool Converter::convert(File& file, MidiMode format) {
+        if (file.getHeader().getFileFormat() == format)
+            return true;
+
+        if (format == MULTITRACK_ASYNC)
+            return false;
+
+        File converted;
+        if (format == SINGLETRACK && !toSingleTrack(file, converted))
+            return false;
+
+        if (format == MULTITRACK_SYNC && !toMultiTrack(file, converted))
+            return false;
+
+        file.swap(converted);
+        return true;
+    }
+}
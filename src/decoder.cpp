@@ -0,0 +1,721 @@
+/**
+ * decoder.cpp
+ *
+ * File with implementations for the Midi::Decoder class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/decoder.h>
+#include <cppmidi/endian.h>
+#include <cppmidi/vlvalue.h>
+#include <cppmidi/validator.h>
+#include <cppmidi/intern.h>
+#include <cppmidi/trace.h>
+#include <cppmidi/events/message.h>
+#include <cppmidi/events/meta.h>
+#include <cppmidi/events/sysex.h>
+#include <cstring>
+#include <algorithm>
+
+using Midi::Events::Message;
+using Midi::Events::MessageType;
+using Midi::Events::Meta;
+using Midi::Events::MetaType;
+using Midi::Events::SysEx;
+using Midi::Events::SysExPacket;
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    /**
+     * The amount of bytes a copied payload takes besides its bytes, for its buffer and the
+     * shared pointer to it.
+     */
+    static const size_t PAYLOAD_OVERHEAD = 64;
+
+    /**
+     * Method to get the memory a payload takes besides its event.
+     * @param owner  The buffer holding the bytes, or empty if payloads are copied.
+     * @param length The amount of bytes in the payload.
+     * @return size_t The amount of bytes that is allocated for the payload.
+     */
+    static size_t copied(const std::shared_ptr<const void>& owner, size_t length) {
+        /* Short payloads are stored inside the event, longer ones point into a shared buffer. */
+        if (length <= Payload::INLINE_SIZE || owner)
+            return 0;
+
+        return length + PAYLOAD_OVERHEAD;
+    }
+
+    /**
+     * Method to check whether a chunk after the last track should be kept.
+     * @param identifier The 4 characters that identify the chunk.
+     * @return bool True for an unknown chunk, false for another track or header or anything else.
+     */
+    static bool isTrailing(const uint8_t *identifier) {
+        return memcmp(identifier, Track::IDENTIFIER, 4) && memcmp(identifier, Header::IDENTIFIER, 4) && Validator::isPrintable(identifier);
+    }
+
+    /**
+     * The memory a single track takes from a budget. Bytes are taken from the budget in blocks,
+     * so tracks that are decoded at the same time rarely touch the shared counter. Unless the
+     * track was decoded completely, everything it took is given back.
+     */
+    class TrackAllowance {
+        public:
+            /**
+             * Constructor
+             * @param budget The budget to take from.
+             */
+            TrackAllowance(DecodeBudget& budget) : _budget(budget), _available(0), _taken(0), _kept(false) {}
+
+            /**
+             * Destructor, which gives back what was not used.
+             */
+            virtual ~TrackAllowance() {
+                _budget.give(_available + (_kept ? 0 : _taken));
+            }
+
+            /**
+             * Method to take bytes before allocating them.
+             * @param bytes The amount of bytes.
+             * @return bool False if the budget does not have them.
+             */
+            bool take(uint64_t bytes) {
+                if (!_budget.limited())
+                    return true;
+
+                if (bytes > _available) {
+                    const uint64_t missing = bytes - _available;
+
+                    /* Near the limit a whole block might not be available anymore. */
+                    if (_budget.take(std::max<uint64_t>(missing, BLOCK_SIZE)))
+                        _available += std::max<uint64_t>(missing, BLOCK_SIZE);
+                    else if (_budget.take(missing))
+                        _available += missing;
+                    else
+                        return false;
+                }
+
+                _available -= bytes;
+                _taken += bytes;
+                return true;
+            }
+
+            /**
+             * Method to keep what was taken, once the track was decoded.
+             */
+            void keep() { _kept = true; }
+
+        private:
+            /**
+             * The amount of bytes that is taken from the budget at once.
+             */
+            static const uint64_t BLOCK_SIZE = 1 << 16;
+
+            /**
+             * The budget.
+             * @var DecodeBudget&
+             */
+            DecodeBudget& _budget;
+
+            /**
+             * The bytes that were taken from the budget but not used yet, and those that were used.
+             * @var uint64_t
+             */
+            uint64_t _available;
+            uint64_t _taken;
+
+            /**
+             * Whether the used bytes are kept.
+             * @var bool
+             */
+            bool _kept;
+    };
+
+    const uint64_t TrackAllowance::BLOCK_SIZE;
+
+    /**
+     * Method to decode a complete file from memory.
+     * @param data  The bytes of the file.
+     * @param size  The amount of bytes.
+     * @param file  The file to decode into.
+     * @param owner The buffer holding the bytes, or empty if payloads should be copied.
+     * @param used  The memory the decoder already allocated for the input.
+     * @return DecodeResult The result of the decoding.
+     */
+    DecodeResult Decoder::decode(const uint8_t *data, size_t size, File& file, const std::shared_ptr<const void>& owner, uint64_t used) const {
+        CPPMIDI_TRACE_SPAN(span, "decode", size);
+        DecodeResult result;
+        file.clear();
+
+        /* The input counts as memory too when the decoded payloads keep it alive. */
+        DecodeBudget budget(_options.maxMemory);
+        if (_options.maxBytes && size > _options.maxBytes)
+            result.status = Status(ERROR_LIMIT_BYTES, _options.maxBytes);
+        else if (!budget.take(used))
+            result.status = Status(ERROR_LIMIT_MEMORY, 0);
+
+        if (!result.status.ok())
+            return result;
+
+        /* Errors in the header are always fatal, there is nothing to recover without it. */
+        uint16_t numTracks;
+        size_t offset;
+        if (!(result.status = decodeHeader(data, size, file, numTracks, offset)).ok())
+            return result;
+
+        file._tracks.reserve(numTracks);
+
+        while (result.tracks + result.skipped < numTracks) {
+            Status status;
+
+            if (size - offset < 8) {
+                status = Status(ERROR_TRUNCATED, size);
+            }
+            else {
+                const uint32_t chunkLength = Endian::readIntBig(data + offset + 4);
+                const size_t end = offset + 8 + chunkLength;
+
+                if (chunkLength > size - offset - 8) {
+                    status = Status(ERROR_CHUNK_LENGTH, offset + 4);
+                }
+                else if (memcmp(data + offset, Track::IDENTIFIER, 4)) {
+                    /* Unknown chunks are kept as they are, as long as they look like chunks. */
+                    if (!Validator::isPrintable(data + offset))
+                        status = Status(ERROR_CHUNK_MAGIC, offset);
+                    else if (!budget.take(sizeof(Chunk) + copied(owner, chunkLength)))
+                        status = Status(ERROR_LIMIT_MEMORY, offset);
+                    else {
+                        file.addChunk(Chunk(reinterpret_cast<const char*>(data + offset), Payload::share(owner, data + offset + 8, chunkLength)), file._tracks.size());
+                        offset = end;
+                        continue;
+                    }
+                }
+                else {
+                    Track *track = new Track();
+                    status = decodeTrack(data, offset + 8, end, *track, owner, &budget);
+
+                    if (status.ok()) {
+                        file._tracks.push_back(track);
+                        result.tracks++;
+                        offset = end;
+                        continue;
+                    }
+
+                    /* The chunk itself is intact, so the next chunk starts right after it. */
+                    delete track;
+                    if (_options.skipCorruptTracks) {
+                        if (result.status.ok())
+                            result.status = status;
+
+                        result.skipped++;
+                        offset = end;
+                        continue;
+                    }
+                }
+            }
+
+            /* Only the first error is reported. */
+            if (result.status.ok())
+                result.status = status;
+
+            /* Without recovery the file is emptied, so it is never left half built. */
+            if (!_options.skipCorruptTracks) {
+                file.clear();
+                result.tracks = 0;
+                return result;
+            }
+
+            /* Only a broken track counts as a skipped one. Any other broken chunk is simply
+             * passed over, so the tracks after it are all still searched for.
+             */
+            if (status.code != ERROR_TRUNCATED && !memcmp(data + offset, Track::IDENTIFIER, 4))
+                result.skipped++;
+
+            /* The chunk framing is broken, so the only way to continue is to search for
+             * the next track identifier.
+             */
+            if (status.code == ERROR_TRUNCATED || (offset = resync(data, offset, size)) >= size)
+                break;
+        }
+
+        /* Unknown chunks may follow the last track as well, up to the end of the file. */
+        for (size_t length; (length = trailingChunk(data, size, offset)) > 0; offset += length) {
+            if (!budget.take(sizeof(Chunk) + copied(owner, length - 8))) {
+                if (result.status.ok())
+                    result.status = Status(ERROR_LIMIT_MEMORY, offset);
+
+                if (!_options.skipCorruptTracks) {
+                    file.clear();
+                    result.tracks = 0;
+                    return result;
+                }
+
+                break;
+            }
+
+            file.addChunk(Chunk(reinterpret_cast<const char*>(data + offset), Payload::share(owner, data + offset + 8, length - 8)), file._tracks.size());
+        }
+
+        file._head._numTracks = file._tracks.size();
+        return result;
+    }
+
+    /**
+     * Method to decode the header of a file and find its track chunks.
+     * @param data   The bytes of the file.
+     * @param size   The amount of bytes.
+     * @param file   The file to decode into.
+     * @param chunks The begin and end offsets of the events in every track chunk.
+     * @return Status The error and its offset, ERROR_NONE on success.
+     */
+    Status Decoder::prepare(const uint8_t *data, size_t size, File& file, std::vector<std::pair<size_t, size_t>>& chunks, const std::shared_ptr<const void>& owner) const {
+        CPPMIDI_TRACE_SPAN(span, "prepare", size);
+        file.clear();
+        chunks.clear();
+
+        uint16_t numTracks;
+        size_t offset;
+        Status status = decodeHeader(data, size, file, numTracks, offset);
+        if (!status.ok())
+            return status;
+
+        chunks.reserve(numTracks);
+
+        while (chunks.size() < numTracks) {
+            if (size - offset < 8)
+                status = Status(ERROR_TRUNCATED, size);
+            else if (Endian::readIntBig(data + offset + 4) > size - offset - 8)
+                status = Status(ERROR_CHUNK_LENGTH, offset + 4);
+            else if (memcmp(data + offset, Track::IDENTIFIER, 4) && !Validator::isPrintable(data + offset))
+                status = Status(ERROR_CHUNK_MAGIC, offset);
+
+            if (!status.ok()) {
+                file.clear();
+                chunks.clear();
+                return status;
+            }
+
+            const size_t end = offset + 8 + Endian::readIntBig(data + offset + 4);
+
+            /* Unknown chunks are kept, just like when decoding. */
+            if (!memcmp(data + offset, Track::IDENTIFIER, 4)) {
+                chunks.push_back(std::make_pair(offset + 8, end));
+                file._tracks.push_back(new Track());
+            }
+            else
+                file.addChunk(Chunk(reinterpret_cast<const char*>(data + offset), Payload::share(owner, data + offset + 8, end - offset - 8)), file._tracks.size());
+
+            offset = end;
+        }
+
+        for (size_t length; (length = trailingChunk(data, size, offset)) > 0; offset += length)
+            file.addChunk(Chunk(reinterpret_cast<const char*>(data + offset), Payload::share(owner, data + offset + 8, length - 8)), file._tracks.size());
+
+        file._head._numTracks = file._tracks.size();
+        return status;
+    }
+
+    /**
+     * Method to decode the header chunk of a file.
+     * @param data      The bytes of the file.
+     * @param size      The amount of bytes.
+     * @param file      The file to set the header of.
+     * @param numTracks The amount of tracks announced by the header.
+     * @param offset    The offset of the first chunk after the header.
+     * @return Status The error and its offset, ERROR_NONE on success.
+     */
+    Status Decoder::decodeHeader(const uint8_t *data, size_t size, File& file, uint16_t& numTracks, size_t& offset) {
+        CPPMIDI_TRACE_SPAN(span, "header", 0);
+
+        if (size < 4 || memcmp(data, Header::IDENTIFIER, 4))
+            return Status(size < 4 ? ERROR_TRUNCATED : ERROR_HEADER_MAGIC, 0);
+
+        if (size < 14)
+            return Status(ERROR_TRUNCATED, size);
+
+        const uint32_t length = Endian::readIntBig(data + 4);
+        if (length < 6)
+            return Status(ERROR_HEADER_LENGTH, 4);
+
+        if (length > size - 8)
+            return Status(ERROR_CHUNK_LENGTH, 4);
+
+        file._head._fileFormat = Endian::readShortBig(data + 8);
+        file._head._deltaTicks = Endian::readShortBig(data + 12);
+
+        numTracks = Endian::readShortBig(data + 10);
+        offset = 8 + length;
+
+        CPPMIDI_TRACE_BYTES(span, offset);
+
+        return Status();
+    }
+
+    /**
+     * Method to check for an unknown chunk after the last track.
+     * @param data   The bytes of the file.
+     * @param size   The amount of bytes.
+     * @param offset The offset of the chunk.
+     * @return size_t The size of the chunk with its header, 0 if there is no such chunk.
+     */
+    size_t Decoder::trailingChunk(const uint8_t *data, size_t size, size_t offset) {
+        if (offset > size || size - offset < 8 || !isTrailing(data + offset))
+            return 0;
+
+        const uint32_t length = Endian::readIntBig(data + offset + 4);
+        return length > size - offset - 8 ? 0 : 8 + (size_t) length;
+    }
+
+    /**
+     * Method to decode a complete file from a stream, which should be in binary mode.
+     * @param input The input stream.
+     * @param file  The file to decode into.
+     * @return DecodeResult The result of the decoding.
+     */
+    DecodeResult Decoder::decode(std::istream& input, File& file) const {
+        std::shared_ptr<std::vector<uint8_t>> buffer = std::make_shared<std::vector<uint8_t>>();
+        Status status;
+        {
+            CPPMIDI_TRACE_SPAN(span, "read", 0);
+            status = read(input, *buffer, inputLimit());
+            CPPMIDI_TRACE_BYTES(span, buffer->size());
+        }
+
+        /* The limit of the input is the lowest of the size and memory limits. */
+        if (status.code == ERROR_LIMIT_BYTES)
+            status.code = checkInput(inputLimit() + 1).code;
+
+        /* Even if the stream ended early the tracks that were read completely might be
+         * recovered, otherwise the error of the stream is the most telling one, and nothing
+         * is decoded at all. A file that is too large thus never gets decoded.
+         */
+        if (!status.ok() && (!_options.skipCorruptTracks || status.code != ERROR_TRUNCATED)) {
+            file.clear();
+
+            DecodeResult result;
+            result.status = status;
+            return result;
+        }
+
+        return decode(buffer->data(), buffer->size(), file, buffer, buffer->size());
+    }
+
+    /**
+     * Method to decode the events of a single track chunk, which are added to the track.
+     * @param data  The bytes of the file.
+     * @param begin The offset of the first event, right after the chunk header.
+     * @param end   The offset right after the last byte of the chunk.
+     * @param track  The track to add the events to.
+     * @param owner  The buffer holding the bytes, or empty if payloads should be copied.
+     * @param budget The memory budget, or NULL for a budget of maxMemory for this track alone.
+     * @return Status The error and its offset, ERROR_NONE on success.
+     */
+    Status Decoder::decodeTrack(const uint8_t *data, size_t begin, size_t end, Track& track, const std::shared_ptr<const void>& owner,
+                                DecodeBudget *budget) const {
+        CPPMIDI_TRACE_SPAN(span, "decodeTrack", end - begin);
+        DecodeBudget local(_options.maxMemory);
+        TrackAllowance allowance(budget == NULL ? local : *budget);
+
+        /* Method to check the limits before an event of a number of bytes is allocated. */
+        auto admit = [&](size_t bytes) -> ErrorCode {
+            const size_t count = track._events.size();
+            if (_options.maxEventsPerTrack && count >= _options.maxEventsPerTrack)
+                return ERROR_LIMIT_EVENTS;
+
+            /* A full vector is about to grow to twice its size. */
+            if (count == track._events.capacity())
+                bytes += std::max<size_t>(count, 1) * sizeof(Event*);
+
+            return allowance.take(bytes) ? ERROR_NONE : ERROR_LIMIT_MEMORY;
+        };
+
+        size_t offset = begin;
+        uint8_t running = 0;
+
+        /* Whether a sysex message was split and its next packet is expected, and whether the
+         * end of track was found.
+         */
+        bool split = false;
+        bool ended = false;
+        uint32_t delta, length;
+        ErrorCode error;
+
+        /* Most events take 3 or 4 bytes, so this avoids nearly all reallocations. Without
+         * the memory for it, the events are simply added without reserving.
+         */
+        size_t expected = (end - begin) / 3;
+        if (_options.maxEventsPerTrack)
+            expected = std::min<size_t>(expected, _options.maxEventsPerTrack);
+
+        const size_t capacity = track._events.size() + expected;
+        if (capacity > track._events.capacity() && allowance.take((capacity - track._events.capacity()) * sizeof(Event*)))
+            track._events.reserve(capacity);
+
+        while (offset < end) {
+            const size_t start = offset;
+            if ((error = VLValue::read(data, offset, end, delta)) != ERROR_NONE)
+                return Status(error, start);
+
+            if (offset >= end)
+                return Status(ERROR_EVENT_OVERRUN, offset);
+
+            /* A data byte where the status is expected means running status. */
+            uint8_t status = data[offset];
+            if (status & 0x80)
+                offset++;
+            else if (!(status = running))
+                return Status(ERROR_STATUS_BYTE, offset);
+
+            if (status < 0xF0) {
+                const uint8_t count = Validator::DATA_BYTES[status >> 4];
+                running = status;
+
+                if (end - offset < count)
+                    return Status(ERROR_EVENT_OVERRUN, offset);
+
+                if ((data[offset] | data[offset + count - 1]) & 0x80)
+                    return Status(ERROR_DATA_BYTE, offset + !(data[offset] & 0x80));
+
+                if ((error = admit(sizeof(Message))) != ERROR_NONE)
+                    return Status(error, start);
+
+                Message *msg = new Message();
+                msg->deltaTime.setValue(delta);
+                msg->_type = status >> 4;
+                msg->_channel = status & 0xF;
+                msg->_data1 = data[offset];
+                msg->_data2 = count == 2 ? data[offset + 1] : 0;
+
+                track.addEvent(msg);
+                offset += count;
+                continue;
+            }
+
+            /* Meta and sysex events cancel the running status. */
+            running = 0;
+
+            if (status == 0xFF) {
+                if (offset >= end)
+                    return Status(ERROR_EVENT_OVERRUN, offset);
+
+                const uint8_t type = data[offset++];
+                const size_t lengthOffset = offset;
+
+                if ((error = VLValue::read(data, offset, end, length)) != ERROR_NONE)
+                    return Status(error, lengthOffset);
+
+                if (length > end - offset)
+                    return Status(ERROR_EVENT_OVERRUN, lengthOffset);
+
+                if (_options.maxPayloadSize && length > _options.maxPayloadSize)
+                    return Status(ERROR_LIMIT_PAYLOAD, lengthOffset);
+
+                if ((error = admit(sizeof(Meta) + copied(owner, length))) != ERROR_NONE)
+                    return Status(error, start);
+
+                Meta *meta = new Meta();
+                meta->deltaTime.setValue(delta);
+                meta->_type = type;
+                meta->_data = _options.pool ? _options.pool->intern(data + offset, length) : Payload::share(owner, data + offset, length);
+
+                track.addEvent(meta);
+                offset += length;
+
+                /* Anything after the end of track is not part of the track. */
+                if (type == MetaType::EOT) {
+                    ended = true;
+                    break;
+                }
+            }
+            else if (status == 0xF0 || status == 0xF7) {
+                const size_t lengthOffset = offset;
+
+                if ((error = VLValue::read(data, offset, end, length)) != ERROR_NONE)
+                    return Status(error, lengthOffset);
+
+                if (length > end - offset)
+                    return Status(ERROR_EVENT_OVERRUN, lengthOffset);
+
+                if (_options.maxPayloadSize && length > _options.maxPayloadSize)
+                    return Status(ERROR_LIMIT_PAYLOAD, lengthOffset);
+
+                if ((error = admit(sizeof(SysEx) + copied(owner, length))) != ERROR_NONE)
+                    return Status(error, start);
+
+                const uint8_t *payload = data + offset;
+                const bool closed = length && payload[length - 1] == 0xF7;
+
+                /* A 0xF7 event is only a continuation if an earlier packet was not closed yet,
+                 * otherwise it is an escape.
+                 */
+                SysExPacket packet;
+                if (status == 0xF0)
+                    packet = closed ? Events::SYSEX_COMPLETE : Events::SYSEX_FIRST;
+                else
+                    packet = split ? Events::SYSEX_CONTINUATION : Events::SYSEX_ESCAPE;
+
+                if (packet != Events::SYSEX_ESCAPE)
+                    split = !closed;
+
+                /* Pointing into the buffer if it is shared, otherwise the bytes are copied. */
+                SysEx *sysex = new SysEx(status, Payload::share(owner, payload, length), packet);
+                sysex->deltaTime.setValue(delta);
+
+                track.addEvent(sysex);
+                offset += length;
+            }
+            else {
+                return Status(ERROR_STATUS_BYTE, offset - 1);
+            }
+        }
+
+        /* A track without an end of track is completed, so it is written back as a valid track. */
+        if (!ended) {
+            if ((error = admit(sizeof(Meta))) != ERROR_NONE)
+                return Status(error, end);
+
+            track.addEvent(new Meta(MetaType::EOT));
+        }
+
+        allowance.keep();
+        return Status();
+    }
+
+    /**
+     * Method to read the chunks of a complete file from a stream into a buffer.
+     * @param input  The input stream.
+     * @param buffer The buffer, which is replaced with the read bytes.
+     * @param limit  The largest size of the buffer, 0 for no limit.
+     * @return Status ERROR_TRUNCATED if the stream ended early, ERROR_LIMIT_BYTES if a
+     *                chunk would make the buffer larger than the limit.
+     */
+    Status Decoder::read(std::istream& input, std::vector<uint8_t>& buffer, uint64_t limit) {
+        buffer.clear();
+
+        /* The header is a chunk as well. */
+        Status status = readChunk(input, buffer, limit);
+        if (!status.ok())
+            return status;
+
+        if (buffer.size() < 14 || memcmp(buffer.data(), Header::IDENTIFIER, 4))
+            return Status();
+
+        /* Reading chunks until there are as many tracks as the header announces. */
+        const uint16_t numTracks = Endian::readShortBig(buffer.data() + 10);
+
+        for (uint16_t track = 0; track < numTracks;) {
+            const size_t offset = buffer.size();
+
+            if (!(status = readChunk(input, buffer, limit)).ok())
+                return status;
+
+            if (!memcmp(buffer.data() + offset, Track::IDENTIFIER, 4) || !Validator::isPrintable(buffer.data() + offset))
+                track++;
+        }
+
+        /* Unknown chunks may follow the last track, up to the end of the stream. Whatever else
+         * follows is not part of the file, and is left out of the buffer.
+         */
+        while (input.peek() != std::char_traits<char>::eof()) {
+            const size_t offset = buffer.size();
+
+            /* Only the chunk header is read before it is checked, which is never too much. */
+            if (Endian::readBytes(input, buffer, 8) && isTrailing(buffer.data() + offset)) {
+                const uint32_t length = Endian::readIntBig(buffer.data() + offset + 4);
+
+                if (limit && (offset + 8 > limit || length > limit - offset - 8))
+                    return Status(ERROR_LIMIT_BYTES, offset);
+
+                if (Endian::readBytes(input, buffer, length))
+                    continue;
+            }
+
+            /* The stream did not fail, the file simply ended before it. */
+            buffer.resize(offset);
+            input.clear(input.rdstate() & ~std::ios::failbit);
+            break;
+        }
+
+        return Status();
+    }
+
+    /**
+     * Method to read a single chunk, including its header, from a stream and append it to a buffer.
+     * @param input  The input stream.
+     * @param buffer The buffer the chunk is appended to.
+     * @param limit  The largest size of the buffer, 0 for no limit.
+     * @return Status ERROR_TRUNCATED if the stream ended early, ERROR_LIMIT_BYTES if the
+     *                chunk would make the buffer larger than the limit.
+     */
+    Status Decoder::readChunk(std::istream& input, std::vector<uint8_t>& buffer, uint64_t limit) {
+        const size_t offset = buffer.size();
+
+        if (limit && offset + 8 > limit)
+            return Status(ERROR_LIMIT_BYTES, offset);
+
+        if (!Endian::readBytes(input, buffer, 8))
+            return Status(ERROR_TRUNCATED, buffer.size());
+
+        /* The length is checked before reading, so nothing beyond the limit is ever allocated. */
+        if (limit && Endian::readIntBig(buffer.data() + offset + 4) > limit - offset - 8)
+            return Status(ERROR_LIMIT_BYTES, offset + 4);
+
+        /* Reading in blocks, so the buffer only grows as far as there actually is data. */
+        if (!Endian::readBytes(input, buffer, Endian::readIntBig(buffer.data() + offset + 4)))
+            return Status(ERROR_TRUNCATED, buffer.size());
+
+        return Status();
+    }
+
+    /**
+     * Method to get the limit on the input of a file, from the size and memory limits.
+     * @return uint64_t The largest amount of bytes to read, 0 for no limit.
+     */
+    uint64_t Decoder::inputLimit() const {
+        if (!_options.maxBytes || !_options.maxMemory)
+            return std::max(_options.maxBytes, _options.maxMemory);
+
+        return std::min(_options.maxBytes, _options.maxMemory);
+    }
+
+    /**
+     * Method to check the size of the input of a file against the limits.
+     * @param size The size of the input.
+     * @return Status ERROR_LIMIT_BYTES or ERROR_LIMIT_MEMORY if the input is too large.
+     */
+    Status Decoder::checkInput(uint64_t size) const {
+        if (_options.maxBytes && size > _options.maxBytes)
+            return Status(ERROR_LIMIT_BYTES, _options.maxBytes);
+
+        if (_options.maxMemory && size > _options.maxMemory)
+            return Status(ERROR_LIMIT_MEMORY, 0);
+
+        return Status();
+    }
+
+    /**
+     * Method which finds the next track chunk identifier after an offset.
+     * @param data   The bytes of the file.
+     * @param offset The offset to start searching after.
+     * @param size   The amount of bytes.
+     * @return size_t The offset of the identifier, size if not found.
+     */
+    size_t Decoder::resync(const uint8_t *data, size_t offset, size_t size) {
+        for (size_t i = offset + 1; i + 8 <= size; i++) {
+            /* Looking for the first letter with memchr first, which is a lot faster. */
+            const void *found = memchr(data + i, 'M', size - 8 - i + 1);
+            if (found == NULL)
+                break;
+
+            i = static_cast<const uint8_t*>(found) - data;
+            if (!memcmp(data + i, Track::IDENTIFIER, 4))
+                return i;
+        }
+
+        return size;
+    }
+}
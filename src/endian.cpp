@@ -20,5 +20,32 @@ namespace Midi {
      * @var const static bool
      */
     const bool Endian::modeBigEndian = (ntohl(1) == 1);
+
+    /**
+     * Helper function for reading a number of bytes and appending them to a buffer.
+     * @param input  The stream to be read from.
+     * @param buffer The buffer the bytes are appended to.
+     * @param count  The amount of bytes to read.
+     * @return bool  True if all the bytes could be read.
+     */
+    bool Endian::readBytes(std::istream &input, std::vector<uint8_t> &buffer, size_t count) {
+        while (count) {
+            const size_t block = count < 65536 ? count : 65536;
+            const size_t current = buffer.size();
+
+            buffer.resize(current + block);
+            input.read(reinterpret_cast<char*>(buffer.data() + current), block);
+
+            /* Only keeping what was actually read. */
+            if (static_cast<size_t>(input.gcount()) != block) {
+                buffer.resize(current + input.gcount());
+                return false;
+            }
+
+            count -= block;
+        }
+
+        return true;
+    }
 }
 
@@ -0,0 +1,74 @@
+/**
+ * eventindex.cpp
+ *
+ * File with implementations for the Midi::EventIndex class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/eventindex.h>
+
+using Midi::Events::Message;
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    /**
+     * Constructor which indexes all the events in a list of events.
+     * @param events The events to index, usually those of a track.
+     */
+    EventIndex::EventIndex(const std::vector<Event*>& events) : _ticks(events.size()) {
+        /* Counting first, so every list can be allocated exactly once. */
+        uint32_t counts[8 * 16] = { 0 };
+        uint32_t categories[3] = { 0 };
+        uint32_t tick = 0;
+
+        for (size_t i = 0; i < events.size(); i++) {
+            const Event *event = events[i];
+
+            _ticks[i] = (tick += event->deltaTime.getValue());
+            categories[event->getCategory()]++;
+
+            if (event->getCategory() == CATEGORY_MESSAGE) {
+                const Message *msg = static_cast<const Message*>(event);
+                counts[(msg->getType() & 0x7) << 4 | msg->getChannel()]++;
+            }
+        }
+
+        for (int i = 0; i < 3; i++)
+            _byCategory[i].reserve(categories[i]);
+
+        uint32_t channels[16] = { 0 };
+        uint32_t types[8] = { 0 };
+
+        for (int status = 0; status < 8 * 16; status++) {
+            _byStatus[status].reserve(counts[status]);
+            channels[status & 0xF] += counts[status];
+            types[status >> 4] += counts[status];
+        }
+
+        for (int i = 0; i < 16; i++)
+            _byChannel[i].reserve(channels[i]);
+
+        for (int i = 0; i < 8; i++)
+            _byType[i].reserve(types[i]);
+
+        /* Filling the lists, which come out sorted since the events are visited in order. */
+        for (uint32_t i = 0; i < events.size(); i++) {
+            const Event *event = events[i];
+
+            _byCategory[event->getCategory()].push_back(i);
+
+            if (event->getCategory() != CATEGORY_MESSAGE)
+                continue;
+
+            const Message *msg = static_cast<const Message*>(event);
+            const uint8_t type = msg->getType() & 0x7;
+
+            _byStatus[type << 4 | msg->getChannel()].push_back(i);
+            _byChannel[msg->getChannel()].push_back(i);
+            _byType[type].push_back(i);
+        }
+    }
+}
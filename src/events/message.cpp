@@ -7,6 +7,7 @@
  */
 
 #include <cppmidi/endian.h>
+#include <cppmidi/encoder.h>
 #include <cppmidi/events/message.h>
 
 /**
@@ -28,7 +29,7 @@ namespace Midi {
          * @param data1 The value of the first data byte.
          * @param data2 The value of the second data byte.
          */
-        Message::Message(MessageType m, uint8_t channel, uint8_t data1, uint8_t data2) : Event() {
+        Message::Message(MessageType m, uint8_t channel, uint8_t data1, uint8_t data2) : Event(CATEGORY_MESSAGE) {
             setType(m);
             setChannel(channel);
             setData1(data1);
@@ -53,7 +54,6 @@ namespace Midi {
 
             /* If we can successfully pass this if statement, we're safe. */
             if (type < MessageType::NOTE_OFF || type > MessageType::PITCH_BEND) {
-                std::cout << "Well, this is not a message event!" << std::endl;
                 input.putback(status);
                 msg->deltaTime.putBack(input);
 
@@ -84,17 +84,18 @@ namespace Midi {
          * @return std::ostream& The original output stream.
          */
         std::ostream& Message::print(std::ostream& output) const {
-            /* The first byte has the type in the upper nibble and the channel in the lower. */
-            Endian::writeByte(output, _type << 4 | _channel);
-            Endian::writeByte(output, _data1);
-
-            /* The last data byte should be omitted if we're writing a program change or
-             * channel aftertouch event.
-             */
-            if (_type != MessageType::PROGRAM_CHANGE && _type != MessageType::CHANNEL_AFTERTOUCH)
-                Endian::writeByte(output, _data2);
+            StreamSink sink(output);
+            Encoder<StreamSink>(sink).writeBody(*this);
 
             return output;
         }
+
+        /**
+         * Method to get the length of this message in bytes, which is counted by encoding it.
+         * @return uint32_t The length in bytes.
+         */
+        uint32_t Message::getLength() const {
+            return CountingSink::measure<Event>(*this);
+        }
     }
 }
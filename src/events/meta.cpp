@@ -7,6 +7,7 @@
  */
 
 #include <cppmidi/endian.h>
+#include <cppmidi/encoder.h>
 #include <cppmidi/events/meta.h>
 
 /**
@@ -17,7 +18,7 @@ namespace Midi {
         /**
          * Method which tries to pop a Meta object from the input stream.
          * @param input The input stream.
-         * @return Event* A dynamically allocated event.
+         * @return Event* A dynamically allocated event, NULL if it is no meta event or the stream ended early.
          */
         Event* Meta::popEvent(std::istream &input) {
             /* Allocating the new message. */
@@ -41,16 +42,23 @@ namespace Midi {
 
             /* Reading the type and de vlv datasize from the stream. */
             meta->_type = Endian::readByte(input);
-            input >> meta->_dataSize;
 
-            uint32_t dataSize = meta->_dataSize.getValue();
+            VLValue dataSize;
+            input >> dataSize;
 
             /* Updating the amount of bytes read on this metaevent. */
-            meta->_gcount += dataSize + meta->_dataSize.gcount() + 2;
+            meta->_gcount += dataSize.getValue() + dataSize.gcount() + 2;
 
-            /* Putting all the data in the array. Might be in wrong order? */
-            while (dataSize--)
-                meta->_data.push_back(Endian::readByte(input));
+            /* Reading all the data at once instead of byte by byte, which ends up inside the
+             * event if it is short enough. A stream that ends early is left failed, since what
+             * was read of it cannot be put back.
+             */
+            std::shared_ptr<std::vector<uint8_t>> data = std::make_shared<std::vector<uint8_t>>();
+            if (!Endian::readBytes(input, *data, dataSize.getValue())) {
+                delete meta;
+                return NULL;
+            }
+            meta->_data = Payload::share(data, data->data(), data->size());
 
             return meta;
         }
@@ -61,18 +69,122 @@ namespace Midi {
          * @return std::ostream& The original output stream.
          */
         std::ostream& Meta::print(std::ostream& output) const {
-            /* Writing the fixed 0xFF header and the type of the meta event. */
-            Endian::writeByte(output, 0xFF);
-            Endian::writeByte(output, _type);
+            StreamSink sink(output);
+            Encoder<StreamSink>(sink).writeBody(*this);
+
+            return output;
+        }
 
-            /* Writing the VLValue to the stream. */
-            output << _dataSize;
+        /**
+         * Method to get the length of this event in bytes, which is counted by encoding it.
+         * @return uint32_t The length in bytes.
+         */
+        uint32_t Meta::getLength() const {
+            return CountingSink::measure<Event>(*this);
+        }
 
-            /* Writing the data bytes to the stream. */
-            for (auto byte : _data)
-                Endian::writeByte(output, byte);
+        /**
+         * Method to get the tempo of a TEMPO event.
+         * @return uint32_t The microseconds per quarter note, 0 if this is no tempo event.
+         */
+        uint32_t Meta::getTempo() const {
+            if (_type != MetaType::TEMPO || _data.size() < 3)
+                return 0;
 
-            return output;
+            /* The tempo is a 24 bit big endian number. */
+            const uint8_t *data = _data.data();
+            return data[0] << 16 | data[1] << 8 | data[2];
+        }
+
+        /**
+         * Method to decode a SIGNATURE_TIME event.
+         * @param signature The decoded time signature.
+         * @return bool False if this is no time signature event.
+         */
+        bool Meta::getTimeSignature(TimeSignature& signature) const {
+            if (_type != MetaType::SIGNATURE_TIME || _data.size() < 4)
+                return false;
+
+            const uint8_t *data = _data.data();
+            signature.numerator = data[0];
+            signature.denominator = data[1];
+            signature.clocksPerClick = data[2];
+            signature.notesPerQuarter = data[3];
+
+            return true;
+        }
+
+        /**
+         * Method to decode a SIGNATURE_KEY event.
+         * @param signature The decoded key signature.
+         * @return bool False if this is no key signature event.
+         */
+        bool Meta::getKeySignature(KeySignature& signature) const {
+            if (_type != MetaType::SIGNATURE_KEY || _data.size() < 2)
+                return false;
+
+            signature.sharps = static_cast<int8_t>(_data[0]);
+            signature.minor = _data[1] != 0;
+
+            return true;
+        }
+
+        /**
+         * Method to decode a SMPTE_OFFSET event.
+         * @param offset The decoded offset.
+         * @return bool False if this is no SMPTE offset event.
+         */
+        bool Meta::getSmpteOffset(SmpteOffset& offset) const {
+            if (_type != MetaType::SMPTE_OFFSET || _data.size() < 5)
+                return false;
+
+            const uint8_t *data = _data.data();
+            offset.hours = data[0];
+            offset.minutes = data[1];
+            offset.seconds = data[2];
+            offset.frames = data[3];
+            offset.fractions = data[4];
+
+            return true;
+        }
+
+        /**
+         * Method to create a TEMPO event.
+         * @param microseconds The microseconds per quarter note, at most 24 bits.
+         * @return Meta The event.
+         */
+        Meta Meta::tempo(uint32_t microseconds) {
+            const uint8_t data[3] = {
+                static_cast<uint8_t>(microseconds >> 16),
+                static_cast<uint8_t>(microseconds >> 8),
+                static_cast<uint8_t>(microseconds)
+            };
+
+            return Meta(MetaType::TEMPO, data, 3);
+        }
+
+        /**
+         * Method to create a SIGNATURE_TIME event.
+         * @param signature The time signature.
+         * @return Meta The event.
+         */
+        Meta Meta::timeSignature(const TimeSignature& signature) {
+            const uint8_t data[4] = {
+                signature.numerator, signature.denominator, signature.clocksPerClick, signature.notesPerQuarter
+            };
+
+            return Meta(MetaType::SIGNATURE_TIME, data, 4);
+        }
+
+        /**
+         * Method to create a SIGNATURE_KEY event.
+         * @param signature The key signature.
+         * @return Meta The event.
+         */
+        Meta Meta::keySignature(const KeySignature& signature) {
+            const uint8_t data[2] = { static_cast<uint8_t>(signature.sharps), signature.minor };
+
+            return Meta(MetaType::SIGNATURE_KEY, data, 2);
         }
     }
 }
@@ -7,6 +7,7 @@
  */
 
 #include <cppmidi/endian.h>
+#include <cppmidi/encoder.h>
 #include <cppmidi/events/sysex.h>
 
 /**
@@ -14,13 +15,120 @@
  */
 namespace Midi {
     namespace Events {
+        /**
+         * Constructor for a complete sysex message, from the id of the manufacturer and
+         * the data that follows it. The closing 0xF7 is added automatically.
+         * @param id   The id of the manufacturer, with EXTENDED_ID set for 3 byte ids.
+         * @param data The data bytes, which are copied.
+         * @param size The amount of data bytes.
+         */
+        SysEx::SysEx(uint32_t id, const uint8_t *data, size_t size) :
+            Event(CATEGORY_SYSEX), _type(0xF0), _packet(SYSEX_COMPLETE) {
+            std::shared_ptr<std::vector<uint8_t>> buffer = std::make_shared<std::vector<uint8_t>>();
+            buffer->reserve(size + 4);
+
+            /* The 3 byte ids start with a 0, which is how they can be recognized. */
+            if (id & EXTENDED_ID) {
+                buffer->push_back(0x00);
+                buffer->push_back((id >> 8) & 0x7F);
+            }
+
+            buffer->push_back(id & 0x7F);
+            buffer->insert(buffer->end(), data, data + size);
+            buffer->push_back(0xF7);
+
+            _payload = Payload(buffer, buffer->data(), buffer->size());
+        }
+
+        /**
+         * Constructor for a packet exactly as it is stored in a file.
+         * @param type    Either 0xF0 or 0xF7.
+         * @param payload The bytes after the length, including any closing 0xF7.
+         * @param packet  The kind of packet.
+         */
+        SysEx::SysEx(uint8_t type, const Payload& payload, SysExPacket packet) :
+            Event(CATEGORY_SYSEX), _type(type == 0xF7 ? 0xF7 : 0xF0), _packet(packet), _payload(payload) { }
+
         /**
          * Method which tries to pop a SysEx object from the input stream.
          * @param input The input stream.
-         * @return Event* A dynamically allocated event.
+         * @return Event* A dynamically allocated event, NULL if it is no sysex event or the stream ended early.
          */
         Event* SysEx::popEvent(std::istream &input) {
-            return NULL;
+            VLValue deltaTime;
+            input >> deltaTime;
+
+            /* A sysex event starts with either 0xF0 or 0xF7. */
+            uint8_t status = Endian::readByte(input);
+
+            if (status != 0xF0 && status != 0xF7) {
+                input.putback(status);
+                deltaTime.putBack(input);
+
+                return NULL;
+            }
+
+            VLValue length;
+            input >> length;
+
+            /* Reading all the data at once into a buffer that is shared by the payload. A stream
+             * that ends early is left failed, since what was read of it cannot be put back.
+             */
+            std::shared_ptr<std::vector<uint8_t>> buffer = std::make_shared<std::vector<uint8_t>>();
+            if (!Endian::readBytes(input, *buffer, length.getValue()))
+                return NULL;
+
+            SysExPacket packet = SYSEX_ESCAPE;
+            if (status == 0xF0)
+                packet = (!buffer->empty() && buffer->back() == 0xF7) ? SYSEX_COMPLETE : SYSEX_FIRST;
+
+            SysEx *sysex = new SysEx(status, Payload(buffer, buffer->data(), buffer->size()), packet);
+            sysex->deltaTime = deltaTime;
+            sysex->_gcount = 1 + length.gcount() + buffer->size();
+
+            return sysex;
+        }
+
+        /**
+         * Method to get the id of the manufacturer.
+         * @return uint32_t The id, with EXTENDED_ID set for 3 byte ids.
+         */
+        uint32_t SysEx::getManufacturerID() const {
+            switch (getManufacturerLength()) {
+                case 1:  return _payload[0];
+                case 3:  return EXTENDED_ID | _payload[1] << 8 | _payload[2];
+                default: return 0;
+            }
+        }
+
+        /**
+         * Method to get the data after the manufacturer id and without the closing 0xF7.
+         * @return Payload The data.
+         */
+        Payload SysEx::getData() const {
+            const size_t offset = getManufacturerLength();
+            size_t size = _payload.size() - offset;
+
+            /* Escapes are sent as they are, so their last byte is data as well. */
+            if (_packet != SYSEX_ESCAPE && size && _payload[_payload.size() - 1] == 0xF7)
+                size--;
+
+            return _payload.slice(offset, size);
+        }
+
+        /**
+         * Method to get the amount of bytes the manufacturer id takes in the payload.
+         * @return size_t 0, 1 or 3.
+         */
+        size_t SysEx::getManufacturerLength() const {
+            /* Only packets that start a message have a manufacturer. */
+            if (_type != 0xF0 || _payload.empty())
+                return 0;
+
+            if (_payload[0] != 0x00)
+                return 1;
+
+            return _payload.size() < 3 ? _payload.size() : 3;
         }
 
         /**
@@ -29,20 +137,18 @@ namespace Midi {
          * @return std::ostream& The original output stream.
          */
         std::ostream& SysEx::print(std::ostream& output) const {
-            /* Writing the type and manufacturerID to the output stream. */
-            Endian::writeByte(output, _type);
-            Endian::writeByte(output, manufacturerID);
-
-            /* Since we only know the data consists of bytes and apart from that nothing,
-             * simply write them to the output stream.
-             */
-            for (auto byte : data)
-                Endian::writeByte(output, byte);
-
-            /* Writing the end of the SysEx to the stream. */
-            Endian::writeByte(output, 0xF7);
+            StreamSink sink(output);
+            Encoder<StreamSink>(sink).writeBody(*this);
 
             return output;
         }
+
+        /**
+         * Method to get the length of this event in bytes, which is counted by encoding it.
+         * @return uint32_t The length in bytes.
+         */
+        uint32_t SysEx::getLength() const {
+            return CountingSink::measure<Event>(*this);
+        }
     }
 }
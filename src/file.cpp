@@ -7,11 +7,74 @@
  */
 
 #include <cppmidi/file.h>
+#include <cppmidi/decoder.h>
+#include <cppmidi/encoder.h>
+#include <cppmidi/intern.h>
+#include <cppmidi/events/message.h>
+#include <cppmidi/events/meta.h>
+#include <cppmidi/events/sysex.h>
+#include <unordered_map>
+#include <algorithm>
+
+using Midi::Events::Message;
+using Midi::Events::Meta;
+using Midi::Events::SysEx;
 
 /**
  * Setting up the basic midi namespace
  */
 namespace Midi {
+    /**
+     * Copy constructor, which copies all the tracks of the other file.
+     * @param file The file to copy.
+     */
+    File::File(const File& file) : _tracks(), _chunks(file._chunks), _head(file._head) {
+        _tracks.reserve(file._tracks.size());
+
+        for (auto track : file._tracks)
+            _tracks.push_back(track == NULL ? NULL : new Track(*track));
+    }
+
+    /**
+     * Assignment operator, which replaces the tracks by copies of those of the other file.
+     * @param file The file to copy.
+     * @return File& This file.
+     */
+    File& File::operator =(const File& file) {
+        /* Copying first, which also makes assigning a file to itself harmless. */
+        File copy(file);
+        swap(copy);
+
+        return *this;
+    }
+
+    /**
+     * Method to remove all the tracks and chunks and reset the header, so the file is empty again.
+     */
+    void File::clear() {
+        /* Tracks are dynamically allocated by us, and should thus be freed. */
+        for (auto track : _tracks)
+            delete track;
+
+        _tracks.clear();
+        _chunks.clear();
+        _head = Header();
+    }
+
+    /**
+     * Method to add a chunk that is not a track, which is written in front of the track in a slot.
+     * @param chunk    The chunk.
+     * @param position The slot of the track the chunk is written in front of.
+     */
+    void File::addChunk(const Chunk& chunk, int position) {
+        /* After the chunks that are already in front of the same slot. */
+        auto it = std::upper_bound(_chunks.begin(), _chunks.end(), position, [](int position, const std::pair<int, Chunk>& entry) {
+            return position < entry.first;
+        });
+
+        _chunks.insert(it, std::make_pair(position, chunk));
+    }
+
     /**
      * Method to get an new, empty track from the file. Might return NULL.
      * @return Track* Pointer to a Track from the file. NULL if there was no new track.
@@ -21,17 +84,18 @@ namespace Midi {
         if (!_head.setNumTracks(_head.getNumTracks() + 1))
             return NULL;
 
-        for (int i = 0; i < 16; i++) {
+        for (auto& track : _tracks) {
 
             /* If an empty spot was found, create a new track at that spot and
              * return the resulting pointer.
              */
-            if (_tracks[i] == NULL)
-                return (_tracks[i] = new Track());
+            if (track == NULL)
+                return (track = new Track());
         }
 
-        /* Fallback, for whatever case there might be no track available. */
-        return NULL;
+        /* There was no empty spot, so the track is added at the end. */
+        _tracks.push_back(new Track());
+        return _tracks.back();
     }
 
     /**
@@ -39,10 +103,14 @@ namespace Midi {
      * @return Track* Pointer to a Track from the file. NULL if there was no new track.
      */
     Track* File::getTrack(int index) {
-        /* We cannot create nor get a track from indexes higher than 15. */
-        if (index > 15 || index < 0)
+        /* We cannot create nor get a track from indexes the header cannot count. */
+        if (index >= 0xFFFF || index < 0)
             return NULL;
 
+        /* Making room for the track, leaving the slots in between empty. */
+        if (index >= getTrackSlots())
+            _tracks.resize(index + 1, NULL);
+
         /* Create a new track if it does not already exist. */
         if (_tracks[index] == NULL) {
             _tracks[index] = new Track();
@@ -52,6 +120,101 @@ namespace Midi {
         return _tracks[index];
     }
 
+    /**
+     * Method to replace the payloads of all the meta events by interned ones.
+     * @param pool The pool.
+     */
+    void File::intern(InternPool& pool) {
+        for (auto track : _tracks) {
+            if (track == NULL)
+                continue;
+
+            /* The bytes stay the same, so the length of the track does not change. */
+            for (auto event : track->getEvents()) {
+                if (event->getCategory() == CATEGORY_META)
+                    static_cast<Meta*>(event)->_data = pool.intern(static_cast<Meta*>(event)->_data);
+            }
+        }
+    }
+
+    /**
+     * Method to get the memory this file takes.
+     * @return MemoryUsage The memory usage.
+     */
+    MemoryUsage File::memoryUsage() const {
+        MemoryUsage usage = { sizeof(File) + _tracks.capacity() * sizeof(Track*), 0, 0 };
+
+        /* The bytes every buffer holds for this file, and how many payloads of this file refer
+         * to it. If anything else refers to the buffer as well, it is shared.
+         */
+        struct Span {
+            const std::shared_ptr<const void> *owner;
+            const uint8_t *begin, *end;
+            long references;
+        };
+        std::unordered_map<const void*, Span> spans;
+
+        for (auto track : _tracks) {
+            if (track == NULL)
+                continue;
+
+            usage.events += sizeof(Track) + track->getEvents().capacity() * sizeof(Event*);
+
+            for (auto event : track->getEvents()) {
+                const Payload *payload = NULL;
+
+                switch (event->getCategory()) {
+                case CATEGORY_MESSAGE:
+                    usage.events += sizeof(Message);
+                    break;
+                case CATEGORY_META:
+                    usage.events += sizeof(Meta);
+                    payload = &static_cast<const Meta*>(event)->getData();
+                    break;
+                case CATEGORY_SYSEX:
+                    usage.events += sizeof(SysEx);
+                    payload = &static_cast<const SysEx*>(event)->getPayload();
+                    break;
+                }
+
+                /* Inline payloads are part of the event, and borrowed ones are not owned at all. */
+                if (payload == NULL || !payload->getOwner())
+                    continue;
+
+                auto result = spans.insert(std::make_pair(payload->getOwner().get(), Span{ &payload->getOwner(), payload->begin(), payload->end(), 0 }));
+                Span& span = result.first->second;
+
+                span.begin = std::min(span.begin, payload->begin());
+                span.end = std::max(span.end, payload->end());
+                span.references++;
+            }
+        }
+
+        for (const auto& span : spans) {
+            const size_t bytes = span.second.end - span.second.begin;
+
+            if (span.second.owner->use_count() > span.second.references)
+                usage.shared += bytes;
+            else
+                usage.payloads += bytes;
+        }
+
+        return usage;
+    }
+
+    /**
+     * Method to get an existing track from the file without creating it.
+     * @param index The index of the track.
+     * @return const Track* Pointer to the track, NULL if there is no track at the index.
+     */
+    const Track* File::getTrack(int index) const {
+        /* Out of range indexes simply do not have a track. */
+        if (index >= getTrackSlots() || index < 0)
+            return NULL;
+
+        return _tracks[index];
+    }
+
     /**
      * Friend function to overload the operator to write to streams, used for
      * file writing. This makes it that the midi can be written to virtually
@@ -61,36 +224,28 @@ namespace Midi {
      * @returns std::ostream    Original stream.
      */
     std::ostream& operator <<(std::ostream& output, const File& f) {
-        output << f._head;
+        StreamSink sink(output);
 
-        /* If the track was allocated, write the track to the stream. */
-        for (auto track : f._tracks) {
-            if (track != NULL)
-                output << *track;
-        }
+        /* The encoder writes the chunks in front of their tracks, and only the allocated tracks. */
+        if (!Encoder<StreamSink>(sink).write(f))
+            output.setstate(std::ios::failbit);
 
         return output;
     }
 
     /**
      * Method to input the file into the midi object. The stream should be in binary mode.
+     * On failure, the file is left empty and a std::ios_base::failure is thrown. Use the
+     * Decoder directly to decode without exceptions.
      * @param input The input stream.
      * @param f The midi file object.
      * @return std::istream& THe original input stream.
      */
     std::istream& operator >>(std::istream& input, File& f) {
-        /* Let the header handle the first bytes. */
-        input >> f._head;
-
-        /* The number of tracks previously read in the header. */
-        uint16_t numTracks = f._head.getNumTracks();
+        DecodeResult result = Decoder().decode(input, f);
 
-        /* Only read as much tracks as the header says. */
-        for (int i = 0; i < numTracks; i++) {
-            /* Dynamically allocate the track and use the stream operator to put it in the track. */
-            f._tracks[i] = new Track();
-            input >> *(f._tracks[i]);
-        }
+        if (!result.ok())
+            throw std::ios_base::failure(result.status.describe());
 
         return input;
     }
@@ -0,0 +1,414 @@
+/**
+ * fileasync.cpp
+ *
+ * File with implementations for loading and saving a Midi::File in the background. All
+ * the reading and writing happens on a single I/O thread, while decoding and encoding
+ * happen on a pool of workers. A file is read in blocks, and every track chunk is handed
+ * to the workers as soon as it was read completely, so decoding the first tracks overlaps
+ * with reading the last ones.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/file.h>
+#include <cppmidi/decoder.h>
+#include <cppmidi/writer.h>
+#include <cppmidi/validator.h>
+#include <cppmidi/endian.h>
+#include <cppmidi/threadpool.h>
+#include <cppmidi/trace.h>
+#include <algorithm>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    /**
+     * The amount of bytes that is read at once.
+     */
+    static const size_t BLOCK_SIZE = 1 << 18;
+
+    /**
+     * Method to get the thread that does all the reading and writing. A single thread is
+     * enough to keep a disk busy, and keeps the requests of one file in order.
+     * @return ThreadPool& The pool with the I/O thread.
+     */
+    static ThreadPool& io() {
+        static ThreadPool pool(1);
+        return pool;
+    }
+
+    /**
+     * Method to get the workers that decode and encode.
+     * @return ThreadPool& The pool of workers.
+     */
+    static ThreadPool& workers() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    /**
+     * Method to get the writer that encodes on the workers.
+     * @return Writer& The writer.
+     */
+    static Writer& writer() {
+        static Writer writer(workers());
+        return writer;
+    }
+
+    /**
+     * A single file that is being loaded. The loader is shared by the read task and the
+     * decode tasks, and whichever of them finishes last completes the load.
+     */
+    class FileLoader : public std::enable_shared_from_this<FileLoader> {
+        public:
+            /**
+             * Constructor
+             * @param file     The file to load into, which is emptied right away.
+             * @param path     The path of the file.
+             * @param options  The options to decode with.
+             * @param callback Called with the result.
+             */
+            FileLoader(File& file, const std::string& path, const DecodeOptions& options, const std::function<void(const DecodeResult&)>& callback) :
+                _file(file), _path(path), _decoder(options), _budget(options.maxMemory), _callback(callback),
+                _buffer(std::make_shared<std::vector<uint8_t>>()), _size(0), _offset(0),
+                _header(false), _numTracks(0), _fallback(false), _failed(false), _pending(1) {
+                _file.clear();
+            }
+
+            /**
+             * Destructor, which frees the tracks that were not handed over.
+             */
+            virtual ~FileLoader() {
+                for (auto track : _tracks)
+                    delete track;
+            }
+
+            /**
+             * Method to read the file, which runs on the I/O thread.
+             */
+            void read() {
+                CPPMIDI_TRACE_SPAN(span, "open", 0);
+                const int fd = ::open(_path.c_str(), O_RDONLY);
+                struct stat info;
+
+                if (fd < 0 || fstat(fd, &info) != 0) {
+                    if (fd >= 0)
+                        ::close(fd);
+
+                    _error = Status(ERROR_IO, 0);
+                    release();
+                    return;
+                }
+
+                /* A file that is too large is not read at all. */
+                if (!(_error = _decoder.checkInput(info.st_size)).ok()) {
+                    ::close(fd);
+                    release();
+                    return;
+                }
+
+                _budget.take(info.st_size);
+
+                /* The buffer is never resized while reading, since the decoded payloads point into it. */
+                _buffer->resize(info.st_size);
+
+                while (_size < _buffer->size()) {
+                    const ssize_t count = pread(fd, _buffer->data() + _size, std::min(BLOCK_SIZE, _buffer->size() - _size), _size);
+
+                    if (count < 0 && errno == EINTR)
+                        continue;
+
+                    if (count < 0)
+                        _error = Status(ERROR_IO, _size);
+
+                    /* The file might have been shortened since we looked at its size. */
+                    if (count <= 0)
+                        break;
+
+                    _size += count;
+                    schedule();
+                }
+
+                CPPMIDI_TRACE_BYTES(span, _size);
+
+                ::close(fd);
+                release();
+            }
+
+        private:
+            /**
+             * Method to hand the track chunks that were read completely to the workers. Anything
+             * unusual, which only the decoder knows how to report, makes the whole file decoded
+             * again once it is read.
+             */
+            void schedule() {
+                const uint8_t *data = _buffer->data();
+
+                if (_fallback)
+                    return;
+
+                if (!_header) {
+                    /* Waiting until the complete header chunk was read. */
+                    if (_size < 14 || (_size < _buffer->size() && _size < 8 + (size_t) Endian::readIntBig(data + 4)))
+                        return;
+
+                    if (!(Decoder::decodeHeader(data, _size, _file, _numTracks, _offset)).ok()) {
+                        _fallback = true;
+                        return;
+                    }
+
+                    _header = true;
+                    _tracks.reserve(_numTracks);
+                }
+
+                while (_tracks.size() < _numTracks && _size - _offset >= 8) {
+                    const uint32_t length = Endian::readIntBig(data + _offset + 4);
+                    const size_t end = _offset + 8 + length;
+
+                    if (length > _buffer->size() - _offset - 8) {
+                        _fallback = true;
+                        return;
+                    }
+
+                    if (end > _size)
+                        return;
+
+                    /* Unknown chunks are kept, just like when decoding. */
+                    if (memcmp(data + _offset, Track::IDENTIFIER, 4)) {
+                        if (!Validator::isPrintable(data + _offset)) {
+                            _fallback = true;
+                            return;
+                        }
+
+                        _file.addChunk(Chunk(reinterpret_cast<const char*>(data + _offset), Payload::share(_buffer, data + _offset + 8, length)), _tracks.size());
+                        _offset = end;
+                        continue;
+                    }
+
+                    Track *track = new Track();
+                    _tracks.push_back(track);
+                    _pending++;
+
+                    std::shared_ptr<FileLoader> self = shared_from_this();
+                    const size_t begin = _offset + 8;
+                    workers().submit([self, track, begin, end]() {
+                        if (!self->_decoder.decodeTrack(self->_buffer->data(), begin, end, *track, self->_buffer, &self->_budget).ok())
+                            self->_failed = true;
+
+                        self->release();
+                    });
+
+                    _offset = end;
+                }
+            }
+
+            /**
+             * Method which is called when the read task or a decode task is done, and which
+             * completes the load after the last one.
+             */
+            void release() {
+                if (--_pending > 0)
+                    return;
+
+                DecodeResult result;
+
+                if (!_error.ok()) {
+                    _file.clear();
+                    result.status = _error;
+                }
+                else if (_fallback || _failed || !_header || _tracks.size() < _numTracks) {
+                    /* Decoding everything again is the only way to get the same errors, and
+                     * the same tracks when corrupt ones are skipped.
+                     */
+                    for (auto track : _tracks)
+                        delete track;
+
+                    _tracks.clear();
+                    _buffer->resize(_size);
+
+                    result = _decoder.decode(std::shared_ptr<const std::vector<uint8_t>>(_buffer), _file);
+                }
+                else {
+                    /* Unknown chunks after the last track were only read, not handed out yet. */
+                    for (size_t length; (length = Decoder::trailingChunk(_buffer->data(), _size, _offset)) > 0; _offset += length)
+                        _file.addChunk(Chunk(reinterpret_cast<const char*>(_buffer->data() + _offset), Payload::share(_buffer, _buffer->data() + _offset + 8, length - 8)), _tracks.size());
+
+                    _file._tracks.swap(_tracks);
+                    _file._head.setNumTracks(_file._tracks.size());
+                    result.tracks = _file._tracks.size();
+                }
+
+                _callback(result);
+            }
+
+            /**
+             * The file to load into, and its path.
+             * @var File&, std::string
+             */
+            File& _file;
+            std::string _path;
+
+            /**
+             * The decoder with the options to decode with.
+             * @var Decoder
+             */
+            Decoder _decoder;
+
+            /**
+             * The memory budget shared by all the tracks.
+             * @var DecodeBudget
+             */
+            DecodeBudget _budget;
+
+            /**
+             * The callback for the result.
+             * @var std::function<void(const DecodeResult&)>
+             */
+            std::function<void(const DecodeResult&)> _callback;
+
+            /**
+             * The contents of the file, and the amount of bytes read so far.
+             * @var std::shared_ptr<std::vector<uint8_t>>, size_t
+             */
+            std::shared_ptr<std::vector<uint8_t>> _buffer;
+            size_t _size;
+
+            /**
+             * The offset of the next chunk.
+             * @var size_t
+             */
+            size_t _offset;
+
+            /**
+             * Whether the header was decoded, and the amount of tracks it announces.
+             * @var bool, uint16_t
+             */
+            bool _header;
+            uint16_t _numTracks;
+
+            /**
+             * The tracks handed to the workers, in order.
+             * @var std::vector<Track*>
+             */
+            std::vector<Track*> _tracks;
+
+            /**
+             * Whether the file has to be decoded again completely once it is read.
+             * @var bool
+             */
+            bool _fallback;
+
+            /**
+             * Whether decoding any of the tracks failed.
+             * @var std::atomic<bool>
+             */
+            std::atomic<bool> _failed;
+
+            /**
+             * The amount of tasks that did not finish yet.
+             * @var std::atomic<size_t>
+             */
+            std::atomic<size_t> _pending;
+
+            /**
+             * The error of reading the file.
+             * @var Status
+             */
+            Status _error;
+    };
+
+    /**
+     * Method to load a file in the background.
+     * @param path The path of the file.
+     * @return std::future<DecodeResult> The result, with ERROR_IO if reading failed.
+     */
+    std::future<DecodeResult> File::loadAsync(const std::string& path) {
+        return loadAsync(path, DecodeOptions());
+    }
+
+    /**
+     * Method to load a file in the background.
+     * @param path    The path of the file.
+     * @param options The options to decode with.
+     * @return std::future<DecodeResult> The result, with ERROR_IO if reading failed.
+     */
+    std::future<DecodeResult> File::loadAsync(const std::string& path, const DecodeOptions& options) {
+        auto promise = std::make_shared<std::promise<DecodeResult>>();
+
+        loadAsync(path, options, [promise](const DecodeResult& result) {
+            promise->set_value(result);
+        });
+
+        return promise->get_future();
+    }
+
+    /**
+     * Method to load a file in the background, calling a callback when it is done.
+     * @param path     The path of the file.
+     * @param options  The options to decode with.
+     * @param callback Called with the result, from one of the background threads.
+     */
+    void File::loadAsync(const std::string& path, const DecodeOptions& options, const std::function<void(const DecodeResult&)>& callback) {
+        std::shared_ptr<FileLoader> loader = std::make_shared<FileLoader>(*this, path, options, callback);
+
+        io().submit([loader]() {
+            loader->read();
+        });
+    }
+
+    /**
+     * Method to save a file in the background.
+     * @param path The path to write to.
+     * @return std::future<Status> ERROR_IO if the file could not be created or written,
+     *                             ERROR_TRACK_LENGTH if a track is too long for a chunk.
+     */
+    std::future<Status> File::saveAsync(const std::string& path) const {
+        auto promise = std::make_shared<std::promise<Status>>();
+
+        saveAsync(path, [promise](const Status& status) {
+            promise->set_value(status);
+        });
+
+        return promise->get_future();
+    }
+
+    /**
+     * Method to save a file in the background, calling a callback when it is done.
+     * @param path     The path to write to.
+     * @param callback Called with the status, from one of the background threads.
+     */
+    void File::saveAsync(const std::string& path, const std::function<void(const Status&)>& callback) const {
+        const File *file = this;
+
+        workers().submit([file, path, callback]() {
+            auto chunks = std::make_shared<std::vector<std::vector<uint8_t>>>();
+
+            /* A file that cannot be encoded is not written at all. */
+            const Status status = writer().encode(*file, *chunks);
+            if (!status.ok()) {
+                callback(status);
+                return;
+            }
+
+            io().submit([chunks, path, callback]() {
+                const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+                if (fd < 0) {
+                    callback(Status(ERROR_IO, 0));
+                    return;
+                }
+
+                Status status = Writer::write(*chunks, fd);
+                if (::close(fd) != 0 && status.ok())
+                    status = Status(ERROR_IO, 0);
+
+                callback(status);
+            });
+        });
+    }
+}
@@ -0,0 +1,183 @@
+/**
+ * fingerprint.cpp
+ *
+ * File with implementations for the Midi::Fingerprint and Midi::Sketch classes.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/fingerprint.h>
+#include <cppmidi/hash.h>
+#include <cppmidi/events/message.h>
+#include <cppmidi/events/meta.h>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+using Midi::Events::Message;
+using Midi::Events::MessageType;
+using Midi::Events::Meta;
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    const uint32_t Fingerprint::RESOLUTION;
+    const size_t Sketch::SIZE;
+    const size_t Sketch::BANDS;
+    const size_t Sketch::SHINGLE;
+
+    /**
+     * The step the time between the notes of a shingle is rounded to, a 64th note.
+     * @var uint64_t
+     */
+    static const uint64_t SHINGLE_STEP = Fingerprint::RESOLUTION / 16;
+
+    /**
+     * Method to compute the fingerprint of a track.
+     * @param track    The track.
+     * @param division The division from the header of the file the track is from.
+     * @return uint64_t The fingerprint.
+     */
+    uint64_t Fingerprint::of(const Track& track, uint16_t division) {
+        uint64_t fingerprint = 0;
+        uint32_t tick = 0;
+
+        for (auto event : track.getEvents()) {
+            tick += event->deltaTime.getValue();
+            uint32_t content;
+
+            if (event->getCategory() == CATEGORY_META) {
+                const uint32_t tempo = static_cast<const Meta*>(event)->getTempo();
+                if (tempo == 0)
+                    continue;
+
+                content = 0xFF000000 | tempo;
+            }
+            else if (event->getCategory() == CATEGORY_MESSAGE) {
+                const Message *msg = static_cast<const Message*>(event);
+                uint8_t type = msg->getType(), data2 = msg->getData2();
+
+                /* Only the data bytes that are actually written count. */
+                if (type == MessageType::NOTE_ON && data2 == 0)
+                    type = MessageType::NOTE_OFF;
+
+                if (type == MessageType::NOTE_OFF || type == MessageType::PROGRAM_CHANGE || type == MessageType::CHANNEL_AFTERTOUCH)
+                    data2 = 0;
+
+                content = type << 20 | msg->getChannel() << 16 | msg->getData1() << 8 | data2;
+            }
+            else
+                continue;
+
+            /* A sum does not depend on the order of the events, and a mixed hash per event keeps
+             * different sets of events apart.
+             */
+            fingerprint += Hash::mix(Hash::mix(normalize(tick, division)) ^ content);
+        }
+
+        return fingerprint;
+    }
+
+    /**
+     * Method to compute the fingerprint of a file.
+     * @param file The file.
+     * @return uint64_t The fingerprint.
+     */
+    uint64_t Fingerprint::of(const File& file) {
+        uint64_t fingerprint = 0;
+
+        for (int i = 0; i < file.getTrackSlots(); i++) {
+            if (file.getTrack(i) != NULL)
+                fingerprint += of(*file.getTrack(i), file.getHeader().getDeltaTicks());
+        }
+
+        return fingerprint;
+    }
+
+    /**
+     * Default constructor, for the sketch of a file without notes.
+     */
+    Sketch::Sketch() {
+        std::fill(minimums, minimums + SIZE, UINT64_MAX);
+    }
+
+    /**
+     * Constructor which computes the sketch of a file.
+     * @param file The file.
+     */
+    Sketch::Sketch(const File& file) {
+        std::fill(minimums, minimums + SIZE, UINT64_MAX);
+
+        /* The scaled tick and the pitch of every note of every track, in order of time. */
+        std::vector<std::pair<uint64_t, uint8_t>> notes;
+        const uint16_t division = file.getHeader().getDeltaTicks();
+
+        for (int i = 0; i < file.getTrackSlots(); i++) {
+            const Track *track = file.getTrack(i);
+            if (track == NULL)
+                continue;
+
+            uint32_t tick = 0;
+            for (auto event : track->getEvents()) {
+                tick += event->deltaTime.getValue();
+
+                if (event->getCategory() != CATEGORY_MESSAGE)
+                    continue;
+
+                const Message *msg = static_cast<const Message*>(event);
+                if (msg->getType() == MessageType::NOTE_ON && msg->getData2() > 0)
+                    notes.push_back(std::make_pair(Fingerprint::normalize(tick, division), msg->getData1()));
+            }
+        }
+
+        std::sort(notes.begin(), notes.end());
+
+        /* A file with fewer notes than a shingle still gets the single shingle it has. */
+        const size_t length = std::min(SHINGLE, notes.size());
+
+        for (size_t first = 0; first + length <= notes.size() && length > 0; first++) {
+            uint64_t shingle = Hash::FNV_OFFSET;
+
+            for (size_t i = first; i < first + length; i++) {
+                const uint64_t gap = i > first ? (notes[i].first - notes[i - 1].first + SHINGLE_STEP / 2) / SHINGLE_STEP : 0;
+                shingle = Hash::mix(shingle ^ (gap << 8 | notes[i].second));
+            }
+
+            /* Every minimum uses its own hash function, derived from the hash of the shingle. */
+            for (size_t k = 0; k < SIZE; k++)
+                minimums[k] = std::min(minimums[k], Hash::mix(shingle + k * 0x9e3779b97f4a7c15ULL));
+        }
+    }
+
+    /**
+     * Method to estimate how similar the content of two files is.
+     * @param other The sketch of the other file.
+     * @return double The estimated Jaccard similarity, from 0 to 1.
+     */
+    double Sketch::similarity(const Sketch& other) const {
+        if (empty() || other.empty())
+            return empty() && other.empty() ? 1 : 0;
+
+        size_t equal = 0;
+        for (size_t k = 0; k < SIZE; k++)
+            equal += minimums[k] == other.minimums[k];
+
+        return (double) equal / SIZE;
+    }
+
+    /**
+     * Method to get the hash of a band of minimums.
+     * @param band The band, from 0 up to BANDS.
+     * @return uint64_t The hash of the band.
+     */
+    uint64_t Sketch::getBand(size_t band) const {
+        const size_t rows = SIZE / BANDS;
+        uint64_t hash = Hash::mix(band + 1);
+
+        for (size_t k = band * rows; k < (band + 1) * rows; k++)
+            hash = Hash::mix(hash ^ minimums[k]);
+
+        return hash;
+    }
+}
@@ -11,6 +11,7 @@
 #include <arpa/inet.h>
 #include <cppmidi/header.h>
 #include <cppmidi/endian.h>
+#include <cppmidi/encoder.h>
 
 /**
  * Setting up the midi namespace.
@@ -34,17 +35,8 @@ namespace Midi {
      * @return std::ostream& The original stream
      */
     std::ostream& operator <<(std::ostream& output, const Header &head) {
-        /* Writes the identifier to the stream. */
-        output.write(Header::IDENTIFIER, 4);
-
-        /* Slightly verbose code but unfortunately there is no other way. Writing
-         * the header info to the stream using the helper functions provided by the
-         * Midi::File class.
-         */
-        Endian::writeIntBig(output, 6);
-        Endian::writeShortBig(output, head._fileFormat);
-        Endian::writeShortBig(output, head._numTracks);
-        Endian::writeShortBig(output, head._deltaTicks);
+        StreamSink sink(output);
+        Encoder<StreamSink>(sink).write(head);
 
         return output;
     }
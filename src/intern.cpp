@@ -0,0 +1,107 @@
+/**
+ * intern.cpp
+ *
+ * File with implementations for the Midi::InternPool class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/intern.h>
+#include <cppmidi/hash.h>
+#include <algorithm>
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    const size_t InternPool::SHARDS;
+
+    /**
+     * Method to get the payload with the same bytes as the given ones.
+     * @param data The bytes.
+     * @param size The amount of bytes.
+     * @return Payload The interned payload.
+     */
+    Payload InternPool::intern(const uint8_t *data, size_t size) {
+        if (size <= Payload::INLINE_SIZE)
+            return Payload(data, size);
+
+        /* The lowest bits pick the bucket in the shard, so the shard is picked by the highest. */
+        const uint64_t hash = Hash::fnv1a(data, size);
+        Shard& shard = _shards[hash >> 60 & (SHARDS - 1)];
+
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto range = shard.copies.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            std::shared_ptr<const std::vector<uint8_t>> copy = it->second.lock();
+
+            if (copy && copy->size() == size && memcmp(copy->data(), data, size) == 0) {
+                _hits.fetch_add(1, std::memory_order_relaxed);
+                return Payload(copy, copy->data(), size);
+            }
+        }
+
+        /* Forgetting the unused copies whenever the shard doubled, so that costs nothing per copy on average. */
+        if (shard.copies.size() >= shard.threshold) {
+            purge(shard);
+            shard.threshold = std::max<size_t>(64, 2 * shard.copies.size());
+        }
+
+        std::shared_ptr<const std::vector<uint8_t>> copy = std::make_shared<const std::vector<uint8_t>>(data, data + size);
+        shard.copies.insert(std::make_pair(hash, copy));
+
+        _misses.fetch_add(1, std::memory_order_relaxed);
+        return Payload(copy, copy->data(), size);
+    }
+
+    /**
+     * Method to forget all the copies that are not used by any payload anymore.
+     * @return size_t The amount of forgotten copies.
+     */
+    size_t InternPool::purge() {
+        size_t forgotten = 0;
+
+        for (auto& shard : _shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            forgotten += purge(shard);
+        }
+
+        return forgotten;
+    }
+
+    /**
+     * Method to get the amount of copies in the pool.
+     * @return size_t The amount of copies.
+     */
+    size_t InternPool::size() const {
+        size_t total = 0;
+
+        for (auto& shard : _shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            total += shard.copies.size();
+        }
+
+        return total;
+    }
+
+    /**
+     * Method to forget the unused copies of a shard, which must be locked.
+     * @param shard The shard.
+     * @return size_t The amount of forgotten copies.
+     */
+    size_t InternPool::purge(Shard& shard) {
+        size_t forgotten = 0;
+
+        for (auto it = shard.copies.begin(); it != shard.copies.end();) {
+            if (it->second.expired()) {
+                it = shard.copies.erase(it);
+                forgotten++;
+            }
+            else
+                ++it;
+        }
+
+        return forgotten;
+    }
+}
@@ -0,0 +1,187 @@
+/**
+ * noteindex.cpp
+ *
+ * File with implementations for the Midi::NoteIndex class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/noteindex.h>
+#include <cppmidi/events/message.h>
+#include <algorithm>
+
+using Midi::Events::Message;
+using Midi::Events::MessageType;
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    /**
+     * Constructor which pairs all the notes of all the tracks in a file.
+     * @param file The file to index.
+     */
+    NoteIndex::NoteIndex(const File& file) {
+        for (int i = 0; i < file.getTrackSlots(); i++) {
+            const Track *track = file.getTrack(i);
+
+            /* Empty slots simply do not have any notes. */
+            if (track != NULL)
+                pair(*track, i);
+        }
+
+        build();
+    }
+
+    /**
+     * Constructor which pairs all the notes of a single track.
+     * @param track The track to index.
+     * @param index The track index which is stored in the notes.
+     */
+    NoteIndex::NoteIndex(const Track& track, uint16_t index) {
+        pair(track, index);
+        build();
+    }
+
+    /**
+     * Method to find all the notes that sound somewhere in [t0, t1).
+     * @param t0     The first tick of the range.
+     * @param t1     The first tick after the range.
+     * @param result The vector the note indexes will be appended to.
+     */
+    void NoteIndex::query(uint32_t t0, uint32_t t1, std::vector<uint32_t>& result) const {
+        const Note *first = _notes.data();
+
+        forEach(t0, t1, [&result, first](const Note& note) {
+            result.push_back(&note - first);
+        });
+    }
+
+    /**
+     * Method which pairs the notes of a single track and appends them to the notes.
+     * @param track The track to pair.
+     * @param index The track index which is stored in the notes.
+     */
+    void NoteIndex::pair(const Track& track, uint16_t index) {
+        NotePairer pairer;
+
+        /* The numbers of the notes count from the first note of this track. */
+        const size_t base = _notes.size();
+        uint32_t tick = 0;
+
+        for (auto event : track.getEvents()) {
+            tick += event->deltaTime.getValue();
+
+            /* Only messages can start or stop a note. */
+            if (event->getCategory() != CATEGORY_MESSAGE)
+                continue;
+
+            const Message *msg = static_cast<const Message*>(event);
+            const uint8_t type = msg->getType();
+
+            if (type != MessageType::NOTE_ON && type != MessageType::NOTE_OFF)
+                continue;
+
+            /* A real NOTE_ON opens a new note. */
+            if (type == MessageType::NOTE_ON && msg->getData2() > 0) {
+                Note note = { tick, tick, msg->getChannel(), msg->getData1(), msg->getData2(), false, index };
+
+                pairer.open(msg->getChannel(), msg->getData1());
+                _notes.push_back(note);
+                continue;
+            }
+
+            /* This is a NOTE_OFF or a NOTE_ON with velocity 0, which closes the oldest open note.
+             * A NOTE_OFF without any open note is simply ignored.
+             */
+            const int32_t local = pairer.close(msg->getChannel(), msg->getData1());
+            if (local < 0)
+                continue;
+
+            Note& note = _notes[base + local];
+            note.end = tick;
+            note.terminated = true;
+        }
+
+        /* Notes that are still open end at the end of the track. */
+        for (size_t i = base; i < _notes.size(); i++) {
+            if (!_notes[i].terminated)
+                _notes[i].end = tick;
+        }
+    }
+
+    /**
+     * Method which sorts the notes and builds the interval tree from them.
+     */
+    void NoteIndex::build() {
+        /* Stable, so notes with the same start keep the order of their tracks. */
+        std::stable_sort(_notes.begin(), _notes.end(), [](const Note& a, const Note& b) {
+            return a.start < b.start;
+        });
+
+        _nodes.clear();
+        _byStart.clear();
+        _byEnd.clear();
+
+        /* The indexes are sorted on start since the notes are. */
+        std::vector<uint32_t> indexes(_notes.size());
+        for (size_t i = 0; i < indexes.size(); i++)
+            indexes[i] = i;
+
+        _byStart.reserve(_notes.size());
+        _byEnd.reserve(_notes.size());
+
+        buildNode(indexes);
+    }
+
+    /**
+     * Method which recursively builds a node from a set of note indexes.
+     * @param indexes The note indexes, sorted on start tick.
+     * @return int32_t The index of the node, -1 if the set was empty.
+     */
+    int32_t NoteIndex::buildNode(std::vector<uint32_t>& indexes) {
+        if (indexes.empty())
+            return -1;
+
+        /* The median start is used as center. At most half of the notes start before it and at
+         * most half start after it, so the tree stays balanced, and the median note itself
+         * always contains the center so a node is never empty.
+         */
+        const uint32_t center = _notes[indexes[indexes.size() / 2]].start;
+
+        std::vector<uint32_t> left, right;
+        const uint32_t offset = _byStart.size();
+
+        /* Splitting keeps the order, so every part is still sorted on start. */
+        for (auto i : indexes) {
+            if (last(_notes[i]) < center)
+                left.push_back(i);
+            else if (_notes[i].start > center)
+                right.push_back(i);
+            else
+                _byStart.push_back(i);
+        }
+
+        /* The same notes again, but sorted on descending end for queries after the center. */
+        _byEnd.insert(_byEnd.end(), _byStart.begin() + offset, _byStart.end());
+        std::sort(_byEnd.begin() + offset, _byEnd.end(), [this](uint32_t a, uint32_t b) {
+            return last(_notes[a]) > last(_notes[b]);
+        });
+
+        /* The input is no longer needed, so free it before going deeper. */
+        std::vector<uint32_t>().swap(indexes);
+
+        /* Reserving the node before the children, so the root ends up at index 0. */
+        const int32_t node = _nodes.size();
+        Node n = { center, offset, static_cast<uint32_t>(_byStart.size() - offset), -1, -1 };
+        _nodes.push_back(n);
+
+        /* The nodes vector might grow in the recursion, so assign by index afterwards. */
+        const int32_t l = buildNode(left);
+        const int32_t r = buildNode(right);
+        _nodes[node].left = l;
+        _nodes[node].right = r;
+
+        return node;
+    }
+}
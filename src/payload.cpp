@@ -0,0 +1,37 @@
+/**
+ * payload.cpp
+ *
+ * File with implementations for the Midi::Payload class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/payload.h>
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    /**
+     * Constructor which copies the bytes, either inside the payload or into a new buffer.
+     * @param data The bytes to copy.
+     * @param size The amount of bytes.
+     */
+    Payload::Payload(const uint8_t *data, size_t size) : _data(NULL), _size(size), _inline(false) {
+        if (size == 0)
+            return;
+
+        /* Short payloads do not need a buffer at all. */
+        if (size <= INLINE_SIZE) {
+            memcpy(_bytes, data, size);
+            _inline = true;
+            return;
+        }
+
+        /* The vector is shared, so copies of the payload point to the same bytes. */
+        std::shared_ptr<std::vector<uint8_t>> buffer = std::make_shared<std::vector<uint8_t>>(data, data + size);
+
+        _data = buffer->data();
+        _owner = buffer;
+    }
+}
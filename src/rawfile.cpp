@@ -0,0 +1,333 @@
+/**
+ * rawfile.cpp
+ *
+ * File with implementations for the Midi::RawFile class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/rawfile.h>
+#include <cppmidi/file.h>
+#include <cppmidi/encoder.h>
+#include <cppmidi/endian.h>
+#include <cppmidi/validator.h>
+#include <fstream>
+#include <cstring>
+#include <algorithm>
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    const size_t RawFile::END;
+
+    /**
+     * Method to read a file from a shared buffer, which the chunks keep alive.
+     * @param buffer The buffer with the bytes of the file.
+     * @return Status The error and its offset, ERROR_NONE on success.
+     */
+    Status RawFile::read(const std::shared_ptr<const std::vector<uint8_t>>& buffer) {
+        _head = Header();
+        _chunks.clear();
+
+        const uint8_t *data = buffer->data();
+        const size_t size = buffer->size();
+
+        /* The header is checked exactly like when decoding. */
+        File file;
+        uint16_t numTracks;
+        size_t offset;
+        Status status = Decoder::decodeHeader(data, size, file, numTracks, offset);
+        if (!status.ok())
+            return status;
+
+        size_t tracks = 0;
+        while (tracks < numTracks) {
+            if (size - offset < 8)
+                status = Status(ERROR_TRUNCATED, size);
+            else if (Endian::readIntBig(data + offset + 4) > size - offset - 8)
+                status = Status(ERROR_CHUNK_LENGTH, offset + 4);
+            else if (memcmp(data + offset, Track::IDENTIFIER, 4) && !Validator::isPrintable(data + offset))
+                status = Status(ERROR_CHUNK_MAGIC, offset);
+
+            if (!status.ok()) {
+                _chunks.clear();
+                return status;
+            }
+
+            const uint32_t length = Endian::readIntBig(data + offset + 4);
+            _chunks.push_back(Chunk(reinterpret_cast<const char*>(data + offset), Payload::share(buffer, data + offset + 8, length)));
+            tracks += _chunks.back().isTrack();
+
+            offset += 8 + length;
+        }
+
+        /* Unknown chunks may follow the last track as well, up to the end of the buffer. */
+        for (size_t length; (length = Decoder::trailingChunk(data, size, offset)) > 0; offset += length)
+            _chunks.push_back(Chunk(reinterpret_cast<const char*>(data + offset), Payload::share(buffer, data + offset + 8, length - 8)));
+
+        _head = file.getHeader();
+        return status;
+    }
+
+    /**
+     * Method to read a file from a stream, which should be in binary mode.
+     * @param input The input stream.
+     * @return Status The error and its offset, ERROR_NONE on success.
+     */
+    Status RawFile::read(std::istream& input) {
+        std::shared_ptr<std::vector<uint8_t>> buffer = std::make_shared<std::vector<uint8_t>>();
+
+        Status status = Decoder::read(input, *buffer);
+        if (!status.ok()) {
+            _head = Header();
+            _chunks.clear();
+            return status;
+        }
+
+        return read(std::shared_ptr<const std::vector<uint8_t>>(buffer));
+    }
+
+    /**
+     * Method to read a file from disk.
+     * @param path The path of the file.
+     * @return Status The error and its offset, ERROR_IO if the file could not be opened.
+     */
+    Status RawFile::load(const std::string& path) {
+        std::ifstream input(path, std::ios::binary);
+        if (!input)
+            return Status(ERROR_IO, 0);
+
+        return read(input);
+    }
+
+    /**
+     * Method to write the file to a stream.
+     * @param output The output stream.
+     * @return Status ERROR_IO if writing failed, with the offset where it failed.
+     */
+    Status RawFile::write(std::ostream& output) const {
+        StreamSink sink(output);
+        Encoder<StreamSink> encoder(sink);
+
+        Header header(_head);
+        header.setNumTracks(getTrackCount());
+        encoder.write(header);
+
+        uint64_t offset = 14;
+        for (const auto& chunk : _chunks) {
+            if (!output || !encoder.write(chunk))
+                return Status(ERROR_IO, offset);
+
+            offset += chunk.size();
+        }
+
+        return output ? Status() : Status(ERROR_IO, offset);
+    }
+
+    /**
+     * Method to write the file to disk.
+     * @param path The path to write to.
+     * @return Status ERROR_IO if the file could not be created or written.
+     */
+    Status RawFile::save(const std::string& path) const {
+        std::ofstream output(path, std::ios::binary | std::ios::trunc);
+        if (!output)
+            return Status(ERROR_IO, 0);
+
+        Status status = write(output);
+
+        output.close();
+        if (!output && status.ok())
+            status = Status(ERROR_IO, 0);
+
+        return status;
+    }
+
+    /**
+     * Method to get the amount of track chunks.
+     * @return size_t The amount of tracks.
+     */
+    size_t RawFile::getTrackCount() const {
+        size_t count = 0;
+        for (const auto& chunk : _chunks)
+            count += chunk.isTrack();
+
+        return count;
+    }
+
+    /**
+     * Method to get a track chunk.
+     * @param index The index of the track.
+     * @return const Chunk* The chunk, NULL if there is no track at the index.
+     */
+    const Chunk* RawFile::getTrack(size_t index) const {
+        const size_t position = locate(index);
+        return position < _chunks.size() ? &_chunks[position] : NULL;
+    }
+
+    /**
+     * Method to decode a single track.
+     * @param index   The index of the track.
+     * @param track   The track to add the events to.
+     * @param options The options to decode with.
+     * @return Status The error and its offset within the chunk.
+     */
+    Status RawFile::decodeTrack(size_t index, Track& track, const DecodeOptions& options) const {
+        const Chunk *chunk = getTrack(index);
+        if (chunk == NULL)
+            return Status(ERROR_TRUNCATED, 0);
+
+        /* The payloads of the events point into the same buffer as the chunk. */
+        const Payload& data = chunk->getData();
+        return Decoder(options).decodeTrack(data.data(), 0, data.size(), track, data.getOwner());
+    }
+
+    /**
+     * Method to add a decoded track, which is encoded once.
+     * @param track    The track.
+     * @param position The index the track gets, END to add it after the last track.
+     * @return bool False if the file cannot hold another track, or the track is too long.
+     */
+    bool RawFile::addTrack(const Track& track, size_t position) {
+        CountingSink counter;
+        Encoder<CountingSink>(counter).writeEvents(track);
+
+        if (counter.size() > 0xFFFFFFFF || !admit(getTrackCount() + 1))
+            return false;
+
+        std::shared_ptr<std::vector<uint8_t>> buffer = std::make_shared<std::vector<uint8_t>>();
+        buffer->reserve(counter.size());
+
+        BufferSink sink(*buffer);
+        Encoder<BufferSink>(sink).writeEvents(track);
+
+        _chunks.insert(_chunks.begin() + locate(position), Chunk(Track::IDENTIFIER, Payload(buffer, buffer->data(), buffer->size())));
+        return true;
+    }
+
+    /**
+     * Method to copy tracks from another file, or from this file itself, without decoding them.
+     * @param source   The file to copy the tracks from.
+     * @param first    The index of the first track to copy.
+     * @param count    The amount of tracks to copy, END for all tracks from the first.
+     * @param position The index the first copied track gets, END to add them after the last track.
+     * @return bool False if the tracks cannot be copied, in which case nothing is copied.
+     */
+    bool RawFile::splice(const RawFile& source, size_t first, size_t count, size_t position) {
+        const size_t available = source.getTrackCount();
+        if (first > available)
+            return false;
+
+        count = std::min(count, available - first);
+
+        /* Ticks only mean the same in both files if the divisions are the same. */
+        const bool empty = getTrackCount() == 0;
+        if (!empty && source._head.getDeltaTicks() != _head.getDeltaTicks())
+            return false;
+
+        /* Collected first, since the source may be this file itself. */
+        std::vector<Chunk> tracks;
+        tracks.reserve(count);
+        for (size_t i = source.locate(first); i < source._chunks.size() && tracks.size() < count; i++) {
+            if (source._chunks[i].isTrack())
+                tracks.push_back(source._chunks[i]);
+        }
+
+        if (!admit(getTrackCount() + count))
+            return false;
+
+        if (empty)
+            _head.setDeltaTicks(source._head.getDeltaTicks());
+
+        _chunks.insert(_chunks.begin() + locate(position), tracks.begin(), tracks.end());
+        return true;
+    }
+
+    /**
+     * Method to remove a track.
+     * @param index The index of the track.
+     * @return bool False if there is no track at the index.
+     */
+    bool RawFile::removeTrack(size_t index) {
+        const size_t position = locate(index);
+        if (position >= _chunks.size())
+            return false;
+
+        _chunks.erase(_chunks.begin() + position);
+        return true;
+    }
+
+    /**
+     * Method to rearrange the tracks.
+     * @param order The current indices of the tracks, in their new order.
+     * @return bool False if an index is out of range or there would be too many tracks.
+     */
+    bool RawFile::reorder(const std::vector<size_t>& order) {
+        /* The track chunks, and every unknown chunk with the index of the track it is in front of. */
+        std::vector<const Chunk*> tracks;
+        std::vector<std::pair<size_t, const Chunk*>> others;
+
+        for (const auto& chunk : _chunks) {
+            if (chunk.isTrack())
+                tracks.push_back(&chunk);
+            else
+                others.push_back(std::make_pair(tracks.size(), &chunk));
+        }
+
+        for (auto index : order) {
+            if (index >= tracks.size())
+                return false;
+        }
+
+        if (!admit(order.size()))
+            return false;
+
+        std::vector<Chunk> chunks;
+        chunks.reserve(order.size() + others.size());
+
+        size_t next = 0;
+        for (size_t i = 0; i < order.size(); i++) {
+            for (; next < others.size() && others[next].first <= i; next++)
+                chunks.push_back(*others[next].second);
+
+            chunks.push_back(*tracks[order[i]]);
+        }
+
+        for (; next < others.size(); next++)
+            chunks.push_back(*others[next].second);
+
+        _chunks.swap(chunks);
+        return true;
+    }
+
+    /**
+     * Method to find the chunk of a track.
+     * @param index The index of the track.
+     * @return size_t The index of the chunk, or the amount of chunks if there is no track at the index.
+     */
+    size_t RawFile::locate(size_t index) const {
+        for (size_t i = 0; i < _chunks.size(); i++) {
+            if (_chunks[i].isTrack() && index-- == 0)
+                return i;
+        }
+
+        return _chunks.size();
+    }
+
+    /**
+     * Method to check whether the file can hold more tracks, and to change the format of a
+     * file with a single track if needed.
+     * @param count The amount of tracks the file would have.
+     * @return bool False if the header cannot count that many tracks.
+     */
+    bool RawFile::admit(size_t count) {
+        if (count > 0xFFFF)
+            return false;
+
+        if (count > 1 && _head.getFileFormat() == SINGLETRACK)
+            _head.setFileFormat(MULTITRACK_SYNC);
+
+        return true;
+    }
+}
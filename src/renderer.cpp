@@ -0,0 +1,578 @@
+/**
+ * renderer.cpp
+ *
+ * File with implementations for the Midi::Renderer class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/renderer.h>
+#include <cppmidi/noteindex.h>
+#include <cppmidi/tempomap.h>
+#include <cppmidi/endian.h>
+#include <cppmidi/hash.h>
+#include <cppmidi/events/message.h>
+#include <algorithm>
+#include <queue>
+#include <set>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+
+using Midi::Events::Message;
+using Midi::Events::MessageType;
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    /**
+     * The waveforms of the oscillators.
+     */
+    enum Waveform {
+        WAVE_SINE = 0,
+        WAVE_TRIANGLE,
+        WAVE_SQUARE,
+        WAVE_SAW,
+        WAVE_COUNT
+    };
+
+    /**
+     * The sound of a family of programs: a waveform and an envelope, with times in seconds.
+     * Without decay the level stays at the top after the attack.
+     */
+    struct Patch {
+        Waveform wave;
+        float attack;
+        float decay;
+        float sustain;
+        float release;
+    };
+
+    /**
+     * The patches of the 16 General MIDI program families, in order from piano to sound effects.
+     */
+    static const Patch patches[16] = {
+        { WAVE_TRIANGLE, 0.005f, 1.00f, 0.00f, 0.20f },
+        { WAVE_SINE,     0.002f, 0.50f, 0.00f, 0.30f },
+        { WAVE_SQUARE,   0.010f, 0.00f, 1.00f, 0.05f },
+        { WAVE_SAW,      0.003f, 0.80f, 0.10f, 0.10f },
+        { WAVE_TRIANGLE, 0.005f, 0.40f, 0.60f, 0.05f },
+        { WAVE_SAW,      0.150f, 0.00f, 1.00f, 0.30f },
+        { WAVE_SAW,      0.200f, 0.00f, 1.00f, 0.40f },
+        { WAVE_SAW,      0.050f, 0.20f, 0.80f, 0.10f },
+        { WAVE_SQUARE,   0.030f, 0.00f, 0.90f, 0.10f },
+        { WAVE_SINE,     0.050f, 0.00f, 1.00f, 0.10f },
+        { WAVE_SQUARE,   0.010f, 0.10f, 0.80f, 0.10f },
+        { WAVE_TRIANGLE, 0.300f, 0.00f, 1.00f, 0.50f },
+        { WAVE_SAW,      0.100f, 0.00f, 0.80f, 0.50f },
+        { WAVE_TRIANGLE, 0.005f, 0.60f, 0.20f, 0.20f },
+        { WAVE_SINE,     0.001f, 0.30f, 0.00f, 0.10f },
+        { WAVE_SINE,     0.010f, 0.50f, 0.50f, 0.20f },
+    };
+
+    /**
+     * The kinds of drums the drum voice can play.
+     */
+    enum Drum {
+        DRUM_KICK = 0,
+        DRUM_SNARE,
+        DRUM_TOM,
+        DRUM_CLOSED_HAT,
+        DRUM_OPEN_HAT,
+        DRUM_CYMBAL,
+        DRUM_OTHER
+    };
+
+    /**
+     * The length of the drums, in seconds.
+     */
+    static const float drumLengths[] = { 0.40f, 0.25f, 0.35f, 0.08f, 0.50f, 1.20f, 0.20f };
+
+    /**
+     * The size of the wavetables, which is a power of 2.
+     */
+    static const size_t TABLE_SIZE = 2048;
+
+    /**
+     * The amount of frames for which the envelope is computed once and then interpolated.
+     */
+    static const size_t CONTROL_FRAMES = 32;
+
+    /**
+     * The time in seconds in which a voice fades out when it is stolen for a new note.
+     */
+    static const double STEAL_FADE = 0.005;
+
+    /**
+     * The wavetables of all the waveforms, with an extra sample at the end so interpolation
+     * never has to wrap around.
+     */
+    struct Wavetables {
+        /**
+         * Constructor, which computes the tables.
+         */
+        Wavetables() {
+            for (size_t i = 0; i <= TABLE_SIZE; i++) {
+                const double phase = (double) (i % TABLE_SIZE) / TABLE_SIZE;
+
+                tables[WAVE_SINE][i] = std::sin(2 * M_PI * phase);
+                tables[WAVE_TRIANGLE][i] = phase < 0.5 ? 4 * phase - 1 : 3 - 4 * phase;
+                tables[WAVE_SQUARE][i] = phase < 0.5 ? 0.5f : -0.5f;
+                tables[WAVE_SAW][i] = 0.7 * (2 * phase - 1);
+            }
+        }
+
+        /**
+         * The tables.
+         * @var float[WAVE_COUNT][TABLE_SIZE + 1]
+         */
+        float tables[WAVE_COUNT][TABLE_SIZE + 1];
+    };
+
+    /**
+     * Method to get the wavetables, which are computed when they are used first.
+     * @return const Wavetables& The wavetables.
+     */
+    static const Wavetables& wavetables() {
+        static const Wavetables tables;
+        return tables;
+    }
+
+    /**
+     * A single note that is rendered, with its times in frames from the start of the audio,
+     * and the time in seconds it fades out in after it was released.
+     */
+    struct Voice {
+        uint64_t start;
+        uint64_t release;
+        uint64_t end;
+        double fade;
+        double frequency;
+        float left;
+        float right;
+        uint8_t family;
+        uint8_t pitch;
+        bool drum;
+        uint64_t seed;
+    };
+
+    /**
+     * The values of a controller of a channel over time, sorted on their tick.
+     */
+    typedef std::vector<std::pair<uint32_t, int32_t>> Timeline;
+
+    /**
+     * Method to get the value of a controller at a tick, including the changes at that tick.
+     * @param timeline The timeline of the controller.
+     * @param tick     The tick.
+     * @param initial  The value before the first change.
+     * @return int32_t The value.
+     */
+    static int32_t valueAt(const Timeline& timeline, uint32_t tick, int32_t initial) {
+        auto it = std::upper_bound(timeline.begin(), timeline.end(), tick, [](uint32_t t, const std::pair<uint32_t, int32_t>& change) {
+            return t < change.first;
+        });
+
+        return it == timeline.begin() ? initial : (it - 1)->second;
+    }
+
+    /**
+     * Method to get the kind of drum for a note on the percussion channel.
+     * @param pitch The pitch of the note.
+     * @return Drum The drum.
+     */
+    static Drum drumOf(uint8_t pitch) {
+        switch (pitch) {
+        case 35: case 36: return DRUM_KICK;
+        case 37: case 38: case 39: case 40: return DRUM_SNARE;
+        case 41: case 43: case 45: case 47: case 48: case 50: return DRUM_TOM;
+        case 42: case 44: return DRUM_CLOSED_HAT;
+        case 46: return DRUM_OPEN_HAT;
+        case 49: case 51: case 52: case 53: case 55: case 57: case 59: return DRUM_CYMBAL;
+        default: return DRUM_OTHER;
+        }
+    }
+
+    /**
+     * Method to get white noise that only depends on a seed and a position, so the noise of
+     * a voice is the same whichever slice it is rendered in.
+     * @param seed     The seed.
+     * @param position The position.
+     * @return float The noise, ranging from -1 to 1.
+     */
+    static float noise(uint64_t seed, uint64_t position) {
+        return (Hash::mix(seed + position * 0x9e3779b97f4a7c15ULL) >> 40) / (float) (1 << 23) - 1.0f;
+    }
+
+    /**
+     * Method to get the level of the envelope of a voice.
+     * @param patch   The patch.
+     * @param time    The time since the start of the voice, in seconds.
+     * @param release The time the note was released, in seconds.
+     * @param fade    The time the voice fades out in after it was released, in seconds.
+     * @return float The level.
+     */
+    static float envelope(const Patch& patch, double time, double release, double fade) {
+        /* The level while the note is held, and the level it is released from. */
+        const double held = std::min(time, release);
+        double level;
+
+        if (held < patch.attack)
+            level = held / patch.attack;
+        else if (patch.decay > 0)
+            level = patch.sustain + (1 - patch.sustain) * std::exp((patch.attack - held) / patch.decay);
+        else
+            level = patch.sustain;
+
+        if (time > release)
+            level *= std::max(0.0, 1 - (time - release) / fade);
+
+        return level;
+    }
+
+    /**
+     * Method to get a sample of a drum.
+     * @param voice The voice.
+     * @param frame The frame since the start of the voice.
+     * @param rate  The sample rate.
+     * @return float The sample.
+     */
+    static float drumSample(const Voice& voice, uint64_t frame, double rate) {
+        const double t = frame / rate;
+
+        switch (drumOf(voice.pitch)) {
+        case DRUM_KICK:
+            /* A sine that sweeps down from 150 to 50 Hz, where the phase is the integral of the frequency. */
+            return std::sin(2 * M_PI * (50 * t + 100 * (1 - std::exp(-30 * t)) / 30)) * std::exp(-8 * t);
+        case DRUM_SNARE:
+            return (0.6f * noise(voice.seed, frame) + 0.4 * std::sin(2 * M_PI * 180 * t)) * std::exp(-18 * t);
+        case DRUM_TOM: {
+            const double base = 80 + 12 * (voice.pitch - 41);
+            return std::sin(2 * M_PI * (base * t + base * (1 - std::exp(-20 * t)) / 40)) * std::exp(-10 * t);
+        }
+        case DRUM_CLOSED_HAT:
+            return 0.5f * noise(voice.seed, frame) * std::exp(-60 * t);
+        case DRUM_OPEN_HAT:
+            return 0.5f * noise(voice.seed, frame) * std::exp(-8 * t);
+        case DRUM_CYMBAL:
+            return 0.4f * noise(voice.seed, frame) * std::exp(-3.5 * t);
+        default:
+            return 0.5f * noise(voice.seed, frame) * std::exp(-25 * t);
+        }
+    }
+
+    /**
+     * Method to add a part of a voice to a slice.
+     * @param voice  The voice.
+     * @param from   The first frame to render, from the start of the audio.
+     * @param to     The frame after the last frame to render.
+     * @param base   The first frame of the slice.
+     * @param output The stereo samples of the slice.
+     * @param rate   The sample rate.
+     */
+    static void renderVoice(const Voice& voice, uint64_t from, uint64_t to, uint64_t base, float *output, double rate) {
+        if (voice.drum) {
+            /* Drums ignore their note off, but stolen drums still fade out. */
+            for (uint64_t frame = from; frame < to; frame++) {
+                float sample = drumSample(voice, frame - voice.start, rate);
+                if (frame > voice.release)
+                    sample *= std::max(0.0, 1 - (frame - voice.release) / rate / voice.fade);
+
+                output[2 * (frame - base)] += sample * voice.left;
+                output[2 * (frame - base) + 1] += sample * voice.right;
+            }
+
+            return;
+        }
+
+        const Patch& patch = patches[voice.family];
+        const float *table = wavetables().tables[patch.wave];
+        const double release = (voice.release - voice.start) / rate;
+
+        /* The blocks are counted from the start of the voice, and the phase is computed again at
+         * the start of every block, so a frame gets the same sample in whichever slice it is.
+         */
+        const double step = voice.frequency / rate;
+
+        for (uint64_t offset = (from - voice.start) / CONTROL_FRAMES * CONTROL_FRAMES; voice.start + offset < to; offset += CONTROL_FRAMES) {
+            const uint64_t block = voice.start + offset;
+            const float first = envelope(patch, offset / rate, release, voice.fade);
+            const float slope = (envelope(patch, (offset + CONTROL_FRAMES) / rate, release, voice.fade) - first) / CONTROL_FRAMES;
+            double phase = std::fmod(step * offset, 1.0);
+
+            for (uint64_t frame = block; frame < std::min<uint64_t>(block + CONTROL_FRAMES, to); frame++, phase += step) {
+                if (phase >= 1)
+                    phase -= std::floor(phase);
+
+                if (frame < from)
+                    continue;
+
+                const double position = phase * TABLE_SIZE;
+                const size_t index = (size_t) position;
+                const float fraction = position - index;
+                const float sample = (table[index] + (table[index + 1] - table[index]) * fraction) * (first + slope * (frame - block));
+
+                output[2 * (frame - base)] += sample * voice.left;
+                output[2 * (frame - base) + 1] += sample * voice.right;
+            }
+        }
+    }
+
+    /**
+     * Method to create the voices of all the notes in a file.
+     * @param file      The file.
+     * @param rate      The sample rate.
+     * @param polyphony The largest amount of voices that sound at once.
+     * @param voices    The voices are appended to this.
+     * @return uint64_t The amount of frames until all the voices have ended.
+     */
+    static uint64_t collectVoices(const File& file, double rate, size_t polyphony, std::vector<Voice>& voices) {
+        NoteIndex index(file);
+        TempoMap tempo(file);
+
+        /* The state of the channels over time, from all the tracks together. */
+        Timeline programs[16], volumes[16], expressions[16], pans[16], bends[16];
+
+        for (uint8_t channel = 0; channel < 16; channel++) {
+            file.forEachMessage(MessageType::PROGRAM_CHANGE, channel, [&](int, uint32_t tick, const Message& msg) {
+                programs[channel].push_back(std::make_pair(tick, msg.getData1() & 0x7F));
+            });
+
+            file.forEachMessage(MessageType::CONTROLLER, channel, [&](int, uint32_t tick, const Message& msg) {
+                if (msg.getData1() == 7)
+                    volumes[channel].push_back(std::make_pair(tick, msg.getData2() & 0x7F));
+                else if (msg.getData1() == 11)
+                    expressions[channel].push_back(std::make_pair(tick, msg.getData2() & 0x7F));
+                else if (msg.getData1() == 10)
+                    pans[channel].push_back(std::make_pair(tick, msg.getData2() & 0x7F));
+            });
+
+            file.forEachMessage(MessageType::PITCH_BEND, channel, [&](int, uint32_t tick, const Message& msg) {
+                bends[channel].push_back(std::make_pair(tick, ((msg.getData2() & 0x7F) << 7 | (msg.getData1() & 0x7F)) - 8192));
+            });
+
+            /* The tracks were visited one by one, the order within a tick stays that of the tracks. */
+            Timeline *timelines[] = { &programs[channel], &volumes[channel], &expressions[channel], &pans[channel], &bends[channel] };
+            for (Timeline *timeline : timelines) {
+                std::stable_sort(timeline->begin(), timeline->end(), [](const std::pair<uint32_t, int32_t>& a, const std::pair<uint32_t, int32_t>& b) {
+                    return a.first < b.first;
+                });
+            }
+        }
+
+        voices.reserve(voices.size() + index.getNotes().size());
+
+        /* The sounding voices by their index, which is the order they started in, and the
+         * ends of the voices so they can be removed once they are done.
+         */
+        std::set<size_t> sounding;
+        std::priority_queue<std::pair<uint64_t, size_t>, std::vector<std::pair<uint64_t, size_t>>, std::greater<std::pair<uint64_t, size_t>>> ends;
+
+        for (const Note& note : index.getNotes()) {
+            const uint8_t c = note.channel;
+
+            Voice voice;
+            voice.start = (uint64_t) std::llround(tempo.toMicroseconds(note.start) * rate / 1e6);
+            voice.release = std::max<uint64_t>(voice.start + 1, std::llround(tempo.toMicroseconds(note.end) * rate / 1e6));
+            voice.pitch = note.pitch;
+            voice.drum = c == 9;
+            voice.family = valueAt(programs[c], note.start, 0) >> 3;
+            voice.seed = Hash::mix(voices.size() + 1);
+
+            /* Bending 2 semitones up or down at most, the General MIDI default. */
+            const double bend = valueAt(bends[c], note.start, 0) / 8192.0 * 2;
+            voice.frequency = 440 * std::pow(2.0, (note.pitch - 69 + bend) / 12);
+
+            if (voice.drum) {
+                voice.end = voice.start + (uint64_t) (drumLengths[drumOf(note.pitch)] * rate);
+                voice.release = voice.end;
+                voice.fade = STEAL_FADE;
+            }
+            else {
+                voice.fade = patches[voice.family].release;
+                voice.end = voice.release + (uint64_t) (voice.fade * rate);
+            }
+
+            /* The pan goes from 0 for left to 127 for right, with equal power in between. */
+            const double gain = 0.25 * (note.velocity / 127.0) * (valueAt(volumes[c], note.start, 100) / 127.0) *
+                                (valueAt(expressions[c], note.start, 127) / 127.0);
+            const double pan = valueAt(pans[c], note.start, 64) / 127.0 * M_PI / 2;
+
+            voice.left = gain * std::cos(pan);
+            voice.right = gain * std::sin(pan);
+
+            while (!ends.empty() && ends.top().first <= voice.start) {
+                sounding.erase(ends.top().second);
+                ends.pop();
+            }
+
+            /* Without a free voice, the oldest one quickly fades out to make room. */
+            if (sounding.size() >= polyphony && !sounding.empty()) {
+                Voice& stolen = voices[*sounding.begin()];
+                stolen.release = std::min(stolen.release, voice.start);
+                stolen.fade = std::min(stolen.fade, STEAL_FADE);
+                stolen.end = std::min(stolen.end, stolen.release + (uint64_t) std::ceil(stolen.fade * rate));
+                sounding.erase(sounding.begin());
+            }
+
+            sounding.insert(voices.size());
+            ends.push(std::make_pair(voice.end, voices.size()));
+            voices.push_back(voice);
+        }
+
+        uint64_t frames = 0;
+        for (const Voice& voice : voices)
+            frames = std::max(frames, voice.end);
+
+        return frames;
+    }
+
+    /**
+     * Method to render a file.
+     * @param file    The file.
+     * @param samples The stereo samples, interleaved left and right, replacing anything in it.
+     * @return RenderStats The statistics of the rendering, with the error if it failed.
+     */
+    RenderStats Renderer::render(const File& file, std::vector<int16_t>& samples) {
+        const auto begin = std::chrono::steady_clock::now();
+        const double rate = std::max(1u, _options.sampleRate);
+        const size_t slice = std::max<size_t>(_options.sliceFrames, CONTROL_FRAMES);
+
+        std::vector<Voice> voices;
+        const uint64_t frames = collectVoices(file, rate, std::max<size_t>(_options.polyphony, 1), voices);
+
+        /* A single note far into the file is enough to need more memory than there is, so the
+         * length is checked before anything the size of the audio is allocated.
+         */
+        if (_options.maxSeconds > 0 && frames / rate > _options.maxSeconds) {
+            samples.clear();
+
+            RenderStats stats;
+            stats.voices = voices.size();
+            stats.status = Status(ERROR_LIMIT_DURATION, 0);
+            stats.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            return stats;
+        }
+
+        /* Every slice gets the voices that sound during it, so slices never write to the same frames. */
+        const size_t count = (frames + slice - 1) / slice;
+        std::vector<std::vector<uint32_t>> slices(count);
+
+        for (size_t i = 0; i < voices.size(); i++) {
+            for (size_t s = voices[i].start / slice; s < count && s * slice < voices[i].end; s++)
+                slices[s].push_back(i);
+        }
+
+        /* Computing the tables before the workers start using them. */
+        wavetables();
+
+        std::vector<float> mix(frames * 2, 0.0f);
+        std::vector<float> peaks(count, 0.0f);
+
+        for (size_t s = 0; s < count; s++) {
+            _pool.submit([&, s]() {
+                const uint64_t first = s * slice;
+                const uint64_t last = std::min<uint64_t>(first + slice, frames);
+                float *output = mix.data() + 2 * first;
+
+                for (uint32_t i : slices[s]) {
+                    const Voice& voice = voices[i];
+                    renderVoice(voice, std::max(first, voice.start), std::min(last, voice.end), first, output, rate);
+                }
+
+                float peak = 0;
+                for (uint64_t i = 0; i < 2 * (last - first); i++)
+                    peak = std::max(peak, std::fabs(output[i]));
+
+                peaks[s] = peak;
+            });
+        }
+
+        _pool.wait();
+
+        RenderStats stats;
+        stats.frames = frames;
+        stats.voices = voices.size();
+        stats.seconds = frames / rate;
+
+        for (float peak : peaks)
+            stats.peak = std::max<double>(stats.peak, peak);
+
+        /* Scaling the whole mix with the same factor, so the balance between the notes stays. */
+        double scale = _options.gain;
+        if (_options.normalize && stats.peak * scale > 1)
+            scale = 1 / stats.peak;
+
+        samples.resize(mix.size());
+        for (size_t i = 0; i < mix.size(); i++)
+            samples[i] = (int16_t) std::lround(std::max(-1.0, std::min(1.0, mix[i] * scale)) * 32767);
+
+        stats.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        return stats;
+    }
+
+    /**
+     * Method to render a file into a WAV file.
+     * @param file  The file.
+     * @param path  The path of the WAV file.
+     * @param stats If not NULL, the statistics of the rendering are stored here.
+     * @return Status The status, with ERROR_IO if the WAV file could not be written, or the error of render().
+     */
+    Status Renderer::save(const File& file, const std::string& path, RenderStats *stats) {
+        std::vector<int16_t> samples;
+        RenderStats result = render(file, samples);
+
+        if (stats != NULL)
+            *stats = result;
+
+        if (!result.status.ok())
+            return result.status;
+
+        std::ofstream output(path, std::ios::binary | std::ios::trunc);
+        if (!output || !writeWav(output, samples, _options.sampleRate))
+            return Status(ERROR_IO, 0);
+
+        return Status();
+    }
+
+    /**
+     * Method to write 16 bit PCM samples as a WAV file.
+     * @param output     The output stream, in binary mode.
+     * @param samples    The samples, interleaved per channel.
+     * @param sampleRate The amount of frames per second.
+     * @param channels   The amount of channels.
+     * @return bool False if writing failed or there are too many samples for a WAV file.
+     */
+    bool Renderer::writeWav(std::ostream& output, const std::vector<int16_t>& samples, unsigned sampleRate, uint16_t channels) {
+        const uint64_t size = (uint64_t) samples.size() * 2;
+        if (size + 36 > 0xFFFFFFFF || channels == 0)
+            return false;
+
+        output.write("RIFF", 4);
+        Endian::writeIntLittle(output, size + 36);
+        output.write("WAVE", 4);
+
+        /* The format chunk, for PCM samples of 16 bits. */
+        output.write("fmt ", 4);
+        Endian::writeIntLittle(output, 16);
+        Endian::writeShortLittle(output, 1);
+        Endian::writeShortLittle(output, channels);
+        Endian::writeIntLittle(output, sampleRate);
+        Endian::writeIntLittle(output, sampleRate * channels * 2);
+        Endian::writeShortLittle(output, channels * 2);
+        Endian::writeShortLittle(output, 16);
+
+        output.write("data", 4);
+        Endian::writeIntLittle(output, size);
+
+        /* WAV files are little endian, so on little endian machines the samples are written as they are. */
+        if (!Endian::modeBigEndian)
+            output.write(reinterpret_cast<const char*>(samples.data()), size);
+        else
+            for (int16_t sample : samples)
+                Endian::writeShortLittle(output, sample);
+
+        return (bool) output;
+    }
+}
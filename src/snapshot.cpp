@@ -0,0 +1,217 @@
+/**
+ * snapshot.cpp
+ *
+ * File with implementations for the Midi::Snapshot and Midi::SnapshotEditor classes.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/snapshot.h>
+#include <cppmidi/encoder.h>
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    /**
+     * Default constructor, for an empty file.
+     */
+    Snapshot::Snapshot() {
+        std::shared_ptr<SnapshotData> data = std::make_shared<SnapshotData>();
+        data->version = 0;
+
+        _data = data;
+    }
+
+    /**
+     * Constructor which copies all the tracks and other chunks of a file.
+     * @param file The file.
+     */
+    Snapshot::Snapshot(const File& file) {
+        std::shared_ptr<SnapshotData> data = std::make_shared<SnapshotData>();
+        data->header = file.getHeader();
+        data->chunks = file.getChunks();
+        data->version = 0;
+        data->tracks.reserve(file.getTrackSlots());
+
+        for (int i = 0; i < file.getTrackSlots(); i++) {
+            const Track *track = file.getTrack(i);
+            data->tracks.push_back(track == NULL ? std::shared_ptr<const Track>() : std::make_shared<const Track>(*track));
+        }
+
+        _data = data;
+    }
+
+    /**
+     * Method to get a track.
+     * @param index The index of the track.
+     * @return const Track* The track, NULL if there is no track at the index.
+     */
+    const Track* Snapshot::getTrack(int index) const {
+        return shareTrack(index).get();
+    }
+
+    /**
+     * Method to get a track that stays valid after the snapshot is gone.
+     * @param index The index of the track.
+     * @return std::shared_ptr<const Track> The track, empty if there is no track at the index.
+     */
+    std::shared_ptr<const Track> Snapshot::shareTrack(int index) const {
+        if (index < 0 || index >= getTrackSlots())
+            return std::shared_ptr<const Track>();
+
+        return _data->tracks[index];
+    }
+
+    /**
+     * Method to copy the snapshot into a file that can be changed freely.
+     * @param file The file, of which anything is replaced.
+     */
+    void Snapshot::toFile(File& file) const {
+        file.clear();
+        file.getHeader().setFileFormat(static_cast<MidiMode>(getHeader().getFileFormat()));
+        file.getHeader().setDeltaTicks(getHeader().getDeltaTicks());
+
+        for (int i = 0; i < getTrackSlots(); i++) {
+            if (_data->tracks[i])
+                *file.getTrack(i) = *_data->tracks[i];
+        }
+
+        for (const auto& chunk : _data->chunks)
+            file.addChunk(chunk.second, chunk.first);
+    }
+
+    /**
+     * Stream operator, which writes the snapshot just like the file it holds.
+     * @param output   The output stream.
+     * @param snapshot The snapshot.
+     * @return std::ostream& The original output stream.
+     */
+    std::ostream& operator <<(std::ostream& output, const Snapshot& snapshot) {
+        output << snapshot.getHeader();
+
+        /* The chunks that are not tracks are written in front of their tracks, like for a file. */
+        const auto& chunks = snapshot._data->chunks;
+        StreamSink sink(output);
+        Encoder<StreamSink> encoder(sink);
+        size_t next = 0;
+
+        for (size_t i = 0; i < snapshot._data->tracks.size(); i++) {
+            for (; next < chunks.size() && chunks[next].first <= (int) i; next++)
+                encoder.write(chunks[next].second);
+
+            if (snapshot._data->tracks[i])
+                output << *snapshot._data->tracks[i];
+        }
+
+        for (; next < chunks.size(); next++)
+            encoder.write(chunks[next].second);
+
+        return output;
+    }
+
+    /**
+     * Constructor
+     * @param base The snapshot to start from.
+     */
+    SnapshotEditor::SnapshotEditor(const Snapshot& base) :
+        _header(base.getHeader()), _tracks(base._data->tracks), _owned(_tracks.size(), NULL), _chunks(base._data->chunks), _version(base.getVersion()) {}
+
+    /**
+     * Method to get a track without changing it.
+     * @param index The index of the track.
+     * @return const Track* The track, NULL if there is no track at the index.
+     */
+    const Track* SnapshotEditor::getTrack(int index) const {
+        if (index < 0 || index >= (int) _tracks.size())
+            return NULL;
+
+        return _tracks[index].get();
+    }
+
+    /**
+     * Method to get a track to change it.
+     * @param index The index of the track.
+     * @return Track* The track, NULL if the index is too large for the header.
+     */
+    Track* SnapshotEditor::editTrack(int index) {
+        /* We cannot create nor get a track from indexes the header cannot count. */
+        if (index >= 0xFFFF || index < 0)
+            return NULL;
+
+        if (index >= (int) _tracks.size()) {
+            _tracks.resize(index + 1);
+            _owned.resize(index + 1, NULL);
+        }
+
+        if (_owned[index] != NULL)
+            return _owned[index];
+
+        /* The track might be shared with snapshots, so the editor gets a copy of its own. */
+        Track *track = _tracks[index] ? new Track(*_tracks[index]) : new Track();
+        _tracks[index] = std::shared_ptr<const Track>(track);
+        _owned[index] = track;
+
+        return track;
+    }
+
+    /**
+     * Method to replace a track by a copy of another track.
+     * @param index The index of the track.
+     * @param track The track to copy.
+     * @return bool False if the index is too large for the header.
+     */
+    bool SnapshotEditor::setTrack(int index, const Track& track) {
+        if (index >= 0xFFFF || index < 0)
+            return false;
+
+        if (index >= (int) _tracks.size()) {
+            _tracks.resize(index + 1);
+            _owned.resize(index + 1, NULL);
+        }
+
+        Track *copy = new Track(track);
+        _tracks[index] = std::shared_ptr<const Track>(copy);
+        _owned[index] = copy;
+
+        return true;
+    }
+
+    /**
+     * Method to remove a track, leaving its slot empty.
+     * @param index The index of the track.
+     */
+    void SnapshotEditor::removeTrack(int index) {
+        if (index < 0 || index >= (int) _tracks.size())
+            return;
+
+        _tracks[index].reset();
+        _owned[index] = NULL;
+    }
+
+    /**
+     * Method to create the snapshot with the changes so far.
+     * @return Snapshot The new snapshot.
+     */
+    Snapshot SnapshotEditor::commit() {
+        std::shared_ptr<SnapshotData> data = std::make_shared<SnapshotData>();
+        data->header = _header;
+        data->tracks = _tracks;
+        data->chunks = _chunks;
+        data->version = _version + 1;
+
+        int count = 0;
+        for (const auto& track : _tracks)
+            count += track ? 1 : 0;
+
+        data->header.setNumTracks(count);
+
+        /* The edited tracks are shared with the snapshot now, so they are copied again
+         * when they are edited once more.
+         */
+        _owned.assign(_tracks.size(), NULL);
+        _version++;
+
+        return Snapshot(std::shared_ptr<const SnapshotData>(data));
+    }
+}
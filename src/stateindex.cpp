@@ -0,0 +1,315 @@
+/**
+ * stateindex.cpp
+ *
+ * File with implementations for the Midi::StateIndex class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/stateindex.h>
+#include <cppmidi/events/message.h>
+#include <cppmidi/events/meta.h>
+#include <algorithm>
+#include <cstring>
+
+using Midi::Events::Message;
+using Midi::Events::MessageType;
+using Midi::Events::Meta;
+using Midi::Events::MetaType;
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    const uint8_t ChannelState::UNSET;
+
+    /**
+     * The controllers that are restored before all the others, so the bank is selected before
+     * the program and the parameter before its data entry.
+     */
+    static const uint8_t FIRST_CONTROLLERS[] = { 0, 32, 98, 99, 100, 101 };
+
+    /**
+     * The controllers that are forgotten when all controllers are reset.
+     */
+    static const uint8_t RESET_CONTROLLERS[] = { 1, 11, 64, 65, 66, 67, 68, 69 };
+
+    /**
+     * Method to check whether an event is an end of track event.
+     * @param event The event.
+     * @return bool True if it is.
+     */
+    static bool isEnd(const Event *event) {
+        return event->getCategory() == CATEGORY_META && static_cast<const Meta*>(event)->getType() == MetaType::EOT;
+    }
+
+    /**
+     * Constructor which collects the changes of state of all the tracks in a file.
+     * @param file     The file to index.
+     * @param interval The amount of ticks between two checkpoints, 0 for every 16 quarter notes.
+     */
+    StateIndex::StateIndex(const File& file, uint32_t interval) : _interval(interval) {
+        /* With SMPTE timing, the upper byte is the negative frame rate and the lower byte the
+         * ticks per frame, and half a second counts as a quarter note.
+         */
+        if (_interval == 0) {
+            const uint16_t division = file.getHeader().getDeltaTicks();
+            const uint32_t perQuarter = (division & 0x8000) ? (-(int8_t) (division >> 8)) * (division & 0xFF) / 2 : division;
+            _interval = std::max<uint32_t>(1, 16 * perQuarter);
+        }
+
+        for (int i = 0; i < file.getTrackSlots(); i++) {
+            const Track *track = file.getTrack(i);
+            if (track == NULL)
+                continue;
+
+            uint32_t tick = 0;
+            for (auto event : track->getEvents()) {
+                tick += event->deltaTime.getValue();
+
+                if (event->getCategory() == CATEGORY_META) {
+                    const uint32_t tempo = static_cast<const Meta*>(event)->getTempo();
+                    if (tempo > 0)
+                        _changes.push_back({ tick, tempo, 0xFF });
+                }
+
+                /* Notes and note aftertouch are not state of the channel. */
+                else if (event->getCategory() == CATEGORY_MESSAGE) {
+                    const Message *msg = static_cast<const Message*>(event);
+                    if (msg->getType() >= MessageType::CONTROLLER)
+                        _changes.push_back({ tick, uint32_t(msg->getData2() << 8 | msg->getData1()), uint8_t(msg->getType() << 4 | msg->getChannel()) });
+                }
+            }
+        }
+
+        /* Stable, so changes on the same tick keep the order of their tracks. */
+        std::stable_sort(_changes.begin(), _changes.end(), [](const Change& a, const Change& b) {
+            return a.tick < b.tick;
+        });
+
+        Checkpoint checkpoint;
+        memset(checkpoint.state.channels, ChannelState::UNSET, sizeof(checkpoint.state.channels));
+        checkpoint.state.tempo = 0;
+        checkpoint.tick = 0;
+        checkpoint.position = 0;
+        _checkpoints.push_back(checkpoint);
+
+        /* A new checkpoint starts at the interval of every change that is past the last one. */
+        for (const auto& change : _changes) {
+            if (change.tick - checkpoint.tick >= _interval) {
+                checkpoint.tick = change.tick - change.tick % _interval;
+                _checkpoints.push_back(checkpoint);
+            }
+
+            apply(checkpoint.state, change);
+            checkpoint.position++;
+        }
+    }
+
+    /**
+     * Method to get the state after all the events before a tick.
+     * @param tick The absolute tick.
+     * @return SongState The state.
+     */
+    SongState StateIndex::stateAt(uint32_t tick) const {
+        /* The last checkpoint at or before the tick, and there always is one at tick 0. */
+        const Checkpoint& checkpoint = *(std::upper_bound(_checkpoints.begin(), _checkpoints.end(), tick, [](uint32_t tick, const Checkpoint& checkpoint) {
+            return tick < checkpoint.tick;
+        }) - 1);
+        SongState state = checkpoint.state;
+
+        for (size_t i = checkpoint.position; i < _changes.size() && _changes[i].tick < tick; i++)
+            apply(state, _changes[i]);
+
+        return state;
+    }
+
+    /**
+     * Method to copy the events in [from, to) of a file into a new file with chased state.
+     * @param file   The file the index was built from.
+     * @param from   The first tick of the range.
+     * @param to     The first tick after the range.
+     * @param output The file to fill, which is cleared first.
+     * @return bool False if the file is of format 2.
+     */
+    bool StateIndex::extract(const File& file, uint32_t from, uint32_t to, File& output) const {
+        if (file.getHeader().getFileFormat() == MULTITRACK_ASYNC)
+            return false;
+
+        std::vector<const Track*> sources;
+        uint32_t end = 0;
+
+        for (int i = 0; i < file.getTrackSlots(); i++) {
+            const Track *track = file.getTrack(i);
+            if (track == NULL)
+                continue;
+
+            uint32_t tick = 0;
+            for (auto event : track->getEvents())
+                tick += event->deltaTime.getValue();
+
+            end = std::max(end, tick);
+            sources.push_back(track);
+        }
+
+        /* Every track ends where the range ends, or where the file ends if that is earlier. */
+        const uint32_t length = std::max(from, std::min(to, end)) - from;
+
+        output.clear();
+        output.getHeader().setFileFormat(file.getHeader().getFileFormat() == SINGLETRACK ? SINGLETRACK : MULTITRACK_SYNC);
+        output.getHeader().setDeltaTicks(file.getHeader().getDeltaTicks());
+
+        /* Every channel is restored on the first track that has messages on it. */
+        bool restored[16] = { false };
+        const SongState state = stateAt(from);
+
+        /* The amount of open notes per channel and pitch. */
+        uint16_t open[16 * 128];
+
+        for (size_t t = 0; t < sources.size(); t++) {
+            Track *track = output.getTrack();
+
+            bool channels[16] = { false };
+            for (uint8_t channel = 0; channel < 16; channel++) {
+                if (!restored[channel] && !sources[t]->getIndex().get(channel).empty())
+                    channels[channel] = restored[channel] = true;
+            }
+
+            restore(state, channels, t == 0, *track);
+            memset(open, 0, sizeof(open));
+
+            uint32_t tick = 0, last = 0;
+            for (auto event : sources[t]->getEvents()) {
+                tick += event->deltaTime.getValue();
+
+                if (tick >= to)
+                    break;
+
+                if (tick < from || isEnd(event))
+                    continue;
+
+                if (event->getCategory() == CATEGORY_MESSAGE) {
+                    const Message *msg = static_cast<const Message*>(event);
+                    const uint16_t slot = msg->getChannel() << 7 | msg->getData1();
+
+                    if (msg->getType() == MessageType::NOTE_ON && msg->getData2() > 0)
+                        open[slot]++;
+
+                    /* A note off without a note on in the range belongs to a note that is not copied. */
+                    else if (msg->getType() == MessageType::NOTE_ON || msg->getType() == MessageType::NOTE_OFF) {
+                        if (open[slot] == 0)
+                            continue;
+
+                        open[slot]--;
+                    }
+                }
+
+                /* The delta time changes the length of the event, so it is set before adding. */
+                Event *copy = event->clone();
+                copy->deltaTime = tick - from - last;
+                last = tick - from;
+
+                track->addEvent(copy);
+            }
+
+            for (uint16_t slot = 0; slot < 16 * 128; slot++) {
+                for (; open[slot] > 0; open[slot]--) {
+                    Message *off = new Message(MessageType::NOTE_OFF, slot >> 7, slot & 0x7F, 0);
+                    off->deltaTime = length - last;
+                    last = length;
+
+                    track->addEvent(off);
+                }
+            }
+
+            Meta *eot = new Meta(MetaType::EOT);
+            eot->deltaTime = length - last;
+            track->addEvent(eot);
+        }
+
+        return true;
+    }
+
+    /**
+     * Method to apply a change to a state.
+     * @param state  The state.
+     * @param change The change.
+     */
+    void StateIndex::apply(SongState& state, const Change& change) {
+        if (change.status == 0xFF) {
+            state.tempo = change.value;
+            return;
+        }
+
+        ChannelState& channel = state.channels[change.status & 0x0F];
+        const uint8_t data1 = change.value & 0x7F, data2 = (change.value >> 8) & 0x7F;
+
+        switch (change.status >> 4) {
+        case MessageType::CONTROLLER:
+            /* Data increments and decrements only make sense relative to what came before. */
+            if (data1 == 96 || data1 == 97)
+                break;
+
+            if (data1 < 120)
+                channel.controllers[data1] = data2;
+
+            else if (data1 == 121) {
+                for (auto controller : RESET_CONTROLLERS)
+                    channel.controllers[controller] = ChannelState::UNSET;
+
+                channel.pressure = channel.bendLow = channel.bendHigh = ChannelState::UNSET;
+            }
+
+            break;
+        case MessageType::PROGRAM_CHANGE:
+            channel.program = data1;
+            break;
+        case MessageType::CHANNEL_AFTERTOUCH:
+            channel.pressure = data1;
+            break;
+        case MessageType::PITCH_BEND:
+            channel.bendLow = data1;
+            channel.bendHigh = data2;
+            break;
+        }
+    }
+
+    /**
+     * Method to append the events that restore a state to a track, all at tick 0.
+     * @param state    The state.
+     * @param channels Which channels to restore on this track.
+     * @param tempo    Whether to restore the tempo on this track.
+     * @param track    The track.
+     */
+    void StateIndex::restore(const SongState& state, const bool *channels, bool tempo, Track& track) {
+        if (tempo && state.tempo > 0)
+            track.addEvent(new Meta(Meta::tempo(state.tempo)));
+
+        for (uint8_t c = 0; c < 16; c++) {
+            if (!channels[c])
+                continue;
+
+            const ChannelState& channel = state.channels[c];
+
+            const uint8_t *first = FIRST_CONTROLLERS, *rest = FIRST_CONTROLLERS + sizeof(FIRST_CONTROLLERS);
+            for (auto controller : FIRST_CONTROLLERS) {
+                if (channel.controllers[controller] != ChannelState::UNSET)
+                    track.addEvent(new Message(MessageType::CONTROLLER, c, controller, channel.controllers[controller]));
+            }
+
+            for (uint8_t controller = 0; controller < 120; controller++) {
+                if (channel.controllers[controller] != ChannelState::UNSET && std::find(first, rest, controller) == rest)
+                    track.addEvent(new Message(MessageType::CONTROLLER, c, controller, channel.controllers[controller]));
+            }
+
+            if (channel.program != ChannelState::UNSET)
+                track.addEvent(new Message(MessageType::PROGRAM_CHANGE, c, channel.program, 0));
+
+            if (channel.pressure != ChannelState::UNSET)
+                track.addEvent(new Message(MessageType::CHANNEL_AFTERTOUCH, c, channel.pressure, 0));
+
+            if (channel.bendLow != ChannelState::UNSET)
+                track.addEvent(new Message(MessageType::PITCH_BEND, c, channel.bendLow, channel.bendHigh));
+        }
+    }
+}
@@ -0,0 +1,236 @@
+/**
+ * statistics.cpp
+ *
+ * File with implementations for the Midi::Statistics class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/statistics.h>
+#include <cppmidi/noteindex.h>
+#include <cppmidi/events/message.h>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+using Midi::Events::MessageType;
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    const size_t Statistics::DURATION_BUCKETS;
+    const size_t Statistics::POLYPHONY_LEVELS;
+
+    /**
+     * Default constructor, for statistics without any files.
+     */
+    Statistics::Statistics() : files(0), events(0), notes(0), quarters(0), maxPolyphony(0) {
+        memset(pitchClasses, 0, sizeof(pitchClasses));
+        memset(velocities, 0, sizeof(velocities));
+        memset(durations, 0, sizeof(durations));
+        memset(channelMessages, 0, sizeof(channelMessages));
+        memset(channelNotes, 0, sizeof(channelNotes));
+        std::fill(polyphony, polyphony + POLYPHONY_LEVELS, 0.0);
+    }
+
+    /**
+     * Method to add the statistics of the columns of a file.
+     * @param columns The columns.
+     */
+    void Statistics::add(const EventColumns& columns) {
+        std::vector<std::pair<size_t, size_t>> tracks;
+        for (size_t t = 0; t < columns.tracks(); t++)
+            tracks.push_back(std::make_pair(columns.trackBegin[t], columns.trackBegin[t + 1] - columns.trackBegin[t]));
+
+        add(columns.division, columns.ticks.data(), columns.status.data(), columns.data1.data(), columns.data2.data(), tracks);
+    }
+
+    /**
+     * Method to add the statistics of a cached file.
+     * @param view The opened cache.
+     */
+    void Statistics::add(const CacheView& view) {
+        std::vector<std::pair<size_t, size_t>> tracks;
+        for (size_t t = 0; t < view.getTrackCount(); t++)
+            tracks.push_back(std::make_pair(view.getTrack(t).first, view.getTrack(t).count));
+
+        add(view.getHeader().division, view.getTicks(), view.getStatus(), view.getData1(), view.getData2(), tracks);
+    }
+
+    /**
+     * Method to add the statistics that were collected by somebody else.
+     * @param other The other statistics.
+     */
+    void Statistics::merge(const Statistics& other) {
+        files += other.files;
+        events += other.events;
+        notes += other.notes;
+        quarters += other.quarters;
+        maxPolyphony = std::max(maxPolyphony, other.maxPolyphony);
+
+        for (size_t i = 0; i < 12; i++)
+            pitchClasses[i] += other.pitchClasses[i];
+
+        for (size_t i = 0; i < 128; i++)
+            velocities[i] += other.velocities[i];
+
+        for (size_t i = 0; i < DURATION_BUCKETS; i++)
+            durations[i] += other.durations[i];
+
+        for (size_t i = 0; i < POLYPHONY_LEVELS; i++)
+            polyphony[i] += other.polyphony[i];
+
+        for (size_t i = 0; i < 16; i++) {
+            channelMessages[i] += other.channelMessages[i];
+            channelNotes[i] += other.channelNotes[i];
+        }
+    }
+
+    /**
+     * Method to get the average amount of notes that sound at the same time.
+     * @return double The average polyphony.
+     */
+    double Statistics::getAveragePolyphony() const {
+        double total = 0, weighted = 0;
+
+        for (size_t i = 0; i < POLYPHONY_LEVELS; i++) {
+            total += polyphony[i];
+            weighted += polyphony[i] * i;
+        }
+
+        return total > 0 ? weighted / total : 0;
+    }
+
+    /**
+     * Method to add the statistics of a file stored in columns.
+     * @param division The division from the header.
+     * @param ticks    The absolute ticks of the events.
+     * @param status   The status bytes.
+     * @param data1    The first data bytes.
+     * @param data2    The second data bytes.
+     * @param tracks   The first event and the amount of events of every track.
+     */
+    void Statistics::add(uint16_t division, const uint32_t *ticks, const uint8_t *status, const uint8_t *data1, const uint8_t *data2,
+                         const std::vector<std::pair<size_t, size_t>>& tracks) {
+        /* With SMPTE timing, the upper byte is the negative frame rate and the lower byte the ticks per frame. */
+        double perQuarter = division;
+        if (division & 0x8000)
+            perQuarter = (-(int8_t) (division >> 8)) * (division & 0xFF) / 2.0;
+
+        if (perQuarter <= 0)
+            perQuarter = 1;
+
+        /* The start and end of every note, for the polyphony afterwards. */
+        std::vector<uint32_t> starts, ends;
+        uint32_t last = 0;
+
+        /* The notes are paired exactly like in the NoteIndex. */
+        NotePairer pairer;
+        std::vector<uint8_t> closed;
+
+        for (const auto& track : tracks) {
+            pairer.reset();
+
+            const size_t first = starts.size();
+            const size_t end = track.first + track.second;
+            closed.clear();
+
+            for (size_t i = track.first; i < end; i++) {
+                /* Meta and sysex events are not channel messages. */
+                if (status[i] >= 0xF0)
+                    continue;
+
+                const uint8_t type = status[i] >> 4;
+                const uint8_t channel = status[i] & 0x0F;
+                channelMessages[channel]++;
+
+                if (type != MessageType::NOTE_ON && type != MessageType::NOTE_OFF)
+                    continue;
+
+                if (type == MessageType::NOTE_ON && data2[i] > 0) {
+                    channelNotes[channel]++;
+                    pitchClasses[(data1[i] & 0x7F) % 12]++;
+                    velocities[data2[i] & 0x7F]++;
+
+                    pairer.open(channel, data1[i]);
+                    starts.push_back(ticks[i]);
+                    ends.push_back(0);
+                    closed.push_back(0);
+                    continue;
+                }
+
+                const int32_t local = pairer.close(channel, data1[i]);
+                if (local < 0)
+                    continue;
+
+                ends[first + local] = ticks[i];
+                closed[local] = 1;
+            }
+
+            /* Notes that are still open end at the end of the track. */
+            const uint32_t trackEnd = track.second > 0 ? ticks[end - 1] : 0;
+            for (size_t local = 0; local < closed.size(); local++) {
+                if (!closed[local])
+                    ends[first + local] = trackEnd;
+            }
+
+            last = std::max(last, trackEnd);
+        }
+
+        for (size_t i = 0; i < starts.size(); i++) {
+            const double length = (double) (ends[i] - starts[i]) * 8 / perQuarter;
+            const size_t bucket = length < 1 ? 0 : std::min<size_t>(1 + std::ilogb(length), DURATION_BUCKETS - 1);
+            durations[bucket]++;
+        }
+
+        std::sort(starts.begin(), starts.end());
+        std::sort(ends.begin(), ends.end());
+
+        /* Sweeping through the starts and ends in order, where notes that end on a tick stop
+         * sounding before the notes that start on it.
+         */
+        uint64_t sounding[POLYPHONY_LEVELS] = { 0 };
+        int64_t level = 0;
+        uint32_t previous = 0;
+        size_t s = 0, e = 0;
+
+        while (s < starts.size() || e < ends.size()) {
+            const bool ending = e < ends.size() && (s == starts.size() || ends[e] <= starts[s]);
+            const uint32_t tick = ending ? ends[e] : starts[s];
+
+            /* Between two different ticks all the changes of the first were done, so the level is
+             * valid. Within a tick it is not, since a note without length ends before it starts.
+             */
+            if (tick > previous) {
+                sounding[std::min<int64_t>(level, POLYPHONY_LEVELS - 1)] += tick - previous;
+                maxPolyphony = std::max<uint32_t>(maxPolyphony, level);
+            }
+
+            previous = tick;
+
+            if (ending) {
+                level--;
+                e++;
+            }
+            else {
+                level++;
+                s++;
+            }
+        }
+
+        sounding[0] += last - std::min(last, previous);
+
+        for (size_t i = 0; i < POLYPHONY_LEVELS; i++)
+            polyphony[i] += sounding[i] / perQuarter;
+
+        size_t total = 0;
+        for (const auto& track : tracks)
+            total += track.second;
+
+        files++;
+        events += total;
+        notes += starts.size();
+        quarters += last / perQuarter;
+    }
+}
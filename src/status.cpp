@@ -0,0 +1,49 @@
+/**
+ * status.cpp
+ *
+ * File with implementations for the Midi::Status class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/status.h>
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    /**
+     * Method to get a human readable description of an error code.
+     * @param code The error code.
+     * @return const char* The description.
+     */
+    const char* Status::describe(ErrorCode code) {
+        switch (code) {
+            case ERROR_NONE:            return "No error";
+            case ERROR_TRUNCATED:       return "Unexpected end of input";
+            case ERROR_HEADER_MAGIC:    return "Bad header magic";
+            case ERROR_HEADER_LENGTH:   return "Bad header length";
+            case ERROR_HEADER_FORMAT:   return "Bad file format or division in header";
+            case ERROR_CHUNK_MAGIC:     return "Bad chunk magic";
+            case ERROR_CHUNK_LENGTH:    return "Chunk length runs past the end of the input";
+            case ERROR_VLVALUE:         return "Variable length value longer than 4 bytes";
+            case ERROR_DATA_BYTE:       return "Data byte with the high bit set";
+            case ERROR_STATUS_BYTE:     return "Unknown status byte or running status without status";
+            case ERROR_EVENT_OVERRUN:   return "Event runs past the end of its track";
+            case ERROR_MISSING_EOT:     return "Track does not end with an end of track event";
+            case ERROR_EVENT_AFTER_EOT: return "Event after the end of track event";
+            case ERROR_IO:              return "Reading or writing failed";
+            case ERROR_CACHE_FORMAT:    return "Not a cache, or a damaged cache";
+            case ERROR_CACHE_VERSION:   return "Cache of another version or byte order";
+            case ERROR_ARCHIVE_FORMAT:  return "Not an archive, or a damaged archive";
+            case ERROR_LIMIT_BYTES:     return "Input is larger than allowed";
+            case ERROR_LIMIT_EVENTS:    return "Track has more events than allowed";
+            case ERROR_LIMIT_PAYLOAD:   return "Meta or sysex payload is larger than allowed";
+            case ERROR_LIMIT_MEMORY:    return "Decoding would use more memory than allowed";
+            case ERROR_TRACK_LENGTH:    return "Track is too long to be written in a chunk";
+            case ERROR_LIMIT_DURATION:  return "Audio would be longer than allowed";
+        }
+
+        return "Unknown error";
+    }
+}
@@ -0,0 +1,235 @@
+/**
+ * streamwriter.cpp
+ *
+ * File with implementations for the Midi::StreamWriter class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/streamwriter.h>
+#include <cppmidi/track.h>
+#include <cppmidi/endian.h>
+#include <cppmidi/encoder.h>
+#include <cppmidi/events/meta.h>
+#include <vector>
+#include <algorithm>
+
+using Midi::Events::Meta;
+using Midi::Events::MetaType;
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    /**
+     * The stream buffer which collects the encoded events in a block of a fixed size, and
+     * writes the block to the output whenever it is full.
+     */
+    class StreamBlock : public std::streambuf {
+        public:
+            /**
+             * Constructor
+             * @param output The output stream.
+             * @param size   The size of the block.
+             */
+            StreamBlock(std::ostream& output, size_t size) : _output(output), _block(std::max<size_t>(size, 16)) {
+                setp(_block.data(), _block.data() + _block.size());
+            }
+
+            /**
+             * Destructor
+             */
+            virtual ~StreamBlock() {}
+
+            /**
+             * Method to write the bytes in the block to the output.
+             * @return bool False if writing failed.
+             */
+            bool flush() {
+                if (pptr() > pbase())
+                    _output.write(pbase(), pptr() - pbase());
+
+                setp(_block.data(), _block.data() + _block.size());
+                return (bool) _output;
+            }
+
+        protected:
+            /**
+             * Method which is called when the block is full.
+             * @param c The character that did not fit, or eof.
+             * @return int_type Something else than eof on success.
+             */
+            virtual int_type overflow(int_type c) {
+                if (!flush())
+                    return traits_type::eof();
+
+                if (c != traits_type::eof()) {
+                    *pptr() = c;
+                    pbump(1);
+                }
+
+                return traits_type::not_eof(c);
+            }
+
+            /**
+             * Method which is called when the stream is flushed.
+             * @return int 0 on success, -1 on failure.
+             */
+            virtual int sync() {
+                return flush() ? 0 : -1;
+            }
+
+        private:
+            /**
+             * The output stream.
+             * @var std::ostream&
+             */
+            std::ostream& _output;
+
+            /**
+             * The block.
+             * @var std::vector<char>
+             */
+            std::vector<char> _block;
+    };
+
+    /**
+     * Constructor, which writes the header.
+     * @param output    The output stream, which should be seekable and in binary mode.
+     * @param format    The format of the file.
+     * @param division  The amount of ticks per quarter note, or the SMPTE division.
+     * @param blockSize The size in bytes of the block the events are encoded into.
+     */
+    StreamWriter::StreamWriter(std::ostream& output, MidiMode format, uint16_t division, size_t blockSize) :
+        _output(output), _block(new StreamBlock(output, blockSize)), _stream(new std::ostream(_block.get())),
+        _start(output.tellp()), _format(format), _size(0), _tracks(0), _trackOffset(0), _trackLength(0),
+        _open(false), _ended(false), _closed(false) {
+
+        /* The amount of tracks is filled in when closing. */
+        Header header;
+        header.setFileFormat(format);
+        header.setDeltaTicks(division);
+        header.setNumTracks(0);
+
+        *_stream << header;
+        _size = 14;
+    }
+
+    /**
+     * Destructor, which closes the file if that was not done yet.
+     */
+    StreamWriter::~StreamWriter() {
+        close();
+    }
+
+    /**
+     * Method to start a new track.
+     * @return bool False if the file was closed, writing failed, or the format or header
+     *              do not allow another track.
+     */
+    bool StreamWriter::beginTrack() {
+        if (_closed || !*_stream)
+            return false;
+
+        /* Checking first, so the current track stays open if no track can follow it. */
+        if (_tracks == 0xFFFF || (_format == SINGLETRACK && _tracks == 1))
+            return false;
+
+        if (_open && !endTrack())
+            return false;
+
+        /* The length is filled in when the track is finished. */
+        _stream->write(Track::IDENTIFIER, 4);
+        Endian::writeIntBig(*_stream, 0);
+
+        _trackOffset = _size;
+        _trackLength = 0;
+        _size += 8;
+        _tracks++;
+        _open = true;
+        _ended = false;
+
+        return (bool) *_stream;
+    }
+
+    /**
+     * Method to add an event to the current track.
+     * @param event The event, with its delta time.
+     * @return bool False if there is no track, the track was ended with an end of track
+     *              event already, it would become too long, or writing failed.
+     */
+    bool StreamWriter::write(const Event& event) {
+        if (!_open || _ended || !*_stream)
+            return false;
+
+        const uint64_t length = CountingSink::measure(event);
+        if (_trackLength + length > 0xFFFFFFFF)
+            return false;
+
+        StreamSink sink(*_stream);
+        Encoder<StreamSink>(sink).write(event);
+
+        _trackLength += length;
+        _size += length;
+        _ended = event.getCategory() == CATEGORY_META && static_cast<const Meta&>(event).getType() == MetaType::EOT;
+
+        return (bool) *_stream;
+    }
+
+    /**
+     * Method to finish the current track.
+     * @return bool False if there is no track or writing failed.
+     */
+    bool StreamWriter::endTrack() {
+        if (!_open)
+            return false;
+
+        if (!_ended && !write(Meta(MetaType::EOT)))
+            return false;
+
+        _open = false;
+        return patch(_trackOffset + 4, _trackLength, 4);
+    }
+
+    /**
+     * Method to finish the file.
+     * @return bool False if writing failed.
+     */
+    bool StreamWriter::close() {
+        if (_closed)
+            return (bool) _output;
+
+        if (_open)
+            endTrack();
+
+        _closed = true;
+
+        if (!patch(10, _tracks, 2))
+            return false;
+
+        return (bool) _output.flush();
+    }
+
+    /**
+     * Method to fill in a big endian value that was written before.
+     * @param offset The offset of the value, relative to the start of the file.
+     * @param value  The value.
+     * @param size   The amount of bytes, 2 or 4.
+     * @return bool False if writing failed.
+     */
+    bool StreamWriter::patch(uint64_t offset, uint32_t value, size_t size) {
+        /* The value might still be in the block. */
+        if (!_block->flush())
+            return false;
+
+        _output.seekp(_start + (std::streamoff) offset);
+
+        if (size == 2)
+            Endian::writeShortBig(_output, value);
+        else
+            Endian::writeIntBig(_output, value);
+
+        _output.seekp(_start + (std::streamoff) _size);
+        return (bool) _output;
+    }
+}
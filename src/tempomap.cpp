@@ -0,0 +1,179 @@
+/**
+ * tempomap.cpp
+ *
+ * File with implementations for the Midi::TempoMap class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/tempomap.h>
+#include <cppmidi/events/meta.h>
+#include <algorithm>
+
+using Midi::Events::Meta;
+using Midi::Events::MetaType;
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    const uint32_t TempoMap::DEFAULT_TEMPO;
+
+    /**
+     * Constructor for a map without tempo changes.
+     * @param division The division from the header of the file.
+     */
+    TempoMap::TempoMap(uint16_t division) : _division(division) {
+        update();
+    }
+
+    /**
+     * Constructor which collects the tempo changes from all the tracks of a file.
+     * @param file The file.
+     */
+    TempoMap::TempoMap(const File& file) : _division(file.getHeader().getDeltaTicks()) {
+        for (int i = 0; i < file.getTrackSlots(); i++) {
+            const Track *track = file.getTrack(i);
+            if (track == NULL)
+                continue;
+
+            uint32_t tick = 0;
+            for (auto event : track->getEvents()) {
+                tick += event->deltaTime.getValue();
+
+                if (event->getCategory() != CATEGORY_META)
+                    continue;
+
+                const Meta *meta = static_cast<const Meta*>(event);
+                if (meta->getType() == MetaType::TEMPO && meta->getTempo() > 0)
+                    _changes.push_back({ tick, meta->getTempo(), 0 });
+            }
+        }
+
+        update();
+    }
+
+    /**
+     * Constructor from tempo changes that were computed before.
+     * @param division The division from the header of the file.
+     * @param changes  The tempo changes, sorted on tick.
+     * @param count    The amount of tempo changes.
+     */
+    TempoMap::TempoMap(uint16_t division, const TempoChange *changes, size_t count) :
+        _division(division), _changes(changes, changes + count) {
+        update();
+    }
+
+    /**
+     * Method to add a tempo change.
+     * @param tick  The absolute tick.
+     * @param tempo The tempo in microseconds per quarter note.
+     */
+    void TempoMap::add(uint32_t tick, uint32_t tempo) {
+        _changes.push_back({ tick, tempo, 0 });
+        update();
+    }
+
+    /**
+     * Method to convert an absolute tick into microseconds since the start.
+     * @param tick The absolute tick.
+     * @return uint64_t The time in microseconds.
+     */
+    uint64_t TempoMap::toMicroseconds(uint32_t tick) const {
+        const TempoChange& change = find(tick);
+        return change.microseconds + duration(tick - change.tick, change.tempo);
+    }
+
+    /**
+     * Method to convert a time into the last tick at or before it.
+     * @param microseconds The time in microseconds since the start.
+     * @return uint32_t The absolute tick.
+     */
+    uint32_t TempoMap::toTick(uint64_t microseconds) const {
+        auto it = std::upper_bound(_changes.begin(), _changes.end(), microseconds, [](uint64_t us, const TempoChange& change) {
+            return us < change.microseconds;
+        });
+
+        const TempoChange& change = *(it - 1);
+        const uint64_t elapsed = microseconds - change.microseconds;
+
+        /* The inverse of duration(), rounding down so the tick is never after the time. */
+        uint64_t ticks;
+        if (_division & 0x8000) {
+            const uint64_t perSecond = (uint64_t) (-(int8_t) (_division >> 8)) * (_division & 0xFF);
+            ticks = elapsed * perSecond / 1000000;
+        }
+        else {
+            ticks = elapsed * _division / change.tempo;
+        }
+
+        const uint64_t tick = change.tick + ticks;
+        return tick > 0xFFFFFFFF ? 0xFFFFFFFF : tick;
+    }
+
+    /**
+     * Method to get the tempo at a tick.
+     * @param tick The absolute tick.
+     * @return uint32_t The tempo in microseconds per quarter note.
+     */
+    uint32_t TempoMap::getTempo(uint32_t tick) const {
+        return find(tick).tempo;
+    }
+
+    /**
+     * Method to find the last change at or before a tick.
+     * @param tick The absolute tick.
+     * @return const TempoChange& The change.
+     */
+    const TempoChange& TempoMap::find(uint32_t tick) const {
+        auto it = std::upper_bound(_changes.begin(), _changes.end(), tick, [](uint32_t t, const TempoChange& change) {
+            return t < change.tick;
+        });
+
+        /* There is always a change at tick 0, so this never goes before the first. */
+        return *(it - 1);
+    }
+
+    /**
+     * Method to convert an amount of ticks into microseconds at a tempo.
+     * @param ticks The amount of ticks.
+     * @param tempo The tempo.
+     * @return uint64_t The amount of microseconds.
+     */
+    uint64_t TempoMap::duration(uint64_t ticks, uint32_t tempo) const {
+        /* With SMPTE timing, the upper byte is the negative frame rate and the lower byte the
+         * ticks per frame, and the tempo does not matter at all.
+         */
+        if (_division & 0x8000) {
+            const uint64_t perSecond = (uint64_t) (-(int8_t) (_division >> 8)) * (_division & 0xFF);
+            return perSecond ? ticks * 1000000 / perSecond : 0;
+        }
+
+        return _division ? ticks * tempo / _division : 0;
+    }
+
+    /**
+     * Method which sorts the changes and computes their times.
+     */
+    void TempoMap::update() {
+        /* Changes on the same tick keep their order, so the last one wins. */
+        std::stable_sort(_changes.begin(), _changes.end(), [](const TempoChange& a, const TempoChange& b) {
+            return a.tick < b.tick;
+        });
+
+        if (_changes.empty() || _changes.front().tick != 0)
+            _changes.insert(_changes.begin(), { 0, DEFAULT_TEMPO, 0 });
+
+        /* A tempo of zero would stop time, which no player does either. */
+        for (auto& change : _changes) {
+            if (change.tempo == 0)
+                change.tempo = DEFAULT_TEMPO;
+        }
+
+        _changes.front().microseconds = 0;
+        for (size_t i = 1; i < _changes.size(); i++) {
+            const TempoChange& previous = _changes[i - 1];
+            _changes[i].microseconds = previous.microseconds + duration(_changes[i].tick - previous.tick, previous.tempo);
+        }
+    }
+}
@@ -0,0 +1,160 @@
+/**
+ * threadpool.cpp
+ *
+ * File with implementations for the Midi::ThreadPool class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/threadpool.h>
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    /**
+     * The pool and index of the worker running on the current thread, so tasks submitted
+     * from inside a task end up in the queue of that worker.
+     */
+    static thread_local ThreadPool *currentPool = NULL;
+    static thread_local unsigned currentIndex = 0;
+
+    /**
+     * Constructor, which starts the workers.
+     * @param threads The amount of workers, 0 for one per hardware thread.
+     */
+    ThreadPool::ThreadPool(unsigned threads) : _queued(0), _pending(0), _next(0), _stopping(false) {
+        if (threads == 0)
+            threads = std::thread::hardware_concurrency();
+
+        /* The hardware concurrency might be unknown. */
+        if (threads == 0)
+            threads = 1;
+
+        for (unsigned i = 0; i < threads; i++)
+            _queues.emplace_back(new Queue());
+
+        for (unsigned i = 0; i < threads; i++)
+            _threads.emplace_back(&ThreadPool::run, this, i);
+    }
+
+    /**
+     * Destructor, which waits for all the tasks to finish and stops the workers.
+     */
+    ThreadPool::~ThreadPool() {
+        wait();
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stopping = true;
+        }
+
+        _available.notify_all();
+
+        for (auto& thread : _threads)
+            thread.join();
+    }
+
+    /**
+     * Method to add a task to the pool.
+     * @param task The task to run.
+     */
+    void ThreadPool::submit(const std::function<void()>& task) {
+        /* Tasks from our own workers stay local, others are spread round robin. */
+        const unsigned index = currentPool == this ? currentIndex : _next++ % _queues.size();
+
+        /* Counting first, since a worker that is awake already may take and finish the task
+         * as soon as it is in the queue, and wait() may not return before it did.
+         */
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _queued++;
+            _pending++;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_queues[index]->mutex);
+            _queues[index]->tasks.push_back(task);
+        }
+
+        _available.notify_one();
+    }
+
+    /**
+     * Method which blocks until all the submitted tasks have finished.
+     */
+    void ThreadPool::wait() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _idle.wait(lock, [this]() { return _pending == 0; });
+    }
+
+    /**
+     * Method which is run by every worker.
+     * @param index The index of the worker.
+     */
+    void ThreadPool::run(unsigned index) {
+        currentPool = this;
+        currentIndex = index;
+
+        std::function<void()> task;
+
+        while (true) {
+            if (take(index, task)) {
+                task();
+                task = nullptr;
+
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (--_pending == 0)
+                    _idle.notify_all();
+
+                continue;
+            }
+
+            /* Nothing to do anywhere, so sleep until something is submitted. Since the counter
+             * is changed under the same mutex, no wake up can be missed.
+             */
+            std::unique_lock<std::mutex> lock(_mutex);
+            _available.wait(lock, [this]() { return _queued > 0 || _stopping; });
+
+            if (_stopping && _queued == 0)
+                return;
+        }
+    }
+
+    /**
+     * Method to take a task, from the own queue first and otherwise from another.
+     * @param index The index of the worker.
+     * @param task  The task that was taken.
+     * @return bool True if a task was found.
+     */
+    bool ThreadPool::take(unsigned index, std::function<void()>& task) {
+        const size_t count = _queues.size();
+
+        for (size_t i = 0; i < count; i++) {
+            Queue& queue = *_queues[(index + i) % count];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+
+            if (queue.tasks.empty())
+                continue;
+
+            /* The own queue is used as a stack since its tasks are still warm in the cache,
+             * while stealing takes the oldest task, which is usually the largest.
+             */
+            if (i == 0) {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+            else {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+
+            std::lock_guard<std::mutex> counter(_mutex);
+            _queued--;
+
+            return true;
+        }
+
+        return false;
+    }
+}
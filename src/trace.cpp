@@ -0,0 +1,251 @@
+/**
+ * trace.cpp
+ *
+ * File with implementations for the Midi::Trace class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/trace.h>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+#include <unistd.h>
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    std::atomic<bool> Trace::_active(false);
+
+    /**
+     * A single recorded span.
+     */
+    struct TraceRecord {
+        /**
+         * The name.
+         * @var const char*
+         */
+        const char *name;
+
+        /**
+         * The start and end time in nanoseconds, and the amount of bytes.
+         * @var uint64_t
+         */
+        uint64_t begin, end, bytes;
+    };
+
+    /**
+     * The spans of a single thread. Only that thread adds to it, so the lock is only ever
+     * contended while the spans are written or cleared.
+     */
+    struct TraceBuffer {
+        /**
+         * The lock for the records.
+         * @var std::mutex
+         */
+        std::mutex mutex;
+
+        /**
+         * The records, in the order the spans ended.
+         * @var std::vector<TraceRecord>
+         */
+        std::vector<TraceRecord> records;
+
+        /**
+         * The number of the thread in the trace.
+         * @var uint32_t
+         */
+        uint32_t thread;
+    };
+
+    /**
+     * The buffers of all the threads that ever recorded a span, which are kept after their
+     * threads finished, so their spans can still be written.
+     */
+    struct TraceRegistry {
+        /**
+         * The lock for the buffers.
+         * @var std::mutex
+         */
+        std::mutex mutex;
+
+        /**
+         * The buffers.
+         * @var std::vector<std::shared_ptr<TraceBuffer>>
+         */
+        std::vector<std::shared_ptr<TraceBuffer>> buffers;
+    };
+
+    /**
+     * Method to get the registry, which is created the first time it is needed.
+     * @return TraceRegistry& The registry.
+     */
+    static TraceRegistry& registry() {
+        static TraceRegistry registry;
+        return registry;
+    }
+
+    /**
+     * Method to get the buffer of the calling thread, which is registered the first time.
+     * @return TraceBuffer& The buffer.
+     */
+    static TraceBuffer& local() {
+        thread_local std::shared_ptr<TraceBuffer> buffer;
+
+        if (!buffer) {
+            buffer = std::make_shared<TraceBuffer>();
+
+            TraceRegistry& all = registry();
+            std::lock_guard<std::mutex> lock(all.mutex);
+
+            buffer->thread = all.buffers.size() + 1;
+            all.buffers.push_back(buffer);
+        }
+
+        return *buffer;
+    }
+
+    /**
+     * Method to write a time in nanoseconds as microseconds, which the trace format uses.
+     * @param output The output stream.
+     * @param time   The time in nanoseconds.
+     */
+    static void writeTime(std::ostream& output, uint64_t time) {
+        const uint64_t fraction = time % 1000;
+        output << time / 1000 << '.' << fraction / 100 << fraction / 10 % 10 << fraction % 10;
+    }
+
+    /**
+     * Method to get the current time of the clock the spans use.
+     * @return uint64_t The time in nanoseconds.
+     */
+    uint64_t Trace::now() {
+        /* Never 0, which a span uses to tell that it was not started. */
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() | 1;
+    }
+
+    /**
+     * Method to record a span on the calling thread.
+     * @param name  The name.
+     * @param begin The start time.
+     * @param end   The end time.
+     * @param bytes The amount of bytes that were handled.
+     */
+    void Trace::record(const char *name, uint64_t begin, uint64_t end, uint64_t bytes) {
+        TraceBuffer& buffer = local();
+
+        std::lock_guard<std::mutex> lock(buffer.mutex);
+        buffer.records.push_back({ name, begin, end, bytes });
+    }
+
+    /**
+     * Method to get the amount of recorded spans.
+     * @return size_t The amount of spans.
+     */
+    size_t Trace::size() {
+        TraceRegistry& all = registry();
+        std::lock_guard<std::mutex> lock(all.mutex);
+
+        size_t total = 0;
+        for (auto& buffer : all.buffers) {
+            std::lock_guard<std::mutex> guard(buffer->mutex);
+            total += buffer->records.size();
+        }
+
+        return total;
+    }
+
+    /**
+     * Method to throw away all the recorded spans.
+     */
+    void Trace::clear() {
+        TraceRegistry& all = registry();
+        std::lock_guard<std::mutex> lock(all.mutex);
+
+        for (auto& buffer : all.buffers) {
+            std::lock_guard<std::mutex> guard(buffer->mutex);
+            buffer->records.clear();
+        }
+    }
+
+    /**
+     * Method to write the recorded spans as a Chrome trace.
+     * @param output The output stream.
+     * @return Status ERROR_IO if writing failed.
+     */
+    Status Trace::write(std::ostream& output) {
+        /* Copying the spans first, so the threads are not held up while writing. */
+        std::vector<std::pair<uint32_t, TraceRecord>> spans;
+        {
+            TraceRegistry& all = registry();
+            std::lock_guard<std::mutex> lock(all.mutex);
+
+            for (auto& buffer : all.buffers) {
+                std::lock_guard<std::mutex> guard(buffer->mutex);
+
+                for (auto& record : buffer->records)
+                    spans.push_back(std::make_pair(buffer->thread, record));
+            }
+        }
+
+        /* The times start at the first span, which keeps the numbers short. */
+        uint64_t origin = UINT64_MAX;
+        for (auto& span : spans)
+            origin = std::min(origin, span.second.begin);
+
+        const int process = getpid();
+
+        output << "{\"traceEvents\":[";
+        for (size_t i = 0; i < spans.size(); i++) {
+            const TraceRecord& record = spans[i].second;
+
+            output << (i > 0 ? ",\n" : "\n") << "{\"name\":\"";
+
+            /* Names are meant to be literals, but a quote or backslash would break the JSON. */
+            for (const char *c = record.name; *c != '\0'; c++) {
+                if (*c == '"' || *c == '\\')
+                    output << '\\';
+
+                if ((unsigned char) *c >= 0x20)
+                    output << *c;
+            }
+
+            output << "\",\"cat\":\"cppmidi\",\"ph\":\"X\",\"ts\":";
+            writeTime(output, record.begin - origin);
+            output << ",\"dur\":";
+            writeTime(output, record.end - record.begin);
+            output << ",\"pid\":" << process << ",\"tid\":" << spans[i].first;
+
+            if (record.bytes > 0)
+                output << ",\"args\":{\"bytes\":" << record.bytes << "}";
+
+            output << "}";
+        }
+        output << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+        return output ? Status() : Status(ERROR_IO, 0);
+    }
+
+    /**
+     * Method to save the recorded spans as a Chrome trace.
+     * @param path The path to write to.
+     * @return Status ERROR_IO if the file could not be created or written.
+     */
+    Status Trace::save(const std::string& path) {
+        std::ofstream output(path, std::ios::binary | std::ios::trunc);
+        if (!output)
+            return Status(ERROR_IO, 0);
+
+        Status status = write(output);
+
+        output.close();
+        if (!output && status.ok())
+            status = Status(ERROR_IO, 0);
+
+        return status;
+    }
+}
@@ -8,17 +8,10 @@
 
 #include <cppmidi/track.h>
 #include <cppmidi/endian.h>
-#include <cppmidi/events/meta.h>
-#include <cppmidi/events/message.h>
-#include <cppmidi/events/sysex.h>
+#include <cppmidi/decoder.h>
+#include <cppmidi/encoder.h>
 #include <cstring>
 
-using Midi::Events::Meta;
-using Midi::Events::MetaType;
-using Midi::Events::Message;
-using Midi::Events::MessageType;
-using Midi::Events::SysEx;
-
 /**
  * Setting up the basic midi namespace.
  */
@@ -29,6 +22,61 @@ namespace Midi {
      */
     const char* Track::IDENTIFIER = "MTrk";
 
+    /**
+     * Copy constructor, which clones all the events of the other track.
+     * @param track The track to copy.
+     */
+    Track::Track(const Track& track) : _length(track._length), _index(NULL) {
+        _events.reserve(track._events.size());
+
+        for (auto event : track._events)
+            _events.push_back(event->clone());
+    }
+
+    /**
+     * Assignment operator, which replaces the events by clones of those of the other track.
+     * @param track The track to copy.
+     * @return Track& This track.
+     */
+    Track& Track::operator =(const Track& track) {
+        if (this == &track)
+            return *this;
+
+        invalidate();
+
+        for (auto event : _events)
+            delete event;
+
+        _events.clear();
+        _events.reserve(track._events.size());
+
+        for (auto event : track._events)
+            _events.push_back(event->clone());
+
+        _length = track._length;
+        return *this;
+    }
+
+    /**
+     * Method to get the index with the positions of the events per channel and type.
+     * @return const EventIndex& The index of this track.
+     */
+    const EventIndex& Track::getIndex() const {
+        EventIndex *index = _index.load(std::memory_order_acquire);
+        if (index != NULL)
+            return *index;
+
+        /* Multiple readers might build the index at the same time, in which case the
+         * first one to store it wins and the others throw their own copy away.
+         */
+        EventIndex *built = new EventIndex(_events);
+        if (_index.compare_exchange_strong(index, built, std::memory_order_acq_rel))
+            return *built;
+
+        delete built;
+        return *index;
+    }
+
     /**
      * Stream operator so the track info can be written to any output.
      * @param output Output stream
@@ -36,59 +84,38 @@ namespace Midi {
      * @return std::ostream& Original output stream.
      */
     std::ostream& operator <<(std::ostream& output, const Track& t) {
-        /* Writing the track identifier plus the length to the stream. */
-        output.write(Track::IDENTIFIER, 4);
-        Endian::writeIntBig(output, t._length);
-
-        /* Writing every event to the output stream */
-        for (auto event : t._events)
-            output << *event;
+        /* The length is counted from the events themselves, so it is always exact. A track
+         * that does not fit in a chunk cannot be written at all.
+         */
+        StreamSink sink(output);
+        if (!Encoder<StreamSink>(sink).write(t))
+            output.setstate(std::ios::failbit);
 
         return output;
     }
 
     /**
      * Method to read the Track object from an input stream. The stream should
-     * be in binary mode.
+     * be in binary mode. The events are added to the track, and on failure a
+     * std::ios_base::failure is thrown.
      * @param input The input stream.
      * @param track The track object.
      * @return std::istream& THe original input stream.
      */
     std::istream& operator >>(std::istream& input, Track& track) {
-        /* Reading the first 4 magic bytes from the stream, which should be the MTrk. */
-        char *magic = new char[4];
-        input.read(magic, 4);
+        /* Reading the complete chunk first, so the events can be decoded from memory. */
+        std::vector<uint8_t> chunk;
+        Status status = Decoder::readChunk(input, chunk);
+
+        if (!status.ok())
+            throw std::ios_base::failure(status.describe());
 
         /* If the magic number MTrk does not match, throw an exception. */
-        if (strncmp(magic, Track::IDENTIFIER, 4))
+        if (memcmp(chunk.data(), Track::IDENTIFIER, 4))
             throw std::ios_base::failure("Bad track magic");
 
-        /* Store the length, because although we will not use it in the object, we will use it. */
-        uint32_t length = Endian::readIntBig(input);
-
-        Event* event = NULL;
-
-        while (length) {
-            /* There can really only be 3 cases, so an if-statement is a good choice here, although
-             * this does certainly not feel like good form. After this if statement, event is guaranteed
-             * to have a message in it. Since most of the cases will be the message, everything should be fine.
-             * XXX:2014-06-30:mvdwerve: REVISE / IMPROVE THIS, this works but looks horrendous.
-             */
-            if (!(event = Message::popEvent(input))
-                        && !(event = Meta::popEvent(input))
-                        && !(event = SysEx::popEvent(input)))
-                throw std::ios_base::failure("Cannot create event, unknown status byte.");
-
-            /* Subtracting the read bytes from the length. */
-            length -= event->gcount();
-
-            /* Adding the event to the track and making sure the local pointer cannot be accessed again. */
-            track.addEvent(event);
-            event = NULL;
-        }
-
-        /* Was dynamically allocated, so is freed now. */
-        delete magic;
+        if (!(status = Decoder().decodeTrack(chunk.data(), 8, chunk.size(), track)).ok())
+            throw std::ios_base::failure(status.describe());
 
         return input;
     }
@@ -0,0 +1,238 @@
+/**
+ * trackbuilder.cpp
+ *
+ * File with implementations for the Midi::TrackBuilder class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/trackbuilder.h>
+#include <cppmidi/hash.h>
+#include <cppmidi/events/message.h>
+#include <cppmidi/events/meta.h>
+#include <thread>
+#include <functional>
+#include <algorithm>
+
+using Midi::Events::Message;
+using Midi::Events::MessageType;
+using Midi::Events::Meta;
+using Midi::Events::MetaType;
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    const size_t TrackBuilder::SHARDS;
+
+    /**
+     * The amount of bytes of the sort key that are used, 4 for the tick and 1 for the priority.
+     * @var size_t
+     */
+    static const size_t KEY_BYTES = 5;
+
+    /**
+     * Method to check whether an event is an end of track event.
+     * @param event The event.
+     * @return bool True if it is.
+     */
+    static bool isEnd(const Event *event) {
+        return event->getCategory() == CATEGORY_META && static_cast<const Meta*>(event)->getType() == MetaType::EOT;
+    }
+
+    /**
+     * Method to add a copy of an event.
+     * @param tick     The absolute tick.
+     * @param event    The event.
+     * @param priority The priority among the events on the same tick, lowest first.
+     */
+    void TrackBuilder::add(uint32_t tick, const Event& event, uint8_t priority) {
+        /* Cloning outside of the lock, since that is where most of the time goes. */
+        const Entry entry = { (uint64_t) tick << 8 | priority, event.clone() };
+
+        Shard& target = shard();
+        std::lock_guard<std::mutex> lock(target.mutex);
+        target.entries.push_back(entry);
+    }
+
+    /**
+     * Method to add a note on and its note off.
+     * @param tick     The absolute tick of the note on.
+     * @param duration The amount of ticks until the note off.
+     * @param channel  The channel, ranging from 0-15.
+     * @param note     The note number.
+     * @param velocity The velocity of the note on.
+     */
+    void TrackBuilder::addNote(uint32_t tick, uint32_t duration, uint8_t channel, uint8_t note, uint8_t velocity) {
+        const Message on(MessageType::NOTE_ON, channel, note, velocity);
+        const Message off(MessageType::NOTE_OFF, channel, note, 0);
+
+        add(tick, on);
+        add(std::min<uint64_t>((uint64_t) tick + duration, UINT32_MAX), off);
+    }
+
+    /**
+     * Method to get the amount of events that were added.
+     * @return size_t The amount of events.
+     */
+    size_t TrackBuilder::size() const {
+        size_t total = 0;
+
+        for (auto& shard : _shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            total += shard.entries.size();
+        }
+
+        return total;
+    }
+
+    /**
+     * Method to throw away all the events that were added.
+     */
+    void TrackBuilder::clear() {
+        for (auto& shard : _shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            for (auto& entry : shard.entries)
+                delete entry.event;
+
+            shard.entries.clear();
+        }
+    }
+
+    /**
+     * Method to move all the events into a track, in order, after the events already in it.
+     * @param track The track.
+     * @param end   The earliest tick of the end of track event.
+     */
+    void TrackBuilder::build(Track& track, uint32_t end) {
+        std::vector<Entry> entries;
+        entries.reserve(size());
+
+        /* The shards are taken in a fixed order, and every thread always adds to the same
+         * shard, so the events of a thread keep their order.
+         */
+        for (auto& shard : _shards) {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+
+            entries.insert(entries.end(), shard.entries.begin(), shard.entries.end());
+            shard.entries.clear();
+        }
+
+        sort(entries);
+
+        uint32_t last = 0;
+        for (auto event : track._events)
+            last += event->deltaTime.getValue();
+
+        /* An end of track event of the track is taken off and put back after the new events,
+         * and its tick becomes the earliest end.
+         */
+        Event *eot = NULL;
+        if (!track._events.empty() && isEnd(track._events.back())) {
+            eot = track._events.back();
+            track._events.pop_back();
+            track._length -= eot->getLength();
+
+            end = std::max(end, last);
+            last -= eot->deltaTime.getValue();
+        }
+
+        track._events.reserve(track._events.size() + entries.size() + 1);
+
+        for (auto& entry : entries) {
+            const uint32_t tick = std::max<uint32_t>(entry.key >> 8, last);
+
+            /* An end of track in between would end the track early, so it only sets the end. */
+            if (isEnd(entry.event)) {
+                end = std::max(end, tick);
+                delete entry.event;
+                continue;
+            }
+
+            entry.event->deltaTime = tick - last;
+            last = tick;
+
+            track.addEvent(entry.event);
+        }
+
+        if (eot == NULL)
+            eot = new Meta(MetaType::EOT);
+
+        eot->deltaTime = std::max(end, last) - last;
+        track.addEvent(eot);
+    }
+
+    /**
+     * Method to get the default priority of an event.
+     * @param event The event.
+     * @return uint8_t The priority.
+     */
+    uint8_t TrackBuilder::priority(const Event& event) {
+        switch (event.getCategory()) {
+        case CATEGORY_META:
+            return isEnd(&event) ? 255 : 0;
+        case CATEGORY_SYSEX:
+            return 1;
+        default:
+            break;
+        }
+
+        const Message& msg = static_cast<const Message&>(event);
+
+        /* A note on with velocity 0 is a note off as well. */
+        if (msg.getType() == MessageType::NOTE_OFF || (msg.getType() == MessageType::NOTE_ON && msg.getData2() == 0))
+            return 2;
+
+        return msg.getType() == MessageType::NOTE_ON ? 4 : 3;
+    }
+
+    /**
+     * Method to get the shard of the calling thread.
+     * @return Shard& The shard.
+     */
+    TrackBuilder::Shard& TrackBuilder::shard() {
+        const uint64_t hash = Hash::mix(std::hash<std::thread::id>()(std::this_thread::get_id()));
+        return _shards[hash & (SHARDS - 1)];
+    }
+
+    /**
+     * Method to sort entries on their key, keeping the order of equal keys. This is a radix
+     * sort on a byte at a time, starting at the lowest, which takes a fixed amount of passes
+     * no matter how the events were added.
+     * @param entries The entries.
+     */
+    void TrackBuilder::sort(std::vector<Entry>& entries) {
+        /* The counts of every byte value for every byte of the key, all counted in one pass. */
+        std::vector<size_t> counts(KEY_BYTES * 256, 0);
+
+        for (auto& entry : entries) {
+            for (size_t digit = 0; digit < KEY_BYTES; digit++)
+                counts[digit * 256 + (entry.key >> (8 * digit) & 0xFF)]++;
+        }
+
+        std::vector<Entry> buffer(entries.size());
+
+        for (size_t digit = 0; digit < KEY_BYTES; digit++) {
+            size_t *count = &counts[digit * 256];
+
+            /* A byte that is the same for all entries, like the upper bytes of the tick in a
+             * short track, does not change the order at all.
+             */
+            if (entries.empty() || count[entries[0].key >> (8 * digit) & 0xFF] == entries.size())
+                continue;
+
+            size_t offset = 0;
+            for (size_t value = 0; value < 256; value++) {
+                const size_t amount = count[value];
+                count[value] = offset;
+                offset += amount;
+            }
+
+            for (auto& entry : entries)
+                buffer[count[entry.key >> (8 * digit) & 0xFF]++] = entry;
+
+            entries.swap(buffer);
+        }
+    }
+}
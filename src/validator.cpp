@@ -0,0 +1,179 @@
+/**
+ * validator.cpp
+ *
+ * File with implementations for the Midi::Validator class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/validator.h>
+#include <cppmidi/endian.h>
+#include <cppmidi/vlvalue.h>
+#include <cstring>
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    /**
+     * The amount of data bytes that follow a status byte, indexed by the upper nibble.
+     * @var const static uint8_t[]
+     */
+    const uint8_t Validator::DATA_BYTES[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 1, 1, 2, 0 };
+
+    /**
+     * Method to validate a complete MIDI file in memory.
+     * @param data The bytes of the file.
+     * @param size The amount of bytes.
+     * @return Status The first error found and its offset, ERROR_NONE if valid.
+     */
+    Status Validator::validate(const uint8_t *data, size_t size) {
+        /* The header chunk is at least 14 bytes, but the magic is checked first so that
+         * completely unrelated input gets the more telling error.
+         */
+        if (size < 4 || memcmp(data, "MThd", 4))
+            return Status(size < 4 ? ERROR_TRUNCATED : ERROR_HEADER_MAGIC, 0);
+
+        if (size < 14)
+            return Status(ERROR_TRUNCATED, size);
+
+        /* The header may be longer than 6 bytes in future versions, but never shorter. */
+        const uint32_t length = Endian::readIntBig(data + 4);
+        if (length < 6)
+            return Status(ERROR_HEADER_LENGTH, 4);
+
+        if (length > size - 8)
+            return Status(ERROR_CHUNK_LENGTH, 4);
+
+        const uint16_t format = Endian::readShortBig(data + 8);
+        const uint16_t numTracks = Endian::readShortBig(data + 10);
+        const uint16_t division = Endian::readShortBig(data + 12);
+
+        /* A single track file must have exactly one track. */
+        if (format > 2 || (format == 0 && numTracks != 1))
+            return Status(ERROR_HEADER_FORMAT, 8);
+
+        if (division == 0)
+            return Status(ERROR_HEADER_FORMAT, 12);
+
+        size_t offset = 8 + length;
+
+        for (uint16_t track = 0; track < numTracks;) {
+            if (size - offset < 8)
+                return Status(ERROR_TRUNCATED, size);
+
+            const uint32_t chunkLength = Endian::readIntBig(data + offset + 4);
+            if (chunkLength > size - offset - 8)
+                return Status(ERROR_CHUNK_LENGTH, offset + 4);
+
+            /* Unknown chunks are skipped, as long as they look like chunks. */
+            if (memcmp(data + offset, "MTrk", 4)) {
+                if (!isPrintable(data + offset))
+                    return Status(ERROR_CHUNK_MAGIC, offset);
+
+                offset += 8 + chunkLength;
+                continue;
+            }
+
+            Status status = validateTrack(data, offset + 8, offset + 8 + chunkLength);
+            if (!status.ok())
+                return status;
+
+            offset += 8 + chunkLength;
+            track++;
+        }
+
+        return Status();
+    }
+
+    /**
+     * Method to validate the events of a single track chunk.
+     * @param data  The bytes of the file.
+     * @param begin The offset of the first event, right after the chunk header.
+     * @param end   The offset right after the last byte of the chunk.
+     * @return Status The first error found and its offset, ERROR_NONE if valid.
+     */
+    Status Validator::validateTrack(const uint8_t *data, size_t begin, size_t end) {
+        size_t offset = begin;
+        uint8_t running = 0;
+        uint32_t value;
+        ErrorCode error;
+
+        while (offset < end) {
+            /* Every event starts with the delta time. */
+            const size_t start = offset;
+            if ((error = VLValue::read(data, offset, end, value)) != ERROR_NONE)
+                return Status(error, start);
+
+            if (offset >= end)
+                return Status(ERROR_EVENT_OVERRUN, offset);
+
+            /* A data byte where the status is expected means running status, which is only
+             * allowed if a message came before it.
+             */
+            uint8_t status = data[offset];
+            if (status & 0x80)
+                offset++;
+            else if (!(status = running))
+                return Status(ERROR_STATUS_BYTE, offset);
+
+            if (status < 0xF0) {
+                const uint8_t count = DATA_BYTES[status >> 4];
+                running = status;
+
+                if (end - offset < count)
+                    return Status(ERROR_EVENT_OVERRUN, offset);
+
+                /* Checking both data bytes at once, which is the same byte twice for messages
+                 * with only one data byte.
+                 */
+                if ((data[offset] | data[offset + count - 1]) & 0x80)
+                    return Status(ERROR_DATA_BYTE, offset + !(data[offset] & 0x80));
+
+                offset += count;
+                continue;
+            }
+
+            /* Meta and sysex events cancel the running status. */
+            running = 0;
+
+            if (status == 0xFF) {
+                if (offset >= end)
+                    return Status(ERROR_EVENT_OVERRUN, offset);
+
+                const uint8_t type = data[offset++];
+                if (type & 0x80)
+                    return Status(ERROR_DATA_BYTE, offset - 1);
+
+                const size_t lengthOffset = offset;
+                if ((error = VLValue::read(data, offset, end, value)) != ERROR_NONE)
+                    return Status(error, lengthOffset);
+
+                if (value > end - offset)
+                    return Status(ERROR_EVENT_OVERRUN, lengthOffset);
+
+                offset += value;
+
+                /* The end of track must be the very last event of the chunk. */
+                if (type == 0x2F)
+                    return offset == end ? Status() : Status(ERROR_EVENT_AFTER_EOT, offset);
+            }
+            else if (status == 0xF0 || status == 0xF7) {
+                const size_t lengthOffset = offset;
+                if ((error = VLValue::read(data, offset, end, value)) != ERROR_NONE)
+                    return Status(error, lengthOffset);
+
+                if (value > end - offset)
+                    return Status(ERROR_EVENT_OVERRUN, lengthOffset);
+
+                offset += value;
+            }
+            else {
+                /* System common and real time messages cannot appear in files. */
+                return Status(ERROR_STATUS_BYTE, offset - 1);
+            }
+        }
+
+        return Status(ERROR_MISSING_EOT, end);
+    }
+}
@@ -0,0 +1,17 @@
+/**
+ * wire.cpp
+ *
+ * File with definitions for the Midi::WireEvent class. The parser and the encoder for the
+ * wire are completely in the header, so they can be inlined for every byte.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/wire.h>
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    const uint8_t WireEvent::CHUNK_SIZE;
+}
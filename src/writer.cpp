@@ -0,0 +1,339 @@
+/**
+ * writer.cpp
+ *
+ * File with implementations for the Midi::Writer class.
+ *
+ * @author Michael van der Werve
+ */
+
+#include <cppmidi/writer.h>
+#include <cppmidi/encoder.h>
+#include <cppmidi/trace.h>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <climits>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+/**
+ * Setting up the basic midi namespace.
+ */
+namespace Midi {
+    /**
+     * Method to encode a complete track chunk.
+     * @param track The track.
+     * @param chunk The chunk to fill.
+     * @return bool False if the track is too long for a chunk, in which case the chunk is empty.
+     */
+    static bool encodeTrack(const Track& track, std::vector<uint8_t>& chunk) {
+        CPPMIDI_TRACE_SPAN(span, "encodeTrack", track.getLength());
+        CountingSink counter;
+        Encoder<CountingSink>(counter).writeEvents(track);
+
+        /* A track that does not fit in a chunk cannot be written at all. */
+        if (counter.size() > 0xFFFFFFFF) {
+            chunk.clear();
+            return false;
+        }
+
+        /* Counting first, so the chunk is allocated exactly once and filled without any checks. */
+        chunk.resize(8 + counter.size());
+        RawSink sink(chunk.data());
+        Encoder<RawSink> encoder(sink);
+
+        encoder.writeChunkHeader(Track::IDENTIFIER, counter.size());
+        encoder.writeEvents(track);
+        return true;
+    }
+
+    /**
+     * Method to add a copy of a chunk that is not a track.
+     * @param chunk  The chunk.
+     * @param chunks The chunks to add it to.
+     */
+    static void copyChunk(const Chunk& chunk, std::vector<std::vector<uint8_t>>& chunks) {
+        chunks.emplace_back();
+        chunks.back().reserve(chunk.size());
+
+        BufferSink sink(chunks.back());
+        Encoder<BufferSink>(sink).write(chunk);
+    }
+
+    /**
+     * The tracks of a file that are being encoded, shared by the writing thread and the tasks
+     * on the pool. Tracks are claimed one at a time, so the tasks that start after all tracks
+     * were claimed do nothing at all.
+     */
+    struct WriteJob {
+        /**
+         * The tracks, the chunks they are encoded into, and the index of the chunk of every track.
+         * @var std::vector<const Track*>, std::vector<std::vector<uint8_t>>*, std::vector<size_t>
+         */
+        std::vector<const Track*> tracks;
+        std::vector<std::vector<uint8_t>> *chunks;
+        std::vector<size_t> targets;
+
+        /**
+         * The positions of the tracks in the order they are claimed in, largest first so
+         * one large track at the end does not keep everybody waiting.
+         * @var std::vector<size_t>
+         */
+        std::vector<size_t> order;
+
+        /**
+         * The index in the order of the next track to claim.
+         * @var std::atomic<size_t>
+         */
+        std::atomic<size_t> next;
+
+        /**
+         * Whether a track was too long for a chunk.
+         * @var std::atomic<bool>
+         */
+        std::atomic<bool> failed;
+
+        /**
+         * The amount of tracks that were encoded, and the means to wait for all of them.
+         * @var size_t, std::mutex, std::condition_variable
+         */
+        size_t done;
+        std::mutex mutex;
+        std::condition_variable finished;
+
+        /**
+         * Method to claim and encode a single track.
+         * @return bool False if all the tracks were claimed already.
+         */
+        bool run() {
+            const size_t index = next++;
+            if (index >= order.size())
+                return false;
+
+            const size_t position = order[index];
+            if (!encodeTrack(*tracks[position], (*chunks)[targets[position]]))
+                failed = true;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (++done == order.size())
+                finished.notify_all();
+
+            return true;
+        }
+    };
+
+    /**
+     * Method to check that every track could be encoded, and to give up on the chunks otherwise.
+     * @param chunks The chunks.
+     * @param failed Whether a track was too long for a chunk.
+     * @return Status ERROR_TRACK_LENGTH with the offset the chunk of the first such track would have.
+     */
+    static Status finish(std::vector<std::vector<uint8_t>>& chunks, bool failed) {
+        if (!failed)
+            return Status();
+
+        /* Only the chunk of a track that was too long is empty, every other one has a header. */
+        uint64_t offset = 0;
+        for (size_t i = 0; i < chunks.size() && !chunks[i].empty(); i++)
+            offset += chunks[i].size();
+
+        chunks.clear();
+        return Status(ERROR_TRACK_LENGTH, offset);
+    }
+
+    /**
+     * Method to encode a file into chunks.
+     * @param file   The file.
+     * @param chunks The chunks to fill.
+     * @return Status ERROR_TRACK_LENGTH if a track is too long for a chunk.
+     */
+    Status Writer::encode(const File& file, std::vector<std::vector<uint8_t>>& chunks) {
+        CPPMIDI_TRACE_SPAN(span, "encode", 0);
+        auto job = std::make_shared<WriteJob>();
+        job->next = 0;
+        job->done = 0;
+        job->failed = false;
+
+        /* Chunk 0 is the header, and the chunks that are not tracks are copied in front of
+         * their tracks right away, so only the tracks are left to encode.
+         */
+        chunks.clear();
+        chunks.emplace_back(14);
+        RawSink sink(chunks[0].data());
+        Encoder<RawSink>(sink).write(file.getHeader());
+
+        const auto& others = file.getChunks();
+        size_t next = 0;
+        size_t total = 0;
+
+        for (int i = 0; i < file.getTrackSlots(); i++) {
+            for (; next < others.size() && others[next].first <= i; next++)
+                copyChunk(others[next].second, chunks);
+
+            if (file.getTrack(i) == NULL)
+                continue;
+
+            job->tracks.push_back(file.getTrack(i));
+            job->targets.push_back(chunks.size());
+            chunks.emplace_back();
+            total += file.getTrack(i)->getLength();
+        }
+
+        for (; next < others.size(); next++)
+            copyChunk(others[next].second, chunks);
+
+        /* Starting the pool costs more than encoding small files takes. */
+        if (total < _splitSize || job->tracks.size() < 2) {
+            for (size_t i = 0; i < job->tracks.size(); i++) {
+                if (!encodeTrack(*job->tracks[i], chunks[job->targets[i]]))
+                    job->failed = true;
+            }
+
+            CPPMIDI_TRACE_BYTES(span, total);
+            return finish(chunks, job->failed);
+        }
+
+        job->chunks = &chunks;
+        job->order.resize(job->tracks.size());
+        for (size_t i = 0; i < job->order.size(); i++)
+            job->order[i] = i;
+
+        std::stable_sort(job->order.begin(), job->order.end(), [&job](size_t a, size_t b) {
+            return job->tracks[a]->getLength() > job->tracks[b]->getLength();
+        });
+
+        /* The tasks hold on to the job, since some of them may only start after we are done. */
+        const size_t tasks = std::min<size_t>(_pool.size(), job->tracks.size() - 1);
+        for (size_t i = 0; i < tasks; i++) {
+            _pool.submit([job]() {
+                while (job->run());
+            });
+        }
+
+        /* Encoding ourselves as well, which also means this never waits for a busy pool. */
+        while (job->run());
+
+        std::unique_lock<std::mutex> lock(job->mutex);
+        job->finished.wait(lock, [&job]() { return job->done == job->order.size(); });
+        CPPMIDI_TRACE_BYTES(span, total);
+
+        return finish(chunks, job->failed);
+    }
+
+    /**
+     * Method to write a file to a stream.
+     * @param file   The file.
+     * @param output The output stream.
+     * @return Status ERROR_IO if writing failed, with the offset where it failed, or ERROR_TRACK_LENGTH.
+     */
+    Status Writer::write(const File& file, std::ostream& output) {
+        std::vector<std::vector<uint8_t>> chunks;
+
+        /* Nothing is written at all if a track cannot be, since the file would be corrupt. */
+        Status status = encode(file, chunks);
+        if (!status.ok())
+            return status;
+
+        size_t offset = 0;
+        for (auto& chunk : chunks) {
+            if (!output.write(reinterpret_cast<const char*>(chunk.data()), chunk.size()))
+                return Status(ERROR_IO, offset);
+
+            offset += chunk.size();
+        }
+
+        return Status();
+    }
+
+    /**
+     * Method to write a file to a file descriptor.
+     * @param file The file.
+     * @param fd   The file descriptor.
+     * @return Status ERROR_IO if writing failed, with the offset where it failed, or ERROR_TRACK_LENGTH.
+     */
+    Status Writer::write(const File& file, int fd) {
+        std::vector<std::vector<uint8_t>> chunks;
+
+        Status status = encode(file, chunks);
+        if (!status.ok())
+            return status;
+
+        return write(chunks, fd);
+    }
+
+    /**
+     * Method to write encoded chunks to a file descriptor.
+     * @param chunks The chunks.
+     * @param fd     The file descriptor.
+     * @return Status ERROR_IO if writing failed, with the offset where it failed.
+     */
+    Status Writer::write(const std::vector<std::vector<uint8_t>>& chunks, int fd) {
+        CPPMIDI_TRACE_SPAN(span, "write", 0);
+        std::vector<struct iovec> vectors(chunks.size());
+        for (size_t i = 0; i < chunks.size(); i++) {
+            vectors[i].iov_base = const_cast<uint8_t*>(chunks[i].data());
+            vectors[i].iov_len = chunks[i].size();
+        }
+
+        /* A single call normally writes everything, but it may stop early, and it takes at
+         * most IOV_MAX chunks at a time.
+         */
+        size_t offset = 0;
+        size_t first = 0;
+        while (first < vectors.size()) {
+            const int count = std::min<size_t>(vectors.size() - first, IOV_MAX);
+            const ssize_t written = writev(fd, &vectors[first], count);
+
+            if (written < 0 && errno == EINTR)
+                continue;
+
+            if (written <= 0)
+                return Status(ERROR_IO, offset);
+
+            offset += written;
+            CPPMIDI_TRACE_BYTES(span, offset);
+
+            /* Skipping the chunks that were written completely, and the written part of the next. */
+            size_t remaining = written;
+            while (first < vectors.size() && remaining >= vectors[first].iov_len)
+                remaining -= vectors[first++].iov_len;
+
+            if (remaining > 0) {
+                vectors[first].iov_base = static_cast<uint8_t*>(vectors[first].iov_base) + remaining;
+                vectors[first].iov_len -= remaining;
+            }
+        }
+
+        return Status();
+    }
+
+    /**
+     * Method to save a file.
+     * @param file The file.
+     * @param path The path to write to.
+     * @return Status ERROR_IO if the file could not be created or written, or ERROR_TRACK_LENGTH.
+     */
+    Status Writer::save(const File& file, const std::string& path) {
+        std::vector<std::vector<uint8_t>> chunks;
+
+        /* Encoding first, so a file that cannot be written does not replace the old one. */
+        Status status = encode(file, chunks);
+        if (!status.ok())
+            return status;
+
+        const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0)
+            return Status(ERROR_IO, 0);
+
+        status = write(chunks, fd);
+
+        if (::close(fd) != 0 && status.ok())
+            status = Status(ERROR_IO, 0);
+
+        return status;
+    }
+}
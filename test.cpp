@@ -14,16 +14,50 @@
  * file is put back in the object from the file and rewritten to testrw.mid. testrw should be
  * equal to test.mid.
  *
+ * The other tests check the rest of the library, and report every check that fails. The
+ * program exits with 1 if any check failed.
+ *
  * @author Michael van der Werve
  */
 
 #include <cppmidi/file.h>
 #include <cppmidi/events/message.h>
 #include <cppmidi/events/meta.h>
+#include <cppmidi/events/sysex.h>
 #include <cppmidi/event.h>
 #include <cppmidi/track.h>
+#include <cppmidi/noteindex.h>
+#include <cppmidi/eventindex.h>
+#include <cppmidi/validator.h>
+#include <cppmidi/decoder.h>
+#include <cppmidi/batch.h>
+#include <cppmidi/cache.h>
+#include <cppmidi/archive.h>
+#include <cppmidi/convert.h>
+#include <cppmidi/writer.h>
+#include <cppmidi/streamwriter.h>
+#include <cppmidi/snapshot.h>
+#include <cppmidi/statistics.h>
+#include <cppmidi/renderer.h>
+#include <cppmidi/encoder.h>
+#include <cppmidi/stateindex.h>
+#include <cppmidi/fingerprint.h>
+#include <cppmidi/intern.h>
+#include <cppmidi/wire.h>
+#include <cppmidi/rawfile.h>
+#include <cppmidi/trackbuilder.h>
+#include <cppmidi/trace.h>
 #include <vector>
+#include <algorithm>
 #include <fstream>
+#include <sstream>
+#include <iterator>
+#include <atomic>
+#include <thread>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/stat.h>
 
 using Midi::File;
 using Midi::Track;
@@ -33,6 +67,39 @@ using Midi::Events::MessageType;
 using Midi::Events::MetaType;
 using Midi::Events::Meta;
 
+/**
+ * The amount of checks that failed.
+ */
+static int failures = 0;
+
+/**
+ * Function to report a check that failed.
+ * @param ok   Whether the check passed.
+ * @param what What was checked.
+ */
+static void check(bool ok, const char *what) {
+    if (ok)
+        return;
+
+    std::cout << "Check failed: " << what << std::endl;
+    failures++;
+}
+
+/**
+ * Function to add a message to a track.
+ * @param t       The track.
+ * @param delta   The delta time.
+ * @param type    The type of the message.
+ * @param channel The channel.
+ * @param data1   The first data byte.
+ * @param data2   The second data byte.
+ */
+static void addMessage(Track *t, uint32_t delta, MessageType type, uint8_t channel, uint8_t data1, uint8_t data2 = 0) {
+    Message msg(type, channel, data1, data2);
+    msg.deltaTime = delta;
+    t->addEvent(msg);
+}
+
 void writeTest() {
     /* Loading the basic midi object with a filename of test.mid */
     File midi;
@@ -107,10 +174,963 @@ void readTest() {
     newFile.close();
 }
 
+/**
+ * Function to build a chunk from its identifier and its data.
+ * @param id   The 4 characters of the identifier.
+ * @param data The data.
+ * @return std::string The bytes of the chunk.
+ */
+static std::string chunk(const char *id, const std::string& data) {
+    const uint32_t size = data.size();
+    const char length[] = { char(size >> 24), char(size >> 16), char(size >> 8), char(size) };
+
+    return std::string(id, 4) + std::string(length, 4) + data;
+}
+
+/**
+ * Function to build a file from the chunks after the header.
+ * @param tracks The amount of tracks in the header.
+ * @param chunks The bytes of the chunks.
+ * @return std::vector<uint8_t> The bytes of the file, with a division of 96.
+ */
+static std::vector<uint8_t> smf(uint16_t tracks, const std::string& chunks) {
+    const char fields[] = { 0, 1, char(tracks >> 8), char(tracks), 0, 96 };
+    const std::string bytes = chunk("MThd", std::string(fields, 6)) + chunks;
+
+    return std::vector<uint8_t>(bytes.begin(), bytes.end());
+}
+
+/**
+ * The bytes of a note on and an end of track, and of the end of track alone.
+ */
+static const std::string NOTE("\x00\x90\x40\x40", 4);
+static const std::string END("\x00\xFF\x2F\x00", 4);
+
+/**
+ * Function to write bytes to a file.
+ * @param path  The path of the file.
+ * @param bytes The bytes.
+ */
+static void writeFile(const std::string& path, const std::vector<uint8_t>& bytes) {
+    std::ofstream output(path.c_str(), std::ios::binary);
+    output.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+void noteIndexTest() {
+    /* Two overlapping notes on the same pitch, the second closed by a note on without velocity,
+     * and a note that is never closed.
+     */
+    File midi;
+    Track *t = midi.getTrack();
+    addMessage(t, 0, MessageType::NOTE_ON, 0, 60, 100);
+    addMessage(t, 10, MessageType::NOTE_ON, 0, 60, 90);
+    addMessage(t, 10, MessageType::NOTE_OFF, 0, 60);
+    addMessage(t, 10, MessageType::NOTE_ON, 0, 60, 0);
+    addMessage(t, 10, MessageType::NOTE_ON, 1, 64, 80);
+    Meta EOT(MetaType::EOT);
+    EOT.deltaTime = 60;
+    t->addEvent(EOT);
+
+    /* Overlapping notes are paired first in, first out. */
+    Midi::NoteIndex index(midi);
+    check(index.size() == 3, "note index pairs every note");
+    check(index[0].start == 0 && index[0].end == 20 && index[0].velocity == 100, "note index closes the oldest note first");
+    check(index[1].start == 10 && index[1].end == 30 && index[1].terminated, "note index treats velocity 0 as note off");
+    check(index[2].end == 100 && !index[2].terminated && index[2].channel == 1, "note index ends open notes at the end of the track");
+
+    std::vector<uint32_t> found;
+    index.query(25, 35, found);
+    check(found.size() == 1 && index[found[0]].start == 10, "note index finds the notes in a range");
+
+    found.clear();
+    index.query(20, 20, found);
+    check(found.empty(), "note index finds nothing in an empty range");
+}
+
+void eventIndexTest() {
+    /* Controllers on the drum channel between notes on another channel. */
+    File midi;
+    Track *t = midi.getTrack();
+    addMessage(t, 0, MessageType::NOTE_ON, 0, 60, 100);
+    addMessage(t, 5, MessageType::CONTROLLER, 9, 7, 100);
+    addMessage(t, 5, MessageType::NOTE_OFF, 0, 60);
+    addMessage(t, 5, MessageType::CONTROLLER, 9, 10, 64);
+    addMessage(t, 5, MessageType::CONTROLLER, 0, 7, 90);
+
+    const Midi::EventIndex& index = t->getIndex();
+    check(index.get(MessageType::CONTROLLER, 9) == std::vector<uint32_t>({ 1, 3 }), "event index finds the messages of a type on a channel");
+    check(index.get(MessageType::CONTROLLER).size() == 3 && index.get(9).size() == 2, "event index finds the messages of a type and of a channel");
+    check(index.getTick(3) == 15, "event index knows the tick of every event");
+
+    /* Only the matching messages are visited, with their absolute ticks. */
+    std::vector<uint32_t> ticks;
+    midi.forEachMessage(MessageType::CONTROLLER, 9, [&ticks](int track, uint32_t tick, const Message& msg) {
+        if (track == 0 && msg.getChannel() == 9)
+            ticks.push_back(tick);
+    });
+    check(ticks == std::vector<uint32_t>({ 5, 15 }), "event index visits only the matching messages");
+
+    /* Adding an event throws the index away, so it is built again with the new event. */
+    addMessage(t, 1, MessageType::CONTROLLER, 9, 1, 0);
+    check(t->getIndex().get(MessageType::CONTROLLER, 9).size() == 3, "event index is rebuilt after the track changes");
+}
+
+void validatorTest() {
+    using Midi::Validator;
+
+    /* The first event of the first track starts at 22, right after both chunk headers. */
+    check(Validator::validate(smf(1, chunk("MTrk", NOTE + END))).ok(), "validator accepts a valid file");
+    check(Validator::validate(smf(1, chunk("XFIH", "abc") + chunk("MTrk", NOTE + END))).ok(), "validator skips unknown chunks");
+
+    std::vector<uint8_t> bad = smf(1, chunk("MTrk", NOTE + END));
+    bad[0] = 'X';
+    Midi::Status status = Validator::validate(bad);
+    check(status.code == Midi::ERROR_HEADER_MAGIC && status.offset == 0, "validator reports the header magic");
+
+    status = Validator::validate(smf(1, chunk("MTrk", std::string("\x00\x90\x40\xC0", 4) + END)));
+    check(status.code == Midi::ERROR_DATA_BYTE && status.offset == 25, "validator reports a data byte with the high bit set");
+
+    status = Validator::validate(smf(1, chunk("MTrk", std::string("\x80\x80\x80\x80\x00\x90\x40\x40", 8) + END)));
+    check(status.code == Midi::ERROR_VLVALUE && status.offset == 22, "validator reports a variable length value that is too long");
+
+    status = Validator::validate(smf(1, chunk("MTrk", std::string("\x00\x40\x40", 3) + END)));
+    check(status.code == Midi::ERROR_STATUS_BYTE && status.offset == 23, "validator reports running status without a status");
+
+    status = Validator::validate(smf(1, chunk("MTrk", NOTE)));
+    check(status.code == Midi::ERROR_MISSING_EOT && status.offset == 26, "validator reports a missing end of track");
+
+    status = Validator::validate(smf(1, chunk("MTrk", NOTE + END + NOTE)));
+    check(status.code == Midi::ERROR_EVENT_AFTER_EOT && status.offset == 30, "validator reports events after the end of track");
+
+    bad = smf(1, chunk("MTrk", NOTE + END));
+    bad[21] = 9;
+    status = Validator::validate(bad);
+    check(status.code == Midi::ERROR_CHUNK_LENGTH && status.offset == 18, "validator reports a chunk running past the end");
+}
+
+void decoderTest() {
+    /* A broken track, garbage that is not a chunk, and a last track without an end of track. */
+    const std::vector<uint8_t> data = smf(3, chunk("MTrk", NOTE + END) + chunk("MTrk", std::string("\x00\x90\x40\xC0", 4) + END) +
+                                             std::string("\x01\x02\x03\x04\x05\x06\x07\x08", 8) + chunk("MTrk", NOTE));
+
+    File strict;
+    Midi::DecodeResult result = Midi::Decoder().decode(data, strict);
+    check(result.status.code == Midi::ERROR_DATA_BYTE && result.status.offset == 41, "decoder reports the broken track");
+    check(result.tracks == 0 && strict.getTrackSlots() == 0, "decoder empties the file without recovery");
+
+    Midi::DecodeOptions options;
+    options.skipCorruptTracks = true;
+
+    File recovered;
+    result = Midi::Decoder(options).decode(data, recovered);
+    check(result.status.code == Midi::ERROR_DATA_BYTE && result.status.offset == 41, "decoder reports the first error while recovering");
+    check(result.tracks == 2 && result.skipped == 1 && recovered.getTrackSlots() == 2, "decoder skips only the broken track");
+
+    const Track *last = recovered.getTrack(1);
+    check(last != NULL && last->getEvents().size() == 2, "decoder recovers the track after the garbage");
+    if (last != NULL && last->getEvents().size() == 2) {
+        const Event *eot = last->getEvents().back();
+        check(eot->getCategory() == Midi::CATEGORY_META && static_cast<const Meta*>(eot)->getType() == MetaType::EOT, "decoder appends a missing end of track");
+    }
+
+    std::ostringstream output;
+    output << recovered;
+    const std::string bytes = output.str();
+    check(Midi::Validator::validate(std::vector<uint8_t>(bytes.begin(), bytes.end())).ok(), "decoder output is a valid file");
+}
+
+void sysexTest() {
+    using Midi::Events::SysEx;
+
+    /* A large dump with a 3 byte id, a message split over two packets, and an escape. */
+    const std::string dump = std::string("\x00\xF0\x81\x4C\x00\x20\x29", 7) + std::string(200, '\x11') + "\xF7";
+    const std::string split = std::string("\x00\xF0\x03\x43\x01\x02\x00\xF7\x02\x03\xF7", 11);
+    const std::string escape = std::string("\x00\xF7\x02\xFA\xFB", 5);
+    const std::vector<uint8_t> bytes = smf(1, chunk("MTrk", dump + split + escape + END));
+    const std::shared_ptr<const std::vector<uint8_t>> buffer = std::make_shared<const std::vector<uint8_t>>(bytes);
+
+    File file;
+    check(Midi::Decoder().decode(buffer, file).status.ok(), "sysex file decodes");
+
+    const Track *track = file.getTrack(0);
+    check(track != NULL && track->getEvents().size() == 5, "sysex packets are all decoded");
+    if (track == NULL || track->getEvents().size() != 5)
+        return;
+
+    const SysEx *large = static_cast<const SysEx*>(track->getEvents()[0]);
+    check(large->getPacket() == Midi::Events::SYSEX_COMPLETE, "large dump is a complete packet");
+    check(large->getManufacturerID() == (SysEx::EXTENDED_ID | 0x2029), "large dump has a 3 byte id");
+    check(large->getData().size() == 200 && large->getData()[0] == 0x11, "large dump data skips the id and closing byte");
+    check(large->getPayload().data() >= buffer->data() && large->getPayload().data() < buffer->data() + buffer->size(), "large dump points into the buffer");
+
+    const SysEx *first = static_cast<const SysEx*>(track->getEvents()[1]);
+    const SysEx *next = static_cast<const SysEx*>(track->getEvents()[2]);
+    const SysEx *escaped = static_cast<const SysEx*>(track->getEvents()[3]);
+    check(first->getPacket() == Midi::Events::SYSEX_FIRST && first->getManufacturerID() == 0x43, "unclosed packet starts a message");
+    check(next->getPacket() == Midi::Events::SYSEX_CONTINUATION && next->getData().size() == 1, "next 0xF7 packet continues it");
+    check(escaped->getPacket() == Midi::Events::SYSEX_ESCAPE && escaped->getData().size() == 2, "later 0xF7 packet is an escape");
+
+    std::ostringstream output;
+    output << file;
+    check(output.str() == std::string(bytes.begin(), bytes.end()), "sysex packets are written back unchanged");
+
+    /* A stream that ends within the data cannot give an event. */
+    std::istringstream truncated(std::string("\x00\xF0\x05\x43\x01", 5));
+    Event *event = SysEx::popEvent(truncated);
+    check(event == NULL && truncated.fail(), "truncated sysex is not popped");
+    delete event;
+}
+
+void metaTest() {
+    using namespace Midi::Events;
+
+    const std::string text = "A lyric long enough to be shared";
+    const std::string events = std::string("\x00\xFF\x51\x03\x07\xA1\x20\x00\xFF\x58\x04\x06\x03\x18\x08\x00\xFF\x59\x02\xFD\x01", 21) +
+                               std::string("\x00\xFF\x54\x05\x61\x02\x03\x04\x05\x00\xFF\x05", 12) + char(text.size()) + text;
+    const std::shared_ptr<const std::vector<uint8_t>> buffer = std::make_shared<const std::vector<uint8_t>>(smf(1, chunk("MTrk", events + END)));
+
+    File file;
+    check(Midi::Decoder().decode(buffer, file).status.ok(), "meta file decodes");
+
+    const Track *track = file.getTrack(0);
+    check(track != NULL && track->getEvents().size() == 6, "meta events are all decoded");
+    if (track == NULL || track->getEvents().size() != 6)
+        return;
+
+    const Meta *tempo = static_cast<const Meta*>(track->getEvents()[0]);
+    check(tempo->getTempo() == 500000 && tempo->getData().isInline(), "tempo is decoded from inline data");
+
+    TimeSignature time;
+    check(static_cast<const Meta*>(track->getEvents()[1])->getTimeSignature(time) && time.numerator == 6 && time.denominator == 3 &&
+          time.clocksPerClick == 24 && time.notesPerQuarter == 8, "time signature is decoded");
+    check(!tempo->getTimeSignature(time), "tempo is no time signature");
+
+    KeySignature key;
+    check(static_cast<const Meta*>(track->getEvents()[2])->getKeySignature(key) && key.sharps == -3 && key.minor, "key signature is decoded");
+
+    SmpteOffset smpte;
+    check(static_cast<const Meta*>(track->getEvents()[3])->getSmpteOffset(smpte) && smpte.hours == 0x61 && smpte.minutes == 2 &&
+          smpte.seconds == 3 && smpte.frames == 4 && smpte.fractions == 5, "smpte offset is decoded");
+
+    const Meta *lyric = static_cast<const Meta*>(track->getEvents()[4]);
+    check(!lyric->getData().isInline() && lyric->getData().data() >= buffer->data() && lyric->getData().data() < buffer->data() + buffer->size(),
+          "long text points into the buffer");
+
+    Event *copy = lyric->clone();
+    check(static_cast<Meta*>(copy)->getData().data() == lyric->getData().data(), "clone shares the long text");
+    delete copy;
+
+    check(Meta::tempo(250000).getTempo() == 250000, "tempo factory round-trips");
+
+    /* A stream that ends within the data cannot give an event. */
+    std::istringstream truncated(std::string("\x00\xFF\x01\x05" "ab", 6));
+    Event *event = Meta::popEvent(truncated);
+    check(event == NULL && truncated.fail(), "truncated meta event is not popped");
+    delete event;
+}
+
+void batchTest() {
+    char name[] = "/tmp/cppmidi-batch-XXXXXX";
+    check(mkdtemp(name) != NULL, "batch directory is created");
+    const std::string directory = name;
+
+    /* One good file, one broken file in a subdirectory with a link back up, and a file that is no MIDI file. */
+    mkdir((directory + "/sub").c_str(), 0700);
+    writeFile(directory + "/good.mid", smf(1, chunk("MTrk", NOTE + END)));
+    writeFile(directory + "/sub/bad.MID", smf(1, chunk("MTrk", std::string("\x00\x90\x40\xC0", 4) + END)));
+    writeFile(directory + "/notes.txt", std::vector<uint8_t>(1, 'x'));
+    check(symlink("..", (directory + "/sub/loop").c_str()) == 0, "batch link is created");
+
+    check(Midi::Batch::isMidiFile("song.KAR") && !Midi::Batch::isMidiFile("song.mid.txt"), "batch recognizes extensions");
+
+    std::vector<std::string> paths;
+    check(Midi::Batch::list(directory, paths) && paths.size() == 2, "batch lists each file once despite the link");
+    check(Midi::Batch::list(directory, paths = std::vector<std::string>(), false) && paths.size() == 1, "batch lists without recursion");
+
+    Midi::BatchOptions options;
+    options.threads = 2;
+
+    std::atomic<int> calls(0);
+    const Midi::BatchStats stats = Midi::Batch(options).run(directory, [&calls](const std::string&, File&, const Midi::DecodeResult&) { calls++; });
+    check(calls == 2 && stats.files == 2 && stats.failed == 1 && stats.tracks == 1, "batch decodes every file");
+    check(stats.failures.size() == 1 && stats.failures[0].first == directory + "/sub/bad.MID" && stats.failures[0].second.code == Midi::ERROR_DATA_BYTE,
+          "batch reports the broken file");
+
+    unlink((directory + "/sub/loop").c_str());
+    unlink((directory + "/sub/bad.MID").c_str());
+    unlink((directory + "/notes.txt").c_str());
+    unlink((directory + "/good.mid").c_str());
+    rmdir((directory + "/sub").c_str());
+    rmdir(directory.c_str());
+}
+
+void cacheTest() {
+    char name[] = "/tmp/cppmidi-cache-XXXXXX";
+    check(mkdtemp(name) != NULL, "cache directory is created");
+    const std::string source = std::string(name) + "/song.mid", cache = std::string(name) + "/song.cache";
+
+    const std::string text = "A lyric long enough to be shared";
+    const std::string events = std::string("\x00\xFF\x51\x03\x07\xA1\x20\x00\xFF\x05", 10) + char(text.size()) + text + NOTE +
+                               std::string("\x60\x80\x40\x00", 4) + END;
+    std::vector<uint8_t> bytes = smf(2, chunk("MTrk", events) + chunk("MTrk", NOTE + END));
+    writeFile(source, bytes);
+
+    Midi::CacheView view;
+    check(Midi::Cache::load(source, cache, view).ok() && view.isOpen(), "cache is built and opened");
+    check(view.getTrackCount() == 2 && view.size() == 7 && view.getHeader().division == 96, "cache holds every event");
+    check(view.getTempoMap().getTempo(0) == 500000, "cache holds the tempo map");
+
+    File restored;
+    std::ostringstream output;
+    check(view.toFile(restored).ok() && (output << restored, output.str() == std::string(bytes.begin(), bytes.end())), "cache restores the file");
+
+    /* Changing a velocity keeps the size, but the cache must still be rebuilt. */
+    bytes[bytes.size() - 21] = 0x7F;
+    writeFile(source, bytes);
+
+    Midi::CacheView changed;
+    File rebuilt;
+    std::ostringstream again;
+    check(Midi::Cache::load(source, cache, changed).ok() && changed.toFile(rebuilt).ok() &&
+          (again << rebuilt, again.str() == std::string(bytes.begin(), bytes.end())), "cache is rebuilt after a change of the same size");
+
+    unlink(cache.c_str());
+    unlink(source.c_str());
+    rmdir(name);
+}
+
+void archiveTest() {
+    const std::vector<uint8_t> sources[] = {
+        smf(1, chunk("MTrk", NOTE + END)),
+        smf(2, chunk("MTrk", std::string("\x00\xFF\x51\x03\x07\xA1\x20", 7) + END) + chunk("MTrk", NOTE + NOTE + END)),
+        smf(1, chunk("MTrk", std::string("\x00\xF0\x03\x43\x01\xF7", 6) + END))
+    };
+
+    /* A small block size puts the files in several blocks. */
+    std::stringstream stream;
+    {
+        Midi::ArchiveWriter writer(stream, 32);
+        for (size_t i = 0; i < 3; i++) {
+            File file;
+            Midi::Decoder().decode(sources[i], file);
+            check(writer.add(file, "song" + std::to_string(i)), "archive adds a file");
+        }
+        check(writer.close(), "archive is closed");
+    }
+
+    Midi::ArchiveReader reader;
+    check(reader.open(stream).ok() && reader.size() == 3 && reader.getBlocks().size() > 1, "archive opens with its index");
+
+    /* Reading out of order has to load the right block every time. */
+    const size_t order[] = { 2, 0, 1 };
+    for (size_t i = 0; i < 3; i++) {
+        File file;
+        std::string name;
+        std::ostringstream output;
+        check(reader.read(order[i], file, &name).ok() && name == "song" + std::to_string(order[i]) &&
+              (output << file, output.str() == std::string(sources[order[i]].begin(), sources[order[i]].end())), "archive reads back every file");
+    }
+
+    File file;
+    check(!reader.read(3, file).ok(), "archive refuses an index out of range");
+
+    std::stringstream truncated(stream.str().substr(0, stream.str().size() - 1));
+    Midi::ArchiveReader broken;
+    check(!broken.open(truncated).ok(), "archive refuses a truncated archive");
+}
+
+void convertTest() {
+    using Midi::Converter;
+
+    /* A single track with a tempo and notes on two channels, ending at tick 30. */
+    const std::string events = std::string("\x00\xFF\x51\x03\x07\xA1\x20\x00\x90\x40\x40\x0A\x91\x30\x40\x0A\x80\x40\x00\x0A\xFF\x2F\x00", 23);
+    std::vector<uint8_t> bytes = smf(1, chunk("MTrk", events));
+    bytes[9] = Midi::SINGLETRACK;
+
+    File single;
+    Midi::Decoder().decode(bytes, single);
+
+    File multi;
+    check(Converter::toMultiTrack(single, multi) && multi.getTrackSlots() == 3 && multi.getHeader().getFileFormat() == Midi::MULTITRACK_SYNC,
+          "conversion splits a conductor track and a track per channel");
+
+    const size_t sizes[] = { 2, 3, 2 };
+    for (int i = 0; i < multi.getTrackSlots() && i < 3; i++) {
+        uint32_t tick = 0;
+        for (const Event *event : multi.getTrack(i)->getEvents())
+            tick += event->deltaTime.getValue();
+
+        check(multi.getTrack(i)->getEvents().size() == sizes[i] && tick == 30, "conversion ends every track where the original ended");
+    }
+
+    File merged;
+    std::ostringstream output;
+    check(Converter::toSingleTrack(multi, merged) && (output << merged, output.str() == std::string(bytes.begin(), bytes.end())),
+          "conversion merges the tracks back into the original");
+
+    File independent;
+    Midi::Decoder().decode(bytes, independent);
+    independent.getHeader().setFileFormat(Midi::MULTITRACK_ASYNC);
+    check(!Converter::convert(independent, Midi::SINGLETRACK) && independent.getHeader().getFileFormat() == Midi::MULTITRACK_ASYNC,
+          "conversion refuses independent sequences");
+}
+
+void writerTest() {
+    /* Tracks of different sizes, with an unknown chunk in between that has to stay in place. */
+    const std::vector<uint8_t> bytes = smf(3, chunk("MTrk", NOTE + NOTE + NOTE + END) + chunk("XFIH", "abc") + chunk("MTrk", END) +
+                                              chunk("MTrk", std::string("\x00\xFF\x51\x03\x07\xA1\x20", 7) + NOTE + END));
+    File file;
+    Midi::Decoder().decode(bytes, file);
+
+    /* A tiny split size encodes every track on the pool. */
+    Midi::Writer writer(2, 8);
+    std::vector<std::vector<uint8_t>> chunks;
+    check(writer.encode(file, chunks).ok() && chunks.size() == 5, "writer encodes the header, the tracks and the unknown chunk");
+
+    std::ostringstream expected, output;
+    expected << file;
+    check(writer.write(file, output).ok() && output.str() == expected.str() && expected.str() == std::string(bytes.begin(), bytes.end()),
+          "writer output equals the stream operator");
+
+    char name[] = "/tmp/cppmidi-writer-XXXXXX";
+    check(mkdtemp(name) != NULL, "writer directory is created");
+    const std::string path = std::string(name) + "/song.mid";
+
+    std::ifstream input;
+    check(writer.save(file, path).ok() && (input.open(path.c_str(), std::ios::binary), input.is_open()), "writer saves the file");
+    check(std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>()) == expected.str(), "writer saves the same bytes");
+
+    unlink(path.c_str());
+    rmdir(name);
+}
+
+void asyncTest() {
+    char name[] = "/tmp/cppmidi-async-XXXXXX";
+    check(mkdtemp(name) != NULL, "async directory is created");
+    const std::string path = std::string(name) + "/song.mid", broken = std::string(name) + "/broken.mid";
+
+    const std::vector<uint8_t> bytes = smf(2, chunk("MTrk", std::string("\x00\xFF\x51\x03\x07\xA1\x20", 7) + END) + chunk("MTrk", NOTE + NOTE + END));
+    File file;
+    Midi::Decoder().decode(bytes, file);
+
+    check(file.saveAsync(path).get().ok(), "file is saved in the background");
+
+    File loaded;
+    Midi::DecodeResult result = loaded.loadAsync(path).get();
+    std::ostringstream output;
+    check(result.status.ok() && result.tracks == 2 && (output << loaded, output.str() == std::string(bytes.begin(), bytes.end())),
+          "file is loaded in the background");
+
+    File missing;
+    check(missing.loadAsync(std::string(name) + "/missing.mid").get().status.code == Midi::ERROR_IO, "loading a missing file fails");
+
+    /* The callback gets the result of a recovering load. */
+    writeFile(broken, smf(2, chunk("MTrk", std::string("\x00\x90\x40\xC0", 4) + END) + chunk("MTrk", NOTE + END)));
+    Midi::DecodeOptions options;
+    options.skipCorruptTracks = true;
+
+    std::promise<Midi::DecodeResult> done;
+    File recovered;
+    recovered.loadAsync(broken, options, [&done](const Midi::DecodeResult& result) { done.set_value(result); });
+    result = done.get_future().get();
+    check(result.tracks == 1 && result.skipped == 1 && recovered.getTrackSlots() == 1, "file is recovered in the background");
+
+    unlink(broken.c_str());
+    unlink(path.c_str());
+    rmdir(name);
+}
+
+void streamWriterTest() {
+    const std::vector<uint8_t> bytes = smf(2, chunk("MTrk", std::string("\x00\xFF\x51\x03\x07\xA1\x20", 7) + END) + chunk("MTrk", NOTE + NOTE + END));
+    File file;
+    Midi::Decoder().decode(bytes, file);
+
+    /* A tiny block flushes the events before the lengths are known, so they have to be patched. */
+    std::stringstream stream;
+    {
+        Midi::StreamWriter writer(stream, Midi::MULTITRACK_SYNC, 96, 4);
+        check(!writer.write(*file.getTrack(0)->getEvents()[0]), "stream writer refuses events before a track");
+
+        check(writer.beginTrack(), "stream writer starts a track");
+        for (const Event *event : file.getTrack(0)->getEvents())
+            check(writer.write(*event), "stream writer writes an event");
+
+        check(!writer.write(*file.getTrack(1)->getEvents()[0]), "stream writer refuses events after the end of track");
+
+        /* The end of track of the second track is left out, so it has to be added. */
+        check(writer.beginTrack(), "stream writer starts another track");
+        const std::vector<Event*>& events = file.getTrack(1)->getEvents();
+        for (size_t i = 0; i + 1 < events.size(); i++)
+            check(writer.write(*events[i]), "stream writer writes an event");
+
+        check(writer.close() && writer.getTracks() == 2 && !writer.beginTrack(), "stream writer closes the file");
+    }
+    check(stream.str() == std::string(bytes.begin(), bytes.end()), "stream writer output equals the encoded file");
+
+    std::stringstream single;
+    Midi::StreamWriter writer(single, Midi::SINGLETRACK);
+    check(writer.beginTrack() && !writer.beginTrack(), "stream writer allows a single track in format 0");
+}
+
+void snapshotTest() {
+    const std::vector<uint8_t> bytes = smf(2, chunk("MTrk", std::string("\x00\xFF\x51\x03\x07\xA1\x20", 7) + END) + chunk("MTrk", NOTE + END));
+    File file;
+    Midi::Decoder().decode(bytes, file);
+
+    const Midi::Snapshot base(file);
+    Midi::SnapshotEditor editor(base);
+    addMessage(editor.editTrack(1), 0, MessageType::NOTE_OFF, 0, 0x40);
+    const Midi::Snapshot next = editor.commit();
+
+    check(next.getVersion() > base.getVersion(), "snapshot versions increase");
+    check(next.shareTrack(0) == base.shareTrack(0), "snapshot shares unchanged tracks");
+    check(next.getTrack(1) != base.getTrack(1) && next.getTrack(1)->getEvents().size() == 3, "snapshot copies an edited track");
+
+    std::ostringstream output;
+    output << base;
+    check(base.getTrack(1)->getEvents().size() == 2 && output.str() == std::string(bytes.begin(), bytes.end()), "snapshot is not changed by later edits");
+
+    /* Concurrent updates are all kept, even when they race. */
+    Midi::SharedFile shared(base);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.push_back(std::thread([&shared]() {
+            for (int j = 0; j < 50; j++)
+                shared.update([](Midi::SnapshotEditor& editor) { addMessage(editor.editTrack(0), 0, MessageType::PROGRAM_CHANGE, 0, 1); });
+        }));
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    check(shared.load().getTrack(0)->getEvents().size() == 202 && base.getTrack(0)->getEvents().size() == 2, "shared file keeps every update");
+}
+
+void statisticsTest() {
+    /* A quarter C and a half E on another channel, then a G without length at the end. */
+    const std::string events = std::string("\x00\x90\x3C\x64\x00\x91\x40\x50\x60\x80\x3C\x00\x60\x81\x40\x00\x00\x90\x43\x40\x00\x80\x43\x00", 24);
+    File file;
+    Midi::Decoder().decode(smf(1, chunk("MTrk", events + END)), file);
+
+    Midi::Statistics stats;
+    stats.add(file);
+    check(stats.files == 1 && stats.notes == 3 && stats.quarters == 2, "statistics count the notes and the length");
+    check(stats.pitchClasses[0] == 1 && stats.pitchClasses[4] == 1 && stats.pitchClasses[7] == 1, "statistics count pitch classes");
+    check(stats.velocities[100] == 1 && stats.velocities[80] == 1 && stats.velocities[64] == 1, "statistics count velocities");
+    check(stats.durations[0] == 1 && stats.durations[4] == 1 && stats.durations[5] == 1, "statistics count durations");
+    check(stats.channelNotes[0] == 2 && stats.channelNotes[1] == 1, "statistics count notes per channel");
+    check(stats.maxPolyphony == 2 && stats.polyphony[2] == 1 && stats.polyphony[1] == 1, "statistics measure polyphony");
+
+    Midi::Statistics total;
+    total.merge(stats);
+    total.merge(stats);
+    check(total.files == 2 && total.notes == 6 && total.maxPolyphony == 2 && total.getDensity() == 1.5, "statistics merge");
+}
+
+void rendererTest() {
+    /* Two overlapping notes of one and two quarters, so a second at the default tempo. */
+    const std::string events = std::string("\x00\x90\x3C\x64\x00\x91\x40\x50\x60\x80\x3C\x00\x60\x81\x40\x00", 16);
+    File file;
+    Midi::Decoder().decode(smf(1, chunk("MTrk", events + END)), file);
+
+    Midi::RenderOptions options;
+    options.sampleRate = 8000;
+    options.threads = 2;
+    options.sliceFrames = 1000;
+
+    std::vector<int16_t> samples;
+    Midi::RenderStats stats = Midi::Renderer(options).render(file, samples);
+    check(stats.status.ok() && stats.voices == 2 && stats.frames >= 8000 && samples.size() == 2 * stats.frames, "renderer renders every note");
+    check(stats.peak > 0 && *std::max_element(samples.begin(), samples.end()) > 0, "renderer output is not silent");
+
+    std::ostringstream wav;
+    check(Midi::Renderer::writeWav(wav, samples, options.sampleRate) && wav.str().size() == 44 + 2 * samples.size() && wav.str().compare(0, 4, "RIFF") == 0,
+          "renderer writes a wav file");
+
+    /* Audio longer than allowed is not rendered at all. */
+    options.maxSeconds = 0.5;
+    stats = Midi::Renderer(options).render(file, samples);
+    check(stats.status.code == Midi::ERROR_LIMIT_DURATION && samples.empty(), "renderer refuses audio that is too long");
+}
+
+void limitTest() {
+    /* The events of the track start at 22, 26 and 30. */
+    const std::vector<uint8_t> bytes = smf(1, chunk("MTrk", NOTE + NOTE + END));
+    File file;
+
+    Midi::DecodeOptions options;
+    options.maxBytes = bytes.size() - 1;
+    Midi::Status status = Midi::Decoder(options).decode(bytes, file).status;
+    check(status.code == Midi::ERROR_LIMIT_BYTES && status.offset == bytes.size() - 1, "limit on the size of the input");
+
+    std::istringstream input(std::string(bytes.begin(), bytes.end()));
+    check(Midi::Decoder(options).decode(input, file).status.code == Midi::ERROR_LIMIT_BYTES, "limit on the size of a stream");
+
+    options = Midi::DecodeOptions();
+    options.maxEventsPerTrack = 2;
+    status = Midi::Decoder(options).decode(bytes, file).status;
+    check(status.code == Midi::ERROR_LIMIT_EVENTS && status.offset == 30 && file.getTrackSlots() == 0, "limit on the events of a track");
+
+    /* The length of the text is at 25, after the delta time, status and type. */
+    options = Midi::DecodeOptions();
+    options.maxPayloadSize = 4;
+    status = Midi::Decoder(options).decode(smf(1, chunk("MTrk", std::string("\x00\xFF\x01\x05lyric", 9) + END)), file).status;
+    check(status.code == Midi::ERROR_LIMIT_PAYLOAD && status.offset == 25, "limit on the size of a payload");
+
+    std::string notes;
+    for (int i = 0; i < 100; i++)
+        notes += NOTE;
+
+    options = Midi::DecodeOptions();
+    options.maxMemory = 1024;
+    check(Midi::Decoder(options).decode(smf(1, chunk("MTrk", notes + END)), file).status.code == Midi::ERROR_LIMIT_MEMORY, "limit on the memory of a file");
+    check(Midi::Decoder(options).decode(bytes, file).status.ok(), "limits allow a file within them");
+}
+
+void encoderTest() {
+    /* Every kind of event, a message with a single data byte and the longest delta time. */
+    const std::string events = std::string("\x00\xFF\x51\x03\x07\xA1\x20\x00\xF0\x03\x43\x01\xF7\x00\xC0\x05\xFF\xFF\xFF\x7F\x90\x40\x40", 23);
+    const std::vector<uint8_t> bytes = smf(2, chunk("MTrk", events + END) + chunk("XFIH", "abc") + chunk("MTrk", NOTE + END));
+    File file;
+    Midi::Decoder().decode(bytes, file);
+
+    std::vector<uint8_t> buffer;
+    Midi::BufferSink sink(buffer);
+    check(Midi::Encoder<Midi::BufferSink>(sink).write(file) && buffer == bytes, "encoder writes the file into a buffer");
+    check(Midi::CountingSink::measure(file) == bytes.size(), "encoder counts the exact size of the file");
+
+    std::vector<uint8_t> raw(bytes.size());
+    Midi::RawSink position(raw.data());
+    Midi::Encoder<Midi::RawSink>(position).write(file);
+    check(position.position() == raw.data() + raw.size() && raw == bytes, "encoder writes the file into raw memory");
+
+    /* The events of the first track take 27 bytes, and every event knows its own length. */
+    const Track *track = file.getTrack(0);
+    uint64_t length = 0;
+    for (const Event *event : track->getEvents()) {
+        check(event->getLength() == Midi::CountingSink::measure(*event), "encoder counts the exact size of an event");
+        length += event->getLength();
+    }
+    check(length == 27 && track->getLength() == length, "encoder counts the exact length of a track");
+}
+
+void stateIndexTest() {
+    using Midi::SongState;
+    using Midi::ChannelState;
+
+    /* Tempos at 0 and 25, and programs, a volume and a bend spread over the checkpoints. */
+    const std::string tempos = std::string("\x00\xFF\x51\x03\x07\xA1\x20\x19\xFF\x51\x03\x06\x1A\x80", 14);
+    const std::string changes = std::string("\x00\xC0\x05\x05\xB0\x07\x64\x0A\xC0\x09\x05\xE1\x00\x50\x0F\xB0\x07\x32", 18);
+    File file;
+    Midi::Decoder().decode(smf(2, chunk("MTrk", tempos + END) + chunk("MTrk", changes + END)), file);
+
+    const Midi::StateIndex index(file, 10), full(file, 1 << 30);
+    check(index.getInterval() == 10 && index.getCheckpoints() > 1 && full.getCheckpoints() == 1, "state index places checkpoints");
+
+    SongState state = index.stateAt(0);
+    check(state.tempo == 0 && state.channels[0].program == ChannelState::UNSET, "state index starts unset");
+
+    state = index.stateAt(15);
+    check(state.tempo == 500000 && state.channels[0].program == 5 && state.channels[0].controllers[7] == 100, "state index replays before a tick");
+
+    state = index.stateAt(26);
+    check(state.tempo == 400000 && state.channels[0].program == 9 && state.channels[1].bendLow == 0 && state.channels[1].bendHigh == 0x50,
+          "state index replays after a checkpoint");
+
+    /* Starting from any checkpoint gives exactly the state of replaying everything. */
+    bool same = true;
+    for (uint32_t tick = 0; tick < 50; tick++) {
+        const SongState a = index.stateAt(tick), b = full.stateAt(tick);
+        same = same && memcmp(&a, &b, sizeof(SongState)) == 0;
+    }
+    check(same, "state index checkpoints equal a full replay");
+
+    File range;
+    check(index.extract(file, 16, 30, range), "state index extracts a range");
+
+    state = Midi::StateIndex(range).stateAt(1);
+    check(state.tempo == 500000 && state.channels[0].program == 9 && state.channels[0].controllers[7] == 100, "state index chases the state of a range");
+}
+
+/**
+ * Function to build the events of a melody, with notes following each other.
+ * @param first  The pitch of the first note.
+ * @param step   The interval to the pitch of the next note.
+ * @param length The length of every note in ticks, below 128.
+ * @return std::string The bytes of the events, without the end of track.
+ */
+static std::string melody(int first, int step, char length) {
+    std::string events;
+    for (int i = 0; i < 24; i++) {
+        const char pitch = first + (i * step) % 24;
+        events += std::string("\x00\x90", 2) + pitch + '\x40' + length + '\x80' + pitch + '\x00';
+    }
+    return events;
+}
+
+void fingerprintTest() {
+    using Midi::Fingerprint;
+    using Midi::Sketch;
+
+    const std::string lead = chunk("MTrk", std::string("\x00\xFF\x03\x04" "lead", 8) + melody(60, 5, 0x10) + END);
+    const std::string bass = chunk("MTrk", std::string("\x00\xFF\x03\x04" "bass", 8) + melody(36, 7, 0x10) + END);
+    File original, reordered, varied, other;
+    Midi::Decoder().decode(smf(2, lead + bass), original);
+
+    /* Swapped tracks with other names and twice the resolution are the same content. */
+    std::vector<uint8_t> bytes = smf(2, chunk("MTrk", std::string("\x00\xFF\x03\x04" "Bass", 8) + melody(36, 7, 0x20) + END) +
+                                        chunk("MTrk", std::string("\x00\xFF\x03\x04" "Lead", 8) + melody(60, 5, 0x20) + END));
+    bytes[13] = 192;
+    Midi::Decoder().decode(bytes, reordered);
+
+    /* A single pitch that differs, and a completely different piece. */
+    bytes = smf(2, lead + bass);
+    bytes[bytes.size() - 18] = bytes[bytes.size() - 14] = 0x30;
+    Midi::Decoder().decode(bytes, varied);
+    Midi::Decoder().decode(smf(1, chunk("MTrk", melody(40, 11, 0x10) + END)), other);
+
+    check(Fingerprint::of(original) != 0 && Fingerprint::of(original) == Fingerprint::of(reordered), "fingerprint ignores order, names and resolution");
+    check(Fingerprint::of(*original.getTrack(0), 96) == Fingerprint::of(*reordered.getTrack(1), 192), "fingerprint of a track ignores its resolution");
+    check(Fingerprint::of(original) != Fingerprint::of(varied) && Fingerprint::of(original) != Fingerprint::of(other), "fingerprint changes with the content");
+
+    const Sketch sketch(original);
+    check(!sketch.empty() && Sketch().empty() && sketch.similarity(Sketch(reordered)) == 1, "sketch of the same content is identical");
+    check(sketch.similarity(Sketch(varied)) > 0.5 && sketch.similarity(Sketch(varied)) < 1, "sketch of nearly the same content is similar");
+    check(sketch.similarity(Sketch(other)) < 0.2, "sketch of other content is not similar");
+}
+
+void internTest() {
+    Midi::InternPool pool;
+    const uint8_t bytes[] = "Copyright of the whole catalog";
+    Midi::Payload first = pool.intern(bytes, sizeof(bytes)), second = pool.intern(Midi::Payload(bytes, sizeof(bytes)));
+    check(first.data() == second.data() && first.data() != bytes && pool.getHits() == 1 && pool.getMisses() == 1, "pool keeps a single copy");
+
+    /* The same copyright in two files decoded with the pool. */
+    const std::string copyright = std::string("\x00\xFF\x02", 3) + char(sizeof(bytes)) + std::string(reinterpret_cast<const char*>(bytes), sizeof(bytes));
+    const std::vector<uint8_t> data = smf(1, chunk("MTrk", copyright + NOTE + END));
+
+    Midi::DecodeOptions options;
+    options.pool = &pool;
+
+    File plain;
+    Midi::Decoder().decode(data, plain);
+    {
+        File one, two;
+        Midi::Decoder(options).decode(data, one);
+        Midi::Decoder(options).decode(data, two);
+
+        const Meta *a = static_cast<const Meta*>(one.getTrack(0)->getEvents()[0]);
+        const Meta *b = static_cast<const Meta*>(two.getTrack(0)->getEvents()[0]);
+        check(a->getData().data() == first.data() && b->getData().data() == first.data(), "pool is shared by decoded files");
+
+        const Midi::MemoryUsage unique = plain.memoryUsage(), shared = one.memoryUsage();
+        check(unique.shared == 0 && unique.payloads >= sizeof(bytes) && shared.shared >= sizeof(bytes) && shared.payloads < unique.payloads,
+              "memory usage tells shared payloads apart");
+    }
+
+    /* Once nothing uses the copy anymore, it can be forgotten. */
+    const size_t size = pool.size();
+    check(pool.purge() == 0 && pool.size() == size, "pool keeps copies that are used");
+    first = second = Midi::Payload();
+    check(pool.purge() == 1 && pool.size() == size - 1, "pool forgets copies that are not used");
+}
+
+void wireTest() {
+    using Midi::WireEvent;
+
+    /* A stray data byte, a clock inside a note, running status, and a sysex message longer than a chunk. */
+    const uint8_t input[] = { 0x40, 0x90, 0x3C, 0xF8, 0x64, 0x3E, 0x50, 0xC1, 0x05, 0xFA, 0xF0, 0x43, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0xF7 };
+    std::vector<WireEvent> events;
+    Midi::WireParser parser;
+    parser.push(input, sizeof(input), [&events](const WireEvent& event) { events.push_back(event); });
+
+    check(parser.getDropped() == 1 && events.size() == 7, "wire parser finds every event");
+    if (events.size() != 7)
+        return;
+
+    check(events[0].isRealtime() && events[0].status == 0xF8, "wire parser passes real-time bytes inside a message");
+    check(events[1].status == 0x90 && events[1].size == 2 && events[1].data[0] == 0x3C && events[1].data[1] == 0x64, "wire parser completes the interrupted message");
+    check(events[2].status == 0x90 && events[2].data[0] == 0x3E && events[2].data[1] == 0x50, "wire parser applies running status");
+    check(events[3].getType() == MessageType::PROGRAM_CHANGE && events[3].getChannel() == 1 && events[3].size == 1, "wire parser knows messages with one data byte");
+    check(events[4].status == 0xFA, "wire parser passes real-time bytes between messages");
+    check(events[5].status == 0xF0 && events[5].size == WireEvent::CHUNK_SIZE && events[6].status == 0xF7 && events[6].size == 2, "wire parser splits sysex in chunks");
+
+    const Message msg = events[2].toMessage();
+    check(msg.getType() == MessageType::NOTE_ON && msg.getData1() == 0x3E && WireEvent::from(msg).status == 0x90, "wire events convert to messages");
+
+    /* Encoding the events again gives the input without the stray byte, with the clock first. */
+    std::vector<uint8_t> output;
+    Midi::BufferSink sink(output);
+    Midi::WireEncoder<Midi::BufferSink> encoder(sink);
+    for (const WireEvent& event : events)
+        encoder.write(event);
+
+    const uint8_t expected[] = { 0xF8, 0x90, 0x3C, 0x64, 0x3E, 0x50, 0xC1, 0x05, 0xFA, 0xF0, 0x43, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0xF7 };
+    check(output == std::vector<uint8_t>(expected, expected + sizeof(expected)), "wire encoder uses running status");
+}
+
+/**
+ * Function to write a raw file into a string.
+ * @param file The raw file.
+ * @return std::string The bytes, empty if writing failed.
+ */
+static std::string bytesOf(const Midi::RawFile& file) {
+    std::ostringstream output;
+    return file.write(output).ok() ? output.str() : std::string();
+}
+
+/**
+ * Function to get a file as a string.
+ * @param bytes The bytes of the file.
+ * @return std::string The same bytes.
+ */
+static std::string bytesOf(const std::vector<uint8_t>& bytes) {
+    return std::string(bytes.begin(), bytes.end());
+}
+
+void rawFileTest() {
+    using Midi::RawFile;
+
+    const std::string first = chunk("MTrk", NOTE + END), second = chunk("MTrk", NOTE + NOTE + END), third = chunk("MTrk", END), unknown = chunk("XFIH", "abc");
+    const std::vector<uint8_t> bytes = smf(2, first + unknown + second + chunk("XTRA", "z"));
+
+    RawFile file;
+    check(file.read(std::make_shared<const std::vector<uint8_t>>(bytes)).ok() && file.getTrackCount() == 2, "raw file reads the chunks");
+    check(bytesOf(file) == bytesOf(bytes), "raw file writes the same bytes, trailing chunk included");
+
+    /* The unknown chunk stays in front of the second track. */
+    check(file.reorder({ 1, 0 }) && bytesOf(file) == bytesOf(smf(2, second + unknown + first + chunk("XTRA", "z"))), "raw file reorders tracks");
+    check(!file.reorder({ 2 }) && file.getTrackCount() == 2, "raw file refuses an order out of range");
+
+    RawFile target, source;
+    target.read(std::make_shared<const std::vector<uint8_t>>(smf(2, first + second)));
+    source.read(std::make_shared<const std::vector<uint8_t>>(smf(1, third)));
+    check(target.splice(source, 0, RawFile::END, 1) && bytesOf(target) == bytesOf(smf(3, first + third + second)), "raw file splices tracks in between");
+    check(target.splice(target, 0, 1) && bytesOf(target) == bytesOf(smf(4, first + third + second + first)), "raw file splices its own tracks");
+    check(target.removeTrack(1) && bytesOf(target) == bytesOf(smf(3, first + second + first)), "raw file removes a track");
+
+    /* A decoded track is encoded into a chunk of the same bytes. */
+    File decoded;
+    Midi::Decoder().decode(smf(1, second), decoded);
+    check(target.addTrack(*decoded.getTrack(0), 0) && bytesOf(target) == bytesOf(smf(4, second + first + second + first)), "raw file adds a decoded track");
+
+    std::vector<uint8_t> other = smf(1, third);
+    other[13] = 192;
+    source.read(std::make_shared<const std::vector<uint8_t>>(other));
+    check(!target.splice(source) && target.getTrackCount() == 4, "raw file refuses tracks of another division");
+}
+
+void trackBuilderTest() {
+    using Midi::TrackBuilder;
+
+    /* Events added out of order, with ties on tick 96 and a tick that needs every radix pass. */
+    TrackBuilder builder;
+    builder.add(300, Message(MessageType::NOTE_ON, 0, 0x40, 0x64));
+    builder.add(70000, Message(MessageType::NOTE_OFF, 0, 0x40, 0));
+    builder.addNote(96, 96, 0, 0x3E, 0x64);
+    builder.add(96, Message(MessageType::PROGRAM_CHANGE, 0, 1, 0));
+    builder.add(96, Message(MessageType::CONTROLLER, 0, 7, 0x7F), 0);
+    builder.add(96, Meta::tempo(500000));
+    builder.add(96, Message(MessageType::CONTROLLER, 0, 1, 1));
+    builder.addNote(0, 96, 0, 0x3C, 0x64);
+    builder.add(96, Message(MessageType::CONTROLLER, 0, 1, 2));
+    check(builder.size() == 11, "track builder keeps every event");
+
+    Track track;
+    builder.build(track);
+    check(builder.size() == 0, "track builder is empty after building");
+
+    /* On tick 96 the explicit priority ties with the tempo, the note off goes before the other
+     * messages, which keep the order they were added in, and the note on goes last.
+     */
+    std::ostringstream output;
+    for (const Event *event : track.getEvents())
+        output << *event;
+
+    const std::string expected = std::string("\x00\x90\x3C\x64\x60\xB0\x07\x7F\x00\xFF\x51\x03\x07\xA1\x20\x00\x80\x3C\x00\x00\xC0\x01", 22) +
+                                 std::string("\x00\xB0\x01\x01\x00\xB0\x01\x02\x00\x90\x3E\x64\x60\x80\x3E\x00\x6C\x90\x40\x64\x84\xA0\x44\x80\x40\x00", 26) + END;
+    check(output.str() == expected, "track builder sorts on tick and priority, keeping ties in order");
+
+    /* Notes added by several threads at once all end up in the track. */
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.push_back(std::thread([&builder, i]() {
+            for (int j = 0; j < 100; j++)
+                builder.addNote(j * 10, 5, i, 0x3C, 0x64);
+        }));
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    Track parallel;
+    builder.build(parallel, 2000);
+
+    uint32_t tick = 0;
+    for (const Event *event : parallel.getEvents())
+        tick += event->deltaTime.getValue();
+    check(parallel.getEvents().size() == 801 && tick == 2000, "track builder takes events from several threads");
+}
+
+void traceTest() {
+    using Midi::Trace;
+
+    Trace::clear();
+    Trace::start();
+    Trace::record("read", 1000, 3500, 100);
+    {
+        Midi::TraceSpan span("quote\"d", 0);
+    }
+    Trace::stop();
+    {
+        Midi::TraceSpan span("ignored", 0);
+    }
+    check(Trace::size() == 2, "trace records spans only while started");
+
+    /* Times are in microseconds from the first span. */
+    std::ostringstream output;
+    check(Trace::write(output).ok(), "trace is written");
+
+    const std::string json = output.str();
+    check(json.compare(0, 16, "{\"traceEvents\":[") == 0 &&
+          json.find("{\"name\":\"read\",\"cat\":\"cppmidi\",\"ph\":\"X\",\"ts\":0.000,\"dur\":2.500,") != std::string::npos &&
+          json.find("\"args\":{\"bytes\":100}") != std::string::npos, "trace is written as a Chrome trace");
+    check(json.find("\"name\":\"quote\\\"d\"") != std::string::npos && json.find("ignored") == std::string::npos, "trace escapes names");
+
+    Trace::clear();
+    check(Trace::size() == 0, "trace is cleared");
+}
+
 int main(__attribute__ ((unused)) int argc, __attribute__ ((unused)) char* argv[]) {
     /* First we will perform the writing test, which will create a simple MIDI. */
     writeTest();
 
     /* Then we will perform a reading test, which will open the created midi and rewrite it to a new file. */
     readTest();
+
+    noteIndexTest();
+    eventIndexTest();
+    validatorTest();
+    decoderTest();
+    sysexTest();
+    metaTest();
+    batchTest();
+    cacheTest();
+    archiveTest();
+    convertTest();
+    writerTest();
+    asyncTest();
+    streamWriterTest();
+    snapshotTest();
+    statisticsTest();
+    rendererTest();
+    limitTest();
+    encoderTest();
+    stateIndexTest();
+    fingerprintTest();
+    internTest();
+    wireTest();
+    rawFileTest();
+    trackBuilderTest();
+    traceTest();
+
+    return failures > 0 ? 1 : 0;
 }